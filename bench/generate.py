@@ -0,0 +1,161 @@
+#!/usr/bin/env python3
+
+"""
+Generates synthetic C90 programs for compile-time benchmarking. Every program
+only uses features the compiler supports, and its size grows linearly with
+--scale so the runner can check how each phase scales.
+
+Usage: generate.py [-h] [--scale N] [--seed S] KIND OUTPUT
+
+KIND is one of: functions, expressions, switch, globals, strings
+"""
+
+
+import argparse
+import random
+import sys
+
+
+def gen_functions(scale, rng):
+    """Many small functions with locals, loops, branches and calls."""
+    lines = []
+    count = 50 * scale
+    for i in range(count):
+        lines.append(f"int f{i}(int a, int b)")
+        lines.append("{")
+        lines.append("    int i;")
+        lines.append("    int acc;")
+        lines.append(f"    acc = a * {rng.randint(1, 9)} + b;")
+        lines.append(f"    for (i = 0; i < {rng.randint(2, 20)}; i++)")
+        lines.append("    {")
+        lines.append(f"        if (acc > {rng.randint(100, 999)})")
+        lines.append("        {")
+        lines.append(f"            acc = acc - {rng.randint(1, 99)};")
+        lines.append("        }")
+        lines.append("        else")
+        lines.append("        {")
+        lines.append(f"            acc = acc + i * {rng.randint(1, 9)};")
+        lines.append("        }")
+        lines.append("    }")
+        if i > 0:
+            lines.append(f"    acc = acc + f{rng.randrange(i)}(b, acc);")
+        lines.append("    return acc;")
+        lines.append("}")
+        lines.append("")
+    return lines
+
+
+# codegen keeps both operand registers live while compiling the left operand,
+# so expression trees deeper than this run out of temporaries
+MAX_EXPR_DEPTH = 6
+
+
+def nested_expr(depth, rng):
+    expr = "a"
+    for _ in range(depth):
+        op = rng.choice(["+", "-", "*", "&", "|", "^"])
+        operand = rng.choice(["a", "b", str(rng.randint(1, 99))])
+        # redundant parentheses nest the grammar without growing the tree
+        parens = rng.randint(1, 8)
+        expr = f"({expr} {op} {'(' * parens}{operand}{')' * parens})"
+    return expr
+
+
+def gen_expressions(scale, rng):
+    """Functions full of parenthesised expressions inside deeply nested blocks."""
+    lines = []
+    for i in range(10 * scale):
+        lines.append(f"int e{i}(int a, int b)")
+        lines.append("{")
+        lines.append("    int x;")
+        lines.append("    x = 0;")
+        depth = 16
+        for level in range(depth):
+            indent = "    " * (level + 1)
+            lines.append(f"{indent}if (a != {rng.randint(1, 99)})")
+            lines.append(f"{indent}{{")
+            lines.append(f"{indent}    x = x + {nested_expr(MAX_EXPR_DEPTH - 1, rng)};")
+        for level in reversed(range(depth)):
+            lines.append("    " * (level + 1) + "}")
+        lines.append("    return x;")
+        lines.append("}")
+        lines.append("")
+    return lines
+
+
+def gen_switch(scale, rng):
+    """One function holding a huge switch statement."""
+    lines = ["int dispatch(int x)", "{", "    int r;", "    r = 0;", "    switch (x)", "    {"]
+    value = 0
+    for i in range(200 * scale):
+        value += rng.randint(1, 3)  # sparse but distinct case values
+        lines.append(f"    case {value}:")
+        lines.append(f"        r = x + {rng.randint(0, 999)};")
+        lines.append("        break;")
+    lines += ["    default:", "        r = -1;", "    }", "    return r;", "}", ""]
+    return lines
+
+
+def gen_globals(scale, rng):
+    """Thousands of globals, all referenced from a few functions."""
+    count = 1000 * scale
+    lines = [f"int g{i};" for i in range(count)]
+    lines.append("")
+    for f in range(4):
+        lines.append(f"int sum{f}(void)")
+        lines.append("{")
+        lines.append("    int s;")
+        lines.append("    s = 0;")
+        for i in range(f, count, 4):
+            lines.append(f"    s = s + g{i};")
+        lines.append("    return s;")
+        lines.append("}")
+        lines.append("")
+    return lines
+
+
+def gen_strings(scale, rng):
+    """A long table of distinct string literals returned from a switch."""
+    words = ["alpha", "beta", "gamma", "delta", "epsilon", "zeta", "eta", "theta"]
+    lines = ["char *name(int i)", "{", "    switch (i)", "    {"]
+    for i in range(300 * scale):
+        text = " ".join(rng.choice(words) for _ in range(rng.randint(2, 6)))
+        lines.append(f"    case {i}:")
+        lines.append(f"        return \"{text} {i}\";")
+    lines += ["    }", "    return \"\";", "}", ""]
+    return lines
+
+
+GENERATORS = {
+    "functions": gen_functions,
+    "expressions": gen_expressions,
+    "switch": gen_switch,
+    "globals": gen_globals,
+    "strings": gen_strings,
+}
+
+
+def generate(kind, scale, seed=0):
+    """Returns the source text of a benchmark program."""
+    rng = random.Random(f"{kind}-{seed}")
+    return "\n".join(GENERATORS[kind](scale, rng)) + "\n"
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Generate a synthetic C90 benchmark program.")
+    parser.add_argument("kind", choices=sorted(GENERATORS))
+    parser.add_argument("output", help="path of the C file to write, - for stdout")
+    parser.add_argument("--scale", type=int, default=1, help="size multiplier (default: 1)")
+    parser.add_argument("--seed", type=int, default=0)
+    args = parser.parse_args()
+
+    source = generate(args.kind, args.scale, args.seed)
+    if args.output == "-":
+        sys.stdout.write(source)
+    else:
+        with open(args.output, "w") as f:
+            f.write(source)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,115 @@
+#!/usr/bin/env python3
+
+"""
+Times bin/c_compiler over the generated benchmark programs at increasing
+scales. For every program it reports lines/sec, peak RSS and the time of each
+compiler phase (from -ftime-report), plus how each phase grows between
+successive scales. A growth exponent well above 1 means superlinear behaviour.
+
+Usage: run.py [-h] [--compiler PATH] [--scales 1,4,16] [--kinds K,...] [--json FILE]
+
+Example usage: bench/run.py --scales 1,4,16 --kinds globals,switch
+"""
+
+
+import argparse
+import json
+import math
+import subprocess
+import sys
+from pathlib import Path
+
+from generate import GENERATORS, generate
+
+
+SCRIPT_LOCATION = Path(__file__).resolve().parent
+PROJECT_LOCATION = SCRIPT_LOCATION.joinpath("..").resolve()
+COMPILER_FILE = PROJECT_LOCATION.joinpath("bin/c_compiler")
+OUTPUT_FOLDER = PROJECT_LOCATION.joinpath("bin/bench")
+
+# growth exponents above this are flagged as superlinear
+SUPERLINEAR_THRESHOLD = 1.3
+# phases shorter than this are too noisy to compute a growth exponent for
+MIN_PHASE_MS = 5.0
+
+
+def run_one(compiler, kind, scale):
+    """Compiles one generated program, returns its report as a dict."""
+    source = OUTPUT_FOLDER.joinpath(f"{kind}_{scale}.c")
+    source.write_text(generate(kind, scale))
+    lines = source.read_text().count("\n")
+    result = subprocess.run(
+        [str(compiler), "-S", str(source), "-o", str(source.with_suffix(".s")), "-ftime-report", "-fmem-report"],
+        stdout=subprocess.DEVNULL,
+        stderr=subprocess.PIPE,
+        text=True,
+    )
+    if result.returncode != 0:
+        return {"kind": kind, "scale": scale, "lines": lines, "error": result.stderr.strip().splitlines()[-1:]}
+    report = json.loads(result.stderr.strip().splitlines()[-1])
+    total_ms = report["total"]["wall_ms"]
+    return {
+        "kind": kind,
+        "scale": scale,
+        "lines": lines,
+        "lines_per_sec": lines / (total_ms / 1e3) if total_ms > 0 else float("inf"),
+        "peak_rss_kib": report["memory"]["peak_rss_kib"],
+        "phases": {name: phase["wall_ms"] for name, phase in report["phases"].items()},
+        "total_ms": total_ms,
+    }
+
+
+def growth(prev, curr, key):
+    """Exponent k such that time grows like lines^k between two runs."""
+    if key == "total":
+        a, b = prev["total_ms"], curr["total_ms"]
+    else:
+        a, b = prev["phases"][key], curr["phases"][key]
+    if a < MIN_PHASE_MS or b < MIN_PHASE_MS or curr["lines"] == prev["lines"]:
+        return None
+    return math.log(b / a) / math.log(curr["lines"] / prev["lines"])
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Compile-time benchmark for bin/c_compiler.")
+    parser.add_argument("--compiler", type=Path, default=COMPILER_FILE)
+    parser.add_argument("--scales", default="1,4,16", help="comma separated scale factors")
+    parser.add_argument("--kinds", default=",".join(GENERATORS), help="comma separated program kinds")
+    parser.add_argument("--json", type=Path, help="also write every result to this file")
+    args = parser.parse_args()
+
+    OUTPUT_FOLDER.mkdir(parents=True, exist_ok=True)
+    scales = [int(s) for s in args.scales.split(",")]
+    results = []
+    flagged = []
+    for kind in args.kinds.split(","):
+        print(f"{kind}")
+        print(f"  {'scale':>5} {'lines':>8} {'lines/s':>10} {'rss KiB':>9} {'total ms':>9}  phase ms (growth)")
+        prev = None
+        for scale in scales:
+            res = run_one(args.compiler, kind, scale)
+            results.append(res)
+            if "error" in res:
+                print(f"  {scale:>5} {res['lines']:>8}  failed: {' '.join(res['error'])}")
+                prev = None
+                continue
+            phases = []
+            for name, ms in res["phases"].items():
+                k = growth(prev, res, name) if prev else None
+                phases.append(f"{name} {ms:.1f}" + (f" ({k:.2f})" if k is not None else ""))
+                if k is not None and k > SUPERLINEAR_THRESHOLD:
+                    flagged.append(f"{kind}: {name} grows like n^{k:.2f} from scale {prev['scale']} to {scale}")
+            print(f"  {scale:>5} {res['lines']:>8} {res['lines_per_sec']:>10.0f} {res['peak_rss_kib']:>9} {res['total_ms']:>9.1f}  {', '.join(phases)}")
+            prev = res
+
+    if flagged:
+        print("\nSuperlinear phases:")
+        for line in flagged:
+            print(f"  {line}")
+    if args.json:
+        args.json.write_text(json.dumps(results, indent=1))
+    return 1 if any("error" in r for r in results) else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,53 @@
+int sumForward(int *a, int n)
+{
+    int i;
+    int s;
+    s = 0;
+    for (i = 0; i < n; i++)
+    {
+        s = s + a[i];
+    }
+    return s;
+}
+
+int weighReverse(int *a, int n)
+{
+    int i;
+    int s;
+    s = 0;
+    for (i = 0; i < n; i++)
+    {
+        s = s * 2 + a[n - 1 - i];
+    }
+    return s;
+}
+
+void fillInclusive(int *a, int n)
+{
+    int i;
+    for (i = 0; i <= n; i++)
+    {
+        a[i] = 3;
+    }
+}
+
+int findFirst(int *a, int n, int x)
+{
+    int i;
+    for (i = 0; i < n; i++)
+    {
+        if (a[i] == x)
+            break;
+    }
+    return i;
+}
+
+int copyCount(int *to, int *from, int n)
+{
+    int i;
+    for (i = 0; i < n; i++)
+    {
+        to[i] = from[i] + 1;
+    }
+    return i;
+}
@@ -0,0 +1,37 @@
+int sumForward(int *a, int n);
+int weighReverse(int *a, int n);
+void fillInclusive(int *a, int n);
+int findFirst(int *a, int n, int x);
+int copyCount(int *to, int *from, int n);
+
+int main()
+{
+    int a[8];
+    int b[8];
+    int i;
+    for (i = 0; i < 8; i++)
+    {
+        a[i] = i + 1;
+        b[i] = 0;
+    }
+    if (sumForward(a, 8) != 36 || sumForward(a, 3) != 6)
+        return 1;
+    if (sumForward(a, 0) != 0 || sumForward(a, -4) != 0)
+        return 2;
+    if (weighReverse(a, 3) != 17 || weighReverse(a, 1) != 1 || weighReverse(a, 0) != 0 || weighReverse(a, -1) != 0)
+        return 3;
+    fillInclusive(b, 4);
+    if (b[0] != 3 || b[4] != 3 || b[5] != 0)
+        return 4;
+    fillInclusive(b + 6, -1);
+    fillInclusive(b + 6, 0);
+    if (b[5] != 0 || b[6] != 3 || b[7] != 0)
+        return 5;
+    if (findFirst(a, 8, 5) != 4 || findFirst(a, 8, 9) != 8 || findFirst(a, 0, 1) != 0 || findFirst(a, -2, 1) != 0)
+        return 6;
+    if (copyCount(b, a, 8) != 8 || b[0] != 2 || b[7] != 9)
+        return 7;
+    if (copyCount(b, a, -3) != 0 || copyCount(b, a, 0) != 0 || b[0] != 2)
+        return 8;
+    return 0;
+}
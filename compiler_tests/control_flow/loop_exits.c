@@ -0,0 +1,75 @@
+int forOdd(int n)
+{
+    int i;
+    int s;
+    s = 0;
+    for (i = 0; i < n; i++)
+    {
+        if (i % 2 == 0)
+            continue;
+        if (i > 10)
+            break;
+        s = s + i;
+    }
+    return s * 100 + i;
+}
+
+int whileSkip(int n)
+{
+    int i;
+    int s;
+    i = 0;
+    s = 0;
+    while (i < n)
+    {
+        i++;
+        if (i == 3)
+            continue;
+        if (s > 20)
+            break;
+        s = s + i;
+    }
+    return s * 100 + i;
+}
+
+int doSkip(int n)
+{
+    int i;
+    int s;
+    i = 0;
+    s = 0;
+    do
+    {
+        i++;
+        if (i % 3 == 0)
+            continue;
+        if (i > n)
+            break;
+        s = s + i;
+    } while (i < n);
+    return s * 100 + i;
+}
+
+int nestedBreak(int n)
+{
+    int i;
+    int j;
+    int s;
+    s = 0;
+    for (i = 0; i < n; i++)
+    {
+        j = 0;
+        while (1)
+        {
+            if (j >= i)
+                break;
+            j++;
+            if (j == 2)
+                continue;
+            s++;
+        }
+        if (s > 8)
+            break;
+    }
+    return s * 100 + i;
+}
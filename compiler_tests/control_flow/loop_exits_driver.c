@@ -0,0 +1,23 @@
+int forOdd(int n);
+int whileSkip(int n);
+int doSkip(int n);
+int nestedBreak(int n);
+
+int main()
+{
+    if (forOdd(0) != 0 || forOdd(-5) != 0)
+        return 1;
+    if (forOdd(1) != 1 || forOdd(6) != 906 || forOdd(20) != 2511)
+        return 2;
+    if (whileSkip(0) != 0 || whileSkip(-1) != 0)
+        return 3;
+    if (whileSkip(5) != 1205 || whileSkip(20) != 2508)
+        return 4;
+    if (doSkip(0) != 1 || doSkip(-3) != 1)
+        return 5;
+    if (doSkip(5) != 1205 || doSkip(6) != 1206)
+        return 6;
+    if (nestedBreak(0) != 0 || nestedBreak(3) != 203 || nestedBreak(10) != 1105)
+        return 7;
+    return 0;
+}
@@ -0,0 +1,55 @@
+int calls;
+
+int bump(int v)
+{
+    calls = calls + 1;
+    return v;
+}
+
+int andSkips(int a)
+{
+    calls = 0;
+    if (a && bump(1))
+    {
+        return calls;
+    }
+    return 10 + calls;
+}
+
+int orSkips(int a)
+{
+    calls = 0;
+    if (a || bump(0))
+    {
+        return calls;
+    }
+    return 10 + calls;
+}
+
+int chained(int a, int b)
+{
+    int r;
+    calls = 0;
+    r = (a && bump(b)) || bump(2);
+    return r * 100 + calls;
+}
+
+int notAnd(int a)
+{
+    calls = 0;
+    return !(a && bump(1)) * 10 + calls;
+}
+
+int valueAt(int *p)
+{
+    if (p && *p)
+    {
+        return *p;
+    }
+    return -1;
+}
+
+int valueOr(int *p, int fallback)
+{
+    return (!p || *p == 0) ? fallback : *p;
+}
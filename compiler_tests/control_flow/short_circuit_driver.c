@@ -0,0 +1,29 @@
+int andSkips(int a);
+int orSkips(int a);
+int chained(int a, int b);
+int notAnd(int a);
+int valueAt(int *p);
+int valueOr(int *p, int fallback);
+
+int main()
+{
+    int x;
+    if (andSkips(0) != 10 || andSkips(1) != 1)
+        return 1;
+    if (orSkips(1) != 0 || orSkips(0) != 11)
+        return 2;
+    if (chained(0, 1) != 101 || chained(1, 1) != 101 || chained(1, 0) != 102)
+        return 3;
+    if (notAnd(0) != 10 || notAnd(1) != 1)
+        return 4;
+    x = 5;
+    if (valueAt(0) != -1 || valueAt(&x) != 5)
+        return 5;
+    x = 0;
+    if (valueAt(&x) != -1 || valueOr(0, 7) != 7 || valueOr(&x, 8) != 8)
+        return 6;
+    x = 9;
+    if (valueOr(&x, 8) != 9)
+        return 7;
+    return 0;
+}
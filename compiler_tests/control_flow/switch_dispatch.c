@@ -0,0 +1,138 @@
+int dense(int x)
+{
+    int r;
+    r = 0;
+    switch (x)
+    {
+    case 10:
+        r = 1;
+        break;
+    case 11:
+        r = 2;
+    case 12:
+        r = r + 10;
+        break;
+    case 13:
+        return 13;
+    case 14:
+        r = 14;
+        break;
+    case 16:
+        r = 16;
+        break;
+    case 17:
+    case 18:
+        r = 18;
+        break;
+    case 19:
+        r = 19;
+        break;
+    default:
+        r = -1;
+    }
+    return r;
+}
+
+int denseNoDefault(int x)
+{
+    int r;
+    r = 100;
+    switch (x)
+    {
+    case -3:
+        r = 3;
+        break;
+    case -2:
+        r = 2;
+        break;
+    case -1:
+        r = 1;
+    case 0:
+        r = r + 5;
+        break;
+    case 1:
+        r = 7;
+        break;
+    case 2:
+        r = 8;
+        break;
+    case 3:
+        r = 9;
+        break;
+    case 4:
+        r = 10;
+        break;
+    }
+    return r;
+}
+
+int sparse(int x)
+{
+    switch (x)
+    {
+    case -2147483647 - 1:
+        return 1;
+    case -1000:
+        return 2;
+    case -1:
+        return 3;
+    case 7:
+    case 100:
+        return 4;
+    case 5000:
+        return 5;
+    case 2147483647:
+        return 6;
+    default:
+        return 0;
+    }
+}
+
+int sparseNoDefault(int x)
+{
+    int r;
+    r = 0;
+    switch (x)
+    {
+    case -2147483647 - 1:
+        r = 1;
+    case 0:
+        r = r + 2;
+        break;
+    case 65536:
+        r = 3;
+        break;
+    case 2147483647:
+        r = 4;
+        break;
+    }
+    return r;
+}
+
+int mixed(int x)
+{
+    switch (x)
+    {
+    case -2147483647 - 1:
+        return -100;
+    case 0:
+        return 0;
+    case 1:
+        return 1;
+    case 2:
+        return 2;
+    case 3:
+        return 3;
+    case 4:
+        return 4;
+    case 5:
+        return 5;
+    case 6:
+        return 6;
+    case 7:
+        return 7;
+    case 2147483647:
+        return 100;
+    }
+    return -1;
+}
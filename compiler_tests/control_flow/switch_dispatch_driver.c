@@ -0,0 +1,36 @@
+int dense(int x);
+int denseNoDefault(int x);
+int sparse(int x);
+int sparseNoDefault(int x);
+int mixed(int x);
+
+int main()
+{
+    int min;
+    int max;
+    min = -2147483647 - 1;
+    max = 2147483647;
+    if (dense(10) != 1 || dense(11) != 12 || dense(12) != 10 || dense(13) != 13)
+        return 1;
+    if (dense(14) != 14 || dense(15) != -1 || dense(17) != 18 || dense(19) != 19)
+        return 2;
+    if (dense(9) != -1 || dense(20) != -1 || dense(min) != -1 || dense(max) != -1)
+        return 3;
+    if (denseNoDefault(-3) != 3 || denseNoDefault(-1) != 6 || denseNoDefault(0) != 105 || denseNoDefault(4) != 10)
+        return 4;
+    if (denseNoDefault(-4) != 100 || denseNoDefault(5) != 100 || denseNoDefault(min) != 100 || denseNoDefault(max) != 100)
+        return 5;
+    if (sparse(min) != 1 || sparse(-1000) != 2 || sparse(-1) != 3 || sparse(7) != 4 || sparse(100) != 4)
+        return 6;
+    if (sparse(5000) != 5 || sparse(max) != 6 || sparse(0) != 0 || sparse(min + 1) != 0 || sparse(max - 1) != 0)
+        return 7;
+    if (sparseNoDefault(min) != 3 || sparseNoDefault(0) != 2 || sparseNoDefault(65536) != 3 || sparseNoDefault(max) != 4)
+        return 8;
+    if (sparseNoDefault(1) != 0 || sparseNoDefault(min + 1) != 0 || sparseNoDefault(max - 1) != 0)
+        return 9;
+    if (mixed(min) != -100 || mixed(0) != 0 || mixed(4) != 4 || mixed(7) != 7 || mixed(max) != 100)
+        return 10;
+    if (mixed(-1) != -1 || mixed(8) != -1 || mixed(min + 1) != -1 || mixed(max - 1) != -1)
+        return 11;
+    return 0;
+}
@@ -0,0 +1,33 @@
+double a = -1.5;
+double b = 1.0 / 3;
+double c = 2;
+double d = 1.5 * -4 + 1;
+double e = 7 / 2;
+double f = 17 % 5;
+double g = 1.5 + 7 / 2;
+double h = 1 << 2;
+float k = 7 / 2;
+
+double get(int i)
+{
+    if (i == 0)
+        return a;
+    if (i == 1)
+        return b;
+    if (i == 2)
+        return c;
+    if (i == 3)
+        return d;
+    if (i == 4)
+        return e;
+    if (i == 5)
+        return f;
+    if (i == 6)
+        return g;
+    return h;
+}
+
+float getFloat()
+{
+    return k;
+}
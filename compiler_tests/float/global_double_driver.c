@@ -0,0 +1,25 @@
+double get(int i);
+float getFloat();
+
+int main()
+{
+    if (get(0) != -1.5)
+        return 1;
+    if (get(1) * 3 != 1.0)
+        return 2;
+    if (get(2) != 2.0)
+        return 3;
+    if (get(3) != -5.0)
+        return 4;
+    if (get(4) != 3.0)
+        return 5;
+    if (get(5) != 2.0)
+        return 6;
+    if (get(6) != 4.5)
+        return 7;
+    if (get(7) != 4.0)
+        return 8;
+    if (getFloat() != 3.0)
+        return 9;
+    return 0;
+}
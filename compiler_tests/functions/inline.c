@@ -0,0 +1,70 @@
+int total;
+
+int viaAddress(int x)
+{
+    int *p;
+    p = &x;
+    *p = *p * 2;
+    return x + 1;
+}
+
+int localArray(int n)
+{
+    int t[3];
+    t[0] = n;
+    t[1] = n * 2;
+    t[2] = t[0] + t[1];
+    return t[2];
+}
+
+int sign(int x)
+{
+    if (x < 0)
+        return -1;
+    if (x == 0)
+        return 0;
+    return 1;
+}
+
+int clampAdd(int a, int b)
+{
+    a = a + b;
+    if (a > 100)
+        a = 100;
+    b = 0;
+    return a + b;
+}
+
+void addTotal(int v)
+{
+    total = total + v;
+}
+
+float scale(int a, float f, int b)
+{
+    return a * f + b;
+}
+
+int run(int n)
+{
+    int i;
+    int s;
+    int a;
+    int b;
+    s = 0;
+    total = 0;
+    for (i = -2; i < n; i++)
+    {
+        s = s + localArray(i) + sign(i) * 1000;
+        addTotal(viaAddress(i));
+    }
+    a = 60;
+    b = 50;
+    s = s + clampAdd(a, b) + clampAdd(b, 1) + a + b;
+    return s + total * 100000;
+}
+
+float runFloat(int n)
+{
+    return scale(n, 1.5, 2) + scale(1, 0.25, n);
+}
@@ -0,0 +1,13 @@
+int run(int n);
+float runFloat(int n);
+
+int main()
+{
+    if (run(0) != -401748)
+        return 1;
+    if (run(4) != 1201270)
+        return 2;
+    if (run(-5) != 261)
+        return 3;
+    return !(runFloat(4) == 12.25);
+}
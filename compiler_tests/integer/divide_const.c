@@ -0,0 +1,49 @@
+int div7(int x)
+{
+    return x / 7;
+}
+
+int mod7(int x)
+{
+    return x % 7;
+}
+
+int divMinus8(int x)
+{
+    return x / -8;
+}
+
+int modMinus8(int x)
+{
+    return x % -8;
+}
+
+int div1000(int x)
+{
+    return x / 1000;
+}
+
+int mod1000(int x)
+{
+    return x % 1000;
+}
+
+int div16(int x)
+{
+    return x / 16;
+}
+
+int mod16(int x)
+{
+    return x % 16;
+}
+
+unsigned int udiv7(unsigned int x)
+{
+    return x / 7;
+}
+
+unsigned int umod1000(unsigned int x)
+{
+    return x % 1000;
+}
@@ -0,0 +1,65 @@
+int div7(int x);
+int mod7(int x);
+int divMinus8(int x);
+int modMinus8(int x);
+int div1000(int x);
+int mod1000(int x);
+int div16(int x);
+int mod16(int x);
+unsigned int udiv7(unsigned int x);
+unsigned int umod1000(unsigned int x);
+
+int check(int x)
+{
+    int d;
+    unsigned int v;
+    unsigned int u;
+    d = 7;
+    if (div7(x) != x / d || mod7(x) != x % d)
+        return 1;
+    d = -8;
+    if (divMinus8(x) != x / d || modMinus8(x) != x % d)
+        return 2;
+    d = 1000;
+    if (div1000(x) != x / d || mod1000(x) != x % d)
+        return 3;
+    d = 16;
+    if (div16(x) != x / d || mod16(x) != x % d)
+        return 4;
+    v = x;
+    u = 7;
+    if (udiv7(v) != v / u)
+        return 5;
+    u = 1000;
+    if (umod1000(v) != v % u)
+        return 6;
+    return 0;
+}
+
+int main()
+{
+    int values[14];
+    int i;
+    int r;
+    values[0] = 0;
+    values[1] = 1;
+    values[2] = 6;
+    values[3] = 7;
+    values[4] = -1;
+    values[5] = -7;
+    values[6] = -8;
+    values[7] = -15;
+    values[8] = 999;
+    values[9] = -1001;
+    values[10] = 123456789;
+    values[11] = -123456789;
+    values[12] = 2147483647;
+    values[13] = -2147483647 - 1;
+    for (i = 0; i < 14; i++)
+    {
+        r = check(values[i]);
+        if (r != 0)
+            return 10 * i + r;
+    }
+    return 0;
+}
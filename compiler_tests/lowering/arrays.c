@@ -0,0 +1,57 @@
+int table[8];
+
+int fill(int n)
+{
+    int i;
+    int local[8];
+    int s;
+    for (i = 0; i < 8; i++)
+    {
+        table[i] = i * n;
+        local[7 - i] = table[i] + 1;
+    }
+    s = 0;
+    for (i = 0; i < 8; i++)
+    {
+        s = s + local[i] * (i + 1);
+    }
+    return s;
+}
+
+int sum(int *p, int n)
+{
+    int s;
+    s = 0;
+    while (n > 0)
+    {
+        s = s + *p;
+        p++;
+        n--;
+    }
+    return s;
+}
+
+int letters()
+{
+    char word[6];
+    int i;
+    int count;
+    word[0] = 'h';
+    word[1] = 'e';
+    word[2] = 'l';
+    word[3] = 'l';
+    word[4] = 'o';
+    word[5] = 0;
+    count = 0;
+    for (i = 0; word[i] != 0; i++)
+    {
+        if (word[i] == 'l')
+            count++;
+    }
+    return count * 10 + i;
+}
+
+int global(int i)
+{
+    return table[i];
+}
@@ -0,0 +1,22 @@
+int fill(int n);
+int sum(int *p, int n);
+int letters();
+int global(int i);
+
+int main()
+{
+    int v[4];
+    v[0] = 3;
+    v[1] = 5;
+    v[2] = 7;
+    v[3] = 9;
+    if (fill(2) != 204)
+        return 1;
+    if (global(5) != 10)
+        return 2;
+    if (sum(v, 4) != 24 || sum(v + 1, 2) != 12)
+        return 3;
+    if (letters() != 25)
+        return 4;
+    return 0;
+}
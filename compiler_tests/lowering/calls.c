@@ -0,0 +1,28 @@
+int twice(int x);
+
+int add6(int a, int b, int c, int d, int e, int f)
+{
+    return a + b * 2 + c * 3 + d * 4 + e * 5 + f * 6;
+}
+
+float mix(int a, float b, int c, float d)
+{
+    return a * b + c * d;
+}
+
+int fib(int n)
+{
+    if (n < 2)
+        return n;
+    return fib(n - 1) + fib(n - 2);
+}
+
+int chain(int x)
+{
+    return twice(add6(x, 1, 1, 1, 1, twice(x)));
+}
+
+int twice(int x)
+{
+    return x + x;
+}
@@ -0,0 +1,19 @@
+int add6(int a, int b, int c, int d, int e, int f);
+float mix(int a, float b, int c, float d);
+int fib(int n);
+int chain(int x);
+
+int main()
+{
+    float m;
+    if (add6(1, 2, 3, 4, 5, 6) != 91)
+        return 1;
+    m = mix(2, 1.5, 3, 0.5);
+    if (m < 4.49 || m > 4.51)
+        return 2;
+    if (fib(10) != 55)
+        return 3;
+    if (chain(3) != 106)
+        return 4;
+    return 0;
+}
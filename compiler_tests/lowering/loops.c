@@ -0,0 +1,42 @@
+int triangle(int n)
+{
+    int i;
+    int j;
+    int s;
+    s = 0;
+    for (i = 0; i < n; i++)
+    {
+        j = 0;
+        while (j <= i)
+        {
+            s = s + j;
+            j++;
+        }
+    }
+    return s;
+}
+
+int digits(int n)
+{
+    int count;
+    count = 0;
+    do
+    {
+        n = n / 10;
+        count++;
+    } while (n != 0);
+    return count;
+}
+
+int search(int n)
+{
+    int i;
+    i = 0;
+again:
+    if (i * i >= n)
+        goto done;
+    i++;
+    goto again;
+done:
+    return i;
+}
@@ -0,0 +1,18 @@
+int triangle(int n);
+int digits(int n);
+int search(int n);
+
+int main()
+{
+    if (triangle(0) != 0)
+        return 1;
+    if (triangle(5) != 20)
+        return 2;
+    if (digits(0) != 1)
+        return 3;
+    if (digits(12345) != 5)
+        return 4;
+    if (search(50) != 8)
+        return 5;
+    return 0;
+}
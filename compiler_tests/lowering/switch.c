@@ -0,0 +1,44 @@
+int classify(int c)
+{
+    int r;
+    r = 0;
+    switch (c)
+    {
+    case 'a':
+    case 'e':
+    case 'i':
+    case 'o':
+    case 'u':
+        r = 1;
+        break;
+    case ' ':
+        r = 2;
+        break;
+    case '0':
+        r = 3;
+    case '1':
+        r = r + 4;
+        break;
+    default:
+        r = 5;
+    }
+    return r;
+}
+
+int nested(int a, int b)
+{
+    switch (a)
+    {
+    case 1:
+        switch (b)
+        {
+        case 1:
+            return 11;
+        default:
+            return 10;
+        }
+    case 2:
+        return 20;
+    }
+    return -1;
+}
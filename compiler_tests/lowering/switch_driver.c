@@ -0,0 +1,21 @@
+int classify(int c);
+int nested(int a, int b);
+
+int main()
+{
+    if (classify('e') != 1)
+        return 1;
+    if (classify(' ') != 2)
+        return 2;
+    if (classify('0') != 7)
+        return 3;
+    if (classify('1') != 4)
+        return 4;
+    if (classify('z') != 5)
+        return 5;
+    if (nested(1, 1) != 11 || nested(1, 7) != 10)
+        return 6;
+    if (nested(2, 0) != 20 || nested(3, 0) != -1)
+        return 7;
+    return 0;
+}
@@ -0,0 +1,62 @@
+int g;
+
+void setG(int v);
+
+int forward(int *p, int v)
+{
+    *p = v;
+    return *p + 1;
+}
+
+int aliasStore(int *a, int *p, int i)
+{
+    int x;
+    x = a[i];
+    *p = x + 1;
+    return a[i] * 10 + x;
+}
+
+int aliasIndex(int *a, int i, int j)
+{
+    int x;
+    x = a[i];
+    a[j] = 7;
+    return a[i] * 10 + x;
+}
+
+int callBetween()
+{
+    int x;
+    x = g;
+    setG(x + 5);
+    return g - x;
+}
+
+int charThenInt(int *p)
+{
+    char *c;
+    c = p;
+    *p = 0;
+    *c = 9;
+    return *p;
+}
+
+int diamond(int *p, int c)
+{
+    int x;
+    x = *p;
+    if (c)
+    {
+        *p = x + 10;
+    }
+    else
+    {
+        x = x + 1;
+    }
+    return *p * 100 + x;
+}
+
+void setG(int v)
+{
+    g = v;
+}
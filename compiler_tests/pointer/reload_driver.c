@@ -0,0 +1,32 @@
+int forward(int *p, int v);
+int aliasStore(int *a, int *p, int i);
+int aliasIndex(int *a, int i, int j);
+int callBetween();
+int charThenInt(int *p);
+int diamond(int *p, int c);
+
+int main()
+{
+    int a[4];
+    int x;
+    a[0] = 1;
+    a[1] = 2;
+    a[2] = 3;
+    a[3] = 4;
+    if (aliasStore(a, a + 2, 2) != 43 || aliasStore(a, a, 1) != 22)
+        return 1;
+    if (aliasIndex(a, 3, 3) != 74 || aliasIndex(a, 1, 0) != 22)
+        return 2;
+    if (callBetween() != 5 || callBetween() != 5)
+        return 3;
+    if (charThenInt(&x) != 9)
+        return 4;
+    x = 1;
+    if (diamond(&x, 1) != 1101 || x != 11)
+        return 5;
+    if (diamond(&x, 0) != 1112 || x != 11)
+        return 6;
+    if (forward(&x, 6) != 7 || x != 6)
+        return 7;
+    return 0;
+}
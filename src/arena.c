@@ -0,0 +1,133 @@
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "arena.h"
+
+// every allocation is rounded up to this, enough for any AST node field
+#define ARENA_ALIGNMENT 8
+
+typedef struct ArenaBlock
+{
+    ArenaBlock *next;
+    size_t size;
+    size_t used;
+    _Alignas(ARENA_ALIGNMENT) unsigned char data[];
+} ArenaBlock;
+
+static size_t alignSize(const size_t size)
+{
+    return (size + ARENA_ALIGNMENT - 1) & ~(size_t)(ARENA_ALIGNMENT - 1);
+}
+
+// Adds a new block of at least size bytes in front of the block list
+static ArenaBlock *arenaBlockPush(Arena *arena, const size_t size)
+{
+    size_t blockSize = size > arena->blockSize ? size : arena->blockSize;
+    ArenaBlock *block = malloc(sizeof(ArenaBlock) + blockSize);
+    if (block == NULL)
+    {
+        abort();
+    }
+    block->next = arena->head;
+    block->size = blockSize;
+    block->used = 0;
+    arena->head = block;
+    arena->bytesReserved += blockSize;
+    return block;
+}
+
+// Arena constructor
+Arena *arenaCreate(const size_t blockSize)
+{
+    Arena *arena = malloc(sizeof(Arena));
+    if (arena == NULL)
+    {
+        abort();
+    }
+    arena->head = NULL;
+    arena->blockSize = alignSize(blockSize);
+    arena->bytesUsed = 0;
+    arena->bytesReserved = 0;
+    return arena;
+}
+
+// Arena destructor, releases every allocation made from the arena at once
+void arenaDestroy(Arena *arena)
+{
+    ArenaBlock *block = arena->head;
+    while (block != NULL)
+    {
+        ArenaBlock *next = block->next;
+        free(block);
+        block = next;
+    }
+    free(arena);
+}
+
+// Forgets every allocation but keeps the newest block around for reuse
+void arenaReset(Arena *arena)
+{
+    ArenaBlock *block = arena->head;
+    if (block == NULL)
+    {
+        return;
+    }
+    ArenaBlock *next = block->next;
+    while (next != NULL)
+    {
+        ArenaBlock *after = next->next;
+        free(next);
+        next = after;
+    }
+    block->next = NULL;
+    block->used = 0;
+    arena->bytesUsed = 0;
+    arena->bytesReserved = block->size;
+}
+
+// Allocates size bytes from the arena
+// Important: memory is not zeroed, same as malloc
+void *arenaAlloc(Arena *arena, const size_t size)
+{
+    size_t alignedSize = alignSize(size);
+    ArenaBlock *block = arena->head;
+    if (block == NULL || block->size - block->used < alignedSize)
+    {
+        block = arenaBlockPush(arena, alignedSize);
+    }
+    void *ptr = block->data + block->used;
+    block->used += alignedSize;
+    arena->bytesUsed += alignedSize;
+    return ptr;
+}
+
+// Grows an allocation, in place if it was the last one made, otherwise by copying
+void *arenaRealloc(Arena *arena, void *ptr, const size_t oldSize, const size_t newSize)
+{
+    if (ptr == NULL)
+    {
+        return arenaAlloc(arena, newSize);
+    }
+    size_t oldAligned = alignSize(oldSize);
+    size_t newAligned = alignSize(newSize);
+    ArenaBlock *block = arena->head;
+    if ((unsigned char *)ptr + oldAligned == block->data + block->used && block->size - block->used + oldAligned >= newAligned)
+    {
+        block->used = block->used - oldAligned + newAligned;
+        arena->bytesUsed = arena->bytesUsed - oldAligned + newAligned;
+        return ptr;
+    }
+    void *newPtr = arenaAlloc(arena, newSize);
+    memcpy(newPtr, ptr, oldSize < newSize ? oldSize : newSize);
+    return newPtr;
+}
+
+// Copies len characters of str into the arena and null terminates them
+char *arenaStrdup(Arena *arena, const char *str, const size_t len)
+{
+    char *copy = arenaAlloc(arena, len + 1);
+    memcpy(copy, str, len);
+    copy[len] = '\0';
+    return copy;
+}
@@ -0,0 +1,26 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+
+typedef struct ArenaBlock ArenaBlock;
+
+// Bump allocator. A reset frees every block but the newest, which is kept for reuse, and
+// destroying the arena frees everything
+typedef struct Arena
+{
+    ArenaBlock *head; // block currently being allocated from
+    size_t blockSize; // default size of a new block
+    size_t bytesUsed;
+    size_t bytesReserved;
+} Arena;
+
+Arena *arenaCreate(size_t blockSize);
+void arenaDestroy(Arena *arena);
+void arenaReset(Arena *arena);
+
+void *arenaAlloc(Arena *arena, size_t size);
+void *arenaRealloc(Arena *arena, void *ptr, size_t oldSize, size_t newSize);
+char *arenaStrdup(Arena *arena, const char *str, size_t len);
+
+#endif
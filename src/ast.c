@@ -2,106 +2,107 @@
 #include <stdio.h>
 #include <stdlib.h>
 
+#include "arena.h"
 #include "ast.h"
 #include "symbol.h"
 
-// Expression constructor
-Expr *exprCreate(const ExprType type)
+#define AST_ARENA_BLOCK_SIZE (64 * 1024)
+
+// Every node of the translation unit is allocated from this arena
+static Arena *astArena = NULL;
+
+// statistics for -fmem-report, kept across releases
+static size_t astAllocations = 0;
+static size_t astPeakBytes = 0;
+
+// Allocates AST memory, the arena is created on first use
+void *astAlloc(const size_t size)
 {
-    Expr *expr = malloc(sizeof(Expr));
-    if (expr == NULL)
+    if (astArena == NULL)
     {
-        abort();
+        astArena = arenaCreate(AST_ARENA_BLOCK_SIZE);
     }
-    expr->type = type;
-    return expr;
+    astAllocations++;
+    return arenaAlloc(astArena, size);
 }
 
-// Expression destructor
-void exprDestroy(Expr *expr)
+// Grows an AST array previously returned by astAlloc
+void *astRealloc(void *ptr, const size_t oldSize, const size_t newSize)
 {
-    switch (expr->type)
-    {
-    case VARIABLE_EXPR:
+    if (astArena == NULL)
     {
-        variableExprDestroy(expr->variable);
-        break;
+        astArena = arenaCreate(AST_ARENA_BLOCK_SIZE);
     }
-    case CONSTANT_EXPR:
-    {
-        constantExprDestroy(expr->constant);
-        break;
-    }
-    case OPERATION_EXPR:
+    return arenaRealloc(astArena, ptr, oldSize, newSize);
+}
+
+// Frees every node and list of the translation unit in one go
+void astArenaRelease(void)
+{
+    if (astArena != NULL)
     {
-        operationExprDestroy(expr->operation);
-        break;
+        astPeakBytes = astArenaPeakBytes();
+        arenaDestroy(astArena);
+        astArena = NULL;
     }
-    case ASSIGN_EXPR:
+}
+
+// Frees every node allocated so far but keeps the arena for the next declaration
+void astArenaReset(void)
+{
+    if (astArena != NULL)
     {
-        assignExprDestroy(expr->assignment);
-        break;
+        astPeakBytes = astArenaPeakBytes();
+        arenaReset(astArena);
     }
-    case FUNC_EXPR:
+}
+
+// Number of allocations made through astAlloc
+size_t astAllocationCount(void)
+{
+    return astAllocations;
+}
+
+// Largest number of bytes the AST arena has reserved at once
+size_t astArenaPeakBytes(void)
+{
+    if (astArena != NULL && astArena->bytesReserved > astPeakBytes)
     {
-        funcExprDestroy(expr->function);
-        break;
-    }
+        return astArena->bytesReserved;
     }
-    free(expr);
+    return astPeakBytes;
+}
+
+// Expression constructor
+Expr *exprCreate(const ExprType type)
+{
+    Expr *expr = astAlloc(sizeof(Expr));
+    expr->type = type;
+    return expr;
 }
 
 // Variable expression constructor
 VariableExpr *variableExprCreate(char *ident)
 {
-    VariableExpr *expr = malloc(sizeof(VariableExpr));
-    if (expr == NULL)
-    {
-        abort();
-    }
+    VariableExpr *expr = astAlloc(sizeof(VariableExpr));
     expr->ident = ident;
     expr->symbolEntry = NULL;
     return expr;
 }
 
-// Variable expresssion destructor
-void variableExprDestroy(VariableExpr *expr)
-{
-    free(expr->ident);
-    free(expr);
-}
-
 // Constant expression constructor
 ConstantExpr *constantExprCreate(const DataType type, const bool isString)
 {
-    ConstantExpr *expr = malloc(sizeof(ConstantExpr));
-    if (expr == NULL)
-    {
-        abort();
-    }
+    ConstantExpr *expr = astAlloc(sizeof(ConstantExpr));
     expr->type = type;
     expr->isString = isString;
     return expr;
 }
 
-// Constant expression destructor
-void constantExprDestroy(ConstantExpr *expr)
-{
-    if (expr->isString)
-    {
-        free(expr->string_const);
-    }
-    free(expr);
-}
-
 // Operation expression constructor
 OperationExpr *operationExprCreate(const Operator operator)
 {
-    OperationExpr *expr = malloc(sizeof(OperationExpr));
-    if (expr == NULL)
-    {
-        abort();
-    }
+    OperationExpr *expr = astAlloc(sizeof(OperationExpr));
     expr->op1 = NULL;
     expr->op2 = NULL;
     expr->op3 = NULL;
@@ -109,33 +110,10 @@ OperationExpr *operationExprCreate(const Operator operator)
     return expr;
 }
 
-// Operation expression destructor
-void operationExprDestroy(OperationExpr *expr)
-{
-    // Note: Do not change deallocation behaviour, parser relies on it
-    if (expr->op1 != NULL)
-    {
-        exprDestroy(expr->op1);
-    }
-    if (expr->op2 != NULL)
-    {
-        exprDestroy(expr->op2);
-    }
-    if (expr->op3 != NULL)
-    {
-        exprDestroy(expr->op3);
-    }
-    free(expr);
-}
-
 // Assignment expression constructor
 AssignExpr *assignExprCreate(Expr *op, const Operator operator)
 {
-    AssignExpr *expr = malloc(sizeof(AssignExpr));
-    if (expr == NULL)
-    {
-        abort();
-    }
+    AssignExpr *expr = astAlloc(sizeof(AssignExpr));
     expr->ident = NULL;
     expr->lvalue = NULL;
     expr->op = op;
@@ -143,34 +121,13 @@ AssignExpr *assignExprCreate(Expr *op, const Operator operator)
     return expr;
 }
 
-// Assignment expression destructor
-void assignExprDestroy(AssignExpr *expr)
-{
-    exprDestroy(expr->op);
-    if (expr->lvalue != NULL)
-    {
-        exprDestroy(expr->lvalue);
-    }
-    free(expr->ident);
-    free(expr);
-}
-
 // Function call expression constructor
-// Important: if the allocation fails abort() is called
 FuncExpr *funcExprCreate(const size_t argsSize)
 {
-    FuncExpr *expr = malloc(sizeof(FuncExpr));
-    if (expr == NULL)
-    {
-        abort();
-    }
+    FuncExpr *expr = astAlloc(sizeof(FuncExpr));
     if (argsSize != 0)
     {
-        expr->args = malloc(sizeof(Expr) * argsSize);
-        if (expr->args == NULL)
-        {
-            abort();
-        }
+        expr->args = astAlloc(sizeof(Expr *) * argsSize);
     }
     else
     {
@@ -179,6 +136,8 @@ FuncExpr *funcExprCreate(const size_t argsSize)
     expr->ident = NULL;
     expr->argsSize = argsSize;
     expr->argsCapacity = argsSize;
+    expr->type = INT_TYPE; // calls to undeclared functions return int
+    expr->symbolEntry = NULL;
     return expr;
 }
 
@@ -191,25 +150,18 @@ void funcExprArgsResize(FuncExpr *expr, const size_t argsSize)
         expr->argsSize = argsSize;
         if (expr->argsSize > expr->argsCapacity)
         {
+            size_t oldCapacity = expr->argsCapacity;
             while (expr->argsSize > expr->argsCapacity)
             {
                 expr->argsCapacity *= 2;
             }
-            expr->args = realloc(expr->args, sizeof(Expr *) * expr->argsCapacity);
-            if (expr->args == NULL)
-            {
-                abort();
-            }
+            expr->args = astRealloc(expr->args, sizeof(Expr *) * oldCapacity, sizeof(Expr *) * expr->argsCapacity);
         }
     }
     else
     {
         expr->argsSize = argsSize;
-        expr->args = malloc(sizeof(Expr *) * argsSize);
-        if (expr->args == NULL)
-        {
-            abort();
-        }
+        expr->args = astAlloc(sizeof(Expr *) * argsSize);
         expr->argsCapacity = argsSize;
     }
 }
@@ -229,96 +181,28 @@ Expr *funcExprArgsPop(FuncExpr *expr)
     return arg;
 }
 
-// Function expression destructor
-void funcExprDestroy(FuncExpr *expr)
-{
-    free(expr->ident);
-    if (expr->argsCapacity != 0)
-    {
-        for (size_t i = 0; i < expr->argsSize; i++)
-        {
-            exprDestroy(expr->args[i]);
-        }
-        free(expr->args);
-    }
-    free(expr);
-}
-
 // Statement constructor
 Stmt *stmtCreate(const StmtType type)
 {
-    Stmt *stmt = malloc(sizeof(Stmt));
-    if (stmt == NULL)
-    {
-        abort();
-    }
+    Stmt *stmt = astAlloc(sizeof(Stmt));
     stmt->type = type;
     return stmt;
 }
 
-// Statement destructor
-void stmtDestroy(Stmt *stmt)
-{
-    switch (stmt->type)
-    {
-    case WHILE_STMT:
-        whileStmtDestroy(stmt->whileStmt);
-        break;
-    case FOR_STMT:
-        forStmtDestroy(stmt->forStmt);
-        break;
-    case IF_STMT:
-        ifStmtDestroy(stmt->ifStmt);
-        break;
-    case SWITCH_STMT:
-        switchStmtDestroy(stmt->switchStmt);
-        break;
-    case EXPR_STMT:
-        exprStmtDestroy(stmt->exprStmt);
-        break;
-    case COMPOUND_STMT:
-        compoundStmtDestroy(stmt->compoundStmt);
-        break;
-    case LABEL_STMT:
-        labelStmtDestroy(stmt->labelStmt);
-        break;
-    case JUMP_STMT:
-        jumpStmtDestroy(stmt->jumpStmt);
-        break;
-    }
-    free(stmt);
-}
-
 // While statement constructor
 WhileStmt *whileStmtCreate(Expr *condition, Stmt *body, const bool doWhile)
 {
-    WhileStmt *stmt = malloc(sizeof(WhileStmt));
-    if (stmt == NULL)
-    {
-        abort();
-    }
+    WhileStmt *stmt = astAlloc(sizeof(WhileStmt));
     stmt->condition = condition;
     stmt->body = body;
     stmt->doWhile = doWhile;
     return stmt;
 }
 
-// While statement destructor
-void whileStmtDestroy(WhileStmt *stmt)
-{
-    exprDestroy(stmt->condition);
-    stmtDestroy(stmt->body);
-    free(stmt);
-}
-
 // For statement constructor
 ForStmt *forStmtCreate(Stmt *init, Stmt *condition, Stmt *body)
 {
-    ForStmt *stmt = malloc(sizeof(ForStmt));
-    if (stmt == NULL)
-    {
-        abort();
-    }
+    ForStmt *stmt = astAlloc(sizeof(ForStmt));
     stmt->init = init;
     stmt->condition = condition;
     stmt->body = body;
@@ -326,98 +210,39 @@ ForStmt *forStmtCreate(Stmt *init, Stmt *condition, Stmt *body)
     return stmt;
 }
 
-// For statement destructor
-void forStmtDestroy(ForStmt *stmt)
-{
-    stmtDestroy(stmt->init);
-    stmtDestroy(stmt->condition);
-    stmtDestroy(stmt->body);
-    if (stmt->modifier != NULL)
-    {
-        exprDestroy(stmt->modifier);
-    }
-    free(stmt);
-}
-
 // If statement constructor
 IfStmt *ifStmtCreate(Expr *condition, Stmt *trueBody)
 {
-    IfStmt *stmt = malloc(sizeof(IfStmt));
-    if (stmt == NULL)
-    {
-        abort();
-    }
+    IfStmt *stmt = astAlloc(sizeof(IfStmt));
     stmt->condition = condition;
     stmt->trueBody = trueBody;
     stmt->falseBody = NULL;
     return stmt;
 }
 
-// If statement destructor
-void ifStmtDestroy(IfStmt *stmt)
-{
-    exprDestroy(stmt->condition);
-    stmtDestroy(stmt->trueBody);
-    if (stmt->falseBody != NULL)
-    {
-        stmtDestroy(stmt->falseBody);
-    }
-    free(stmt);
-}
-
 // Switch statement constructor
 SwitchStmt *switchStmtCreate(Expr *selector, Stmt *body)
 {
-    SwitchStmt *stmt = malloc(sizeof(SwitchStmt));
-    if (stmt == NULL)
-    {
-        abort();
-    }
+    SwitchStmt *stmt = astAlloc(sizeof(SwitchStmt));
     stmt->selector = selector;
     stmt->body = body;
     return stmt;
 }
 
-// Switch statement destroy
-void switchStmtDestroy(SwitchStmt *stmt)
-{
-    exprDestroy(stmt->selector);
-    stmtDestroy(stmt->body);
-    free(stmt);
-}
-
 // Expression statement constructor
 ExprStmt *exprStmtCreate(void)
 {
-    ExprStmt *stmt = malloc(sizeof(ExprStmt));
-    if (stmt == NULL)
-    {
-        abort();
-    }
+    ExprStmt *stmt = astAlloc(sizeof(ExprStmt));
     stmt->expr = NULL;
     return stmt;
 }
 
-// Expression statement destructor
-void exprStmtDestroy(ExprStmt *stmt)
-{
-    if (stmt->expr != NULL)
-    {
-        exprDestroy(stmt->expr);
-    }
-    free(stmt);
-}
-
 // Statement List initializer
 void statementListInit(StatementList *stmtList, const size_t size)
 {
     if (size != 0)
     {
-        stmtList->stmts = malloc(sizeof(Stmt *) * size);
-        if (stmtList->stmts == NULL)
-        {
-            abort();
-        }
+        stmtList->stmts = astAlloc(sizeof(Stmt *) * size);
     }
     else
     {
@@ -427,19 +252,6 @@ void statementListInit(StatementList *stmtList, const size_t size)
     stmtList->capacity = size;
 }
 
-// Statement List destructor
-void statementListDestroy(StatementList *stmtList)
-{
-    for (size_t i = 0; i < stmtList->size; i++)
-    {
-        stmtDestroy(stmtList->stmts[i]);
-    }
-    free(stmtList->stmts);
-    stmtList->stmts = NULL;
-    stmtList->size = 0;
-    stmtList->capacity = 0;
-}
-
 // Resizes the size of the statement list
 // Important: size must greater than 0
 void statementListResize(StatementList *stmtList, const size_t size)
@@ -449,25 +261,18 @@ void statementListResize(StatementList *stmtList, const size_t size)
         stmtList->size = size;
         if (stmtList->size > stmtList->capacity)
         {
+            size_t oldCapacity = stmtList->capacity;
             while (stmtList->size > stmtList->capacity)
             {
                 stmtList->capacity *= 2;
             }
-            stmtList->stmts = realloc(stmtList->stmts, sizeof(Stmt *) * stmtList->capacity);
-            if (stmtList->stmts == NULL)
-            {
-                abort();
-            }
+            stmtList->stmts = astRealloc(stmtList->stmts, sizeof(Stmt *) * oldCapacity, sizeof(Stmt *) * stmtList->capacity);
         }
     }
     else
     {
         stmtList->size = size;
-        stmtList->stmts = malloc(sizeof(Stmt *) * size);
-        if (stmtList->stmts == NULL)
-        {
-            abort();
-        }
+        stmtList->stmts = astAlloc(sizeof(Stmt *) * size);
         stmtList->capacity = size;
     }
 }
@@ -484,11 +289,7 @@ void declarationListInit(DeclarationList *declList, const size_t size)
 {
     if (size != 0)
     {
-        declList->decls = malloc(sizeof(Decl *) * size);
-        if (declList->decls == NULL)
-        {
-            abort();
-        }
+        declList->decls = astAlloc(sizeof(Decl *) * size);
     }
     else
     {
@@ -499,19 +300,6 @@ void declarationListInit(DeclarationList *declList, const size_t size)
     declList->capacity = size;
 }
 
-// Declaration List destructor
-void declarationListDestroy(DeclarationList *declList)
-{
-    for (size_t i = 0; i < declList->size; i++)
-    {
-        declDestroy(declList->decls[i]);
-    }
-    free(declList->decls);
-    declList->decls = NULL;
-    declList->size = 0;
-    declList->capacity = 0;
-}
-
 // Resizes the size of the declaration list
 // Important: size must greater than 0
 void declarationListResize(DeclarationList *declList, const size_t size)
@@ -521,25 +309,18 @@ void declarationListResize(DeclarationList *declList, const size_t size)
         declList->size = size;
         if (declList->size > declList->capacity)
         {
+            size_t oldCapacity = declList->capacity;
             while (declList->size > declList->capacity)
             {
                 declList->capacity *= 2;
             }
-            declList->decls = realloc(declList->decls, sizeof(Decl *) * declList->capacity);
-            if (declList->decls == NULL)
-            {
-                abort();
-            }
+            declList->decls = astRealloc(declList->decls, sizeof(Decl *) * oldCapacity, sizeof(Decl *) * declList->capacity);
         }
     }
     else
     {
         declList->size = size;
-        declList->decls = malloc(sizeof(Decl *) * size);
-        if (declList->decls == NULL)
-        {
-            abort();
-        }
+        declList->decls = astAlloc(sizeof(Decl *) * size);
         declList->capacity = size;
     }
 }
@@ -554,11 +335,7 @@ void declarationListPush(DeclarationList *declList, Decl *decl)
 // Compound statement constructor
 CompoundStmt *compoundStmtCreate(void)
 {
-    CompoundStmt *stmt = malloc(sizeof(CompoundStmt));
-    if (stmt == NULL)
-    {
-        abort();
-    }
+    CompoundStmt *stmt = astAlloc(sizeof(CompoundStmt));
     stmt->stmtList.size = 0;
     stmt->stmtList.capacity = 0;
     stmt->stmtList.stmts = NULL;
@@ -568,81 +345,34 @@ CompoundStmt *compoundStmtCreate(void)
     return stmt;
 }
 
-// Compound statement destructor
-void compoundStmtDestroy(CompoundStmt *stmt)
-{
-    statementListDestroy(&stmt->stmtList);
-    declarationListDestroy(&stmt->declList);
-    free(stmt);
-}
-
 // Label statement constructor
 LabelStmt *labelStmtCreate(Stmt *body)
 {
-    LabelStmt *stmt = malloc(sizeof(LabelStmt));
-    if (stmt == NULL)
-    {
-        abort();
-    }
+    LabelStmt *stmt = astAlloc(sizeof(LabelStmt));
     stmt->body = body;
     stmt->ident = NULL;
     stmt->caseLabel = NULL;
     return stmt;
 }
 
-// Label statement destructor
-void labelStmtDestroy(LabelStmt *stmt)
-{
-    stmtDestroy(stmt->body);
-    if (stmt->caseLabel != NULL)
-    {
-        exprDestroy(stmt->caseLabel);
-    }
-    free(stmt->ident);
-    free(stmt);
-}
-
 // Jump statement constructor
 JumpStmt *jumpStmtCreate(const JumpType type)
 {
-    JumpStmt *stmt = malloc(sizeof(JumpStmt));
-    if (stmt == NULL)
-    {
-        abort();
-    }
+    JumpStmt *stmt = astAlloc(sizeof(JumpStmt));
     stmt->type = type;
     stmt->ident = NULL;
     stmt->expr = NULL;
     return stmt;
 }
 
-// Jump statement destuctor
-void jumpStmtDestroy(JumpStmt *stmt)
-{
-    if (stmt->expr != NULL)
-    {
-        exprDestroy(stmt->expr);
-    }
-    free(stmt->ident);
-    free(stmt);
-}
-
 // Type Qualifier List constructor
 TypeSpecList *typeSpecListCreate(const size_t typeSpecSize)
 {
-    TypeSpecList *typeSpecList = malloc(sizeof(TypeSpecList));
-    if (typeSpecList == NULL)
-    {
-        abort();
-    }
+    TypeSpecList *typeSpecList = astAlloc(sizeof(TypeSpecList));
 
     if (typeSpecSize != 0)
     {
-        typeSpecList->typeSpecs = malloc(sizeof(TypeSpecifier *) * typeSpecSize);
-        if (typeSpecList->typeSpecs == NULL)
-        {
-            abort();
-        }
+        typeSpecList->typeSpecs = astAlloc(sizeof(TypeSpecifier *) * typeSpecSize);
     }
     else
     {
@@ -654,17 +384,6 @@ TypeSpecList *typeSpecListCreate(const size_t typeSpecSize)
     return typeSpecList;
 }
 
-// Type Qualifier List destructor
-void typeSpecListDestroy(TypeSpecList *typeSpecList)
-{
-    for (size_t i = 0; i < typeSpecList->typeSpecSize; i++)
-    {
-        typeSpecifierDestroy(typeSpecList->typeSpecs[i]);
-    }
-    free(typeSpecList->typeSpecs);
-    free(typeSpecList);
-}
-
 // Resizes the size of the type qualifier list
 void typeSpecListResize(TypeSpecList *typeSpecList, const size_t typeSpecSize)
 {
@@ -673,25 +392,18 @@ void typeSpecListResize(TypeSpecList *typeSpecList, const size_t typeSpecSize)
         typeSpecList->typeSpecSize = typeSpecSize;
         if (typeSpecList->typeSpecSize > typeSpecList->typeSpecCapacity)
         {
+            size_t oldCapacity = typeSpecList->typeSpecCapacity;
             while (typeSpecList->typeSpecSize > typeSpecList->typeSpecCapacity)
             {
                 typeSpecList->typeSpecCapacity *= 2;
             }
-            typeSpecList->typeSpecs = realloc(typeSpecList->typeSpecs, sizeof(TypeSpecifier *) * typeSpecList->typeSpecCapacity);
-            if (typeSpecList->typeSpecs == NULL)
-            {
-                abort();
-            }
+            typeSpecList->typeSpecs = astRealloc(typeSpecList->typeSpecs, sizeof(TypeSpecifier *) * oldCapacity, sizeof(TypeSpecifier *) * typeSpecList->typeSpecCapacity);
         }
     }
     else
     {
         typeSpecList->typeSpecSize = typeSpecSize;
-        typeSpecList->typeSpecs = malloc(sizeof(TypeSpecifier *) * typeSpecSize);
-        if (typeSpecList->typeSpecs == NULL)
-        {
-            abort();
-        }
+        typeSpecList->typeSpecs = astAlloc(sizeof(TypeSpecifier *) * typeSpecSize);
         typeSpecList->typeSpecCapacity = typeSpecSize;
     }
 }
@@ -732,99 +444,40 @@ TypeSpecList *typeSpecListCopy(TypeSpecList *typeSpecList)
 
 Declarator *declaratorCreate(void)
 {
-    Declarator *declarator = malloc(sizeof(Declarator));
-    if (declarator == NULL)
-    {
-        abort();
-    }
+    Declarator *declarator = astAlloc(sizeof(Declarator));
     declarator->pointerCount = 0;
     declarator->isArray = false;
     return declarator;
 }
 
-void declaratorDestroy(Declarator *declarator)
-{
-    if (declarator->ident != NULL)
-    {
-        free(declarator->ident);
-    }
-    if (declarator->isArray)
-    {
-        exprDestroy(declarator->arraySize);
-    }
-    free(declarator);
-}
-
 // Declaration-Initializer constructor
 DeclInit *declInitCreate(Declarator *declarator)
 {
-    DeclInit *declInit = malloc(sizeof(DeclInit));
-    if (declInit == NULL)
-    {
-        abort();
-    }
+    DeclInit *declInit = astAlloc(sizeof(DeclInit));
     declInit->declarator = declarator;
     declInit->initExpr = NULL;
     declInit->initList = NULL;
     return declInit;
 }
 
-// Declaration-Initializer destructor
-void declInitDestroy(DeclInit *declInit)
-{
-    if (declInit->initList != NULL) // may not be initialized
-    {
-        initListDestroy(declInit->initList);
-    }
-    if (declInit->initExpr != NULL) // may not be initialized
-    {
-        exprDestroy(declInit->initExpr);
-    }
-    declaratorDestroy(declInit->declarator);
-    free(declInit);
-}
-
 // Declaration constructor
 Decl *declCreate(TypeSpecList *typeSpecList)
 {
-    Decl *decl = malloc(sizeof(Decl));
-    if (decl == NULL)
-    {
-        abort();
-    }
+    Decl *decl = astAlloc(sizeof(Decl));
 
     decl->typeSpecList = typeSpecList;
     decl->declInit = NULL;
     return decl;
 }
 
-// Declaration destructor
-void declDestroy(Decl *decl)
-{
-    typeSpecListDestroy(decl->typeSpecList);
-    if (decl->declInit != NULL)
-    {
-        declInitDestroy(decl->declInit);
-    }
-    free(decl);
-}
-
 DeclInitList *declInitListCreate(const size_t declInitListSize)
 {
-    DeclInitList *declInitList = malloc(sizeof(DeclInitList));
-    if (declInitList == NULL)
-    {
-        abort();
-    }
+    DeclInitList *declInitList = astAlloc(sizeof(DeclInitList));
 
     if (declInitListSize != 0)
     {
         // recent change
-        declInitList->declInits = malloc(sizeof(DeclInit *) * declInitListSize);
-        if (declInitList->declInits == NULL)
-        {
-            abort();
-        }
+        declInitList->declInits = astAlloc(sizeof(DeclInit *) * declInitListSize);
     }
     else
     {
@@ -836,17 +489,6 @@ DeclInitList *declInitListCreate(const size_t declInitListSize)
     return declInitList;
 }
 
-// Declaration Initializer List Destructor
-void declInitListDestroy(DeclInitList *declInitList)
-{
-    for (size_t i = 0; i < declInitList->declInitListSize; i++)
-    {
-        declInitDestroy(declInitList->declInits[i]);
-    }
-    free(declInitList->declInits);
-    free(declInitList);
-}
-
 // Resizes the size of the declaration initializer list
 void declInitListResize(DeclInitList *declInitList, const size_t declInitListSize)
 {
@@ -855,25 +497,18 @@ void declInitListResize(DeclInitList *declInitList, const size_t declInitListSiz
         declInitList->declInitListSize = declInitListSize;
         if (declInitList->declInitListSize > declInitList->declInitListCapacity)
         {
+            size_t oldCapacity = declInitList->declInitListCapacity;
             while (declInitList->declInitListSize > declInitList->declInitListCapacity)
             {
                 declInitList->declInitListCapacity *= 2;
             }
-            declInitList->declInits = realloc(declInitList->declInits, sizeof(DeclInit *) * declInitList->declInitListCapacity);
-            if (declInitList->declInits == NULL)
-            {
-                abort();
-            }
+            declInitList->declInits = astRealloc(declInitList->declInits, sizeof(DeclInit *) * oldCapacity, sizeof(DeclInit *) * declInitList->declInitListCapacity);
         }
     }
     else
     {
         declInitList->declInitListSize = declInitListSize;
-        declInitList->declInits = malloc(sizeof(DeclInit *) * declInitListSize);
-        if (declInitList->declInits == NULL)
-        {
-            abort();
-        }
+        declInitList->declInits = astAlloc(sizeof(DeclInit *) * declInitListSize);
         declInitList->declInitListCapacity = declInitListSize;
     }
 }
@@ -888,47 +523,19 @@ void declInitListPush(DeclInitList *declInitList, DeclInit *declInit)
 // Constructor for struct declaration
 StructDecl *structDeclCreate(void)
 {
-    StructDecl *structDecl = malloc(sizeof(StructDecl));
-    if (structDecl == NULL)
-    {
-        abort();
-    }
+    StructDecl *structDecl = astAlloc(sizeof(StructDecl));
     structDecl->bitField = NULL;
     return structDecl;
 }
 
-// Destructor for struct declaration
-void structDeclDestroy(StructDecl *structDecl)
-{
-    typeSpecListDestroy(structDecl->typeSpecList);
-
-    if (structDecl->declarator != NULL)
-    {
-        declaratorDestroy(structDecl->declarator);
-    }
-    if (structDecl->bitField != NULL)
-    {
-        exprDestroy(structDecl->bitField);
-    }
-    free(structDecl);
-}
-
 // Constructor for struct declaration list
 StructDeclList *structDeclListCreate(size_t structDeclListSize)
 {
-    StructDeclList *structDeclList = malloc(sizeof(StructDeclList));
-    if (structDeclList == NULL)
-    {
-        abort();
-    }
+    StructDeclList *structDeclList = astAlloc(sizeof(StructDeclList));
 
     if (structDeclListSize != 0)
     {
-        structDeclList->structDecls = malloc(sizeof(StructDecl *) * structDeclListSize);
-        if (structDeclList->structDecls == NULL)
-        {
-            abort();
-        }
+        structDeclList->structDecls = astAlloc(sizeof(StructDecl *) * structDeclListSize);
     }
     else
     {
@@ -940,17 +547,6 @@ StructDeclList *structDeclListCreate(size_t structDeclListSize)
     return structDeclList;
 }
 
-// Destructor for struct declaration list
-void structDeclListDestroy(StructDeclList *structDeclList)
-{
-    for (size_t i = 0; i < structDeclList->structDeclListSize; i++)
-    {
-        structDeclDestroy(structDeclList->structDecls[i]);
-    }
-    free(structDeclList->structDecls);
-    free(structDeclList);
-}
-
 // Resize the array inside struct specifier types
 void structDeclListResize(StructDeclList *structDeclList, const size_t structDeclListSize)
 {
@@ -959,25 +555,18 @@ void structDeclListResize(StructDeclList *structDeclList, const size_t structDec
         structDeclList->structDeclListSize = structDeclListSize;
         if (structDeclList->structDeclListSize > structDeclList->structDeclListCapacity)
         {
+            size_t oldCapacity = structDeclList->structDeclListCapacity;
             while (structDeclList->structDeclListSize > structDeclList->structDeclListCapacity)
             {
                 structDeclList->structDeclListCapacity *= 2;
             }
-            structDeclList->structDecls = realloc(structDeclList->structDecls, sizeof(StructDecl *) * structDeclList->structDeclListCapacity);
-            if (structDeclList->structDecls == NULL)
-            {
-                abort();
-            }
+            structDeclList->structDecls = astRealloc(structDeclList->structDecls, sizeof(StructDecl *) * oldCapacity, sizeof(StructDecl *) * structDeclList->structDeclListCapacity);
         }
     }
     else
     {
         structDeclList->structDeclListSize = structDeclListSize;
-        structDeclList->structDecls = malloc(sizeof(StructDecl *) * structDeclListSize);
-        if (structDeclList->structDecls == NULL)
-        {
-            abort();
-        }
+        structDeclList->structDecls = astAlloc(sizeof(StructDecl *) * structDeclListSize);
         structDeclList->structDeclListCapacity = structDeclListSize;
     }
 }
@@ -992,55 +581,25 @@ void structDeclListPush(StructDeclList *structDeclList, StructDecl *structDecl)
 // Constructor for struct specifier
 StructSpecifier *structSpecifierCreate(void)
 {
-    StructSpecifier *structSpec = malloc(sizeof(StructSpecifier));
-    if (structSpec == NULL)
-    {
-        abort();
-    }
+    StructSpecifier *structSpec = astAlloc(sizeof(StructSpecifier));
+    structSpec->ident = NULL;
+    structSpec->structDeclList = NULL;
     return structSpec;
 }
 
-// Destructor for struct specifier
-void structSpecifierDestroy(StructSpecifier *structSpec)
-{
-    if (structSpec->ident != NULL)
-    {
-        free(structSpec->ident);
-    }
-    structDeclListDestroy(structSpec->structDeclList);
-    free(structSpec);
-}
-
 // Constructor for type specifiers
 TypeSpecifier *typeSpecifierCreate(bool isStruct)
 {
-    TypeSpecifier *typeSpecifier = malloc(sizeof(TypeSpecifier));
-    if (typeSpecifier == NULL)
-    {
-        abort();
-    }
+    TypeSpecifier *typeSpecifier = astAlloc(sizeof(TypeSpecifier));
     typeSpecifier->isStruct = isStruct;
+    typeSpecifier->structSpecifier = NULL;
     return typeSpecifier;
 }
 
-// Destructor for type specifiers
-void typeSpecifierDestroy(TypeSpecifier *typeSpecifier)
-{
-    if (typeSpecifier->isStruct == true)
-    {
-        structSpecifierDestroy(typeSpecifier->structSpecifier);
-    }
-    free(typeSpecifier);
-}
-
 // Constructor for function definition
 FuncDef *funcDefCreate(TypeSpecList *retType, size_t ptrCount, char *ident)
 {
-    FuncDef *funcDef = malloc(sizeof(FuncDef));
-    if (funcDef == NULL)
-    {
-        abort();
-    }
+    FuncDef *funcDef = astAlloc(sizeof(FuncDef));
     funcDef->retType = retType;
     funcDef->ptrCount = ptrCount;
     funcDef->ident = ident;
@@ -1048,38 +607,14 @@ FuncDef *funcDefCreate(TypeSpecList *retType, size_t ptrCount, char *ident)
     return funcDef;
 }
 
-// Destructor for function definition
-void funcDefDestroy(FuncDef *funcDef)
-{
-    typeSpecListDestroy(funcDef->retType);
-    free(funcDef->ident);
-    if (funcDef->isParam)
-    {
-        declarationListDestroy(&(funcDef->args));
-    }
-    if (funcDef->body != NULL)
-    {
-        stmtDestroy(funcDef->body);
-    }
-    free(funcDef);
-}
-
 // constructor for initializer list
 InitList *initListCreate(size_t initListSize)
 {
-    InitList *initList = malloc(sizeof(InitList));
-    if (initList == NULL)
-    {
-        abort();
-    }
+    InitList *initList = astAlloc(sizeof(InitList));
 
     if (initListSize != 0)
     {
-        initList->inits = malloc(sizeof(Expr *) * initListSize);
-        if (initList->inits == NULL)
-        {
-            abort();
-        }
+        initList->inits = astAlloc(sizeof(Expr *) * initListSize);
     }
     else
     {
@@ -1091,17 +626,6 @@ InitList *initListCreate(size_t initListSize)
     return initList;
 }
 
-// Destructor for initialiser list
-void initListDestroy(InitList *initList)
-{
-    for (size_t i = 0; i < initList->size; i++)
-    {
-        initDestroy(initList->inits[i]);
-    }
-    free(initList->inits);
-    free(initList);
-}
-
 // Resize the initialiser list
 void initListResize(InitList *initList, const size_t initListSize)
 {
@@ -1110,25 +634,18 @@ void initListResize(InitList *initList, const size_t initListSize)
         initList->size = initListSize;
         if (initList->size > initList->capacity)
         {
+            size_t oldCapacity = initList->capacity;
             while (initList->size > initList->capacity)
             {
                 initList->capacity *= 2;
             }
-            initList->inits = realloc(initList->inits, sizeof(Expr *) * initList->capacity);
-            if (initList->inits == NULL)
-            {
-                abort();
-            }
+            initList->inits = astRealloc(initList->inits, sizeof(Expr *) * oldCapacity, sizeof(Expr *) * initList->capacity);
         }
     }
     else
     {
         initList->size = initListSize;
-        initList->inits = malloc(sizeof(Expr *) * initListSize);
-        if (initList->inits == NULL)
-        {
-            abort();
-        }
+        initList->inits = astAlloc(sizeof(Expr *) * initListSize);
         initList->capacity = initListSize;
     }
 }
@@ -1143,30 +660,12 @@ void initListPush(InitList *initList, Initializer *init)
 // constructor for an initializer
 Initializer *initCreate(void)
 {
-    Initializer *initializer = malloc(sizeof(Initializer));
-    if (initializer == NULL)
-    {
-        abort();
-    }
+    Initializer *initializer = astAlloc(sizeof(Initializer));
     initializer->initList = NULL;
     initializer->expr = NULL;
     return initializer;
 }
 
-// destructor for an initializer
-void initDestroy(Initializer *init)
-{
-    if (init->initList != NULL)
-    {
-        initListDestroy(init->initList);
-    }
-    if (init->expr != NULL)
-    {
-        exprDestroy(init->expr);
-    }
-    free(init);
-}
-
 // Returns the type field stored in an expression node
 DataType returnType(Expr *expr)
 {
@@ -1369,45 +868,19 @@ void resolveType(Expr *expr)
 // Constructor for external declaration
 ExternDecl *externDeclCreate(bool isFunc)
 {
-    ExternDecl *externDecl = malloc(sizeof(ExternDecl));
-    if (externDecl == NULL)
-    {
-        abort();
-    }
+    ExternDecl *externDecl = astAlloc(sizeof(ExternDecl));
     externDecl->isFunc = isFunc;
     return externDecl;
 }
 
-// Destructor for external declaration
-void externDeclDestroy(ExternDecl *externDecl)
-{
-    if (externDecl->isFunc)
-    {
-        funcDefDestroy(externDecl->funcDef);
-    }
-    else
-    {
-        declDestroy(externDecl->decl);
-    }
-    free(externDecl);
-}
-
 // Consstructor for translation unit
 TranslationUnit *transUnitCreate(size_t size)
 {
-    TranslationUnit *transUnit = malloc(sizeof(TranslationUnit));
-    if (transUnit == NULL)
-    {
-        abort();
-    }
+    TranslationUnit *transUnit = astAlloc(sizeof(TranslationUnit));
 
     if (size != 0)
     {
-        transUnit->externDecls = malloc(sizeof(ExternDecl *) * size);
-        if (transUnit->externDecls == NULL)
-        {
-            abort();
-        }
+        transUnit->externDecls = astAlloc(sizeof(ExternDecl *) * size);
     }
     else
     {
@@ -1419,17 +892,6 @@ TranslationUnit *transUnitCreate(size_t size)
     return transUnit;
 }
 
-// Destructor for translation unit
-void transUnitDestroy(TranslationUnit *transUnit)
-{
-    for (size_t i = 0; i < transUnit->size; i++)
-    {
-        externDeclDestroy(transUnit->externDecls[i]);
-    }
-    free(transUnit->externDecls);
-    free(transUnit);
-}
-
 // Resize the translation unit
 void transUnitResize(TranslationUnit *transUnit, const size_t size)
 {
@@ -1438,25 +900,18 @@ void transUnitResize(TranslationUnit *transUnit, const size_t size)
         transUnit->size = size;
         if (transUnit->size > transUnit->capacity)
         {
+            size_t oldCapacity = transUnit->capacity;
             while (transUnit->size > transUnit->capacity)
             {
                 transUnit->capacity *= 2;
             }
-            transUnit->externDecls = realloc(transUnit->externDecls, sizeof(ExternDecl *) * transUnit->capacity);
-            if (transUnit->externDecls == NULL)
-            {
-                abort();
-            }
+            transUnit->externDecls = astRealloc(transUnit->externDecls, sizeof(ExternDecl *) * oldCapacity, sizeof(ExternDecl *) * transUnit->capacity);
         }
     }
     else
     {
         transUnit->size = size;
-        transUnit->externDecls = malloc(sizeof(ExternDecl *) * size);
-        if (transUnit->externDecls == NULL)
-        {
-            abort();
-        }
+        transUnit->externDecls = astAlloc(sizeof(ExternDecl *) * size);
         transUnit->capacity = size;
     }
 }
@@ -1519,7 +974,6 @@ TypeSpecList *flattenTypeSpecs(TypeSpecList *typeSpecList)
         }
     }
 
-    typeSpecListDestroy(typeSpecList);
     TypeSpecList *flatList = typeSpecListCreate(1);
 
     if (signedCount > 1 && unsignedCount > 1)
@@ -364,118 +364,98 @@ typedef struct TranslationUnit
     size_t capacity;
 } TranslationUnit;
 
+// Called by the parser with each external declaration as soon as it has been
+// reduced, the declaration's nodes are only valid until the handler returns
+typedef void (*ExternDeclHandler)(TranslationUnit *externDecls);
+
+void *astAlloc(size_t size);
+void *astRealloc(void *ptr, size_t oldSize, size_t newSize);
+void astArenaRelease(void);
+void astArenaReset(void);
+size_t astAllocationCount(void);
+size_t astArenaPeakBytes(void);
+
 Expr *exprCreate(ExprType type);
-void exprDestroy(Expr *expr);
 
 VariableExpr *variableExprCreate(char *ident);
-void variableExprDestroy(VariableExpr *expr);
 
 ConstantExpr *constantExprCreate(DataType type, bool isString);
-void constantExprDestroy(ConstantExpr *expr);
 
 OperationExpr *operationExprCreate(const Operator operator);
-void operationExprDestroy(OperationExpr *expr);
 
 AssignExpr *assignExprCreate(Expr *op, Operator operator);
-void assignExprDestroy(AssignExpr *expr);
 
 FuncExpr *funcExprCreate(size_t argsSize);
 void funcExprArgsResize(FuncExpr *expr, size_t argsSize);
 void funcExprArgsPush(FuncExpr *expr, Expr *arg);
 Expr *funcExprArgsPop(FuncExpr *expr);
-void funcExprDestroy(FuncExpr *expr);
 
 Stmt *stmtCreate(StmtType type);
-void stmtDestroy(Stmt *stmt);
 
 WhileStmt *whileStmtCreate(Expr *condition, Stmt *body, bool doWhile);
-void whileStmtDestroy(WhileStmt *whileStmt);
 
 ForStmt *forStmtCreate(Stmt *init, Stmt *condition, Stmt *body);
-void forStmtDestroy(ForStmt *forStmt);
 
 IfStmt *ifStmtCreate(Expr *condition, Stmt *trueBody);
-void ifStmtDestroy(IfStmt *ifStmt);
 
 SwitchStmt *switchStmtCreate(Expr *selector, Stmt *body);
-void switchStmtDestroy(SwitchStmt *switchStmt);
 
 ExprStmt *exprStmtCreate(void);
-void exprStmtDestroy(ExprStmt *exprStmt);
 
 void statementListInit(StatementList *stmtList, size_t size);
-void statementListDestroy(StatementList *stmtList);
 void statementListResize(StatementList *stmtList, size_t size);
 void statementListPush(StatementList *stmtList, Stmt *stmt);
 
 void declarationListInit(DeclarationList *declList, size_t size);
-void declarationListDestroy(DeclarationList *declList);
 void declarationListResize(DeclarationList *declList, size_t size);
 void declarationListPush(DeclarationList *declList, Decl *decl);
 
 CompoundStmt *compoundStmtCreate(void);
-void compoundStmtDestroy(CompoundStmt *stmt);
 
 LabelStmt *labelStmtCreate(Stmt *body);
-void labelStmtDestroy(LabelStmt *labelStmt);
 
 JumpStmt *jumpStmtCreate(JumpType type);
-void jumpStmtDestroy(JumpStmt *jumpStmt);
 
 TypeSpecList *typeSpecListCreate(size_t typeSpecSize);
-void typeSpecListDestroy(TypeSpecList *typeSpecList);
 void typeSpecListResize(TypeSpecList *typeSpecList, const size_t typeSpecSize);
 void typeSpecListPush(TypeSpecList *typeSpecList, TypeSpecifier *typeSpec);
 TypeSpecList *typeSpecListCopy(TypeSpecList *typeSpecList);
 
 DeclInit *declInitCreate(Declarator *declarator);
-void declInitDestroy(DeclInit *declInit);
 
 Decl *declCreate(TypeSpecList *typeSpecList);
-void declDestroy(Decl *decl);
 
 DeclInitList *declInitListCreate(size_t declInitListSize);
-void declInitListDestroy(DeclInitList *declInitList);
 void declInitListResize(DeclInitList *declInitList, size_t declInitListSize);
 void declInitListPush(DeclInitList *declInitList, DeclInit *declInit);
 
 StructDecl *structDeclCreate(void);
-void structDeclDestroy(StructDecl *structDecl);
 
 StructDeclList *structDeclListCreate(size_t structDeclListSize);
-void structDeclListDestroy(StructDeclList *structDeclList);
 void structDeclListResize(StructDeclList *structDeclList, const size_t structDeclListSize);
 void structDeclListPush(StructDeclList *structDeclList, StructDecl *structDecl);
 
 StructSpecifier *structSpecifierCreate(void);
-void structSpecifierDestroy(StructSpecifier *structSpec);
 
 TypeSpecifier *typeSpecifierCreate(bool isStruct);
-void typeSpecifierDestroy(TypeSpecifier *typeSpecifier);
 TypeSpecifier *typeSpecifierCopy(TypeSpecifier *typeSpec);
 
 Declarator *declaratorCreate(void);
-void declaratorDestroy(Declarator *declarator);
 
 FuncDef *funcDefCreate(TypeSpecList *retType, size_t ptrCount, char *ident);
-void funcDefDestroy(FuncDef *funcDef);
 
 InitList *initListCreate(size_t initListSize);
-void initListDestroy(InitList *initList);
 void initListResize(InitList *initList, const size_t initListSize);
 void initListPush(InitList *initList, Initializer *init);
 
 Initializer *initCreate(void);
-void initDestroy(Initializer *init);
 
 DataType returnType(Expr *expr);
 void resolveType(Expr *expr);
 
 ExternDecl *externDeclCreate(bool isFunc);
-void externDeclDestroy(ExternDecl *externDecl);
 
 TranslationUnit *transUnitCreate(size_t size);
-void transUnitDestroy(TranslationUnit *transUnit);
 void transUnitResize(TranslationUnit *transUnit, const size_t size);
 void transUnitPush(TranslationUnit *transUnit, ExternDecl *externDecl);
 
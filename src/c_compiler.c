@@ -1,58 +1,158 @@
+#include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "ast.h"
 #include "codegen.h"
+#include "emit.h"
+#include "intern.h"
+#include "irinline.h"
 #include "parser.tab.h"
+#include "peephole.h"
+#include "report.h"
 #include "symbol.h"
 
+static SymbolTable *globalTable = NULL;
+
+// Scans and compiles each external declaration as soon as it is parsed, then
+// frees its nodes, so only one declaration's AST is ever held in memory
+static void compileExternDecls(TranslationUnit *externDecls)
+{
+    phaseEnd(PARSE_PHASE);
+
+    phaseBegin(SYMBOL_PHASE);
+    scanTransUnit(externDecls, globalTable);
+    phaseEnd(SYMBOL_PHASE);
+
+    phaseBegin(CODEGEN_PHASE);
+    compileTranslationUnit(externDecls);
+    phaseEnd(CODEGEN_PHASE);
+
+    phaseBegin(DESTROY_PHASE);
+    astArenaReset();
+    phaseEnd(DESTROY_PHASE);
+
+    phaseBegin(PARSE_PHASE);
+}
+
 int main(int argc, char **argv)
 {
-    if (argc != 5 && argc != 3)
+    char *inPath = NULL;
+    char *outPath = NULL;
+    bool timeReport = false;
+    bool memReport = false;
+    bool peepholeReporting = false;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "-S") == 0 && i + 1 < argc)
+        {
+            inPath = argv[++i];
+        }
+        else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc)
+        {
+            outPath = argv[++i];
+        }
+        else if (strcmp(argv[i], "-ftime-report") == 0)
+        {
+            timeReport = true;
+        }
+        else if (strcmp(argv[i], "-fmem-report") == 0)
+        {
+            memReport = true;
+        }
+        else if (strcmp(argv[i], "-fpeephole-report") == 0)
+        {
+            peepholeReporting = true;
+        }
+        else if (strcmp(argv[i], "-emit-ir") == 0)
+        {
+            emitIr = true;
+        }
+        else
+        {
+            inPath = NULL;
+            break;
+        }
+    }
+    if (inPath == NULL)
     {
         fprintf(stderr, "Incorrect usage, exitting...\n");
         return EXIT_FAILURE;
     }
-    if (argc == 5)
+
+    yyin = fopen(inPath, "r");
+    if (yyin == NULL)
+    {
+        fprintf(stderr, "Unable to open source file, exitting...\n");
+        return EXIT_FAILURE;
+    }
+    if (outPath != NULL)
     {
-        yyin = fopen(argv[2], "r");
-        if (yyin == NULL)
-        {
-            fprintf(stderr, "Unable to open source file, exitting...\n");
-            return EXIT_FAILURE;
-        }
-        outFile = fopen(argv[4], "w");
+        outFile = fopen(outPath, "w");
         if (outFile == NULL)
         {
             fprintf(stderr, "Unable to open output file for writting, exitting...\n");
             fclose(yyin);
+            return EXIT_FAILURE;
         }
     }
     else
     {
-        yyin = fopen(argv[2], "r");
-        if (yyin == NULL)
-        {
-            fprintf(stderr, "Unable to open source file, exitting...\n");
-            return EXIT_FAILURE;
-        }
         fprintf(stderr, "No output file specified, outputing to STDOUT...\n");
         outFile = stdout;
     }
+
+    // the symbol and codegen phases run from inside the parser, see compileExternDecls
+    globalTable = symbolTableCreate(0, 0, NULL, NULL);
+    externDeclHandler = compileExternDecls;
+    phaseBegin(PARSE_PHASE);
     yyparse();
-    SymbolTable *globalTable = populateSymbolTable(root);
-    displaySymbolTable(globalTable);
+    phaseEnd(PARSE_PHASE);
 
-    compileTranslationUnit(root);
-    transUnitDestroy(root);
-    symbolTableDestroy(globalTable);
+    // literals are shared by the whole file and follow its last declaration
+    phaseBegin(CODEGEN_PHASE);
+    compileConstantPool();
+    phaseEnd(CODEGEN_PHASE);
 
-    fclose(yyin);
-    if (argc == 5)
+    phaseBegin(SYMBOL_DUMP_PHASE);
+    displaySymbolTable(globalTable);
+    phaseEnd(SYMBOL_DUMP_PHASE);
+
+    phaseBegin(OUTPUT_PHASE);
+    emitFlush();
+    if (outPath != NULL)
     {
         fclose(outFile);
     }
+    phaseEnd(OUTPUT_PHASE);
+
+    // gather counts before the structures they describe are freed
+    MemoryStats stats = {0};
+    stats.astAllocations = astAllocationCount();
+    stats.astArenaBytes = astArenaPeakBytes();
+    stats.internedStrings = internCount();
+    stats.internBytes = internBytes();
+    symbolTableCount(globalTable, &stats.symbolTables, &stats.symbolEntries);
+    stats.outputBytes = emitBytesWritten();
+
+    phaseBegin(DESTROY_PHASE);
+    astArenaRelease();
+    irInlineRelease();
+    symbolTableDestroy(globalTable);
+    internTableDestroy();
+    fclose(yyin);
     // TODO: Maybe remove
     yylex_destroy();
+    phaseEnd(DESTROY_PHASE);
+
+    if (timeReport || memReport)
+    {
+        reportPrint(stderr, &stats, timeReport, memReport);
+    }
+    if (peepholeReporting)
+    {
+        peepholeReport(stderr);
+    }
     return EXIT_SUCCESS;
 }
@@ -2,17 +2,23 @@
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "ast.h"
 #include "codegen.h"
+#include "emit.h"
+#include "ir.h"
+#include "irgen.h"
+#include "irinline.h"
+#include "iropt.h"
+#include "peephole.h"
+#include "regalloc.h"
 #include "symbol.h"
 
 FILE *outFile;
+bool emitIr = false;
 
 size_t LCLabelId = 0;
-size_t ifLabelId = 0;
-bool regs[64] = {0};
-int ternID = 0;
 
 const char *regStr(Reg reg)
 {
@@ -149,1927 +155,1329 @@ const char *regStr(Reg reg)
     }
 }
 
-// Returns a temporary register
-Reg getTmpReg(void)
+// Gets a "unique" number, aborts if we run out of numbers
+size_t getId(size_t *num)
+{
+    if (*num + 1 < *num)
+    {
+        abort();
+    }
+    return (*num)++; // TODO: Check if this works as expected
+}
+
+/* Constant pool */
+
+typedef enum PoolKind
+{
+    POOL_FLOAT,
+    POOL_DOUBLE,
+    POOL_STRING
+} PoolKind;
+
+typedef struct PoolEntry
+{
+    PoolKind kind;
+    uint64_t bits;   // FLOAT and DOUBLE, the exact bit pattern
+    const char *str; // STRING, interned so equal literals share a pointer
+    size_t labelId;
+} PoolEntry;
+
+// Literals of the translation unit, each emitted once after its last function
+typedef struct ConstantPool
+{
+    PoolEntry *entries;
+    size_t size;
+    size_t capacity;
+
+    // open addressing index over entries, SIZE_MAX marks a free slot
+    size_t *index;
+    size_t indexCapacity;
+} ConstantPool;
+
+static ConstantPool pool;
+
+static uint32_t floatBits(const float value)
+{
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+static uint64_t doubleBits(const double value)
+{
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+static size_t poolHash(const PoolKind kind, const uint64_t bits, const char *str)
+{
+    uint64_t hash = (bits ^ ((uintptr_t)str >> 3)) + ((uint64_t)kind << 59);
+    hash *= 0x9E3779B97F4A7C15u;
+    return (size_t)(hash >> 32);
+}
+
+static void poolIndexInsert(const size_t entry)
+{
+    PoolEntry *e = &pool.entries[entry];
+    size_t mask = pool.indexCapacity - 1;
+    size_t slot = poolHash(e->kind, e->bits, e->str) & mask;
+    while (pool.index[slot] != SIZE_MAX)
+    {
+        slot = (slot + 1) & mask;
+    }
+    pool.index[slot] = entry;
+}
+
+// Gets the label of a literal, adding it to the pool the first time it is seen
+static size_t poolLabel(const PoolKind kind, const uint64_t bits, const char *str)
 {
-    for (size_t i = 0; i < 32; i++)
+    if (pool.indexCapacity != 0)
     {
-        if (i == T0 || i == T1 || i == T2 || i == T3 || i == T4 || i == T5 || i == T6 ||
-            i == S1 || i == S2 || i == S3 || i == S4 || i == S5 || i == S6 || i == S7 || i == S8 || i == S9)
+        size_t mask = pool.indexCapacity - 1;
+        for (size_t slot = poolHash(kind, bits, str) & mask; pool.index[slot] != SIZE_MAX; slot = (slot + 1) & mask)
         {
-            if (!regs[i])
+            PoolEntry *e = &pool.entries[pool.index[slot]];
+            if (e->kind == kind && e->bits == bits && e->str == str)
             {
-                regs[i] = true;
-                return i;
+                return e->labelId;
             }
         }
     }
-    fprintf(stderr, "All registers filled, exiting...\n");
-    exit(-1);
+
+    if (pool.size == pool.capacity)
+    {
+        pool.capacity = pool.capacity == 0 ? 16 : pool.capacity * 2;
+        pool.entries = realloc(pool.entries, sizeof(PoolEntry) * pool.capacity);
+        if (pool.entries == NULL)
+        {
+            abort();
+        }
+    }
+    PoolEntry *entry = &pool.entries[pool.size++];
+    entry->kind = kind;
+    entry->bits = bits;
+    entry->str = str;
+    entry->labelId = getId(&LCLabelId);
+
+    // keep the load factor of the index at or under a half
+    if (2 * pool.size > pool.indexCapacity)
+    {
+        free(pool.index);
+        pool.indexCapacity = pool.indexCapacity == 0 ? 32 : pool.indexCapacity * 2;
+        pool.index = malloc(sizeof(size_t) * pool.indexCapacity);
+        if (pool.index == NULL)
+        {
+            abort();
+        }
+        memset(pool.index, 0xff, sizeof(size_t) * pool.indexCapacity);
+        for (size_t i = 0; i < pool.size; i++)
+        {
+            poolIndexInsert(i);
+        }
+    }
+    else
+    {
+        poolIndexInsert(pool.size - 1);
+    }
+    return entry->labelId;
 }
 
-// Returns a temporary register
-Reg getTmpFltReg(void)
+// Emits the pooled literals into mergeable read-only sections, so that the linker can also
+// share them between translation units, and empties the pool. Ends the assembly output.
+void compileConstantPool(void)
 {
-    for (size_t i = 32; i < 64; i++)
+    static const char *sections[] = {
+        [POOL_FLOAT] = "\t.section .rodata.cst4,\"aM\",@progbits,4\n\t.align 2\n",
+        [POOL_DOUBLE] = "\t.section .rodata.cst8,\"aM\",@progbits,8\n\t.align 3\n",
+        [POOL_STRING] = "\t.section .rodata.str1.1,\"aMS\",@progbits,1\n"};
+
+    peepholeBegin();
+
+    for (PoolKind kind = POOL_FLOAT; kind <= POOL_STRING; kind++)
     {
-        if (i == FT0 || i == FT1 || i == FT2 || i == FT3 || i == FT4 || i == FT5 || i == FT6 || i == FT7 || i == FT8 || i == FT9 || i == FT10 || i == FT11)
+        bool started = false;
+        for (size_t i = 0; i < pool.size; i++)
         {
-            if (!regs[i])
+            PoolEntry *entry = &pool.entries[i];
+            if (entry->kind != kind)
+            {
+                continue;
+            }
+            if (!started)
+            {
+                emit("%s", sections[kind]);
+                started = true;
+            }
+            emit(".LC%zu:\n", entry->labelId);
+            if (kind == POOL_STRING)
+            {
+                emit("\t.string \"%s\"\n", entry->str);
+            }
+            else
             {
-                regs[i] = true;
-                return i;
+                // doubles are two little endian words
+                emit("\t.word %u\n", (unsigned int)(uint32_t)entry->bits);
+                if (kind == POOL_DOUBLE)
+                {
+                    emit("\t.word %u\n", (unsigned int)(entry->bits >> 32));
+                }
             }
         }
     }
-    fprintf(stderr, "All floating-point registers filled, exiting...\n");
-    exit(-1);
+    if (pool.size != 0)
+    {
+        emit(".text\n");
+    }
+    free(pool.entries);
+    free(pool.index);
+    memset(&pool, 0, sizeof(pool));
+    peepholeEnd();
+    peepholeFinish();
+}
+
+/* Instruction selection */
+
+// largest offset a load, store or addi can encode
+#define MAX_IMM 2047
+#define MIN_IMM -2048
+
+typedef struct Selection
+{
+    IrFunc *func;
+    RegAlloc *alloc;
+    size_t callIndex; // calls selected so far
+    IrBlock *block;   // block being selected
+
+    // block that saves ra and the callee-saved registers in use, NULL when none need saving
+    IrBlock *savePoint;
+    bool saveRa;
+
+    // the saved registers sit right below fp, the locals and spill slots below them
+    size_t saveSlots[64]; // offset below fp of a saved register's slot
+    size_t saveAreaSize;
+} Selection;
+
+static Reg physReg(Selection *sel, const size_t vreg)
+{
+    return sel->alloc->regs[vreg];
 }
 
-// Free a register
-void freeReg(Reg reg)
+// right operand of a binary operation or comparison, a zero immediate is the zero register
+static Reg rhsReg(Selection *sel, IrInstr *instr)
 {
-    regs[reg] = false;
+    return instr->src[1] != 0 ? physReg(sel, instr->src[1]) : ZERO;
 }
 
-// Gets a "unique" number, aborts if we run out of numbers
-size_t getId(size_t *num)
+static const char *floatSuffix(const IrType type)
 {
-    if (*num + 1 < *num)
+    return type == IR_F64 ? "d" : "s";
+}
+
+static void emitBlockLabel(Selection *sel, IrBlock *block)
+{
+    emit(".L%s_%zu", sel->func->ident, block->id);
+}
+
+// offset from fp of a local, spill slot or float save slot
+static long frameOffset(Selection *sel, const size_t offset)
+{
+    return -(long)(sel->saveAreaSize + offset);
+}
+
+// mnemonic reg, offset(fp) for any offset
+static void emitFrameAccess(const char *mnemonic, const Reg reg, const long offset)
+{
+    if (offset >= MIN_IMM && offset <= MAX_IMM)
     {
-        abort();
+        emit("\t%s %r, %li(fp)\n", mnemonic, reg, offset);
+    }
+    else
+    {
+        emit("\tli %r, %li\n", SCRATCH_REG, offset);
+        emit("\tadd %r, %r, fp\n", SCRATCH_REG, SCRATCH_REG);
+        emit("\t%s %r, 0(%r)\n", mnemonic, reg, SCRATCH_REG);
     }
-    return (*num)++; // TODO: Check if this works as expected
 }
 
-void compileExpr(Expr *expr, Reg dest)
+static void emitSymbol(SymbolEntry *var, const int32_t imm)
 {
-    switch (expr->type)
-    {
-    case OPERATION_EXPR:
+    if (imm == 0)
     {
-        compileOperationExpr(expr->operation, dest);
-        break;
+        emit("%s", var->ident);
     }
-    case CONSTANT_EXPR:
+    else
     {
-        compileConstantExpr(expr->constant, dest);
-        break;
+        emit("%s%s%i", var->ident, imm > 0 ? "+" : "", imm);
+    }
+}
+
+static const char *loadMnemonic(const IrType memType)
+{
+    switch (memType)
+    {
+    case IR_I8:
+        return "lb";
+    case IR_I16:
+        return "lh";
+    case IR_F32:
+        return "flw";
+    case IR_F64:
+        return "fld";
+    default:
+        return "lw";
     }
-    case VARIABLE_EXPR:
+}
+
+static const char *storeMnemonic(const IrType memType)
+{
+    switch (memType)
+    {
+    case IR_I8:
+        return "sb";
+    case IR_I16:
+        return "sh";
+    case IR_F32:
+        return "fsw";
+    case IR_F64:
+        return "fsd";
+    default:
+        return "sw";
+    }
+}
+
+static void selectMemory(Selection *sel, IrInstr *instr)
+{
+    bool isLoad = instr->op == IR_LOAD;
+    const char *mnemonic = isLoad ? loadMnemonic(instr->memType) : storeMnemonic(instr->memType);
+    Reg value = physReg(sel, isLoad ? instr->dest : instr->src[0]);
+    if (instr->var == NULL)
     {
-        compileVariableExpr(expr->variable, dest);
-        break;
+        emit("\t%s %r, %i(%r)\n", mnemonic, value, instr->imm, physReg(sel, isLoad ? instr->src[0] : instr->src[1]));
     }
-    case ASSIGN_EXPR:
+    else if (!instr->var->isGlobal)
     {
-        compileAssignExpr(expr->assignment, dest);
-        break;
+        emitFrameAccess(mnemonic, value, (long)instr->imm + frameOffset(sel, instr->var->stackOffset));
     }
-    case FUNC_EXPR:
+    else if (isLoad && !irIsFloatType(instr->memType))
     {
-        compileFuncExpr(expr->function, dest);
-        break;
+        // the loaded register doubles as the address temporary
+        emit("\t%s %r, ", mnemonic, value);
+        emitSymbol(instr->var, instr->imm);
+        emit("\n");
     }
+    else
+    {
+        emit("\t%s %r, ", mnemonic, value);
+        emitSymbol(instr->var, instr->imm);
+        emit(", %r\n", SCRATCH_REG);
     }
 }
 
-void compileConstantExpr(ConstantExpr *expr, const Reg dest)
+static void selectAddress(Selection *sel, IrInstr *instr)
 {
-    if (expr->isString)
+    Reg dest = physReg(sel, instr->dest);
+    if (instr->var->isGlobal)
+    {
+        emit("\tla %r, %s\n", dest, instr->var->ident);
+        return;
+    }
+    long offset = frameOffset(sel, instr->var->stackOffset);
+    if (offset >= MIN_IMM)
     {
-        uint64_t labelId = getId(&LCLabelId);
-        fprintf(outFile, ".section .sdata\n");
-        fprintf(outFile, ".align 2\n");
-        fprintf(outFile, ".LC%lu:\n", labelId);
-        fprintf(outFile, "\t.string \"%s\"\n", expr->string_const);
-        fprintf(outFile, ".text\n");
-        fprintf(outFile, "\tla %s, .LC%lu\n", regStr(dest), labelId);
+        emit("\taddi %r, fp, %li\n", dest, offset);
     }
     else
     {
-        switch (expr->type)
-        {
-        case INT_TYPE:
-        {
-            fprintf(outFile, "\tli %s, %i\n", regStr(dest), expr->int_const);
-            break;
-        }
-        case CHAR_TYPE:
-        {
-            fprintf(outFile, "\tli %s, %u\n", regStr(dest), expr->char_const); // TODO: Switch to hex format, check if there is unsigned version, switch to non-pseudoinstruction for char
-            break;
-        }
-        case FLOAT_TYPE:
-        {
-            Reg address = getTmpReg();
-            uint64_t labelId = getId(&LCLabelId);
-            fprintf(outFile, ".section .rodata\n");
-            fprintf(outFile, ".LC%lu:\n", labelId);
-            fprintf(outFile, "\t.float %f\n", expr->float_const);
-            fprintf(outFile, ".text\n");
-            fprintf(outFile, "\tlui %s, %%hi(.LC%lu)\n", regStr(address), labelId);
-            fprintf(outFile, "\tflw %s, %%lo(.LC%lu)(%s)\n", regStr(dest), labelId, regStr(address));
-            break;
-        }
-        default:
-        {
-            fprintf(stderr, "Non-long types not supported, exiting...\n");
-            exit(EXIT_FAILURE);
-        }
-        }
+        emit("\tli %r, %li\n", dest, offset);
+        emit("\tadd %r, %r, fp\n", dest, dest);
     }
 }
 
-void compileOperationExpr(OperationExpr *expr, const Reg dest)
+static void selectConstant(Selection *sel, IrInstr *instr)
 {
-    switch (expr->operator)
+    Reg dest = physReg(sel, instr->dest);
+    if (instr->op == IR_LI)
     {
-    case ADD:
-    {
-        switch (expr->type)
-        {
-        case FLOAT_TYPE:
-        {
-            // TODO: Deal with non-long types
-            Reg op1 = getTmpFltReg();
-            Reg op2 = getTmpFltReg();
-            compileExpr(expr->op1, op1);
-            compileExpr(expr->op2, op2);
-            fprintf(outFile, "\tfadd.s %s, %s, %s\n", regStr(dest), regStr(op1), regStr(op2));
-            freeReg(op1);
-            freeReg(op2);
-            break;
-        }
-        case DOUBLE_TYPE:
-        {
-            // TODO: Deal with non-long types
-            Reg op1 = getTmpFltReg();
-            Reg op2 = getTmpFltReg();
-            compileExpr(expr->op1, op1);
-            compileExpr(expr->op2, op2);
-            fprintf(outFile, "\tfadd.d %s, %s, %s\n", regStr(dest), regStr(op1), regStr(op2));
-            freeReg(op1);
-            freeReg(op2);
-            break;
-        }
-        default:
-        {
-            if (isPtr(expr->type))
-            {
-                bool op1Ptr = isPtr(returnType(expr->op1));
-                bool op2Ptr = isPtr(returnType(expr->op2));
-                if (op1Ptr && op2Ptr)
-                {
-                    Reg op1 = getTmpReg();
-                    Reg op2 = getTmpReg();
-                    compileExpr(expr->op1, op1);
-                    compileExpr(expr->op2, op2);
-                    fprintf(outFile, "\tadd %s, %s, %s\n", regStr(dest), regStr(op1), regStr(op2));
-                    freeReg(op1);
-                    freeReg(op2);
-                }
-                else
-                {
-                    // TODO: Deal with non-long types
-                    Reg op1 = getTmpReg();
-                    Reg op2 = getTmpReg();
-                    compileExpr(expr->op1, op1);
-                    compileExpr(expr->op2, op2);
-                    fprintf(outFile, "\tli %s, %lu\n", regStr(dest), typeSize(removerPtrFromType(expr->type)));
-                    if (op1Ptr)
-                    {
-                        fprintf(outFile, "\tmul %s, %s, %s\n", regStr(op2), regStr(op2), regStr(dest));
-                    }
-                    else
-                    {
-                        fprintf(outFile, "\tmul %s, %s, %s\n", regStr(op1), regStr(op1), regStr(dest));
-                    }
-                    fprintf(outFile, "\tadd %s, %s, %s\n", regStr(dest), regStr(op1), regStr(op2));
-                    freeReg(op1);
-                    freeReg(op2);
-                }
-            }
-            else
-            {
-                // TODO: Deal with non-long types
-                Reg op1 = getTmpReg();
-                Reg op2 = getTmpReg();
-                compileExpr(expr->op1, op1);
-                compileExpr(expr->op2, op2);
-                fprintf(outFile, "\tadd %s, %s, %s\n", regStr(dest), regStr(op1), regStr(op2));
-                freeReg(op1);
-                freeReg(op2);
-            }
-            break;
-        }
-        }
-        break;
+        emit("\tli %r, %i\n", dest, instr->imm);
+        return;
     }
-    case SUB:
+    switch (instr->op)
     {
-        switch (expr->type)
+    case IR_LF:
+        if (instr->type == IR_F32 && (floatBits((float)instr->fimm) & 0xfff) == 0)
         {
-        case FLOAT_TYPE:
-        {
-            if (expr->op2 == NULL)
-            {
-                compileExpr(expr->op1, dest);
-                fprintf(outFile, "\tfneg.s %s, %s\n", regStr(dest), regStr(dest));
-            }
-            else
+            // the bit pattern is a lui immediate, or zero for 0.0
+            uint32_t bits = floatBits((float)instr->fimm);
+            if (bits != 0)
             {
-                Reg op1 = getTmpFltReg();
-                Reg op2 = getTmpFltReg();
-                compileExpr(expr->op1, op1);
-                compileExpr(expr->op2, op2);
-                fprintf(outFile, "\tfsub.s %s, %s, %s\n", regStr(dest), regStr(op1), regStr(op2));
-                freeReg(op1);
-                freeReg(op2);
+                emit("\tlui %r, %u\n", SCRATCH_REG, bits >> 12);
             }
-            break;
+            emit("\tfmv.w.x %r, %r\n", dest, bits != 0 ? SCRATCH_REG : ZERO);
         }
-        case DOUBLE_TYPE:
+        else if (instr->type == IR_F64 && instr->fimm >= MIN_IMM && instr->fimm <= MAX_IMM &&
+                 instr->fimm == (int32_t)instr->fimm && doubleBits(instr->fimm) != doubleBits(-0.0))
         {
-            if (expr->op2 == NULL)
-            {
-                compileExpr(expr->op1, dest);
-                fprintf(outFile, "\tfneg.s %s, %s\n", regStr(dest), regStr(dest));
-            }
-            else
+            // small integers convert exactly, RV32 has no move into a double register
+            if (instr->fimm != 0.0)
             {
-                Reg op1 = getTmpFltReg();
-                Reg op2 = getTmpFltReg();
-                compileExpr(expr->op1, op1);
-                compileExpr(expr->op2, op2);
-                fprintf(outFile, "\tfsub.d %s, %s, %s\n", regStr(dest), regStr(op1), regStr(op2));
-                freeReg(op1);
-                freeReg(op2);
+                emit("\tli %r, %i\n", SCRATCH_REG, (int32_t)instr->fimm);
             }
-            break;
+            emit("\tfcvt.d.w %r, %r\n", dest, instr->fimm != 0.0 ? SCRATCH_REG : ZERO);
         }
-        default:
+        else
         {
-            if (expr->op2 == NULL)
-            {
-                compileExpr(expr->op1, dest);
-                fprintf(outFile, "\tneg %s, %s\n", regStr(dest), regStr(dest));
-            }
-            else
-            {
-                // TODO: Deal with non-long types
-                Reg op1 = getTmpReg();
-                Reg op2 = getTmpReg();
-                compileExpr(expr->op1, op1);
-                compileExpr(expr->op2, op2);
-                fprintf(outFile, "\tsub %s, %s, %s\n", regStr(dest), regStr(op1), regStr(op2));
-                freeReg(op1);
-                freeReg(op2);
-            }
-            break;
-        }
+            size_t labelId = instr->type == IR_F64 ? poolLabel(POOL_DOUBLE, doubleBits(instr->fimm), NULL)
+                                                   : poolLabel(POOL_FLOAT, floatBits((float)instr->fimm), NULL);
+            emit("\tlui %r, %%hi(.LC%zu)\n", SCRATCH_REG, labelId);
+            emit("\t%s %r, %%lo(.LC%zu)(%r)\n", loadMnemonic(instr->type), dest, labelId, SCRATCH_REG);
         }
         break;
+    default:
+        emit("\tla %r, .LC%zu\n", dest, poolLabel(POOL_STRING, 0, instr->str));
+        break;
     }
-    case MUL:
+}
+
+static void emitMove(const IrType type, const Reg dest, const Reg src)
+{
+    if (dest == src)
     {
-        switch (expr->type)
-        {
-        case FLOAT_TYPE:
-        {
-            // TODO: Deal with non-long types
-            Reg op1 = getTmpFltReg();
-            Reg op2 = getTmpFltReg();
-            compileExpr(expr->op1, op1);
-            compileExpr(expr->op2, op2);
-            fprintf(outFile, "\tfmul.s %s, %s, %s\n", regStr(dest), regStr(op1), regStr(op2));
-            freeReg(op1);
-            freeReg(op2);
-            break;
-        }
-        case DOUBLE_TYPE:
-        {
-            // TODO: Deal with non-long types
-            Reg op1 = getTmpFltReg();
-            Reg op2 = getTmpFltReg();
-            compileExpr(expr->op1, op1);
-            compileExpr(expr->op2, op2);
-            fprintf(outFile, "\tfmul.d %s, %s, %s\n", regStr(dest), regStr(op1), regStr(op2));
-            freeReg(op1);
-            freeReg(op2);
-            break;
-        }
-        default:
-        {
-            // TODO: Deal with non-long types
-            Reg op1 = getTmpReg();
-            Reg op2 = getTmpReg();
-            compileExpr(expr->op1, op1);
-            compileExpr(expr->op2, op2);
-            fprintf(outFile, "\tmul %s, %s, %s\n", regStr(dest), regStr(op1), regStr(op2));
-            freeReg(op1);
-            freeReg(op2);
-            break;
-        }
-        }
-        break;
+        return;
     }
-    case DIV:
+    if (irIsFloatType(type))
     {
-        switch (expr->type)
-        {
-        case FLOAT_TYPE:
-        {
-            // TODO: Deal with non-long types
-            Reg op1 = getTmpFltReg();
-            Reg op2 = getTmpFltReg();
-            compileExpr(expr->op1, op1);
-            compileExpr(expr->op2, op2);
-            fprintf(outFile, "\tfdiv.s %s, %s, %s\n", regStr(dest), regStr(op1), regStr(op2));
-            freeReg(op1);
-            freeReg(op2);
-            break;
-        }
-        case DOUBLE_TYPE:
-        {
-            // TODO: Deal with non-long types
-            Reg op1 = getTmpFltReg();
-            Reg op2 = getTmpFltReg();
-            compileExpr(expr->op1, op1);
-            compileExpr(expr->op2, op2);
-            fprintf(outFile, "\tfdiv.d %s, %s, %s\n", regStr(dest), regStr(op1), regStr(op2));
-            freeReg(op1);
-            freeReg(op2);
-            break;
-        }
-        default:
-        {
-            // TODO: Deal with non-long types
-            Reg op1 = getTmpReg();
-            Reg op2 = getTmpReg();
-            compileExpr(expr->op1, op1);
-            compileExpr(expr->op2, op2);
-            fprintf(outFile, "\tdiv %s, %s, %s\n", regStr(dest), regStr(op1), regStr(op2));
-            freeReg(op1);
-            freeReg(op2);
-            break;
-        }
-        }
-        break;
+        emit("\tfmv.%s %r, %r\n", floatSuffix(type), dest, src);
     }
-    case MOD:
-    {
-        // TODO: Deal with non-long types
-        // TODO: Deal with unsigned division
-        Reg op1 = getTmpReg();
-        Reg op2 = getTmpReg();
-        compileExpr(expr->op1, op1);
-        compileExpr(expr->op2, op2);
-        fprintf(outFile, "\trem %s, %s, %s\n", regStr(dest), regStr(op1), regStr(op2));
-        freeReg(op1); // TODO: Test register eviction
-        freeReg(op2);
-        break;
+    else
+    {
+        emit("\tmv %r, %r\n", dest, src);
     }
-    case NOT:
+}
+
+static void selectConvert(Selection *sel, IrInstr *instr)
+{
+    IrType from = sel->func->vregTypes[instr->src[0]];
+    Reg dest = physReg(sel, instr->dest);
+    Reg src = physReg(sel, instr->src[0]);
+    if (instr->type == IR_I32)
     {
-        // TODO: Deal with unsigned
-        Reg op1 = getTmpReg();
-        compileExpr(expr->op1, op1);
-        fprintf(outFile, "\tsgtz %s, %s\n", regStr(op1), regStr(op1));
-        fprintf(outFile, "\tnot %s, %s\n", regStr(dest), regStr(op1));
-        freeReg(op1); // TODO: Test register eviction
-        break;
+        // C truncates towards zero
+        emit("\tfcvt.w.%s %r, %r, rtz\n", floatSuffix(from), dest, src);
     }
-    case NOT_BIT:
+    else if (from == IR_I32)
     {
-        // TODO: Deal with unsigned
-        Reg op1 = getTmpReg();
-        compileExpr(expr->op1, op1);
-        fprintf(outFile, "\tnot %s, %s\n", regStr(dest), regStr(op1));
-        freeReg(op1); // TODO: Test register eviction
-        break;
+        emit("\tfcvt.%s.w %r, %r\n", floatSuffix(instr->type), dest, src);
     }
-    case EQ:
+    else
     {
-        // if one of the ops is a float (cant use expr->type)
-        if (returnType(expr->op1) == FLOAT_TYPE)
-        {
-            // TODO: Deal with signs
-            Reg op1 = getTmpFltReg();
-            Reg op2 = getTmpFltReg();
-            compileExpr(expr->op1, op1);
-            compileExpr(expr->op2, op2);
-            fprintf(outFile, "\tfeq.s %s, %s, %s\n", regStr(dest), regStr(op1), regStr(op2));
-            freeReg(op1); // TODO: Test register eviction
-            freeReg(op2);
-            break;
-        }
-        else
-        {
-            // TODO: Deal with signs
-            Reg op1 = getTmpReg();
-            Reg op2 = getTmpReg();
-            compileExpr(expr->op1, op1);
-            compileExpr(expr->op2, op2);
-            fprintf(outFile, "\tsub %s, %s, %s\n", regStr(dest), regStr(op1), regStr(op2));
-            fprintf(outFile, "\tseqz %s, %s\n", regStr(dest), regStr(dest));
-            freeReg(op1); // TODO: Test register eviction
-            freeReg(op2);
-            break;
-        }
+        emit("\tfcvt.%s.%s %r, %r\n", floatSuffix(instr->type), floatSuffix(from), dest, src);
     }
-    case NE:
+}
+
+static void selectArith(Selection *sel, IrInstr *instr)
+{
+    static const char *intNames[] = {
+        [IR_ADD] = "add",
+        [IR_SUB] = "sub",
+        [IR_MUL] = "mul",
+        [IR_DIV] = "div",
+        [IR_NEG] = "neg",
+        [IR_DIVU] = "divu",
+        [IR_MULH] = "mulh",
+        [IR_MULHU] = "mulhu",
+        [IR_REM] = "rem",
+        [IR_REMU] = "remu",
+        [IR_AND] = "and",
+        [IR_OR] = "or",
+        [IR_XOR] = "xor",
+        [IR_SHL] = "sll",
+        [IR_SHR] = "srl",
+        [IR_SAR] = "sra",
+        [IR_NOT] = "not",
+        [IR_LNOT] = "seqz",
+        [IR_BOOL] = "snez"};
+    static const char *floatNames[] = {
+        [IR_ADD] = "fadd",
+        [IR_SUB] = "fsub",
+        [IR_MUL] = "fmul",
+        [IR_DIV] = "fdiv",
+        [IR_NEG] = "fneg"};
+    // operations irSelectImmediates gives an immediate right operand
+    static const char *immNames[] = {
+        [IR_ADD] = "addi",
+        [IR_AND] = "andi",
+        [IR_OR] = "ori",
+        [IR_XOR] = "xori",
+        [IR_SHL] = "slli",
+        [IR_SHR] = "srli",
+        [IR_SAR] = "srai"};
+
+    Reg dest = physReg(sel, instr->dest);
+    if (irIsFloatType(instr->type))
     {
-        if (returnType(expr->op1) == FLOAT_TYPE)
-        {
-            // TODO: Deal with signs
-            Reg op1 = getTmpFltReg();
-            Reg op2 = getTmpFltReg();
-            compileExpr(expr->op1, op1);
-            compileExpr(expr->op2, op2);
-            fprintf(outFile, "\tfeq.s %s, %s, %s\n", regStr(dest), regStr(op1), regStr(op2));
-            fprintf(outFile, "\txor %s, %s, %i\n", regStr(dest), regStr(dest), 1);
-            freeReg(op1); // TODO: Test register eviction
-            freeReg(op2);
-            break;
-        }
-        else
-        {
-            // TODO: Deal with signs
-            Reg op1 = getTmpReg();
-            Reg op2 = getTmpReg();
-            compileExpr(expr->op1, op1);
-            compileExpr(expr->op2, op2);
-            fprintf(outFile, "\tsub %s, %s, %s\n", regStr(dest), regStr(op1), regStr(op2));
-            fprintf(outFile, "\tsnez %s, %s\n", regStr(dest), regStr(dest));
-            freeReg(op1); // TODO: Test register eviction
-            freeReg(op2);
-            break;
-        }
+        emit("\t%s.%s %r, %r", floatNames[instr->op], floatSuffix(instr->type), dest, physReg(sel, instr->src[0]));
     }
-    case LT:
+    else if (instr->src[1] == 0 && instr->op < sizeof(immNames) / sizeof(immNames[0]) && immNames[instr->op] != NULL)
     {
-        if (returnType(expr->op1) == FLOAT_TYPE)
-        {
-            // TODO: Deal with signs
-            Reg op1 = getTmpFltReg();
-            Reg op2 = getTmpFltReg();
-            compileExpr(expr->op1, op1);
-            compileExpr(expr->op2, op2);
-            fprintf(outFile, "\tflt.s %s, %s, %s\n", regStr(dest), regStr(op1), regStr(op2));
-            freeReg(op1); // TODO: Test register eviction
-            freeReg(op2);
-            break;
-        }
-        else
-        {
-            // TODO: Deal with signs
-            Reg op1 = getTmpReg();
-            Reg op2 = getTmpReg();
-            compileExpr(expr->op1, op1);
-            compileExpr(expr->op2, op2);
-            fprintf(outFile, "\tslt %s, %s, %s\n", regStr(dest), regStr(op1), regStr(op2));
-            freeReg(op1); // TODO: Test register eviction
-            freeReg(op2);
-            break;
-        }
+        emit("\t%s %r, %r, %i", immNames[instr->op], dest, physReg(sel, instr->src[0]), instr->imm);
+    }
+    else
+    {
+        emit("\t%s %r, %r", intNames[instr->op], dest, physReg(sel, instr->src[0]));
+    }
+    if (irSrcCount(instr) == 2)
+    {
+        emit(", %r", physReg(sel, instr->src[1]));
     }
-    case GT:
+    emit("\n");
+}
+
+static void selectCompare(Selection *sel, IrInstr *instr)
+{
+    IrType type = sel->func->vregTypes[instr->src[0]];
+    Reg dest = physReg(sel, instr->dest);
+    Reg lhs = physReg(sel, instr->src[0]);
+    Reg rhs = rhsReg(sel, instr);
+    bool swap = instr->op == IR_GT || instr->op == IR_GTU;
+    bool invert = instr->op == IR_NE;
+
+    if (irIsFloatType(type))
     {
-        if (returnType(expr->op1) == FLOAT_TYPE)
+        const char *name = "feq";
+        if (instr->op == IR_LT || instr->op == IR_GT)
         {
-            // TODO: Deal with signs
-            Reg op1 = getTmpFltReg();
-            Reg op2 = getTmpFltReg();
-            compileExpr(expr->op1, op1);
-            compileExpr(expr->op2, op2);
-            fprintf(outFile, "\tflt.s %s, %s, %s\n", regStr(dest), regStr(op2), regStr(op1));
-            freeReg(op1); // TODO: Test register eviction
-            freeReg(op2);
-            break;
+            name = "flt";
         }
-        else
+        else if (instr->op == IR_LE || instr->op == IR_GE)
         {
-            // TODO: Deal with signs
-            // TODO: Test the damn code
-            Reg op1 = getTmpReg();
-            Reg op2 = getTmpReg();
-            compileExpr(expr->op1, op1);
-            compileExpr(expr->op2, op2);
-            fprintf(outFile, "\tslt %s, %s, %s\n", regStr(dest), regStr(op2), regStr(op1));
-            freeReg(op1); // TODO: Test register eviction
-            freeReg(op2);
-            break;
+            name = "fle";
+            swap = instr->op == IR_GE;
         }
+        emit("\t%s.%s %r, %r, %r\n", name, floatSuffix(type), dest, swap ? rhs : lhs, swap ? lhs : rhs);
     }
-    case LE:
+    else if (instr->op == IR_EQ || instr->op == IR_NE)
     {
-        if (returnType(expr->op1) == FLOAT_TYPE)
+        // against an immediate the difference is an add of its negation, against zero it is lhs itself
+        if (instr->src[1] != 0)
         {
-            // TODO: Deal with signs
-            Reg op1 = getTmpFltReg();
-            Reg op2 = getTmpFltReg();
-            compileExpr(expr->op1, op1);
-            compileExpr(expr->op2, op2);
-            fprintf(outFile, "\tflt.s %s, %s, %s\n", regStr(dest), regStr(op2), regStr(op1));
-            fprintf(outFile, "\txori %s, %s, 1\n", regStr(dest), regStr(dest));
-            freeReg(op1); // TODO: Test register eviction
-            freeReg(op2);
-            break;
+            emit("\tsub %r, %r, %r\n", dest, lhs, rhs);
+            lhs = dest;
         }
-        else
+        else if (instr->imm != 0)
         {
-            // TODO: Deal with signs
-            Reg op1 = getTmpReg();
-            Reg op2 = getTmpReg();
-            compileExpr(expr->op1, op1);
-            compileExpr(expr->op2, op2);
-            fprintf(outFile, "\tslt %s, %s, %s\n", regStr(dest), regStr(op2), regStr(op1));
-            fprintf(outFile, "\txori %s, %s, 1\n", regStr(dest), regStr(dest));
-            freeReg(op1); // TODO: Test register eviction
-            freeReg(op2);
-            break;
+            emit("\taddi %r, %r, %i\n", dest, lhs, -instr->imm);
+            lhs = dest;
         }
+        emit("\t%s %r, %r\n", instr->op == IR_EQ ? "seqz" : "snez", dest, lhs);
+        invert = false;
+    }
+    else if (instr->src[1] == 0 && instr->imm != 0)
+    {
+        // irSelectImmediates leaves only <, >= and their unsigned forms with nonzero immediates
+        bool isUnsignedCmp = instr->op == IR_LTU || instr->op == IR_GEU;
+        invert = instr->op == IR_GE || instr->op == IR_GEU;
+        emit("\t%s %r, %r, %i\n", isUnsignedCmp ? "sltiu" : "slti", dest, lhs, instr->imm);
     }
-    case GE:
+    else
     {
-        if (returnType(expr->op1) == FLOAT_TYPE)
+        bool isUnsignedCmp = instr->op == IR_LTU || instr->op == IR_LEU || instr->op == IR_GTU || instr->op == IR_GEU;
+        // a <= b is !(b < a) and a >= b is !(a < b)
+        if (instr->op == IR_LE || instr->op == IR_LEU)
         {
-            // TODO: Deal with signs
-            Reg op1 = getTmpFltReg();
-            Reg op2 = getTmpFltReg();
-            compileExpr(expr->op1, op1);
-            compileExpr(expr->op2, op2);
-            fprintf(outFile, "\tflt.s %s, %s, %s\n", regStr(dest), regStr(op1), regStr(op2));
-            fprintf(outFile, "\txori %s, %s, 1\n", regStr(dest), regStr(dest));
-            freeReg(op1); // TODO: Test register eviction
-            freeReg(op2);
-            break;
+            swap = true;
+            invert = true;
         }
-        else
+        else if (instr->op == IR_GE || instr->op == IR_GEU)
         {
-            // TODO: Deal with signs
-            Reg op1 = getTmpReg();
-            Reg op2 = getTmpReg();
-            compileExpr(expr->op1, op1);
-            compileExpr(expr->op2, op2);
-            fprintf(outFile, "\tslt %s, %s, %s\n", regStr(dest), regStr(op1), regStr(op2));
-            fprintf(outFile, "\txori %s, %s, 1\n", regStr(dest), regStr(dest));
-            freeReg(op1); // TODO: Test register eviction
-            freeReg(op2);
-            break;
+            invert = true;
         }
+        emit("\t%s %r, %r, %r\n", isUnsignedCmp ? "sltu" : "slt", dest, swap ? rhs : lhs, swap ? lhs : rhs);
     }
-    case OR:
-    {
-        // TODO: Deal with signs
-        Reg op1 = getTmpReg();
-        Reg op2 = getTmpReg();
-        compileExpr(expr->op1, op1);
-        compileExpr(expr->op2, op2);
-        fprintf(outFile, "\tor %s, %s, %s\n", regStr(dest), regStr(op1), regStr(op2));
-        fprintf(outFile, "\tsgtz %s, %s\n", regStr(dest), regStr(dest));
-        freeReg(op1); // TODO: Test register eviction
-        freeReg(op2);
-        break;
-    }
-    case AND:
-    {
-        // TODO: Deal with signs
-        Reg op1 = getTmpReg();
-        Reg op2 = getTmpReg();
-        compileExpr(expr->op1, op1);
-        compileExpr(expr->op2, op2);
-        fprintf(outFile, "\tsgtz %s, %s\n", regStr(op1), regStr(op1));
-        fprintf(outFile, "\tsgtz %s, %s\n", regStr(op2), regStr(op2));
-        fprintf(outFile, "\tand %s, %s, %s\n", regStr(dest), regStr(op1), regStr(op2));
-        freeReg(op1); // TODO: Test register eviction
-        freeReg(op2);
-        break;
-    }
-    case OR_BIT:
-    {
-        // TODO: Deal with signs
-        Reg op1 = getTmpReg();
-        Reg op2 = getTmpReg();
-        compileExpr(expr->op1, op1);
-        compileExpr(expr->op2, op2);
-        fprintf(outFile, "\tor %s, %s, %s\n", regStr(dest), regStr(op1), regStr(op2));
-        freeReg(op1); // TODO: Test register eviction
-        freeReg(op2);
-        break;
-    }
-    case AND_BIT:
+    if (invert)
     {
-        // TODO: Deal with signs
-        Reg op1 = getTmpReg();
-        Reg op2 = getTmpReg();
-        compileExpr(expr->op1, op1);
-        compileExpr(expr->op2, op2);
-        fprintf(outFile, "\tand %s, %s, %s\n", regStr(dest), regStr(op1), regStr(op2));
-        freeReg(op1); // TODO: Test register eviction
-        freeReg(op2);
-        break;
-    }
-    case XOR:
-    {
-        // TODO: Deal with signs
-        Reg op1 = getTmpReg();
-        Reg op2 = getTmpReg();
-        compileExpr(expr->op1, op1);
-        compileExpr(expr->op2, op2);
-        fprintf(outFile, "\txor %s, %s, %s\n", regStr(dest), regStr(op1), regStr(op2));
-        freeReg(op1); // TODO: Test register eviction
-        freeReg(op2);
-        break;
-    }
-    case LEFT_SHIFT:
-    {
-        switch (expr->type)
-        {
-        case FLOAT_TYPE:
-        {
-            fprintf(stderr, "Shift-operations cannot be done on floating-point types, exiting...\n");
-            exit(EXIT_FAILURE);
-            break;
-        }
-        case DOUBLE_TYPE:
-        {
-            fprintf(stderr, "Shift-operations cannot be done on floating-point types, exiting...\n");
-            exit(EXIT_FAILURE);
-            break;
-        }
-        default:
-        {
-            Reg op1 = getTmpReg();
-            Reg op2 = getTmpReg();
-            compileExpr(expr->op1, op1);
-            compileExpr(expr->op2, op2);
-            fprintf(outFile, "\tsll %s, %s, %s\n", regStr(dest), regStr(op1), regStr(op2));
-            freeReg(op1);
-            freeReg(op2);
-            break;
-        }
-        }
-        break;
-    }
-    case RIGHT_SHIFT:
-    {
-        switch (expr->type)
-        {
-        case FLOAT_TYPE:
-        {
-            fprintf(stderr, "Shift-operations cannot be done on floating-point types, exiting...\n");
-            exit(EXIT_FAILURE);
-            break;
-        }
-        case DOUBLE_TYPE:
-        {
-            fprintf(stderr, "Shift-operations cannot be done on floating-point types, exiting...\n");
-            exit(EXIT_FAILURE);
-            break;
-        }
-        case INT_TYPE: // Signed shift
-        {
-            Reg op1 = getTmpReg();
-            Reg op2 = getTmpReg();
-            compileExpr(expr->op1, op1);
-            compileExpr(expr->op2, op2);
-            fprintf(outFile, "\tsra %s, %s, %s\n", regStr(dest), regStr(op1), regStr(op2));
-            freeReg(op1);
-            freeReg(op2);
-            break;
-        }
-        default:
-        {
-            Reg op1 = getTmpReg();
-            Reg op2 = getTmpReg();
-            compileExpr(expr->op1, op1);
-            compileExpr(expr->op2, op2);
-            fprintf(outFile, "\tsrl %s, %s, %s\n", regStr(dest), regStr(op1), regStr(op2));
-            freeReg(op1);
-            freeReg(op2);
-            break;
-        }
-        }
-        break;
-    }
-    case INC:
-    {
-        // TODO: Handle types (add float support)
-        if (expr->op1->type != VARIABLE_EXPR)
-        {
-            fprintf(stderr, "Expression is not assignable, exiting...\n");
-            exit(EXIT_FAILURE);
-        }
-        Expr *one = exprCreate(CONSTANT_EXPR);
-        one->constant = constantExprCreate(expr->type, false);
-        one->constant->int_const = 1;
-        AssignExpr *assign = assignExprCreate(one, ADD);
-        assign->type = expr->type;
-        assign->lvalue = NULL;
-        assign->ident = expr->op1->variable->ident;
-        assign->symbolEntry = expr->op1->variable->symbolEntry;
-        compileAssignExpr(assign, dest);
-        exprDestroy(one);
-        break;
-    }
-    case INC_POST:
-    {
-        // TODO: Handle types (add float support)
-        if (expr->op1->type != VARIABLE_EXPR)
-        {
-            fprintf(stderr, "Expression is not assignable, exiting...\n");
-            exit(EXIT_FAILURE);
-        }
-        compileVariableExpr(expr->op1->variable, dest);
-        Expr *one = exprCreate(CONSTANT_EXPR);
-        one->constant = constantExprCreate(expr->type, false);
-        one->constant->int_const = 1;
-        AssignExpr *assign = assignExprCreate(one, ADD);
-        assign->type = expr->type;
-        assign->lvalue = NULL;
-        assign->ident = expr->op1->variable->ident;
-        assign->symbolEntry = expr->op1->variable->symbolEntry;
-        Reg tmp;
-        if (expr->type == FLOAT_TYPE || expr->type == DOUBLE_TYPE)
-        {
-            tmp = getTmpFltReg();
-        }
-        else
-        {
-            tmp = getTmpReg();
-        }
-        compileAssignExpr(assign, tmp);
-        freeReg(tmp);
-        free(assign);
-        exprDestroy(one);
-        break;
-    }
-    case DEC:
-    {
-        // TODO: Handle types (add float code)
-        if (expr->op1->type != VARIABLE_EXPR)
-        {
-            fprintf(stderr, "Expression is not assignable, exiting...\n");
-            exit(EXIT_FAILURE);
-        }
-        Expr *one = exprCreate(CONSTANT_EXPR);
-        one->constant = constantExprCreate(expr->type, false);
-        one->constant->int_const = 1;
-        AssignExpr *assign = assignExprCreate(one, SUB);
-        assign->type = expr->type;
-        assign->lvalue = NULL;
-        assign->ident = expr->op1->variable->ident;
-        assign->symbolEntry = expr->op1->variable->symbolEntry;
-        compileAssignExpr(assign, dest);
-        exprDestroy(one);
-        break;
-    }
-    case DEC_POST:
-    {
-        // TODO: Fix memory leaks everywhere
-        // TODO: Handle types (add float code)
-        if (expr->op1->type != VARIABLE_EXPR)
-        {
-            fprintf(stderr, "Expression is not assignable, exiting...\n");
-            exit(EXIT_FAILURE);
-        }
-        compileVariableExpr(expr->op1->variable, dest);
-        Expr *one = exprCreate(CONSTANT_EXPR);
-        one->constant = constantExprCreate(expr->type, false);
-        one->constant->int_const = 1;
-        AssignExpr *assign = assignExprCreate(one, SUB);
-        assign->type = expr->type;
-        assign->lvalue = NULL;
-        assign->ident = expr->op1->variable->ident;
-        assign->symbolEntry = expr->op1->variable->symbolEntry;
-        Reg tmp;
-        if (expr->type == FLOAT_TYPE || expr->type == DOUBLE_TYPE)
-        {
-            tmp = getTmpFltReg();
-        }
-        else
-        {
-            tmp = getTmpReg();
-        }
-        compileAssignExpr(assign, tmp);
-        free(assign);
-        freeReg(tmp);
-        exprDestroy(one);
-        break;
-    }
-    case SIZEOF_OP:
-    {
-        size_t size;
-        if (expr->op1->type == CONSTANT_EXPR)
-        {
-            size = typeSize(expr->op1->constant->type);
-        }
-        else if (expr->op1->type == VARIABLE_EXPR)
-        {
-            if (expr->op1->variable->symbolEntry->entryType == ARRAY_ENTRY) // TODO: Do the same for structs
-            {
-                size = expr->op1->variable->symbolEntry->storageSize;
-            }
-            else
-            {
-                size = expr->op1->variable->symbolEntry->typeSize;
-            }
-        }
-        else
-        {
-            size = typeSize(returnType(expr->op1));
-        }
-        fprintf(outFile, "\tli %s, %lu\n", regStr(dest), size);
-        break;
-    }
-    case ADDRESS:
-    {
-        if (expr->op1->type == VARIABLE_EXPR)
-        {
-            if (expr->op1->variable->symbolEntry == NULL)
-            {
-                abort();
-            }
-            if (expr->op1->variable->symbolEntry->isGlobal)
-            {
-                fprintf(outFile, "\tla %s, %s\n", regStr(dest), expr->op1->variable->ident);
-            }
-            else
-            {
-                fprintf(outFile, "\taddi %s, fp, -%lu\n", regStr(dest), expr->op1->variable->symbolEntry->stackOffset);
-            }
-        }
-        else
-        {
-            fprintf(stderr, "Toby you promised me that it was gonna be a variable node, exiting...\n");
-            exit(EXIT_FAILURE);
-        }
-        break;
-    }
-    case DEREF:
-    {
-        switch (expr->type)
-        {
-        case CHAR_TYPE:
-        {
-            Reg lvalue = getTmpReg();
-            compileExpr(expr->op1, lvalue);
-            fprintf(outFile, "\tlb %s, 0(%s)\n", regStr(dest), regStr(lvalue));
-            freeReg(lvalue);
-            break;
-        }
-        case INT_TYPE:
-        {
-            Reg lvalue = getTmpReg();
-            compileExpr(expr->op1, lvalue);
-            fprintf(outFile, "\tlw %s, 0(%s)\n", regStr(dest), regStr(lvalue));
-            freeReg(lvalue);
-            break;
-        }
-        case FLOAT_TYPE:
-        {
-            Reg lvalue = getTmpReg();
-            compileExpr(expr->op1, lvalue);
-            fprintf(outFile, "\tflw %s, 0(%s)\n", regStr(dest), regStr(lvalue));
-            freeReg(lvalue);
-            break;
-        }
-        case DOUBLE_TYPE:
-        {
-            Reg lvalue = getTmpReg();
-            compileExpr(expr->op1, lvalue);
-            fprintf(outFile, "\tfld %s, 0(%s)\n", regStr(dest), regStr(lvalue));
-            freeReg(lvalue);
-            break;
-        }
-        default:
-        {
-            Reg lvalue = getTmpReg();
-            compileExpr(expr->op1, lvalue);
-            fprintf(outFile, "\tlw %s, 0(%s)\n", regStr(dest), regStr(lvalue));
-            freeReg(lvalue);
-            break;
-        }
-        }
-        break;
-    }
-    case COMMA_OP:
-    {
-        Reg tmp = getTmpReg();
-        compileExpr(expr->op1, tmp);
-        compileExpr(expr->op2, dest);
-        break;
-    }
-    case TERN:
-    {
-        Reg condition = getTmpReg(); // always an int (bool)
-        compileExpr(expr->op1, condition);
-        fprintf(outFile, "\tbeqz %s, .TERNa%i\n", regStr(condition), ternID);
-        compileExpr(expr->op2, dest);
-        fprintf(outFile, "\tj .TERNb%i\n", ternID); // unconditional jump
-        fprintf(outFile, ".TERNa%lu:\n", ternID);
-        compileExpr(expr->op3, dest);
-        fprintf(outFile, ".TERNb%lu:\n", ternID);
-        ternID++;
-        break;
-    }
-    default:
-    {
-        fprintf(stderr, "Operation not supported, exiting...");
-        exit(EXIT_FAILURE);
-    }
+        emit("\txori %r, %r, 1\n", dest, dest);
     }
 }
 
-void compileVariableExpr(VariableExpr *expr, const Reg dest)
+/* Spilled registers */
+
+static bool isSpilled(Selection *sel, const size_t vreg)
 {
-    switch (expr->type)
-    {
-    case INT_TYPE:
-    {
-        if (!expr->symbolEntry->isGlobal)
-        {
-            fprintf(outFile, "\tlw %s, -%lu(fp)\n", regStr(dest), expr->symbolEntry->stackOffset);
-        }
-        else
-        {
-            fprintf(outFile, "\tlw %s, %s\n", regStr(dest), expr->ident);
-        }
-        break;
-    }
-    case UNSIGNED_INT_TYPE:
-    {
-        if (!expr->symbolEntry->isGlobal)
-        {
-            fprintf(outFile, "\tlw %s, -%lu(fp)\n", regStr(dest), expr->symbolEntry->stackOffset);
-        }
-        else
-        {
-            fprintf(outFile, "\tlw %s, %s\n", regStr(dest), expr->ident);
-        }
-        break;
-    }
-    case FLOAT_TYPE:
+    return sel->alloc->spillOffsets[vreg] != 0;
+}
+
+static Reg spillReg(const IrType type, const size_t operand)
+{
+    if (irIsFloatType(type))
     {
-        if (!expr->symbolEntry->isGlobal)
-        {
-            fprintf(outFile, "\tflw %s, -%lu(fp)\n", regStr(dest), expr->symbolEntry->stackOffset);
-        }
-        else
-        {
-            fprintf(outFile, "\tflw %s, %s, zero\n", regStr(dest), expr->ident);
-        }
-        break;
+        return operand == 0 ? FLOAT_SPILL_REG_0 : FLOAT_SPILL_REG_1;
     }
-    case DOUBLE_TYPE:
-    {
-        if (!expr->symbolEntry->isGlobal)
-        {
-            fprintf(outFile, "\tfld %s, -%lu(fp)\n", regStr(dest), expr->symbolEntry->stackOffset);
-        }
-        else
-        {
-            fprintf(outFile, "\tfld %s, %s, zero\n", regStr(dest), expr->ident);
-        }
-        break;
-    }
-    case CHAR_TYPE:
+    return operand == 0 ? INT_SPILL_REG_0 : INT_SPILL_REG_1;
+}
+
+// Spilled operands are reloaded into the spill registers for the length of one instruction,
+// a spilled result is written to the first spill register of its class
+static void reloadSpilled(Selection *sel, IrInstr *instr)
+{
+    for (size_t i = 0; i < irSrcCount(instr); i++)
     {
-        if (!expr->symbolEntry->isGlobal)
-        {
-            fprintf(outFile, "\tlb %s, -%lu(fp)\n", regStr(dest), expr->symbolEntry->stackOffset);
-        }
-        else
+        size_t vreg = instr->src[i];
+        if (isSpilled(sel, vreg) && physReg(sel, vreg) == ZERO)
         {
-            fprintf(outFile, "\tlb %s, %s\n", regStr(dest), expr->ident);
+            IrType type = sel->func->vregTypes[vreg];
+            sel->alloc->regs[vreg] = spillReg(type, i);
+            emitFrameAccess(loadMnemonic(type), physReg(sel, vreg), frameOffset(sel, sel->alloc->spillOffsets[vreg]));
         }
-        break;
     }
-    default:
+    if (instr->dest != 0 && isSpilled(sel, instr->dest))
     {
-        if (expr->symbolEntry->entryType == ARRAY_ENTRY)
-        {
-            if (!expr->symbolEntry->isGlobal)
-            {
-		// TODO: Verify arrays are actually fixed
-                fprintf(outFile, "\taddi %s, fp, -%lu\n", regStr(dest), expr->symbolEntry->stackOffset);
-            }
-            else
-            {
-                fprintf(outFile, "\tla %s, %s\n", regStr(dest), expr->ident);
-            }
-        }
-        else
-        {
-            if (!expr->symbolEntry->isGlobal)
-            {
-                fprintf(outFile, "\tlw %s, -%lu(fp)\n", regStr(dest), expr->symbolEntry->stackOffset);
-            }
-            else
-            {
-                fprintf(outFile, "\tlw %s, %s\n", regStr(dest), expr->ident);
-            }
-        }
-        break;
-        // TOOD: Deal with more types
-        // fprintf(stderr, "Type not supported, exiting...\n");
-        // exit(EXIT_FAILURE);
-    }
+        sel->alloc->regs[instr->dest] = spillReg(instr->type, 0);
     }
 }
 
-void compileAssignExpr(AssignExpr *expr, Reg dest)
+// Writes a spilled result back to its slot and forgets the reloaded registers
+static void storeSpilled(Selection *sel, IrInstr *instr)
 {
-    // compileExpr(expr->op, dest);
-    switch (expr->type)
+    if (instr->dest != 0 && isSpilled(sel, instr->dest))
     {
-    case CHAR_TYPE:
-    {
-        if (expr->operator!= NOT)
-        {
-            OperationExpr *rvalue = operationExprCreate(expr->operator);
-            rvalue->type = expr->type; // TODO: Maybe remove?
-            rvalue->op2 = expr->op;
-            rvalue->op1 = exprCreate(VARIABLE_EXPR);
-
-            // TODO: Resolve the type you set in op2
-            rvalue->op1->variable = variableExprCreate(expr->ident);
-            rvalue->op1->variable->symbolEntry = expr->symbolEntry;
-            rvalue->op1->variable->type = CHAR_TYPE;
-
-            compileOperationExpr(rvalue, dest);
-            if (expr->lvalue == NULL)
-            {
-                if (expr->symbolEntry->isGlobal)
-                {
-                    fprintf(outFile, "\tsb %s, %s, zero\n", regStr(dest), expr->ident);
-                }
-                else
-                {
-                    fprintf(outFile, "\tsb %s, -%lu(fp)\n", regStr(dest), expr->symbolEntry->stackOffset);
-                }
-            }
-            else
-            {
-                Reg lvalue = getTmpReg();
-                compileExpr(expr->lvalue, lvalue);
-                fprintf(outFile, "\tsb %s, 0(%s)\n", regStr(dest), regStr(lvalue));
-                freeReg(lvalue);
-            }
-            free(rvalue->op1->assignment);
-            free(rvalue->op1);
-            free(rvalue);
-        }
-        else
-        {
-            compileExpr(expr->op, dest);
-            if (expr->lvalue == NULL)
-            {
-                if (expr->symbolEntry->isGlobal)
-                {
-                    fprintf(outFile, "\tsb %s, %s, zero\n", regStr(dest), expr->ident);
-                }
-                else
-                {
-                    fprintf(outFile, "\tsb %s, -%lu(fp)\n", regStr(dest), expr->symbolEntry->stackOffset);
-                }
-            }
-            else
-            {
-                Reg lvalue = getTmpReg();
-                compileExpr(expr->lvalue, lvalue);
-                fprintf(outFile, "\tsb %s, 0(%s)\n", regStr(dest), regStr(lvalue));
-                freeReg(lvalue);
-            }
-        }
-        break;
+        emitFrameAccess(storeMnemonic(instr->type), physReg(sel, instr->dest), frameOffset(sel, sel->alloc->spillOffsets[instr->dest]));
+        sel->alloc->regs[instr->dest] = ZERO;
     }
-    case INT_TYPE:
+    for (size_t i = 0; i < irSrcCount(instr); i++)
     {
-        if (expr->operator!= NOT)
-        {
-            OperationExpr *rvalue = operationExprCreate(expr->operator);
-            rvalue->type = expr->type; // TODO: Maybe remove?
-            rvalue->op2 = expr->op;
-            rvalue->op1 = exprCreate(VARIABLE_EXPR);
-            // TODO: Resolve the type you set in op2
-            rvalue->op1->variable = variableExprCreate(expr->ident);
-            rvalue->op1->variable->symbolEntry = expr->symbolEntry;
-            rvalue->op1->variable->type = INT_TYPE;
-
-            compileOperationExpr(rvalue, dest);
-            if (expr->lvalue == NULL)
-            {
-                if (expr->symbolEntry->isGlobal)
-                {
-                    fprintf(outFile, "\tsw %s, %s, zero\n", regStr(dest), expr->ident);
-                }
-                else
-                {
-                    fprintf(outFile, "\tsw %s, -%lu(fp)\n", regStr(dest), expr->symbolEntry->stackOffset);
-                }
-            }
-            else
-            {
-                Reg lvalue = getTmpReg();
-                compileExpr(expr->lvalue, lvalue);
-                fprintf(outFile, "\tsw %s, 0(%s)\n", regStr(dest), regStr(lvalue));
-                freeReg(lvalue);
-            }
-            free(rvalue->op1->assignment);
-            free(rvalue->op1);
-            free(rvalue);
-        }
-        else
+        if (isSpilled(sel, instr->src[i]))
         {
-            compileExpr(expr->op, dest);
-            if (expr->lvalue == NULL)
-            {
-                if (expr->symbolEntry->isGlobal)
-                {
-                    fprintf(outFile, "\tsw %s, %s, zero\n", regStr(dest), expr->ident);
-                }
-                else
-                {
-                    fprintf(outFile, "\tsw %s, -%lu(fp)\n", regStr(dest), expr->symbolEntry->stackOffset);
-                }
-            }
-            else
-            {
-                Reg lvalue = getTmpReg();
-                compileExpr(expr->lvalue, lvalue);
-                fprintf(outFile, "\tsw %s, 0(%s)\n", regStr(dest), regStr(lvalue));
-                freeReg(lvalue);
-            }
+            sel->alloc->regs[instr->src[i]] = ZERO;
         }
-        break;
     }
-    case FLOAT_TYPE:
+}
+
+// Copies a virtual register into a fixed register, spilled ones straight from their slot
+static void emitCopyOut(Selection *sel, const size_t vreg, const Reg dest)
+{
+    IrType type = sel->func->vregTypes[vreg];
+    if (isSpilled(sel, vreg))
     {
-        if (expr->operator!= NOT)
-        {
-            OperationExpr *rvalue = operationExprCreate(expr->operator);
-            rvalue->type = expr->type; // TODO: Maybe remove?
-            rvalue->op1 = expr->op;
-            rvalue->op2 = exprCreate(VARIABLE_EXPR);
-            // TODO: Resolve the type you set in op2
-            rvalue->op2->variable = variableExprCreate(expr->ident);
-            rvalue->op2->variable->symbolEntry = expr->symbolEntry;
-            rvalue->op2->variable->type = FLOAT_TYPE;
-            compileOperationExpr(rvalue, dest);
-            if (expr->lvalue == NULL)
-            {
-                if (expr->symbolEntry->isGlobal)
-                {
-                    fprintf(outFile, "\tfsw %s, %s, zero\n", regStr(dest), expr->ident);
-                }
-                else
-                {
-                    fprintf(outFile, "\tfsw %s, -%lu(fp)\n", regStr(dest), expr->symbolEntry->stackOffset);
-                }
-            }
-            else
-            {
-                Reg lvalue = getTmpReg();
-                compileExpr(expr->lvalue, lvalue);
-                fprintf(outFile, "\tfsw %s, 0(%s)\n", regStr(dest), regStr(lvalue));
-                freeReg(lvalue);
-            }
-            free(rvalue->op2->assignment);
-            free(rvalue->op2);
-        }
-        else
-        {
-            compileExpr(expr->op, dest);
-            if (expr->lvalue == NULL)
-            {
-                if (expr->symbolEntry->isGlobal)
-                {
-                    fprintf(outFile, "\tfsw %s, %s, zero\n", regStr(dest), expr->ident);
-                }
-                else
-                {
-                    fprintf(outFile, "\tfsw %s, -%lu(fp)\n", regStr(dest), expr->symbolEntry->stackOffset);
-                }
-            }
-            else
-            {
-                Reg lvalue = getTmpReg();
-                compileExpr(expr->lvalue, lvalue);
-                fprintf(outFile, "\tfsw %s, 0(%s)\n", regStr(dest), regStr(lvalue));
-                freeReg(lvalue);
-            }
-        }
-        break;
+        emitFrameAccess(loadMnemonic(type), dest, frameOffset(sel, sel->alloc->spillOffsets[vreg]));
     }
-    case DOUBLE_TYPE:
+    else
     {
-        if (expr->operator!= NOT)
-        {
-            OperationExpr *rvalue = operationExprCreate(expr->operator);
-            rvalue->op1 = expr->op;
-            rvalue->op2 = exprCreate(VARIABLE_EXPR);
-            // TODO: Resolve the type you set in op2
-            rvalue->op2->variable = variableExprCreate(expr->ident);
-            rvalue->op2->variable->symbolEntry = expr->symbolEntry;
-            rvalue->op2->variable->type = DOUBLE_TYPE;
-            compileOperationExpr(rvalue, dest);
-            if (expr->lvalue == NULL)
-            {
-                if (expr->symbolEntry->isGlobal)
-                {
-                    fprintf(outFile, "\tfsd %s, %s, zero\n", regStr(dest), expr->ident);
-                }
-                else
-                {
-                    fprintf(outFile, "\tfsd %s, -%lu(fp)\n", regStr(dest), expr->symbolEntry->stackOffset);
-                }
-            }
-            else
-            {
-                Reg lvalue = getTmpReg();
-                compileExpr(expr->lvalue, lvalue);
-                fprintf(outFile, "\tfsd %s, 0(%s)\n", regStr(dest), regStr(lvalue));
-                freeReg(lvalue);
-            }
-            free(rvalue->op2->assignment);
-            free(rvalue->op2);
-        }
-        else
-        {
-            compileExpr(expr->op, dest);
-            if (expr->lvalue == NULL)
-            {
-                if (expr->symbolEntry->isGlobal)
-                {
-                    fprintf(outFile, "\tfsd %s, %s, zero\n", regStr(dest), expr->ident);
-                }
-                else
-                {
-                    fprintf(outFile, "\tfsd %s, -%lu(fp)\n", regStr(dest), expr->symbolEntry->stackOffset);
-                }
-            }
-            else
-            {
-                Reg lvalue = getTmpReg();
-                compileExpr(expr->lvalue, lvalue);
-                fprintf(outFile, "\tfsd %s, 0(%s)\n", regStr(dest), regStr(lvalue));
-                freeReg(lvalue);
-            }
-        }
-        break;
+        emitMove(type, dest, physReg(sel, vreg));
     }
-    default:
-    {
-        if (expr->operator!= NOT)
-        {
-            OperationExpr *rvalue = operationExprCreate(expr->operator);
-            rvalue->op1 = expr->op;
-            rvalue->op2 = exprCreate(VARIABLE_EXPR);
-            // TODO: Resolve the type you set in op2
-            rvalue->op2->variable = variableExprCreate(expr->ident);
-            rvalue->op2->variable->symbolEntry = expr->symbolEntry;
-            rvalue->op2->variable->type = expr->type;
-            compileOperationExpr(rvalue, dest);
-            if (expr->lvalue == NULL)
-            {
-                if (expr->symbolEntry->isGlobal)
-                {
-                    fprintf(outFile, "\tsw %s, %s, zero\n", regStr(dest), expr->ident);
-                }
-                else
-                {
-                    fprintf(outFile, "\tsw %s, -%lu(fp)\n", regStr(dest), expr->symbolEntry->stackOffset);
-                }
-            }
-            else
-            {
-                Reg lvalue = getTmpReg();
-                compileExpr(expr->lvalue, lvalue);
-                fprintf(outFile, "\tsw %s, 0(%s)\n", regStr(dest), regStr(lvalue));
-                freeReg(lvalue);
-            }
-            free(rvalue->op2->assignment);
-            free(rvalue->op2);
-            free(rvalue);
-        }
-        else
+}
+
+/* Switch dispatch */
+
+// a dense run of at least MIN_TABLE_CASES cases covering at most MAX_TABLE_RANGE values, at
+// least MIN_TABLE_DENSITY percent of which are cases, is dispatched through a jump table
+#define MIN_TABLE_CASES 8
+#define MAX_TABLE_RANGE 4096
+#define MIN_TABLE_DENSITY 40
+
+// A run of cases dispatched as one, either a single value or a dense range looked up in a
+// jump table
+typedef struct CaseCluster
+{
+    size_t first; // into the sorted cases
+    size_t last;
+    bool isTable;
+} CaseCluster;
+
+typedef struct SwitchPlan
+{
+    IrCase *cases; // sorted by value
+    CaseCluster *clusters;
+    size_t clusterCount;
+    IrBlock *defaultBlock;
+    Reg selector;
+    bool scratchKnown; // SCRATCH_REG holds scratchValue
+    int32_t scratchValue;
+} SwitchPlan;
+
+static int caseValueCompare(const void *a, const void *b)
+{
+    int32_t x = ((const IrCase *)a)->value;
+    int32_t y = ((const IrCase *)b)->value;
+    return (x > y) - (x < y);
+}
+
+// A range can use a table when it has enough cases and at least MIN_TABLE_DENSITY percent of
+// its values are cases, the others take the default entry
+static bool denseEnough(const IrCase *cases, const size_t first, const size_t last)
+{
+    int64_t range = (int64_t)cases[last].value - cases[first].value + 1;
+    return last - first + 1 >= MIN_TABLE_CASES && range <= MAX_TABLE_RANGE &&
+           (int64_t)(last - first + 1) * 100 >= range * MIN_TABLE_DENSITY;
+}
+
+// Groups the sorted cases from left to right, every cluster takes the longest dense range
+// starting at its first case. Ranges are bounded by MAX_TABLE_RANGE, which keeps this linear.
+static void clusterCases(SwitchPlan *plan, const size_t size)
+{
+    plan->clusterCount = 0;
+    for (size_t i = 0; i < size;)
+    {
+        size_t last = i;
+        for (size_t j = i + 1; j < size && (int64_t)plan->cases[j].value - plan->cases[i].value < MAX_TABLE_RANGE; j++)
         {
-            compileExpr(expr->op, dest);
-            if (expr->lvalue == NULL)
-            {
-                if (expr->symbolEntry->isGlobal)
-                {
-                    fprintf(outFile, "\tsw %s, %s, zero\n", regStr(dest), expr->ident);
-                }
-                else
-                {
-                    fprintf(outFile, "\tsw %s, -%lu(fp)\n", regStr(dest), expr->symbolEntry->stackOffset);
-                }
-            }
-            else
+            if (denseEnough(plan->cases, i, j))
             {
-                Reg lvalue = getTmpReg();
-                compileExpr(expr->lvalue, lvalue);
-                fprintf(outFile, "\tsw %s, 0(%s)\n", regStr(dest), regStr(lvalue));
-                freeReg(lvalue);
+                last = j;
             }
         }
-        fprintf(stderr, "Type not supported\n");
-        // exit(EXIT_FAILURE);
-        break;
-    }
+        plan->clusters[plan->clusterCount++] = (CaseCluster){i, last, last != i};
+        i = last + 1;
     }
 }
 
-void compileFuncExpr(FuncExpr *expr, Reg dest)
+// Compares the selector against a case value, the value a search node loaded is still there
+// for the first comparison of its upper half
+static void emitCaseCompare(SwitchPlan *plan, const char *branch, const int32_t value)
 {
-    compileCallArgs(expr);
-    for (size_t i = 0; i <= 6; i++) // Store T0-T7
-    {
-        fprintf(outFile, "\tsw t%lu, -%lu(fp)\n", i, 52 + 4 + (i * 4));
-    }
-    for (size_t i = 0; i <= 11; i++) // Store FT0-FT11
-    {
-        fprintf(outFile, "\tfsd ft%lu, -%lu(fp)\n", i, 80 + 8 + (i * 8));
-    }
-    fprintf(outFile, "\tcall %s\n", expr->ident);
-    for (size_t i = 0; i <= 6; i++) // Restore T0-T7
-    {
-        fprintf(outFile, "\tlw t%lu, -%lu(fp)\n", i, 52 + 4 + (i * 4));
-    }
-    // TODO: Check if treating all floating point registers as holding doubles is okay
-    for (size_t i = 0; i <= 11; i++) // Restore FT0-FT11
+    if (!plan->scratchKnown || plan->scratchValue != value)
     {
-        fprintf(outFile, "\tfld ft%lu, -%lu(fp)\n", i, 80 + 8 + (i * 8));
+        emit("\tli %r, %i\n", SCRATCH_REG, value);
     }
-    if (expr->type == FLOAT_TYPE || expr->type == DOUBLE_TYPE)
+    plan->scratchKnown = true;
+    plan->scratchValue = value;
+    emit("\t%s %r, %r, ", branch, plan->selector, SCRATCH_REG);
+}
+
+static void emitJump(Selection *sel, IrBlock *target)
+{
+    emit("\tj ");
+    emitBlockLabel(sel, target);
+    emit("\n");
+}
+
+// Bounds checks the selector against the cluster's range and jumps through a table of block
+// addresses, values without a case take the default
+static void emitTableJump(Selection *sel, SwitchPlan *plan, const CaseCluster *cluster)
+{
+    int32_t low = plan->cases[cluster->first].value;
+    uint32_t range = (uint32_t)plan->cases[cluster->last].value - (uint32_t)low;
+    uint64_t tableId = getId(&LCLabelId);
+    plan->scratchKnown = false;
+    if (low > MIN_IMM && low <= -MIN_IMM)
     {
-        fprintf(outFile, "\tmv %s, fa0\n", regStr(dest));
+        emit("\taddi %r, %r, %i\n", SCRATCH_REG, plan->selector, -low);
     }
     else
     {
-        fprintf(outFile, "\tmv %s, a0\n", regStr(dest));
+        emit("\tli %r, %i\n", SCRATCH_REG, low);
+        emit("\tsub %r, %r, %r\n", SCRATCH_REG, plan->selector, SCRATCH_REG);
+    }
+    emit("\tli %r, %u\n", SWITCH_TABLE_REG, range);
+    emit("\tbgtu %r, %r, ", SCRATCH_REG, SWITCH_TABLE_REG);
+    emitBlockLabel(sel, plan->defaultBlock);
+    emit("\n");
+    emit("\tslli %r, %r, 2\n", SCRATCH_REG, SCRATCH_REG);
+    emit("\tlui %r, %%hi(.LJT%lu)\n", SWITCH_TABLE_REG, tableId);
+    emit("\tadd %r, %r, %r\n", SCRATCH_REG, SCRATCH_REG, SWITCH_TABLE_REG);
+    emit("\tlw %r, %%lo(.LJT%lu)(%r)\n", SCRATCH_REG, tableId, SCRATCH_REG);
+    emit("\tjr %r\n", SCRATCH_REG);
+
+    emit(".section .rodata\n");
+    emit(".align 2\n");
+    emit(".LJT%lu:\n", tableId);
+    size_t next = cluster->first;
+    for (uint64_t offset = 0; offset <= range; offset++)
+    {
+        IrBlock *target = plan->defaultBlock;
+        if (next <= cluster->last && (uint32_t)plan->cases[next].value - (uint32_t)low == offset)
+        {
+            target = plan->cases[next++].target;
+        }
+        emit("\t.word ");
+        emitBlockLabel(sel, target);
+        emit("\n");
     }
-    // fprintf(outFile, "\tlw fp, %lu(sp)\n", expr->symbolEntry->size);
-    // fprintf(outFile, "\tlw ra, -4(fp)\n");
+    emit(".text\n");
 }
 
-void compileStmt(Stmt *stmt)
+// Dispatches to clusters first to last - 1 with a binary search on their first values. Up to
+// three single values are compared in turn, a table cluster is looked up on its own. The last
+// search emitted falls through to the default when that is laid out next.
+static void emitDispatch(Selection *sel, SwitchPlan *plan, const size_t first, const size_t last, const bool fallsThrough)
 {
-    switch (stmt->type)
+    bool hasTable = false;
+    for (size_t i = first; i < last; i++)
+    {
+        hasTable |= plan->clusters[i].isTable;
+    }
+    if (last - first == 1 && hasTable)
     {
-    case EXPR_STMT:
+        emitTableJump(sel, plan, &plan->clusters[first]);
+        return;
+    }
+    if (last - first <= 3 && !hasTable)
     {
-        if (returnType(stmt->exprStmt->expr) == FLOAT_TYPE || returnType(stmt->exprStmt->expr) == DOUBLE_TYPE)
+        for (size_t i = first; i < last; i++)
         {
-            compileExpr(stmt->exprStmt->expr, FA0);
+            IrCase *c = &plan->cases[plan->clusters[i].first];
+            emitCaseCompare(plan, "beq", c->value);
+            emitBlockLabel(sel, c->target);
+            emit("\n");
         }
-        else
+        if (!fallsThrough)
         {
-            compileExpr(stmt->exprStmt->expr, A0);
+            emitJump(sel, plan->defaultBlock);
         }
-        break;
-    }
-    case JUMP_STMT:
-    {
-        compileJumpStmt(stmt->jumpStmt);
-        break;
-    }
-    case COMPOUND_STMT:
-    {
-        compileCompoundStmt(stmt->compoundStmt);
-        break;
+        return;
     }
-    case IF_STMT:
+
+    size_t middle = first + (last - first) / 2;
+    uint64_t lowerId = getId(&LCLabelId);
+    emitCaseCompare(plan, "blt", plan->cases[plan->clusters[middle].first].value);
+    emit(".LS%lu\n", lowerId);
+    emitDispatch(sel, plan, middle, last, false);
+    emit(".LS%lu:\n", lowerId);
+    plan->scratchKnown = false;
+    emitDispatch(sel, plan, first, middle, fallsThrough);
+}
+
+// Sorts the cases of a switch and groups them into clusters
+static void planSwitch(SwitchPlan *plan, const IrInstr *instr)
+{
+    plan->cases = malloc(sizeof(IrCase) * (instr->casesSize + 1));
+    plan->clusters = malloc(sizeof(CaseCluster) * (instr->casesSize + 1));
+    if (plan->cases == NULL || plan->clusters == NULL)
     {
-        compileIfStmt(stmt->ifStmt);
-        break;
+        abort();
     }
-    case WHILE_STMT:
+    memcpy(plan->cases, instr->cases, sizeof(IrCase) * instr->casesSize);
+    qsort(plan->cases, instr->casesSize, sizeof(IrCase), caseValueCompare);
+    plan->defaultBlock = instr->targets[0];
+    plan->scratchKnown = false;
+    clusterCases(plan, instr->casesSize);
+}
+
+// Whether a switch dispatches through a jump table, which needs SWITCH_TABLE_REG saved
+static bool usesJumpTable(const IrInstr *instr)
+{
+    SwitchPlan plan;
+    planSwitch(&plan, instr);
+    bool uses = false;
+    for (size_t i = 0; i < plan.clusterCount; i++)
     {
-        compileWhileStmt(stmt->whileStmt);
-        break;
+        uses |= plan.clusters[i].isTable;
     }
-    case FOR_STMT:
+    free(plan.cases);
+    free(plan.clusters);
+    return uses;
+}
+
+static void selectSwitch(Selection *sel, IrInstr *instr, IrBlock *next)
+{
+    SwitchPlan plan;
+    planSwitch(&plan, instr);
+    plan.selector = physReg(sel, instr->src[0]);
+    if (plan.clusterCount == 0)
     {
-        compileForStmt(stmt->forStmt);
-        break;
+        if (plan.defaultBlock != next)
+        {
+            emitJump(sel, plan.defaultBlock);
+        }
     }
-    case SWITCH_STMT:
+    else
     {
-        compileSwitchStmt(stmt->switchStmt);
-        break;
+        emitDispatch(sel, &plan, 0, plan.clusterCount, plan.defaultBlock == next);
     }
-    case LABEL_STMT:
+    free(plan.cases);
+    free(plan.clusters);
+}
+
+/* Frame */
+
+// callee-saved integer registers, saved like ra in slots at the top of the frame
+static const Reg calleeSavedRegs[] = {S1, S2, S3, S4, S5, S6, S7, S8, S9, S10, S11};
+
+// caller-saved registers, saved around a call in slots of their own when they hold a value across it
+static const Reg intTemps[] = {T0, T1, T2, T3, T4, T5, T6};
+static const Reg floatTemps[] = {FT0, FT1, FT2, FT3, FT4, FT5, FT6, FT7, FT8, FT9, FT10, FT11};
+
+static bool mustSave(Selection *sel, const Reg reg)
+{
+    return reg != ZERO && ((sel->alloc->usedRegs[reg] && !isCallerSaved(reg)) || sel->alloc->saveOffsets[reg] != 0);
+}
+
+// Whether an instruction touches ra or a register the caller expects to be preserved
+static bool needsSaves(Selection *sel, IrInstr *instr)
+{
+    if (instr->op == IR_CALL)
     {
-        compileLabelStmt(stmt->labelStmt);
-        break;
+        return true;
     }
-    default:
+    for (size_t i = 0; i <= irUseCount(instr); i++)
     {
-        fprintf(stderr, "Statement type: %i, not supported...\n", stmt->type);
-        exit(EXIT_FAILURE);
-    }
+        size_t vreg = i < irUseCount(instr) ? irUse(instr, i) : instr->dest;
+        if (vreg == 0)
+        {
+            continue;
+        }
+        if (isSpilled(sel, vreg) ? !irIsFloatType(sel->func->vregTypes[vreg]) : mustSave(sel, physReg(sel, vreg)))
+        {
+            return true;
+        }
     }
+    return false;
 }
 
-void compileJumpStmt(JumpStmt *stmt)
+// The saves can move from the entry to a later block when that block runs at most once and
+// every return it reaches can only be reached through it
+static bool canSaveIn(IrFunc *func, IrBlock *point)
 {
-    switch (stmt->type)
+    bool *reached = calloc(func->blockIds, sizeof(bool));
+    IrBlock **worklist = malloc(sizeof(IrBlock *) * (func->size + 1));
+    if (reached == NULL || worklist == NULL)
     {
-    case RETURN_JUMP:
+        abort();
+    }
+    size_t worklistSize = 0;
+    for (size_t i = 0; i < point->succsSize; i++)
     {
-        if (stmt->expr == NULL)
+        if (!reached[point->succs[i]->id])
         {
-            fprintf(outFile, "\tret\n");
+            reached[point->succs[i]->id] = true;
+            worklist[worklistSize++] = point->succs[i];
         }
-        else
+    }
+    while (worklistSize > 0)
+    {
+        IrBlock *block = worklist[--worklistSize];
+        for (size_t i = 0; i < block->succsSize; i++)
         {
-            // TODO: Deal with other types
-            switch (returnType(stmt->expr))
-            {
-            case FLOAT_TYPE:
-            {
-                compileExpr(stmt->expr, FA0);
-                break;
-            }
-            case DOUBLE_TYPE:
-            {
-                compileExpr(stmt->expr, FA0);
-                break;
-            }
-            default:
-            {
-                compileExpr(stmt->expr, A0);
-                break;
-            }
-            }
-            for (size_t i = 1; i <= 11; i++) // Restore S1-S11
+            if (!reached[block->succs[i]->id])
             {
-                fprintf(outFile, "\tlw s%lu, -%lu(fp)\n", i, 8 + (i * 4)); // Save RA
+                reached[block->succs[i]->id] = true;
+                worklist[worklistSize++] = block->succs[i];
             }
-            fprintf(outFile, "\tmv sp, fp\n");
-            fprintf(outFile, "\tlw ra, -8(fp)\n");
-            fprintf(outFile, "\tlw fp, -4(fp)\n");
-            // fprintf(outFile, "\taddi sp, sp, %lu\n", func->symbolEntry->size);
-            fprintf(outFile, "\tret\n");
         }
-        break;
     }
-    case BREAK_JUMP:
+
+    bool safe = !reached[point->id];
+    for (size_t i = 0; i < func->size && safe; i++)
     {
-        switch (stmt->symbolEntry->entryType)
-        {
-        case WHILE_ENTRY:
+        IrBlock *block = func->blocks[i];
+        if (irTerminator(block)->op == IR_RET && reached[block->id])
         {
-            fprintf(outFile, "\tj .WHILE_END%s\n", stmt->symbolEntry->ident);
-            break;
+            safe = irDominates(point, block);
         }
-        case FOR_ENTRY:
-        {
-            fprintf(outFile, "\tj .FOR_END%s\n", stmt->symbolEntry->ident);
-            break;
+    }
+    free(reached);
+    free(worklist);
+    return safe;
+}
+
+// Shrink-wraps the saves: they go to the nearest block dominating every instruction that
+// needs them, so paths that touch no callee-saved register, such as early returns, skip them
+static void planSaves(Selection *sel)
+{
+    IrFunc *func = sel->func;
+    irComputeDominators(func);
+    sel->savePoint = NULL;
+    sel->saveRa = false;
+    for (size_t i = 0; i < func->size; i++)
+    {
+        IrBlock *block = func->blocks[i];
+        for (size_t j = 0; j < block->size; j++)
+        {
+            IrInstr *instr = block->instrs[j];
+            bool table = instr->op == IR_SWITCH && usesJumpTable(instr);
+            sel->saveRa |= instr->op == IR_CALL;
+            sel->alloc->usedRegs[SWITCH_TABLE_REG] |= table;
+            if (table || needsSaves(sel, instr))
+            {
+                sel->savePoint = sel->savePoint == NULL ? block : irCommonDominator(sel->savePoint, block);
+            }
         }
-        case SWITCH_ENTRY:
+    }
+    if (sel->savePoint != NULL && sel->savePoint != func->blocks[0] && !canSaveIn(func, sel->savePoint))
+    {
+        sel->savePoint = func->blocks[0];
+    }
+}
+
+// Gives fp, ra and every register that is saved a slot below fp, and returns the frame size,
+// rounded up to the 16 bytes the calling convention keeps sp aligned to
+static size_t layoutFrame(Selection *sel)
+{
+    size_t offset = 4; // fp
+    memset(sel->saveSlots, 0, sizeof(sel->saveSlots));
+    if (sel->saveRa)
+    {
+        offset += 4;
+        sel->saveSlots[RA] = offset;
+    }
+    for (size_t i = 0; i < sizeof(calleeSavedRegs) / sizeof(Reg); i++)
+    {
+        if (mustSave(sel, calleeSavedRegs[i]))
         {
-            fprintf(outFile, "\tj .SWITCH_END%s\n", stmt->symbolEntry->ident);
-            break;
-        }
+            offset += 4;
+            sel->saveSlots[calleeSavedRegs[i]] = offset;
         }
-        break;
     }
-    case CONTINUE_JUMP:
+    uint64_t saves = 0;
+    for (size_t i = 0; i < sel->alloc->callCount; i++)
     {
-        switch (stmt->symbolEntry->entryType)
-        {
-        case WHILE_ENTRY:
+        saves |= sel->alloc->callSaves[i];
+    }
+    for (size_t i = 0; i < sizeof(intTemps) / sizeof(Reg); i++)
+    {
+        if ((saves >> intTemps[i]) & 1)
         {
-            fprintf(outFile, "\tj .WHILE%s\n", stmt->symbolEntry->ident);
-            break;
+            offset += 4;
+            sel->saveSlots[intTemps[i]] = offset;
         }
-        case FOR_ENTRY:
+    }
+    offset = (offset + 7) & ~(size_t)7;
+    for (size_t i = 0; i < sizeof(floatTemps) / sizeof(Reg); i++)
+    {
+        if ((saves >> floatTemps[i]) & 1)
         {
-            fprintf(outFile, "\tj .FOR_MOD%s\n", stmt->symbolEntry->ident);
-            break;
+            offset += 8;
+            sel->saveSlots[floatTemps[i]] = offset;
         }
-        }
-        break;
-    }
     }
+    // the locals and spill slots keep their 8 byte alignment below the saved registers
+    sel->saveAreaSize = offset;
+    return (offset + sel->alloc->frameSize + 15) & ~(size_t)15;
 }
 
-void compileCompoundStmt(CompoundStmt *stmt)
+static void emitSaves(Selection *sel)
 {
-    for (size_t i = 0; i < stmt->declList.size; i++)
+    if (sel->saveRa)
+    {
+        emit("\tsw ra, -%lu(fp)\n", sel->saveSlots[RA]);
+    }
+    for (size_t i = 0; i < sizeof(calleeSavedRegs) / sizeof(Reg); i++)
     {
-        if (stmt->declList.decls[i]->declInit->initExpr != NULL)
+        if (mustSave(sel, calleeSavedRegs[i]))
         {
-            if (returnType(stmt->declList.decls[i]->declInit->initExpr) == FLOAT_TYPE)
-            {
-                compileExpr(stmt->declList.decls[i]->declInit->initExpr, FA0);
-                fprintf(outFile, "\tfsw %s, -%lu(fp)\n", regStr(FA0), stmt->declList.decls[i]->symbolEntry->stackOffset);
-            }
-            else if (returnType(stmt->declList.decls[i]->declInit->initExpr) == DOUBLE_TYPE)
-            {
-                compileExpr(stmt->declList.decls[i]->declInit->initExpr, FA0);
-                fprintf(outFile, "\tfld %s, -%lu(fp)\n", regStr(FA0), stmt->declList.decls[i]->symbolEntry->stackOffset);
-            }
-            else
-            {
-                compileExpr(stmt->declList.decls[i]->declInit->initExpr, A0);
-                fprintf(outFile, "\tsw %s, -%lu(fp)\n", regStr(A0), stmt->declList.decls[i]->symbolEntry->stackOffset);
-            }
+            emit("\tsw %r, -%lu(fp)\n", calleeSavedRegs[i], sel->saveSlots[calleeSavedRegs[i]]);
         }
     }
-
-    for (size_t i = 0; i < stmt->stmtList.size; i++)
+    for (Reg reg = FT0; reg <= FT11; reg++)
     {
-        compileStmt(stmt->stmtList.stmts[i]);
+        if (sel->alloc->saveOffsets[reg] != 0)
+        {
+            emitFrameAccess("fsd", reg, frameOffset(sel, sel->alloc->saveOffsets[reg]));
+        }
     }
 }
 
-void compileIfStmt(IfStmt *stmt)
+static void emitRestores(Selection *sel)
 {
-    Reg condition = getTmpReg();
-    compileExpr(stmt->condition, condition);
-    size_t endId = getId(&ifLabelId);
-    size_t elseId = getId(&ifLabelId);
-    if (stmt->falseBody != NULL)
-    {
-        fprintf(outFile, "\tbeqz %s, .IF%lu\n", regStr(condition), elseId);
-        freeReg(condition);
-        compileStmt(stmt->trueBody);
-        fprintf(outFile, "\tj .IF%lu\n", endId);
-        fprintf(outFile, ".IF%lu:\n", elseId);
-        compileStmt(stmt->falseBody);
-        fprintf(outFile, ".IF%lu:\n", endId);
+    if (sel->saveRa)
+    {
+        emit("\tlw ra, -%lu(fp)\n", sel->saveSlots[RA]);
     }
-    else
+    for (size_t i = 0; i < sizeof(calleeSavedRegs) / sizeof(Reg); i++)
+    {
+        if (mustSave(sel, calleeSavedRegs[i]))
+        {
+            emit("\tlw %r, -%lu(fp)\n", calleeSavedRegs[i], sel->saveSlots[calleeSavedRegs[i]]);
+        }
+    }
+    for (Reg reg = FT0; reg <= FT11; reg++)
     {
-        fprintf(outFile, "\tbeqz %s, .IF%lu\n", regStr(condition), endId);
-        freeReg(condition);
-        compileStmt(stmt->trueBody);
-        fprintf(outFile, ".IF%lu:\n", endId);
+        if (sel->alloc->saveOffsets[reg] != 0)
+        {
+            emitFrameAccess("fld", reg, frameOffset(sel, sel->alloc->saveOffsets[reg]));
+        }
     }
 }
 
-void compileWhileStmt(WhileStmt *stmt)
+// Arguments go to a0-a7 and fa0-fa7 in order of their class, the temporaries that hold a
+// value across the call are saved in their frame slots around it
+static void selectCall(Selection *sel, IrInstr *instr)
 {
-    Reg condition = getTmpReg();
-    // TODO: Add do while support
-    if (stmt->doWhile)
+    size_t intArgs = 0;
+    size_t floatArgs = 0;
+    for (size_t i = 0; i < instr->argsSize; i++)
     {
-        fprintf(outFile, ".DO_WHILE%s:\n", stmt->symbolEntry->ident);
-        compileStmt(stmt->body);
-        compileExpr(stmt->condition, condition);
-        fprintf(outFile, "\tbnez %s, .DO_WHILE%s\n", regStr(condition), stmt->symbolEntry->ident);
-        freeReg(condition);
+        IrType type = sel->func->vregTypes[instr->args[i]];
+        emitCopyOut(sel, instr->args[i], irIsFloatType(type) ? FA0 + floatArgs++ : A0 + intArgs++);
     }
-    else
+    uint64_t saves = sel->alloc->callSaves[sel->callIndex++];
+    for (size_t i = 0; i < sizeof(intTemps) / sizeof(Reg); i++)
     {
-        fprintf(outFile, ".WHILE%s:\n", stmt->symbolEntry->ident);
-        compileExpr(stmt->condition, condition);
-        freeReg(condition);
-        fprintf(outFile, "\tbeqz %s, .WHILE_END%s\n", regStr(condition), stmt->symbolEntry->ident);
-        compileStmt(stmt->body);
-        fprintf(outFile, "\tj .WHILE%s\n", stmt->symbolEntry->ident);
-        fprintf(outFile, ".WHILE_END%s:\n", stmt->symbolEntry->ident);
+        if ((saves >> intTemps[i]) & 1)
+        {
+            emit("\tsw %r, -%lu(fp)\n", intTemps[i], sel->saveSlots[intTemps[i]]);
+        }
     }
-}
-
-void compileForStmt(ForStmt *stmt)
-{
-    Reg condition = getTmpReg();
-    compileStmt(stmt->init);
-    fprintf(outFile, ".FOR%s:\n", stmt->symbolEntry->ident);
-    compileExpr(stmt->condition->exprStmt->expr, condition);
-    fprintf(outFile, "\tbeqz %s, .FOR_END%s\n", regStr(condition), stmt->symbolEntry->ident);
-    freeReg(condition);
-    compileStmt(stmt->body);
-    if (stmt->modifier != NULL)
-    {
-        // TODO: Add code to deal with floats
-        Reg tmp = getTmpReg();
-        compileExpr(stmt->modifier, tmp);
-        freeReg(tmp);
-        fprintf(outFile, "\tj .FOR%s\n", stmt->symbolEntry->ident);
-
-        fprintf(outFile, ".FOR_MOD%s:\n", stmt->symbolEntry->ident);
-        Reg tmp1 = getTmpReg();
-        compileExpr(stmt->modifier, tmp1);
-        freeReg(tmp1);
-
-        fprintf(outFile, "\tj .FOR_END%s\n", stmt->symbolEntry->ident);
-    }
-    fprintf(outFile, "\tj .FOR%s\n", stmt->symbolEntry->ident);
-    fprintf(outFile, ".FOR_END%s:\n", stmt->symbolEntry->ident);
-}
-
-void compileSwitchStmt(SwitchStmt *stmt)
-{
-    Reg selector = getTmpReg();
-    Reg tmp = getTmpReg();
-    compileExpr(stmt->selector, selector);
-    // TODO: Add code to deal with const expr
-    bool hasDefault = false;
-    for (size_t i = 0; i < stmt->body->compoundStmt->stmtList.size; i++)
-    {
-        if (stmt->body->compoundStmt->stmtList.stmts[i]->type == LABEL_STMT)
+    // fsd and fld move all 64 bits, which keeps a float NaN-boxed in the register exactly as well
+    for (size_t i = 0; i < sizeof(floatTemps) / sizeof(Reg); i++)
+    {
+        if ((saves >> floatTemps[i]) & 1)
         {
-            if (stmt->body->compoundStmt->stmtList.stmts[i]->labelStmt->caseLabel != NULL)
-            {
-                fprintf(outFile, "\tli %s, %i\n", regStr(tmp), stmt->body->compoundStmt->stmtList.stmts[i]->labelStmt->caseLabel->constant->int_const);
-                fprintf(outFile, "\tbeq %s, %s, .SWITCH%s_CASE%i\n", regStr(selector), regStr(tmp),
-                        stmt->symbolEntry->ident,
-                        stmt->body->compoundStmt->stmtList.stmts[i]->labelStmt->caseLabel->constant->int_const);
-            }
-            else
-            {
-                hasDefault = true;
-            }
+            emit("\tfsd %r, -%lu(fp)\n", floatTemps[i], sel->saveSlots[floatTemps[i]]);
+        }
+    }
+    emit("\tcall %s\n", instr->str);
+    for (size_t i = 0; i < sizeof(intTemps) / sizeof(Reg); i++)
+    {
+        if ((saves >> intTemps[i]) & 1)
+        {
+            emit("\tlw %r, -%lu(fp)\n", intTemps[i], sel->saveSlots[intTemps[i]]);
         }
     }
-    freeReg(selector);
-    freeReg(tmp);
-    if (hasDefault)
+    for (size_t i = 0; i < sizeof(floatTemps) / sizeof(Reg); i++)
     {
-        fprintf(outFile, "\tj .SWITCH_DEFAULT%s\n", stmt->symbolEntry->ident);
+        if ((saves >> floatTemps[i]) & 1)
+        {
+            emit("\tfld %r, -%lu(fp)\n", floatTemps[i], sel->saveSlots[floatTemps[i]]);
+        }
     }
-    else
+    if (instr->dest != 0)
     {
-        fprintf(outFile, "\tj .SWITCH_END%s\n", stmt->symbolEntry->ident);
+        emitMove(instr->type, physReg(sel, instr->dest), irIsFloatType(instr->type) ? FA0 : A0);
     }
-    compileStmt(stmt->body);
-    fprintf(outFile, ".SWITCH_END%s:\n", stmt->symbolEntry->ident);
 }
 
-void compileLabelStmt(LabelStmt *stmt)
+static void selectReturn(Selection *sel, IrInstr *instr)
 {
-    // TODO: Add support for other types of labels
-    if (stmt->ident == NULL && stmt->caseLabel == NULL)
+    if (instr->src[0] != 0)
     {
-        fprintf(outFile, ".SWITCH_DEFAULT%s:\n", stmt->symbolEntry->ident);
-        compileStmt(stmt->body);
+        emitMove(sel->func->retType, irIsFloatType(sel->func->retType) ? FA0 : A0, physReg(sel, instr->src[0]));
     }
-    else if (stmt->caseLabel != NULL)
+    if (sel->savePoint != NULL && irDominates(sel->savePoint, sel->block))
     {
-        fprintf(outFile, ".SWITCH%s_CASE%i:\n", stmt->symbolEntry->ident, evaluateIntConstExpr(stmt->caseLabel));
-        compileStmt(stmt->body);
-        // TOOD: Add support for const expr
+        emitRestores(sel);
     }
-    // TODO: Add case for simple goto labels
+    emit("\tmv sp, fp\n");
+    emit("\tlw fp, -4(fp)\n");
+    emit("\tret\n");
 }
 
-// void compileArg(Decl *decl, Reg dest)
-// {
-//     fprintf(outFile, "\tsw %s, -%lu(fp)\n", regStr(dest), decl->symbolEntry->stackOffset);
-// }
-
-void compileFunc(FuncDef *func)
+// Jumps to target when the branch's condition is, or is not, met. Integer comparisons branch
+// on their operands directly. A float comparison leaves its result in the scratch register,
+// whose test is inverted rather than the comparison, which would not hold for NaN.
+static void emitBranch(Selection *sel, IrInstr *instr, const bool whenMet, IrBlock *target)
 {
-    // displayParameterLocations(func->args);
-    fprintf(outFile, ".globl %s\n", func->ident);
-    fprintf(outFile, ".type %s, @function\n", func->ident);
-    fprintf(outFile, "%s:\n", func->ident);
-    fprintf(outFile, "\tsw fp, -4(sp)\n"); // Save FP, never gets restored
-    fprintf(outFile, "\tsw ra, -8(sp)\n"); // Save RA
-    for (size_t i = 1; i <= 11; i++)       // Save S1-S11
+    static const char *branchNames[] = {
+        [IR_EQ] = "beq",
+        [IR_NE] = "bne",
+        [IR_LT] = "blt",
+        [IR_LE] = "ble",
+        [IR_GT] = "bgt",
+        [IR_GE] = "bge",
+        [IR_LTU] = "bltu",
+        [IR_LEU] = "bleu",
+        [IR_GTU] = "bgtu",
+        [IR_GEU] = "bgeu"};
+    static const IrOp inverses[] = {
+        [IR_EQ] = IR_NE,
+        [IR_NE] = IR_EQ,
+        [IR_LT] = IR_GE,
+        [IR_LE] = IR_GT,
+        [IR_GT] = IR_LE,
+        [IR_GE] = IR_LT,
+        [IR_LTU] = IR_GEU,
+        [IR_LEU] = IR_GTU,
+        [IR_GTU] = IR_LEU,
+        [IR_GEU] = IR_LTU};
+
+    Reg lhs = physReg(sel, instr->src[0]);
+    if (instr->cond == IR_BOOL)
     {
-        fprintf(outFile, "\tsw s%lu, -%lu(sp)\n", i, 8 + (i * 4)); // Save RA
+        emit("\t%s %r, ", whenMet ? "bnez" : "beqz", lhs);
     }
-    fprintf(outFile, "\tmv fp, sp\n");
-    fprintf(outFile, "\taddi sp, sp, -%lu\n", func->symbolEntry->storageSize);
-    // TODO: Figure out if FP needs to be restored
-
-    if (func->isParam)
+    else if (!irIsFloatType(sel->func->vregTypes[instr->src[0]]))
     {
-        compileFuncArgs(func->args);
+        emit("\t%s %r, %r, ", branchNames[whenMet ? instr->cond : inverses[instr->cond]], lhs, rhsReg(sel, instr));
     }
-    // TODO: Potentially remove
-    if (func->body != NULL)
+    else
     {
-        for (size_t i = 0; i < func->body->compoundStmt->declList.size; i++)
+        Reg rhs = physReg(sel, instr->src[1]);
+        bool swap = instr->cond == IR_GT || instr->cond == IR_GE;
+        const char *name = "feq";
+        if (instr->cond == IR_LT || instr->cond == IR_GT)
         {
-            if (func->body->compoundStmt->declList.decls[i]->declInit->initExpr != NULL)
-            {
-                if (returnType(func->body->compoundStmt->declList.decls[i]->declInit->initExpr) == FLOAT_TYPE)
-                {
-                    compileExpr(func->body->compoundStmt->declList.decls[i]->declInit->initExpr, FA0);
-                    fprintf(outFile, "\tfsw %s, -%lu(fp)\n", regStr(FA0), func->body->compoundStmt->declList.decls[i]->symbolEntry->stackOffset);
-                }
-                else if (returnType(func->body->compoundStmt->declList.decls[i]->declInit->initExpr) == DOUBLE_TYPE)
-                {
-                    compileExpr(func->body->compoundStmt->declList.decls[i]->declInit->initExpr, FA0);
-                    fprintf(outFile, "\tfld %s, -%lu(fp)\n", regStr(FA0), func->body->compoundStmt->declList.decls[i]->symbolEntry->stackOffset);
-                }
-                else
-                {
-                    compileExpr(func->body->compoundStmt->declList.decls[i]->declInit->initExpr, A0);
-                    fprintf(outFile, "\tsw %s, -%lu(fp)\n", regStr(A0), func->body->compoundStmt->declList.decls[i]->symbolEntry->stackOffset);
-                }
-            }
+            name = "flt";
         }
-
-        for (size_t i = 0; i < func->body->compoundStmt->stmtList.size; i++)
+        else if (instr->cond == IR_LE || instr->cond == IR_GE)
         {
-            compileStmt(func->body->compoundStmt->stmtList.stmts[i]);
+            name = "fle";
         }
+        emit("\t%s.%s %r, %r, %r\n", name, floatSuffix(sel->func->vregTypes[instr->src[0]]), SCRATCH_REG, swap ? rhs : lhs,
+             swap ? lhs : rhs);
+        emit("\t%s %r, ", whenMet != (instr->cond == IR_NE) ? "bnez" : "beqz", SCRATCH_REG);
     }
-
-    // fprintf(outFile, "\tmv sp, fp\n");
-    for (size_t i = 1; i <= 11; i++) // Restore S1-S11
-    {
-        fprintf(outFile, "\tlw s%lu, -%lu(fp)\n", i, 8 + (i * 4)); // Save RA
-    }
-    fprintf(outFile, "\tlw ra, -8(fp)\n");
-    fprintf(outFile, "\tlw fp, -4(fp)\n");
-    fprintf(outFile, "\taddi sp, sp, %lu\n", func->symbolEntry->storageSize);
-    fprintf(outFile, "\tret\n");
+    emitBlockLabel(sel, target);
+    emit("\n");
 }
 
-void compileCallArgs(FuncExpr *expr)
+// next is the block laid out after the current one, jumps to it fall through
+static void selectTerminator(Selection *sel, IrInstr *instr, IrBlock *next)
 {
-    Reg intRegs[8] = {A0, A1, A2, A3, A4, A5, A6, A7};
-    Reg floatRegs[8] = {FA0, FA1, FA2, FA3, FA4, FA5, FA6, FA7};
-
-    const size_t maxFloatRegs = 8;
-    const size_t maxIntRegs = 8;
-
-    size_t usedFloatRegs = 0;
-    size_t usedIntRegs = 0;
-
-    for (size_t i = 0; i < expr->argsSize; i++)
+    switch (instr->op)
     {
-        // for primitive types
-        DataType paramType = returnType(expr->args[i]);
-        // DataType paramType = declList.decls[i]->symbolEntry->type.dataType;
-        // char *ident = declList.decls[i]->symbolEntry->ident;
-        // size_t stackOffset = declList.decls[i]->symbolEntry->stackOffset;
-
-        if (paramType == INT_TYPE || paramType == CHAR_TYPE || paramType == SHORT_TYPE || isPtr(paramType) || paramType == UNSIGNED_INT_TYPE || paramType == UNSIGNED_SHORT_TYPE)
+    case IR_JMP:
+        if (instr->targets[0] != next)
         {
-            if (usedIntRegs != maxIntRegs)
-            {
-                for (size_t j = 0; j < 8; j++)
-                {
-                    if (intRegs[j] != ZERO)
-                    {
-                        compileExpr(expr->args[i], A0 + j);
-                        // printf("%s : A%zu \n", ident, i);
-                        intRegs[j] = ZERO;
-                        usedIntRegs++;
-                        break;
-                    }
-                }
-            }
-            // else
-            // {
-            //     printf("%s : SP(%zu) \n", ident, stackOffset);
-            // }
+            emitJump(sel, instr->targets[0]);
         }
-        else if (paramType == FLOAT_TYPE || paramType == DOUBLE_TYPE)
+        break;
+    case IR_BR:
+        if (instr->targets[0] == next)
         {
-            if (usedFloatRegs != maxFloatRegs)
-            {
-                for (size_t j = 0; j < 8; j++)
-                {
-                    if (floatRegs[j] != ZERO)
-                    {
-                        if (paramType == FLOAT_TYPE)
-                        {
-                            compileExpr(expr->args[i], FA0 + j);
-                        }
-                        else
-                        {
-                            compileExpr(expr->args[i], FA0 + j);
-                        }
-                        // printf("%s : FA%zu\n", ident, i);
-                        floatRegs[i] = ZERO;
-                        usedFloatRegs++;
-                        break;
-                    }
-                }
-            }
-            // else
-            // {
-            //     printf("%s : SP(%zu) \n", ident, stackOffset);
-            //
-            // }
+            emitBranch(sel, instr, false, instr->targets[1]);
+            break;
         }
-        // else if (paramType == LONG_TYPE )
-        // {
-        //     // both halves stored in registers
-        //     if(usedFloatRegs < maxFloatRegs - 2)
-        //     {
-        //         // find next even register
-        //         for(size_t i = 0; i < 8; i++)
-        //         {
-        //             if(i%2 == 0 && intRegs[i] != ZERO && intRegs[i+1] != ZERO)
-        //             {
-        //                 printf("%s : A%zu \n", ident, i);
-        //                 printf("%s : A%zu \n", ident, i+1);
-        //                 intRegs[i] = ZERO;
-        //                 intRegs[i+1] = ZERO;
-        //                 usedIntRegs += 2;
-        //                 break;
-        //             }
-        //         }
-        //     }
-        // }
+        emitBranch(sel, instr, true, instr->targets[0]);
+        if (instr->targets[1] != next)
+        {
+            emitJump(sel, instr->targets[1]);
+        }
+        break;
+    case IR_SWITCH:
+        selectSwitch(sel, instr, next);
+        break;
+    default:
+        selectReturn(sel, instr);
+        break;
     }
 }
 
-// just return number
-// char = 1 byte
-// short = 2 bytes (half word)
-// long = int = float = 4 bytes (word)
-// long long = double = 8 bytes (2 words)
-// a0 - a7 are integer arg regs
-// fa0 - fa07 are float regs
-
-// floating point registers are 64 bit
-// a floating point is stored in half of this register
-// a double takes an entire register
-
-// longs have their high half stored in an even register and lower in an odd
-void compileFuncArgs(DeclarationList declList)
+static void selectInstr(Selection *sel, IrInstr *instr)
 {
-    Reg intRegs[8] = {A0, A1, A2, A3, A4, A5, A6, A7};
-    Reg floatRegs[8] = {FA0, FA1, FA2, FA3, FA4, FA5, FA6, FA7};
+    switch (instr->op)
+    {
+    case IR_LI:
+    case IR_LF:
+    case IR_LSTR:
+        selectConstant(sel, instr);
+        break;
+    case IR_ADDR:
+        selectAddress(sel, instr);
+        break;
+    case IR_MOV:
+        emitMove(instr->type, physReg(sel, instr->dest), physReg(sel, instr->src[0]));
+        break;
+    case IR_PARAM:
+        emitMove(instr->type, physReg(sel, instr->dest), irIsFloatType(instr->type) ? FA0 + instr->imm : A0 + instr->imm);
+        break;
+    case IR_CVT:
+        selectConvert(sel, instr);
+        break;
+    case IR_LOAD:
+    case IR_STORE:
+        selectMemory(sel, instr);
+        break;
+    case IR_CALL:
+        selectCall(sel, instr);
+        break;
+    case IR_EQ:
+    case IR_NE:
+    case IR_LT:
+    case IR_LE:
+    case IR_GT:
+    case IR_GE:
+    case IR_LTU:
+    case IR_LEU:
+    case IR_GTU:
+    case IR_GEU:
+        selectCompare(sel, instr);
+        break;
+    default:
+        selectArith(sel, instr);
+        break;
+    }
+}
 
-    size_t maxFloatRegs = 8;
-    size_t maxIntRegs = 8;
+static void selectFunc(IrFunc *func)
+{
+    Selection sel = {func, regAllocCreate(func, func->frameSize), 0, NULL, NULL, false};
+    planSaves(&sel);
+    size_t frameSize = layoutFrame(&sel);
 
-    size_t usedFloatRegs = 0;
-    size_t usedIntRegs = 0;
+    emit(".globl %s\n", func->ident);
+    emit(".type %s, @function\n", func->ident);
+    emit("%s:\n", func->ident);
+    emit("\tsw fp, -4(sp)\n"); // Save FP
+    emit("\tmv fp, sp\n");
+    if (frameSize <= MAX_IMM)
+    {
+        emit("\taddi sp, sp, -%lu\n", frameSize);
+    }
+    else
+    {
+        emit("\tli %r, %lu\n", SCRATCH_REG, frameSize);
+        emit("\tsub sp, sp, %r\n", SCRATCH_REG);
+    }
 
-    for (size_t i = 0; i < declList.size; i++)
+    for (size_t i = 0; i < func->size; i++)
     {
-        // for primitive types
-        if(declList.decls[i]->typeSpecList->typeSpecs[0]->dataType != VOID_TYPE)
+        IrBlock *block = func->blocks[i];
+        if (i != 0)
         {
-            DataType paramType = declList.decls[i]->symbolEntry->type.dataType;
-        
-            // char *ident = declList.decls[i]->symbolEntry->ident;
-            size_t stackOffset = declList.decls[i]->symbolEntry->stackOffset;
-
-            if (paramType == INT_TYPE || paramType == CHAR_TYPE || paramType == SHORT_TYPE || isPtr(paramType))
+            emitBlockLabel(&sel, block);
+            emit(":\n");
+        }
+        if (block == sel.savePoint)
+        {
+            emitSaves(&sel);
+        }
+        sel.block = block;
+        for (size_t j = 0; j < block->size; j++)
+        {
+            IrInstr *instr = block->instrs[j];
+            reloadSpilled(&sel, instr);
+            if (j + 1 < block->size)
             {
-                if (usedIntRegs != maxIntRegs)
-                {
-                    for (size_t j = 0; j < 8; j++)
-                    {
-                        if (intRegs[j] != ZERO)
-                        {
-                            fprintf(outFile, "\tsw a%lu, -%lu(fp)\n", j, stackOffset);
-                            intRegs[j] = ZERO;
-                            usedIntRegs++;
-                            break;
-                        }
-                    }
-                }
-                // else
-                // {
-                //     printf("%s : SP(%zu) \n", ident, stackOffset);
-                // }
+                selectInstr(&sel, instr);
             }
-            else if (paramType == FLOAT_TYPE || paramType == DOUBLE_TYPE)
+            else
             {
-                if (usedFloatRegs != maxFloatRegs)
-                {
-                    for (size_t j = 0; j < 8; j++)
-                    {
-                        if (floatRegs[j] != ZERO)
-                        {
-                            if (paramType == FLOAT_TYPE)
-                            {
-                                fprintf(outFile, "\tfsw fa%lu, -%lu(fp)\n", j, stackOffset);
-                            }
-                            else
-                            {
-                                fprintf(outFile, "\tfsd fa%lu, -%lu(fp)\n", j, stackOffset);
-                            }
-                            floatRegs[i] = ZERO;
-                            usedFloatRegs++;
-                            break;
-                        }
-                    }
-                }
-                // else
-                // {
-                //     printf("%s : SP(%zu) \n", ident, stackOffset);
-                //
-                // }
+                selectTerminator(&sel, instr, i + 1 < func->size ? func->blocks[i + 1] : NULL);
             }
+            storeSpilled(&sel, instr);
         }
     }
+    regAllocDestroy(sel.alloc);
+}
+
+// Lowers a function to IR and inlines the small functions before it, then prints the IR or
+// selects instructions from it
+void compileFunc(FuncDef *func)
+{
+    IrFunc *irFunc = irLowerFunc(func);
+    irInlineCalls(irFunc);
+    irInlineRemember(irFunc);
+    irPromoteLocals(irFunc);
+    irBuildSsa(irFunc);
+    irFoldConstants(irFunc);
+    irReduceStrength(irFunc);
+    irNumberValues(irFunc);
+    irRemoveDeadCode(irFunc);
+    irFuseBranches(irFunc);
+    irSelectImmediates(irFunc);
+    irHoistInvariants(irFunc);
+    irReduceInductions(irFunc);
+    irDestroySsa(irFunc);
+    irForwardCopies(irFunc);
+    irRemoveDeadCode(irFunc);
+    irVerify(irFunc);
+    if (emitIr)
+    {
+        irPrintFunc(irFunc);
+    }
+    else
+    {
+        selectFunc(irFunc);
+    }
+    irFuncDestroy(irFunc);
 }
 
 void compileTranslationUnit(TranslationUnit *transUnit)
 {
+    if (!emitIr)
+    {
+        peepholeBegin();
+    }
     for (size_t i = 0; i < transUnit->size; i++)
     {
         if (transUnit->externDecls[i]->isFunc)
@@ -2079,11 +1487,23 @@ void compileTranslationUnit(TranslationUnit *transUnit)
                 compileFunc(transUnit->externDecls[i]->funcDef);
             }
         }
-        else
+        else if (transUnit->externDecls[i]->decl->declInit != NULL)
         {
-            compileGlobal(transUnit->externDecls[i]->decl);
+            if (emitIr)
+            {
+                SymbolEntry *entry = transUnit->externDecls[i]->decl->symbolEntry;
+                emit("global @%s, %lu bytes\n\n", entry->ident, entry->storageSize);
+            }
+            else
+            {
+                compileGlobal(transUnit->externDecls[i]->decl);
+            }
         }
     }
+    if (!emitIr)
+    {
+        peepholeEnd();
+    }
 }
 
 void compileGlobal(Decl *decl)
@@ -2091,38 +1511,37 @@ void compileGlobal(Decl *decl)
     // TODO: Add const expr eval
     if (decl->declInit->initExpr == NULL)
     {
-        fprintf(outFile, "\t.section .sbss\n");
+        emit("\t.section .sbss\n");
     }
     else
     {
-        fprintf(outFile, "\t.section .sdata\n");
+        emit("\t.section .sdata\n");
     }
-    fprintf(outFile, "\t.align 2\n\t.globl %s\n\t.type %s, @object\n\t.size %s, %lu\n", decl->symbolEntry->ident, decl->symbolEntry->ident, decl->symbolEntry->ident, decl->symbolEntry->storageSize);
-    fprintf(outFile, "%s:\n", decl->symbolEntry->ident);
+    // doubles, and arrays of them, are 8 byte aligned
+    DataType dataType = decl->symbolEntry->type.dataType;
+    bool isDouble = dataType == DOUBLE_TYPE || (decl->symbolEntry->entryType == ARRAY_ENTRY && dataType == DOUBLE_PTR_TYPE);
+    emit("\t.align %d\n", isDouble ? 3 : 2);
+    emit("\t.globl %s\n\t.type %s, @object\n\t.size %s, %lu\n", decl->symbolEntry->ident, decl->symbolEntry->ident, decl->symbolEntry->ident, decl->symbolEntry->storageSize);
+    emit("%s:\n", decl->symbolEntry->ident);
     if (isPtr(decl->symbolEntry->type.dataType))
     {
         if (decl->declInit->initExpr == NULL || decl->symbolEntry->entryType == ARRAY_ENTRY)
         {
-            fprintf(outFile, "\t.zero %lu\n", decl->symbolEntry->storageSize);
+            emit("\t.zero %lu\n", decl->symbolEntry->storageSize);
         }
         else
         {
             if (decl->declInit->initExpr->type == CONSTANT_EXPR && decl->declInit->initExpr->constant->type == INT_TYPE)
             {
-                fprintf(outFile, "\t.word %i\n", decl->declInit->initExpr->constant->int_const);
+                emit("\t.word %i\n", decl->declInit->initExpr->constant->int_const);
             }
             else if (decl->declInit->initExpr->type == CONSTANT_EXPR && decl->declInit->initExpr->constant->isString)
             {
-                uint64_t labelId = getId(&LCLabelId);
-                fprintf(outFile, "\t.word .LC%lu\n", labelId);
-                fprintf(outFile, "\t.align 2\n");
-                fprintf(outFile, ".LC%lu:\n", labelId);
-                fprintf(outFile, "\t.string \"%s\"\n", decl->declInit->initExpr->constant->string_const);
-                fprintf(outFile, ".text\n");
+                emit("\t.word .LC%zu\n", poolLabel(POOL_STRING, 0, decl->declInit->initExpr->constant->string_const));
             }
             else
             {
-                fprintf(outFile, "\t.word 0\n");
+                emit("\t.word 0\n");
             }
         }
     }
@@ -2130,41 +1549,36 @@ void compileGlobal(Decl *decl)
     {
         if (decl->declInit->initExpr == NULL)
         {
-            fprintf(outFile, "\t.float\n");
+            emit("\t.zero %lu\n", decl->symbolEntry->storageSize);
         }
         else
         {
-            fprintf(outFile, "\t.float %f\n", evaluateFloatConstExpr(decl->declInit->initExpr));
+            emit("\t.word %u\n", (unsigned int)floatBits(evaluateFloatConstExpr(decl->declInit->initExpr)));
         }
     }
     else if (decl->symbolEntry->type.dataType == DOUBLE_TYPE)
     {
         if (decl->declInit->initExpr == NULL)
         {
-            fprintf(outFile, "\t.double\n");
+            emit("\t.zero %lu\n", decl->symbolEntry->storageSize);
         }
         else
         {
-            if (decl->declInit->initExpr->type == CONSTANT_EXPR)
-            {
-                fprintf(outFile, "\t.double %f\n", decl->declInit->initExpr->constant->float_const);
-            }
-            else
-            {
-                fprintf(outFile, "\t.double 0.0\n");
-            }
+            // the low word first, as a little-endian double
+            uint64_t bits = doubleBits(evaluateDoubleConstExpr(decl->declInit->initExpr));
+            emit("\t.word %u\n\t.word %u\n", (unsigned int)(uint32_t)bits, (unsigned int)(bits >> 32));
         }
     }
     else
     {
         if (decl->declInit->initExpr == NULL)
         {
-            fprintf(outFile, "\t.word\n");
+            emit("\t.zero %lu\n", decl->symbolEntry->storageSize);
         }
         else
         {
-            fprintf(outFile, "\t.word %i\n", evaluateIntConstExpr(decl->declInit->initExpr));
+            emit("\t.word %i\n", evaluateIntConstExpr(decl->declInit->initExpr));
         }
     }
-    fprintf(outFile, ".text\n");
+    emit(".text\n");
 }
@@ -1,11 +1,13 @@
 #ifndef CODEGEN_H
 #define CODEGEN_H
 
+#include <stdbool.h>
 #include <stdio.h>
 
 #include "ast.h"
 
 extern FILE *outFile;
+extern bool emitIr; // print the IR instead of assembly
 
 typedef enum
 {
@@ -75,37 +77,11 @@ typedef enum
     FT11,
 } Reg;
 
-typedef struct ParamRegCounts
-{
-    size_t intRegs;
-    size_t floatRegs;
-} ParamRegCounts;
-
 const char *regStr(Reg reg);
-Reg getTmpReg(void);
-Reg getTmpFltReg(void);
-
-void compileExpr(Expr *expr, Reg dest);
-void compileOperationExpr(OperationExpr *expr, Reg dest);
-void compileConstantExpr(ConstantExpr *expr, Reg dest);
-void compileVariableExpr(VariableExpr *expr, Reg dest);
-void compileAssignExpr(AssignExpr *expr, Reg dest);
-void compileFuncExpr(FuncExpr *expr, Reg dest);
-
-void compileStmt(Stmt *stmt);
-void compileJumpStmt(JumpStmt *stmt);
-void compileCompoundStmt(CompoundStmt *stmt);
-void compileIfStmt(IfStmt *stmt);
-void compileWhileStmt(WhileStmt *stmt);
-void compileForStmt(ForStmt *stmt);
-void compileSwitchStmt(SwitchStmt *stmt);
-void compileLabelStmt(LabelStmt *stmt);
 
 void compileFunc(FuncDef *func);
-void compileFuncArgs(DeclarationList declList);
-void compileCallArgs(FuncExpr *expr);
-
 void compileTranslationUnit(TranslationUnit *transUnit);
 void compileGlobal(Decl *decl);
+void compileConstantPool(void);
 
 #endif
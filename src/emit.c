@@ -0,0 +1,172 @@
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "codegen.h"
+#include "emit.h"
+
+#define EMIT_BUFFER_SIZE (1 << 20)
+
+static char emitBuffer[EMIT_BUFFER_SIZE];
+static size_t emitPos = 0;
+static size_t emitFlushed = 0;
+static size_t emitHeld = SIZE_MAX; // start of the held text, SIZE_MAX when nothing is held
+
+// Writes the buffered assembly to outFile, held text included
+void emitFlush(void)
+{
+    emitHeld = SIZE_MAX;
+    if (emitPos != 0)
+    {
+        fwrite(emitBuffer, 1, emitPos, outFile);
+        emitFlushed += emitPos;
+        emitPos = 0;
+    }
+}
+
+// Number of bytes of assembly emitted so far, flushed or not
+size_t emitBytesWritten(void)
+{
+    return emitFlushed + emitPos;
+}
+
+// Holds back the assembly emitted from here on so that it can be taken out and rewritten
+void emitHold(void)
+{
+    emitHeld = emitPos;
+}
+
+// Takes the text emitted since emitHold out of the buffer as a string the caller frees.
+// Returns NULL when the text outgrew the buffer and has been written out as it was.
+char *emitTakeHeld(size_t *len)
+{
+    if (emitHeld == SIZE_MAX)
+    {
+        return NULL;
+    }
+    *len = emitPos - emitHeld;
+    char *text = malloc(*len + 1);
+    if (text == NULL)
+    {
+        abort();
+    }
+    memcpy(text, emitBuffer + emitHeld, *len);
+    text[*len] = '\0';
+    emitPos = emitHeld;
+    emitHeld = SIZE_MAX;
+    return text;
+}
+
+void emitBytes(const char *bytes, const size_t len)
+{
+    if (emitPos + len > EMIT_BUFFER_SIZE)
+    {
+        emitFlush();
+        if (len > EMIT_BUFFER_SIZE)
+        {
+            fwrite(bytes, 1, len, outFile);
+            emitFlushed += len;
+            return;
+        }
+    }
+    memcpy(emitBuffer + emitPos, bytes, len);
+    emitPos += len;
+}
+
+static void emitUnsigned(uint64_t value)
+{
+    char digits[20];
+    size_t start = sizeof(digits);
+    do
+    {
+        digits[--start] = '0' + value % 10;
+        value /= 10;
+    } while (value != 0);
+    emitBytes(digits + start, sizeof(digits) - start);
+}
+
+static void emitSigned(const int64_t value)
+{
+    if (value < 0)
+    {
+        emitBytes("-", 1);
+        emitUnsigned(-(uint64_t)value);
+    }
+    else
+    {
+        emitUnsigned(value);
+    }
+}
+
+void emit(const char *format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    const char *run = format; // start of the literal text not yet copied
+    const char *c = format;
+    for (; *c != '\0'; c++)
+    {
+        if (*c != '%')
+        {
+            continue;
+        }
+        emitBytes(run, c - run);
+        c++;
+        switch (*c)
+        {
+        case 's':
+        {
+            const char *str = va_arg(args, const char *);
+            emitBytes(str, strlen(str));
+            break;
+        }
+        case 'r':
+        {
+            const char *name = regStr((Reg)va_arg(args, int));
+            emitBytes(name, strlen(name));
+            break;
+        }
+        case 'i':
+        case 'd':
+            emitSigned(va_arg(args, int));
+            break;
+        case 'u':
+            emitUnsigned(va_arg(args, unsigned int));
+            break;
+        case 'l':
+            c++;
+            if (*c == 'u')
+            {
+                emitUnsigned(va_arg(args, unsigned long));
+            }
+            else
+            {
+                emitSigned(va_arg(args, long));
+            }
+            break;
+        case 'z':
+            c++;
+            emitUnsigned(va_arg(args, size_t));
+            break;
+        case 'f':
+        {
+            // rare enough to leave to the C library
+            char number[64];
+            int len = snprintf(number, sizeof(number), "%f", va_arg(args, double));
+            emitBytes(number, len);
+            break;
+        }
+        case '%':
+            emitBytes("%", 1);
+            break;
+        default:
+            fprintf(stderr, "Unsupported emit format \"%s\", exiting...\n", format);
+            exit(EXIT_FAILURE);
+        }
+        run = c + 1;
+    }
+    emitBytes(run, c - run);
+    va_end(args);
+}
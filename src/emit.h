@@ -0,0 +1,15 @@
+#ifndef EMIT_H
+#define EMIT_H
+
+#include <stddef.h>
+
+// Appends formatted assembly to the output buffer. Supports a printf-like subset:
+// %s, %i, %d, %u, %li, %lu, %zu, %f, %% and %r which prints a Reg by name.
+void emit(const char *format, ...);
+void emitBytes(const char *bytes, size_t len);
+void emitFlush(void);
+void emitHold(void);
+char *emitTakeHeld(size_t *len);
+size_t emitBytesWritten(void);
+
+#endif
@@ -0,0 +1,144 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "arena.h"
+#include "intern.h"
+
+#define INTERN_INITIAL_CAPACITY 1024
+#define INTERN_ARENA_BLOCK_SIZE (32 * 1024)
+
+typedef struct InternEntry
+{
+    char *str; // NULL for an empty slot
+    size_t len;
+    uint32_t hash;
+} InternEntry;
+
+// Open addressing hash set of every distinct spelling seen by the lexer
+typedef struct InternTable
+{
+    InternEntry *entries;
+    size_t size;
+    size_t capacity; // always a power of two
+    Arena *strings;
+} InternTable;
+
+static InternTable *internTable = NULL;
+
+// FNV-1a hash
+static uint32_t hashStr(const char *str, const size_t len)
+{
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < len; i++)
+    {
+        hash ^= (unsigned char)str[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+// Intern table constructor
+static InternTable *internTableCreate(const size_t capacity)
+{
+    InternTable *table = malloc(sizeof(InternTable));
+    if (table == NULL)
+    {
+        abort();
+    }
+    table->entries = calloc(capacity, sizeof(InternEntry));
+    if (table->entries == NULL)
+    {
+        abort();
+    }
+    table->size = 0;
+    table->capacity = capacity;
+    table->strings = arenaCreate(INTERN_ARENA_BLOCK_SIZE);
+    return table;
+}
+
+// Doubles the number of slots, the strings themselves do not move
+static void internTableGrow(InternTable *table)
+{
+    size_t newCapacity = table->capacity * 2;
+    InternEntry *newEntries = calloc(newCapacity, sizeof(InternEntry));
+    if (newEntries == NULL)
+    {
+        abort();
+    }
+    for (size_t i = 0; i < table->capacity; i++)
+    {
+        InternEntry entry = table->entries[i];
+        if (entry.str != NULL)
+        {
+            size_t slot = entry.hash & (newCapacity - 1);
+            while (newEntries[slot].str != NULL)
+            {
+                slot = (slot + 1) & (newCapacity - 1);
+            }
+            newEntries[slot] = entry;
+        }
+    }
+    free(table->entries);
+    table->entries = newEntries;
+    table->capacity = newCapacity;
+}
+
+// Returns the unique copy of the first len characters of str
+char *internStr(const char *str, const size_t len)
+{
+    if (internTable == NULL)
+    {
+        internTable = internTableCreate(INTERN_INITIAL_CAPACITY);
+    }
+    uint32_t hash = hashStr(str, len);
+    size_t slot = hash & (internTable->capacity - 1);
+    while (internTable->entries[slot].str != NULL)
+    {
+        InternEntry *entry = &internTable->entries[slot];
+        if (entry->hash == hash && entry->len == len && memcmp(entry->str, str, len) == 0)
+        {
+            return entry->str;
+        }
+        slot = (slot + 1) & (internTable->capacity - 1);
+    }
+
+    InternEntry *entry = &internTable->entries[slot];
+    entry->str = arenaStrdup(internTable->strings, str, len);
+    entry->len = len;
+    entry->hash = hash;
+    internTable->size++;
+
+    // keep the load factor under a half so probe sequences stay short
+    if (internTable->size * 2 > internTable->capacity)
+    {
+        char *interned = entry->str;
+        internTableGrow(internTable);
+        return interned;
+    }
+    return entry->str;
+}
+
+// Number of distinct strings interned so far
+size_t internCount(void)
+{
+    return internTable == NULL ? 0 : internTable->size;
+}
+
+// Bytes reserved for interned strings
+size_t internBytes(void)
+{
+    return internTable == NULL ? 0 : internTable->strings->bytesReserved;
+}
+
+// Releases the table and every interned string
+void internTableDestroy(void)
+{
+    if (internTable != NULL)
+    {
+        arenaDestroy(internTable->strings);
+        free(internTable->entries);
+        free(internTable);
+        internTable = NULL;
+    }
+}
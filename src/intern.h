@@ -0,0 +1,13 @@
+#ifndef INTERN_H
+#define INTERN_H
+
+#include <stddef.h>
+
+// Interned strings are unique per spelling, so two identifiers are equal
+// exactly when their pointers are equal. They live until internTableDestroy.
+char *internStr(const char *str, size_t len);
+size_t internCount(void);
+size_t internBytes(void);
+void internTableDestroy(void);
+
+#endif
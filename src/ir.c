@@ -0,0 +1,1266 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "arena.h"
+#include "emit.h"
+#include "ir.h"
+#include "symbol.h"
+
+// Grows an arena allocated array so that it can hold at least size elements
+void *irArrayGrow(IrFunc *func, void *array, size_t *capacity, const size_t size, const size_t elementSize)
+{
+    if (size <= *capacity)
+    {
+        return array;
+    }
+    size_t oldCapacity = *capacity;
+    size_t newCapacity = oldCapacity == 0 ? 4 : oldCapacity;
+    while (newCapacity < size)
+    {
+        newCapacity *= 2;
+    }
+    *capacity = newCapacity;
+    return arenaRealloc(func->arena, array, oldCapacity * elementSize, newCapacity * elementSize);
+}
+
+// IR function constructor
+IrFunc *irFuncCreate(char *ident, SymbolEntry *symbolEntry, const IrType retType)
+{
+    Arena *arena = arenaCreate(IR_ARENA_BLOCK_SIZE);
+    IrFunc *func = arenaAlloc(arena, sizeof(IrFunc));
+    memset(func, 0, sizeof(IrFunc));
+    func->arena = arena;
+    func->ident = ident;
+    func->symbolEntry = symbolEntry;
+    func->retType = retType;
+    func->frameSize = symbolEntry != NULL ? symbolEntry->storageSize : 0;
+    func->vregCount = 1; // register 0 means no register
+    func->vregTypes = irArrayGrow(func, NULL, &func->vregCapacity, 1, sizeof(IrType));
+    func->vregTypes[0] = IR_VOID;
+    return func;
+}
+
+// IR function destructor, frees every block and instruction
+void irFuncDestroy(IrFunc *func)
+{
+    arenaDestroy(func->arena);
+}
+
+// Creates a block that is not part of the layout until irBlockPlace
+IrBlock *irBlockCreate(IrFunc *func)
+{
+    IrBlock *block = arenaAlloc(func->arena, sizeof(IrBlock));
+    memset(block, 0, sizeof(IrBlock));
+    block->id = func->blockIds++;
+    return block;
+}
+
+// Appends a block to the layout
+void irBlockPlace(IrFunc *func, IrBlock *block)
+{
+    func->blocks = irArrayGrow(func, func->blocks, &func->capacity, func->size + 1, sizeof(IrBlock *));
+    func->blocks[func->size++] = block;
+    block->placed = true;
+}
+
+// Returns a fresh virtual register
+size_t irVregCreate(IrFunc *func, const IrType type)
+{
+    func->vregTypes = irArrayGrow(func, func->vregTypes, &func->vregCapacity, func->vregCount + 1, sizeof(IrType));
+    func->vregTypes[func->vregCount] = type;
+    return func->vregCount++;
+}
+
+// Instruction constructor, every operand starts out empty
+IrInstr *irInstrCreate(IrFunc *func, const IrOp op)
+{
+    IrInstr *instr = arenaAlloc(func->arena, sizeof(IrInstr));
+    memset(instr, 0, sizeof(IrInstr));
+    instr->op = op;
+    instr->type = IR_VOID;
+    instr->memType = IR_VOID;
+    instr->cond = IR_BOOL;
+    return instr;
+}
+
+// Appends an instruction to a block
+void irInstrPush(IrFunc *func, IrBlock *block, IrInstr *instr)
+{
+    block->instrs = irArrayGrow(func, block->instrs, &block->capacity, block->size + 1, sizeof(IrInstr *));
+    block->instrs[block->size++] = instr;
+}
+
+// Inserts an instruction before position index of a block
+void irInstrInsert(IrFunc *func, IrBlock *block, const size_t index, IrInstr *instr)
+{
+    block->instrs = irArrayGrow(func, block->instrs, &block->capacity, block->size + 1, sizeof(IrInstr *));
+    memmove(block->instrs + index + 1, block->instrs + index, sizeof(IrInstr *) * (block->size - index));
+    block->instrs[index] = instr;
+    block->size++;
+}
+
+// Appends an argument to a call
+void irArgPush(IrFunc *func, IrInstr *call, const size_t arg)
+{
+    call->args = irArrayGrow(func, call->args, &call->argsCapacity, call->argsSize + 1, sizeof(size_t));
+    call->args[call->argsSize++] = arg;
+}
+
+// Appends a case to a switch
+void irCasePush(IrFunc *func, IrInstr *instr, const int32_t value, IrBlock *target)
+{
+    instr->cases = irArrayGrow(func, instr->cases, &instr->casesCapacity, instr->casesSize + 1, sizeof(IrCase));
+    instr->cases[instr->casesSize].value = value;
+    instr->cases[instr->casesSize].target = target;
+    instr->casesSize++;
+}
+
+// Appends the argument a phi takes when control comes in from pred
+void irPhiPush(IrFunc *func, IrInstr *phi, const size_t arg, IrBlock *pred)
+{
+    phi->phiPreds = irArrayGrow(func, phi->phiPreds, &phi->phiPredsCapacity, phi->argsSize + 1, sizeof(IrBlock *));
+    phi->phiPreds[phi->argsSize] = pred;
+    irArgPush(func, phi, arg);
+}
+
+bool irIsTerminator(const IrOp op)
+{
+    return op == IR_JMP || op == IR_BR || op == IR_SWITCH || op == IR_RET;
+}
+
+bool irIsComparison(const IrOp op)
+{
+    return op >= IR_EQ && op <= IR_GEU;
+}
+
+// Returns the terminator of a block, NULL if it has none yet
+IrInstr *irTerminator(IrBlock *block)
+{
+    if (block->size == 0 || !irIsTerminator(block->instrs[block->size - 1]->op))
+    {
+        return NULL;
+    }
+    return block->instrs[block->size - 1];
+}
+
+// Number of blocks a terminator can jump to, counting repeated targets
+size_t irTargetCount(const IrInstr *term)
+{
+    switch (term->op)
+    {
+    case IR_JMP:
+        return 1;
+    case IR_BR:
+        return 2;
+    case IR_SWITCH:
+        return term->casesSize + 1;
+    default:
+        return 0;
+    }
+}
+
+// Target i of a terminator, a switch lists its cases before the default
+IrBlock *irTarget(const IrInstr *term, const size_t i)
+{
+    if (term->op == IR_SWITCH)
+    {
+        return i < term->casesSize ? term->cases[i].target : term->targets[0];
+    }
+    return term->targets[i];
+}
+
+static void edgePush(IrFunc *func, IrBlock *from, IrBlock *to)
+{
+    from->succs = irArrayGrow(func, from->succs, &from->succsCapacity, from->succsSize + 1, sizeof(IrBlock *));
+    from->succSlots = irArrayGrow(func, from->succSlots, &from->succSlotsCapacity, from->succsSize + 1, sizeof(size_t));
+    from->succSlots[from->succsSize] = to->predsSize;
+    from->succs[from->succsSize++] = to;
+    to->preds = irArrayGrow(func, to->preds, &to->predsCapacity, to->predsSize + 1, sizeof(IrBlock *));
+    to->preds[to->predsSize++] = from;
+}
+
+// Lines the arguments of every phi of a block up with its rebuilt predecessors, dropping those
+// of edges that no longer exist. slots and args are scratch space by block id and by position.
+static void matchPhis(IrFunc *func, IrBlock *block, size_t *slots, size_t *args)
+{
+    if (block->size == 0 || block->instrs[0]->op != IR_PHI)
+    {
+        return;
+    }
+    for (size_t i = 0; i < block->predsSize; i++)
+    {
+        slots[block->preds[i]->id] = i;
+    }
+    for (size_t i = 0; i < block->size && block->instrs[i]->op == IR_PHI; i++)
+    {
+        IrInstr *phi = block->instrs[i];
+        for (size_t j = 0; j < block->predsSize; j++)
+        {
+            args[j] = 0; // an edge without an argument fails verification
+        }
+        for (size_t j = 0; j < phi->argsSize; j++)
+        {
+            size_t slot = slots[phi->phiPreds[j]->id];
+            if (slot < block->predsSize && block->preds[slot] == phi->phiPreds[j])
+            {
+                args[slot] = phi->args[j];
+            }
+        }
+        phi->args = irArrayGrow(func, phi->args, &phi->argsCapacity, block->predsSize, sizeof(size_t));
+        phi->phiPreds = irArrayGrow(func, phi->phiPreds, &phi->phiPredsCapacity, block->predsSize, sizeof(IrBlock *));
+        memcpy(phi->args, args, sizeof(size_t) * block->predsSize);
+        memcpy(phi->phiPreds, block->preds, sizeof(IrBlock *) * block->predsSize);
+        phi->argsSize = block->predsSize;
+    }
+}
+
+// Rebuilds the predecessor and successor lists of every block from the terminators
+void irComputeCfg(IrFunc *func)
+{
+    // lastFrom[id] is the last block given an edge to block id, so repeated targets add one edge
+    IrBlock **lastFrom = calloc(func->blockIds, sizeof(IrBlock *));
+    if (lastFrom == NULL)
+    {
+        abort();
+    }
+    for (size_t i = 0; i < func->size; i++)
+    {
+        func->blocks[i]->predsSize = 0;
+        func->blocks[i]->succsSize = 0;
+    }
+    for (size_t i = 0; i < func->size; i++)
+    {
+        IrBlock *block = func->blocks[i];
+        IrInstr *term = irTerminator(block);
+        if (term == NULL)
+        {
+            continue;
+        }
+        for (size_t j = 0; j < irTargetCount(term); j++)
+        {
+            IrBlock *target = irTarget(term, j);
+            if (lastFrom[target->id] != block)
+            {
+                lastFrom[target->id] = block;
+                edgePush(func, block, target);
+            }
+        }
+    }
+    size_t *slots = calloc(func->blockIds, sizeof(size_t));
+    size_t *args = malloc(sizeof(size_t) * (func->size + 1));
+    if (slots == NULL || args == NULL)
+    {
+        abort();
+    }
+    for (size_t i = 0; i < func->size; i++)
+    {
+        matchPhis(func, func->blocks[i], slots, args);
+    }
+    free(lastFrom);
+    free(slots);
+    free(args);
+}
+
+static int caseCompare(const void *a, const void *b)
+{
+    int32_t x = *(const int32_t *)a;
+    int32_t y = *(const int32_t *)b;
+    return (x > y) - (x < y);
+}
+
+// Whether two cases of a switch have the same value
+bool irHasDuplicateCase(const IrInstr *instr)
+{
+    if (instr->casesSize < 2)
+    {
+        return false;
+    }
+    int32_t *values = malloc(sizeof(int32_t) * instr->casesSize);
+    if (values == NULL)
+    {
+        abort();
+    }
+    for (size_t i = 0; i < instr->casesSize; i++)
+    {
+        values[i] = instr->cases[i].value;
+    }
+    qsort(values, instr->casesSize, sizeof(int32_t), caseCompare);
+    bool duplicate = false;
+    for (size_t i = 1; i < instr->casesSize && !duplicate; i++)
+    {
+        duplicate = values[i] == values[i - 1];
+    }
+    free(values);
+    return duplicate;
+}
+
+// Drops blocks that cannot be reached from the entry, then rebuilds the CFG
+void irRemoveUnreachable(IrFunc *func)
+{
+    irComputeCfg(func);
+    bool *reached = calloc(func->blockIds, sizeof(bool));
+    IrBlock **worklist = malloc(sizeof(IrBlock *) * (func->size + 1));
+    if (reached == NULL || worklist == NULL)
+    {
+        abort();
+    }
+    size_t worklistSize = 0;
+    reached[func->blocks[0]->id] = true;
+    worklist[worklistSize++] = func->blocks[0];
+    while (worklistSize > 0)
+    {
+        IrBlock *block = worklist[--worklistSize];
+        for (size_t i = 0; i < block->succsSize; i++)
+        {
+            if (!reached[block->succs[i]->id])
+            {
+                reached[block->succs[i]->id] = true;
+                worklist[worklistSize++] = block->succs[i];
+            }
+        }
+    }
+
+    size_t kept = 0;
+    for (size_t i = 0; i < func->size; i++)
+    {
+        if (reached[func->blocks[i]->id])
+        {
+            func->blocks[kept++] = func->blocks[i];
+        }
+        else
+        {
+            func->blocks[i]->placed = false;
+        }
+    }
+    func->size = kept;
+    free(reached);
+    free(worklist);
+    irComputeCfg(func);
+}
+
+/* Dominators */
+
+// Nearest block that dominates both blocks
+IrBlock *irCommonDominator(IrBlock *a, IrBlock *b)
+{
+    while (a != b)
+    {
+        while (a->order > b->order)
+        {
+            a = a->idom;
+        }
+        while (b->order > a->order)
+        {
+            b = b->idom;
+        }
+    }
+    return a;
+}
+
+// Sets the immediate dominator of every block with the iterative algorithm of Cooper, Harvey
+// and Kennedy over reverse postorder. Every block must be reachable.
+void irComputeDominators(IrFunc *func)
+{
+    IrBlock **postorder = malloc(sizeof(IrBlock *) * (func->size + 1));
+    IrBlock **stack = malloc(sizeof(IrBlock *) * (func->size + 1));
+    size_t *nextSucc = calloc(func->blockIds, sizeof(size_t));
+    bool *visited = calloc(func->blockIds, sizeof(bool));
+    if (postorder == NULL || stack == NULL || nextSucc == NULL || visited == NULL)
+    {
+        abort();
+    }
+    size_t postorderSize = 0;
+    size_t stackSize = 0;
+    stack[stackSize++] = func->blocks[0];
+    visited[func->blocks[0]->id] = true;
+    while (stackSize > 0)
+    {
+        IrBlock *block = stack[stackSize - 1];
+        if (nextSucc[block->id] < block->succsSize)
+        {
+            IrBlock *succ = block->succs[nextSucc[block->id]++];
+            if (!visited[succ->id])
+            {
+                visited[succ->id] = true;
+                stack[stackSize++] = succ;
+            }
+        }
+        else
+        {
+            postorder[postorderSize++] = block;
+            stackSize--;
+        }
+    }
+    for (size_t i = 0; i < postorderSize; i++)
+    {
+        postorder[i]->order = postorderSize - 1 - i;
+        postorder[i]->idom = NULL;
+    }
+
+    IrBlock *entry = func->blocks[0];
+    entry->idom = entry;
+    bool changed = true;
+    while (changed)
+    {
+        changed = false;
+        for (size_t i = postorderSize - 1; i-- > 0;)
+        {
+            IrBlock *block = postorder[i];
+            IrBlock *idom = NULL;
+            for (size_t j = 0; j < block->predsSize; j++)
+            {
+                IrBlock *pred = block->preds[j];
+                if (pred->idom != NULL)
+                {
+                    idom = idom == NULL ? pred : irCommonDominator(pred, idom);
+                }
+            }
+            if (idom != block->idom)
+            {
+                block->idom = idom;
+                changed = true;
+            }
+        }
+    }
+    entry->idom = NULL;
+
+    // numbers the tree in preorder from the subtree sizes, an immediate dominator comes before
+    // the blocks it dominates in reverse postorder and after them in postorder
+    size_t *subtree = nextSucc;
+    size_t *nextNumber = calloc(func->blockIds, sizeof(size_t));
+    if (nextNumber == NULL)
+    {
+        abort();
+    }
+    for (size_t i = 0; i < postorderSize; i++)
+    {
+        subtree[postorder[i]->id] = 1;
+    }
+    for (size_t i = 0; i + 1 < postorderSize; i++)
+    {
+        subtree[postorder[i]->idom->id] += subtree[postorder[i]->id];
+    }
+    for (size_t i = postorderSize; i-- > 0;)
+    {
+        IrBlock *block = postorder[i];
+        block->domFirst = block == entry ? 0 : nextNumber[block->idom->id];
+        block->domLast = block->domFirst + subtree[block->id] - 1;
+        nextNumber[block->id] = block->domFirst + 1;
+        if (block != entry)
+        {
+            nextNumber[block->idom->id] += subtree[block->id];
+        }
+    }
+    free(nextNumber);
+    free(postorder);
+    free(stack);
+    free(nextSucc);
+    free(visited);
+}
+
+bool irDominates(const IrBlock *dominator, const IrBlock *block)
+{
+    return dominator->domFirst <= block->domFirst && block->domFirst <= dominator->domLast;
+}
+
+/* Liveness */
+
+static bool bitTest(const uint64_t *set, const size_t bit)
+{
+    return (set[bit / 64] >> (bit % 64)) & 1;
+}
+
+static void bitSet(uint64_t *set, const size_t bit)
+{
+    set[bit / 64] |= (uint64_t)1 << (bit % 64);
+}
+
+// Solves the live variable equations over the registers that are read in a block before
+// being written in it, every other register is dead at every block boundary
+IrLiveness *irLivenessCreate(IrFunc *func)
+{
+    IrLiveness *live = malloc(sizeof(IrLiveness));
+    size_t *definedIn = calloc(func->vregCount, sizeof(size_t));
+    size_t *writtenIn = calloc(func->vregCount, sizeof(size_t)); // block id + 1 of the last write
+    if (live == NULL || definedIn == NULL || writtenIn == NULL)
+    {
+        abort();
+    }
+    for (size_t i = 0; i < func->size; i++)
+    {
+        for (size_t j = 0; j < func->blocks[i]->size; j++)
+        {
+            writtenIn[func->blocks[i]->instrs[j]->dest] = func->blocks[i]->id + 1;
+        }
+    }
+    live->index = malloc(sizeof(size_t) * func->vregCount);
+    live->vregs = malloc(sizeof(size_t) * func->vregCount);
+    if (live->index == NULL || live->vregs == NULL)
+    {
+        abort();
+    }
+    for (size_t i = 0; i < func->vregCount; i++)
+    {
+        live->index[i] = SIZE_MAX;
+    }
+    live->size = 0;
+    for (size_t i = 0; i < func->size; i++)
+    {
+        IrBlock *block = func->blocks[i];
+        for (size_t j = 0; j < block->size; j++)
+        {
+            IrInstr *instr = block->instrs[j];
+            for (size_t k = 0; k < irUseCount(instr); k++)
+            {
+                size_t vreg = irUse(instr, k);
+                bool exposed = instr->op == IR_PHI ? writtenIn[vreg] != instr->phiPreds[k]->id + 1 : definedIn[vreg] != i + 1;
+                if (exposed && live->index[vreg] == SIZE_MAX)
+                {
+                    live->index[vreg] = live->size;
+                    live->vregs[live->size++] = vreg;
+                }
+            }
+            definedIn[instr->dest] = i + 1;
+        }
+    }
+    free(definedIn);
+    free(writtenIn);
+
+    live->words = (live->size + 63) / 64;
+    size_t setsSize = live->words * func->blockIds;
+    live->liveIn = calloc(setsSize + 1, sizeof(uint64_t));
+    live->liveOut = calloc(setsSize + 1, sizeof(uint64_t));
+    uint64_t *gen = calloc(setsSize + 1, sizeof(uint64_t));
+    uint64_t *kill = calloc(setsSize + 1, sizeof(uint64_t));
+    uint64_t *phiUses = calloc(setsSize + 1, sizeof(uint64_t)); // phi arguments read at the end of a block
+    if (live->liveIn == NULL || live->liveOut == NULL || gen == NULL || kill == NULL || phiUses == NULL)
+    {
+        abort();
+    }
+    for (size_t i = 0; i < func->size; i++)
+    {
+        IrBlock *block = func->blocks[i];
+        uint64_t *blockGen = gen + block->id * live->words;
+        uint64_t *blockKill = kill + block->id * live->words;
+        for (size_t j = 0; j < block->size; j++)
+        {
+            IrInstr *instr = block->instrs[j];
+            for (size_t k = 0; instr->op == IR_PHI && k < instr->argsSize; k++)
+            {
+                if (live->index[instr->args[k]] != SIZE_MAX)
+                {
+                    bitSet(phiUses + instr->phiPreds[k]->id * live->words, live->index[instr->args[k]]);
+                }
+            }
+            for (size_t k = 0; instr->op != IR_PHI && k < irUseCount(instr); k++)
+            {
+                size_t index = live->index[irUse(instr, k)];
+                if (index != SIZE_MAX && !bitTest(blockKill, index))
+                {
+                    bitSet(blockGen, index);
+                }
+            }
+            if (instr->dest != 0 && live->index[instr->dest] != SIZE_MAX)
+            {
+                bitSet(blockKill, live->index[instr->dest]);
+            }
+        }
+    }
+
+    // visiting the blocks backwards lets most values flow through a loop in one pass
+    bool changed = true;
+    while (changed)
+    {
+        changed = false;
+        for (size_t i = func->size; i-- > 0;)
+        {
+            IrBlock *block = func->blocks[i];
+            uint64_t *in = live->liveIn + block->id * live->words;
+            uint64_t *out = live->liveOut + block->id * live->words;
+            for (size_t w = 0; w < live->words; w++)
+            {
+                uint64_t word = phiUses[block->id * live->words + w];
+                for (size_t j = 0; j < block->succsSize; j++)
+                {
+                    word |= live->liveIn[block->succs[j]->id * live->words + w];
+                }
+                out[w] = word;
+                word = gen[block->id * live->words + w] | (word & ~kill[block->id * live->words + w]);
+                if (word != in[w])
+                {
+                    in[w] = word;
+                    changed = true;
+                }
+            }
+        }
+    }
+    free(gen);
+    free(kill);
+    free(phiUses);
+    return live;
+}
+
+void irLivenessDestroy(IrLiveness *live)
+{
+    free(live->index);
+    free(live->vregs);
+    free(live->liveIn);
+    free(live->liveOut);
+    free(live);
+}
+
+bool irLiveIn(const IrLiveness *live, const IrBlock *block, const size_t vreg)
+{
+    size_t index = live->index[vreg];
+    return index != SIZE_MAX && bitTest(live->liveIn + block->id * live->words, index);
+}
+
+bool irLiveOut(const IrLiveness *live, const IrBlock *block, const size_t vreg)
+{
+    size_t index = live->index[vreg];
+    return index != SIZE_MAX && bitTest(live->liveOut + block->id * live->words, index);
+}
+
+// returns the type conversion of the ast to the ir
+IrType irTypeOf(const DataType type)
+{
+    switch (type)
+    {
+    case VOID_TYPE:
+        return IR_VOID;
+    case FLOAT_TYPE:
+        return IR_F32;
+    case DOUBLE_TYPE:
+        return IR_F64;
+    default:
+        return IR_I32;
+    }
+}
+
+// returns the width a value of the given type is stored with
+IrType irMemTypeOf(const DataType type)
+{
+    switch (type)
+    {
+    case CHAR_TYPE:
+    case SIGNED_CHAR_TYPE:
+        return IR_I8;
+    case SHORT_TYPE:
+    case UNSIGNED_SHORT_TYPE:
+        return IR_I16;
+    case FLOAT_TYPE:
+        return IR_F32;
+    case DOUBLE_TYPE:
+        return IR_F64;
+    default:
+        return IR_I32;
+    }
+}
+
+bool irIsFloatType(const IrType type)
+{
+    return type == IR_F32 || type == IR_F64;
+}
+
+// returns the type of the value produced by loading the given width
+IrType irValueType(const IrType memType)
+{
+    if (memType == IR_I8 || memType == IR_I16)
+    {
+        return IR_I32;
+    }
+    return memType;
+}
+
+const char *irTypeStr(const IrType type)
+{
+    switch (type)
+    {
+    case IR_VOID:
+        return "void";
+    case IR_I8:
+        return "i8";
+    case IR_I16:
+        return "i16";
+    case IR_I32:
+        return "i32";
+    case IR_F32:
+        return "f32";
+    case IR_F64:
+        return "f64";
+    }
+    return "?";
+}
+
+const char *irOpStr(const IrOp op)
+{
+    static const char *names[] = {
+        [IR_LI] = "li",
+        [IR_LF] = "lf",
+        [IR_LSTR] = "str",
+        [IR_ADDR] = "addr",
+        [IR_MOV] = "mov",
+        [IR_PARAM] = "param",
+        [IR_CVT] = "cvt",
+        [IR_PHI] = "phi",
+        [IR_ADD] = "add",
+        [IR_SUB] = "sub",
+        [IR_MUL] = "mul",
+        [IR_DIV] = "div",
+        [IR_NEG] = "neg",
+        [IR_DIVU] = "divu",
+        [IR_MULH] = "mulh",
+        [IR_MULHU] = "mulhu",
+        [IR_REM] = "rem",
+        [IR_REMU] = "remu",
+        [IR_AND] = "and",
+        [IR_OR] = "or",
+        [IR_XOR] = "xor",
+        [IR_SHL] = "shl",
+        [IR_SHR] = "shr",
+        [IR_SAR] = "sar",
+        [IR_NOT] = "not",
+        [IR_LNOT] = "lnot",
+        [IR_BOOL] = "bool",
+        [IR_EQ] = "eq",
+        [IR_NE] = "ne",
+        [IR_LT] = "lt",
+        [IR_LE] = "le",
+        [IR_GT] = "gt",
+        [IR_GE] = "ge",
+        [IR_LTU] = "ltu",
+        [IR_LEU] = "leu",
+        [IR_GTU] = "gtu",
+        [IR_GEU] = "geu",
+        [IR_LOAD] = "load",
+        [IR_STORE] = "store",
+        [IR_CALL] = "call",
+        [IR_JMP] = "jmp",
+        [IR_BR] = "br",
+        [IR_SWITCH] = "switch",
+        [IR_RET] = "ret"};
+    return names[op];
+}
+
+/* Verifier */
+
+static void verifyFail(IrFunc *func, IrBlock *block, const char *message)
+{
+    if (block == NULL)
+    {
+        fprintf(stderr, "IR verification failed in %s: %s, exiting...\n", func->ident, message);
+    }
+    else
+    {
+        fprintf(stderr, "IR verification failed in %s, block .B%zu: %s, exiting...\n", func->ident, block->id, message);
+    }
+    exit(EXIT_FAILURE);
+}
+
+static bool isBinaryOp(const IrOp op)
+{
+    return op >= IR_ADD && op <= IR_SAR && op != IR_NEG;
+}
+
+static bool isIntOnlyOp(const IrOp op)
+{
+    return op >= IR_DIVU && op <= IR_BOOL;
+}
+
+// whether an instruction writes dest
+bool irDefinesValue(const IrInstr *instr)
+{
+    switch (instr->op)
+    {
+    case IR_STORE:
+    case IR_JMP:
+    case IR_BR:
+    case IR_SWITCH:
+    case IR_RET:
+        return false;
+    case IR_CALL:
+        return instr->type != IR_VOID;
+    default:
+        return true;
+    }
+}
+
+// number of register operands read from src, CALL arguments are in args
+size_t irSrcCount(const IrInstr *instr)
+{
+    if (isBinaryOp(instr->op) || irIsComparison(instr->op))
+    {
+        return instr->src[1] != 0 ? 2 : 1;
+    }
+    switch (instr->op)
+    {
+    case IR_MOV:
+    case IR_CVT:
+    case IR_NEG:
+    case IR_NOT:
+    case IR_LNOT:
+    case IR_BOOL:
+    case IR_SWITCH:
+        return 1;
+    case IR_BR:
+        return instr->cond == IR_BOOL || instr->src[1] == 0 ? 1 : 2;
+    case IR_LOAD:
+        return instr->var == NULL ? 1 : 0;
+    case IR_STORE:
+        return instr->var == NULL ? 2 : 1;
+    case IR_RET:
+        return instr->src[0] != 0 ? 1 : 0;
+    default:
+        return 0;
+    }
+}
+
+// number of registers an instruction reads, its sources followed by its arguments
+size_t irUseCount(const IrInstr *instr)
+{
+    return irSrcCount(instr) + instr->argsSize;
+}
+
+// register read i of an instruction, in the order of irUseCount
+size_t irUse(const IrInstr *instr, const size_t i)
+{
+    size_t srcCount = irSrcCount(instr);
+    return i < srcCount ? instr->src[i] : instr->args[i - srcCount];
+}
+
+static void verifyReg(IrFunc *func, IrBlock *block, const size_t reg, const bool *defined)
+{
+    if (reg == 0 || reg >= func->vregCount)
+    {
+        verifyFail(func, block, "operand is not a virtual register");
+    }
+    if (!defined[reg])
+    {
+        verifyFail(func, block, "virtual register is used but never defined");
+    }
+}
+
+// blocks dropped from the layout are no longer placed
+static bool placedBlock(IrBlock *block)
+{
+    return block != NULL && block->placed;
+}
+
+typedef struct IrEdge
+{
+    size_t from;
+    size_t to;
+} IrEdge;
+
+static int edgeCompare(const void *a, const void *b)
+{
+    const IrEdge *x = a;
+    const IrEdge *y = b;
+    if (x->from != y->from)
+    {
+        return x->from < y->from ? -1 : 1;
+    }
+    return (x->to > y->to) - (x->to < y->to);
+}
+
+// The successor and predecessor lists must both hold exactly the edges of the terminators.
+// Comparing sorted edge lists keeps this linear-logarithmic for switches with many cases.
+static void verifyEdges(IrFunc *func)
+{
+    size_t capacity = 0;
+    for (size_t i = 0; i < func->size; i++)
+    {
+        capacity += irTargetCount(irTerminator(func->blocks[i]));
+    }
+    IrEdge *expected = malloc(sizeof(IrEdge) * (capacity + 1));
+    IrEdge *succs = malloc(sizeof(IrEdge) * (capacity + 1));
+    IrEdge *preds = malloc(sizeof(IrEdge) * (capacity + 1));
+    IrBlock **lastFrom = calloc(func->blockIds, sizeof(IrBlock *));
+    if (expected == NULL || succs == NULL || preds == NULL || lastFrom == NULL)
+    {
+        abort();
+    }
+
+    size_t expectedSize = 0;
+    size_t succsSize = 0;
+    size_t predsSize = 0;
+    for (size_t i = 0; i < func->size; i++)
+    {
+        IrBlock *block = func->blocks[i];
+        IrInstr *term = irTerminator(block);
+        for (size_t j = 0; j < irTargetCount(term); j++)
+        {
+            IrBlock *target = irTarget(term, j);
+            if (lastFrom[target->id] != block)
+            {
+                lastFrom[target->id] = block;
+                expected[expectedSize++] = (IrEdge){block->id, target->id};
+            }
+        }
+        succsSize += block->succsSize;
+        predsSize += block->predsSize;
+    }
+    if (succsSize != expectedSize)
+    {
+        verifyFail(func, NULL, "successor lists are out of date");
+    }
+    if (predsSize != expectedSize)
+    {
+        verifyFail(func, NULL, "predecessor lists are out of date");
+    }
+
+    succsSize = 0;
+    predsSize = 0;
+    for (size_t i = 0; i < func->size; i++)
+    {
+        IrBlock *block = func->blocks[i];
+        for (size_t j = 0; j < block->succsSize; j++)
+        {
+            succs[succsSize++] = (IrEdge){block->id, block->succs[j]->id};
+        }
+        for (size_t j = 0; j < block->predsSize; j++)
+        {
+            preds[predsSize++] = (IrEdge){block->preds[j]->id, block->id};
+        }
+    }
+    qsort(expected, expectedSize, sizeof(IrEdge), edgeCompare);
+    qsort(succs, succsSize, sizeof(IrEdge), edgeCompare);
+    qsort(preds, predsSize, sizeof(IrEdge), edgeCompare);
+    if (memcmp(expected, succs, sizeof(IrEdge) * expectedSize) != 0)
+    {
+        verifyFail(func, NULL, "successor lists are out of date");
+    }
+    if (memcmp(expected, preds, sizeof(IrEdge) * expectedSize) != 0)
+    {
+        verifyFail(func, NULL, "predecessor lists are out of date");
+    }
+    free(expected);
+    free(succs);
+    free(preds);
+    free(lastFrom);
+}
+
+// A phi takes one argument of its own type from every predecessor, in their order
+static bool phiMatchesPreds(IrFunc *func, IrBlock *block, IrInstr *phi)
+{
+    if (phi->argsSize != block->predsSize)
+    {
+        return false;
+    }
+    for (size_t i = 0; i < phi->argsSize; i++)
+    {
+        if (phi->phiPreds[i] != block->preds[i] || func->vregTypes[phi->args[i]] != phi->type)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Checks the structural invariants of a function, exits with a message if one is broken
+void irVerify(IrFunc *func)
+{
+    if (func->size == 0)
+    {
+        verifyFail(func, NULL, "function has no blocks");
+    }
+
+    bool *defined = calloc(func->vregCount, sizeof(bool));
+    if (defined == NULL)
+    {
+        abort();
+    }
+    for (size_t i = 0; i < func->size; i++)
+    {
+        IrBlock *block = func->blocks[i];
+        for (size_t j = 0; j < block->size; j++)
+        {
+            IrInstr *instr = block->instrs[j];
+            if (irDefinesValue(instr))
+            {
+                if (instr->dest == 0 || instr->dest >= func->vregCount)
+                {
+                    verifyFail(func, block, "instruction defines no virtual register");
+                }
+                if (func->vregTypes[instr->dest] != instr->type)
+                {
+                    verifyFail(func, block, "destination type does not match its register");
+                }
+                defined[instr->dest] = true;
+            }
+            else if (instr->dest != 0)
+            {
+                verifyFail(func, block, "instruction defines a register it cannot produce");
+            }
+        }
+    }
+
+    for (size_t i = 0; i < func->size; i++)
+    {
+        IrBlock *block = func->blocks[i];
+        if (irTerminator(block) == NULL)
+        {
+            verifyFail(func, block, "block does not end in a terminator");
+        }
+        for (size_t j = 0; j < block->size; j++)
+        {
+            IrInstr *instr = block->instrs[j];
+            if (irIsTerminator(instr->op) && j != block->size - 1)
+            {
+                verifyFail(func, block, "terminator in the middle of a block");
+            }
+            for (size_t k = 0; k < irSrcCount(instr); k++)
+            {
+                verifyReg(func, block, instr->src[k], defined);
+            }
+            for (size_t k = 0; k < instr->argsSize; k++)
+            {
+                verifyReg(func, block, instr->args[k], defined);
+            }
+
+            // an immediate right operand stands for an I32 one
+            IrType src0 = func->vregTypes[instr->src[0]];
+            IrType src1 = instr->src[1] != 0 ? func->vregTypes[instr->src[1]] : IR_I32;
+            if (isBinaryOp(instr->op) && (src0 != instr->type || src1 != instr->type))
+            {
+                verifyFail(func, block, "operand types of an arithmetic instruction differ");
+            }
+            if ((instr->op == IR_NEG || instr->op == IR_MOV) && src0 != instr->type)
+            {
+                verifyFail(func, block, "operand type differs from the result");
+            }
+            if (isIntOnlyOp(instr->op) && instr->type != IR_I32)
+            {
+                verifyFail(func, block, "integer instruction on a floating point type");
+            }
+            if ((instr->op == IR_NOT || instr->op == IR_LNOT || instr->op == IR_BOOL || instr->op == IR_SWITCH ||
+                 (instr->op == IR_BR && instr->cond == IR_BOOL)) &&
+                src0 != IR_I32)
+            {
+                verifyFail(func, block, "integer operand expected");
+            }
+            if (irIsComparison(instr->op) && (src0 != src1 || instr->type != IR_I32))
+            {
+                verifyFail(func, block, "comparison of mismatched types");
+            }
+            if (instr->op == IR_BR && instr->cond != IR_BOOL && (!irIsComparison(instr->cond) || src0 != src1))
+            {
+                verifyFail(func, block, "branch on a malformed comparison");
+            }
+            if (instr->op == IR_LOAD && instr->type != irValueType(instr->memType))
+            {
+                verifyFail(func, block, "load width does not match its result");
+            }
+            if (instr->op == IR_STORE && src0 != irValueType(instr->memType))
+            {
+                verifyFail(func, block, "store width does not match its value");
+            }
+            if ((instr->op == IR_LOAD || instr->op == IR_STORE) && instr->var == NULL && func->vregTypes[instr->src[instr->op == IR_LOAD ? 0 : 1]] != IR_I32)
+            {
+                verifyFail(func, block, "memory access through a non integer address");
+            }
+            if (instr->op == IR_PHI && j != 0 && block->instrs[j - 1]->op != IR_PHI)
+            {
+                verifyFail(func, block, "phi after the start of its block");
+            }
+            if (instr->op == IR_PHI && !phiMatchesPreds(func, block, instr))
+            {
+                verifyFail(func, block, "phi arguments do not match the predecessors");
+            }
+            if (instr->op == IR_ADDR && instr->var == NULL)
+            {
+                verifyFail(func, block, "address of nothing");
+            }
+            if (instr->op == IR_RET && instr->src[0] != 0 && src0 != func->retType)
+            {
+                verifyFail(func, block, "returned value does not match the function type");
+            }
+            for (size_t k = 0; k < irTargetCount(instr); k++)
+            {
+                if (!placedBlock(irTarget(instr, k)))
+                {
+                    verifyFail(func, block, "jump to a block outside the function");
+                }
+            }
+            if (instr->op == IR_SWITCH && irHasDuplicateCase(instr))
+            {
+                verifyFail(func, block, "duplicate switch case");
+            }
+        }
+    }
+    verifyEdges(func);
+    free(defined);
+}
+
+/* Printer */
+
+static void printVar(SymbolEntry *var)
+{
+    if (var->isGlobal)
+    {
+        emit("@%s", var->ident);
+    }
+    else
+    {
+        emit("%s.%zu", var->ident, var->stackOffset);
+    }
+}
+
+// right operand of a binary operation or comparison, a register or an immediate
+static void printOperand(IrInstr *instr)
+{
+    if (instr->src[1] != 0)
+    {
+        emit("v%zu", instr->src[1]);
+    }
+    else
+    {
+        emit("%i", instr->imm);
+    }
+}
+
+static void printAddress(IrInstr *instr, const size_t base)
+{
+    emit("[");
+    if (instr->var != NULL)
+    {
+        printVar(instr->var);
+    }
+    else
+    {
+        emit("v%zu", base);
+    }
+    if (instr->imm != 0)
+    {
+        emit("%s%i", instr->imm > 0 ? "+" : "", instr->imm);
+    }
+    emit("]");
+}
+
+static void printInstr(IrFunc *func, IrInstr *instr)
+{
+    emit("    ");
+    if (instr->dest != 0)
+    {
+        emit("v%zu = ", instr->dest);
+    }
+    emit("%s", irOpStr(instr->op));
+
+    switch (instr->op)
+    {
+    case IR_LI:
+        emit(".%s %i", irTypeStr(instr->type), instr->imm);
+        break;
+    case IR_LF:
+        emit(".%s %f", irTypeStr(instr->type), instr->fimm);
+        break;
+    case IR_LSTR:
+        emit(" \"%s\"", instr->str);
+        break;
+    case IR_ADDR:
+        emit(" ");
+        printVar(instr->var);
+        break;
+    case IR_PARAM:
+        emit(".%s %i", irTypeStr(instr->type), instr->imm);
+        break;
+    case IR_CVT:
+        emit(".%s.%s v%zu", irTypeStr(instr->type), irTypeStr(func->vregTypes[instr->src[0]]), instr->src[0]);
+        break;
+    case IR_LOAD:
+        emit(".%s ", irTypeStr(instr->memType));
+        printAddress(instr, instr->src[0]);
+        break;
+    case IR_STORE:
+        emit(".%s v%zu, ", irTypeStr(instr->memType), instr->src[0]);
+        printAddress(instr, instr->src[1]);
+        break;
+    case IR_CALL:
+        if (instr->type != IR_VOID)
+        {
+            emit(".%s", irTypeStr(instr->type));
+        }
+        emit(" %s(", instr->str);
+        for (size_t i = 0; i < instr->argsSize; i++)
+        {
+            emit("%sv%zu", i == 0 ? "" : ", ", instr->args[i]);
+        }
+        emit(")");
+        break;
+    case IR_PHI:
+        emit(".%s", irTypeStr(instr->type));
+        for (size_t i = 0; i < instr->argsSize; i++)
+        {
+            emit("%s [v%zu, .B%zu]", i == 0 ? "" : ",", instr->args[i], instr->phiPreds[i]->id);
+        }
+        break;
+    case IR_JMP:
+        emit(" .B%zu", instr->targets[0]->id);
+        break;
+    case IR_BR:
+        if (instr->cond != IR_BOOL)
+        {
+            emit(".%s.%s v%zu, ", irOpStr(instr->cond), irTypeStr(func->vregTypes[instr->src[0]]), instr->src[0]);
+            printOperand(instr);
+            emit(",");
+        }
+        else
+        {
+            emit(" v%zu,", instr->src[0]);
+        }
+        emit(" .B%zu, .B%zu", instr->targets[0]->id, instr->targets[1]->id);
+        break;
+    case IR_SWITCH:
+        emit(" v%zu, .B%zu [", instr->src[0], instr->targets[0]->id);
+        for (size_t i = 0; i < instr->casesSize; i++)
+        {
+            emit("%s%i: .B%zu", i == 0 ? "" : ", ", instr->cases[i].value, instr->cases[i].target->id);
+        }
+        emit("]");
+        break;
+    case IR_RET:
+        if (instr->src[0] != 0)
+        {
+            emit(" v%zu", instr->src[0]);
+        }
+        break;
+    default:
+        // arithmetic and comparisons are suffixed with their operand type
+        emit(".%s v%zu", irTypeStr(func->vregTypes[instr->src[0]]), instr->src[0]);
+        if (isBinaryOp(instr->op) || irIsComparison(instr->op))
+        {
+            emit(", ");
+            printOperand(instr);
+        }
+        break;
+    }
+    emit("\n");
+}
+
+// Writes a textual listing of a function to the output
+void irPrintFunc(IrFunc *func)
+{
+    emit("function %s -> %s\n", func->ident, irTypeStr(func->retType));
+    for (size_t i = 0; i < func->size; i++)
+    {
+        IrBlock *block = func->blocks[i];
+        emit(".B%zu:", block->id);
+        if (block->predsSize != 0)
+        {
+            emit(" ; preds");
+            for (size_t j = 0; j < block->predsSize; j++)
+            {
+                emit(" .B%zu", block->preds[j]->id);
+            }
+        }
+        emit("\n");
+        for (size_t j = 0; j < block->size; j++)
+        {
+            printInstr(func, block->instrs[j]);
+        }
+    }
+    emit("\n");
+}
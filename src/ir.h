@@ -0,0 +1,229 @@
+#ifndef IR_H
+#define IR_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "arena.h"
+#include "symbol.h"
+
+#define IR_ARENA_BLOCK_SIZE (16 * 1024)
+
+// I8 and I16 only appear as the width of a memory access, values are I32
+typedef enum IrType
+{
+    IR_VOID,
+    IR_I8,
+    IR_I16,
+    IR_I32,
+    IR_F32,
+    IR_F64
+} IrType;
+
+typedef enum IrOp
+{
+    IR_LI,    // dest = imm
+    IR_LF,    // dest = fimm
+    IR_LSTR,  // dest = address of the string literal str
+    IR_ADDR,  // dest = address of var
+    IR_MOV,   // dest = src0
+    IR_PARAM, // dest = incoming argument imm of its register class
+    IR_CVT,   // dest = src0 converted to the type of dest
+    IR_PHI,   // dest = args[i] when control arrives from preds[i], phis start their block
+
+    // arithmetic on I32, F32 or F64 depending on the type of dest
+    IR_ADD,
+    IR_SUB,
+    IR_MUL,
+    IR_DIV,
+    IR_NEG,
+
+    // I32 only
+    IR_DIVU,
+    IR_MULH,  // high word of the signed product
+    IR_MULHU, // high word of the unsigned product
+    IR_REM,
+    IR_REMU,
+    IR_AND,
+    IR_OR,
+    IR_XOR,
+    IR_SHL,
+    IR_SHR, // logical
+    IR_SAR, // arithmetic
+    IR_NOT,
+    IR_LNOT, // dest = src0 == 0
+    IR_BOOL, // dest = src0 != 0
+
+    // comparisons, dest is an I32 0 or 1, operands are of any one type
+    // a binary operation or comparison on I32 whose src1 is 0 takes imm as its right operand,
+    // only irSelectImmediates produces that form
+    IR_EQ,
+    IR_NE,
+    IR_LT,
+    IR_LE,
+    IR_GT,
+    IR_GE,
+    IR_LTU,
+    IR_LEU,
+    IR_GTU,
+    IR_GEU,
+
+    // memory, the address is var + imm when var is set, otherwise base + imm
+    // LOAD: dest = [src0 + imm], STORE: [src1 + imm] = src0
+    IR_LOAD,
+    IR_STORE,
+
+    IR_CALL, // dest = str(args), dest is 0 for void calls
+
+    // terminators, exactly one ends every block
+    IR_JMP,    // goto targets[0]
+    IR_BR,     // if cond holds goto targets[0] else targets[1]
+    IR_SWITCH, // goto the case matching src0, otherwise targets[0]
+    IR_RET     // return src0, which is 0 for void returns
+} IrOp;
+
+typedef struct IrBlock IrBlock;
+
+typedef struct IrCase
+{
+    int32_t value;
+    IrBlock *target;
+} IrCase;
+
+// Three-address instruction over virtual registers, register 0 means none
+typedef struct IrInstr
+{
+    IrOp op;
+    IrType type; // type of dest
+    size_t dest;
+    size_t src[2];
+    int32_t imm;
+    double fimm;
+    IrType memType;   // LOAD and STORE access width
+    SymbolEntry *var; // ADDR, and LOAD or STORE of a named variable
+    char *str;        // LSTR contents, CALL callee
+
+    size_t *args; // CALL, PHI
+    size_t argsSize;
+    size_t argsCapacity;
+    IrBlock **phiPreds; // PHI: the predecessor each argument comes in from, in the order of preds
+    size_t phiPredsCapacity;
+
+    IrCase *cases; // SWITCH
+    size_t casesSize;
+    size_t casesCapacity;
+
+    IrBlock *targets[2];
+    IrOp cond; // BR: IR_BOOL tests src0, a comparison fused in by irFuseBranches compares src0 with src1 or imm
+} IrInstr;
+
+typedef struct IrBlock
+{
+    size_t id;
+    bool placed; // part of the layout yet
+
+    IrInstr **instrs;
+    size_t size;
+    size_t capacity;
+
+    // CFG edges, rebuilt from the terminators by irComputeCfg
+    IrBlock **preds;
+    size_t predsSize;
+    size_t predsCapacity;
+    IrBlock **succs;
+    size_t succsSize;
+    size_t succsCapacity;
+    size_t *succSlots; // position of the block among the preds of every successor
+    size_t succSlotsCapacity;
+
+    // dominator tree, set by irComputeDominators, the entry has no immediate dominator
+    IrBlock *idom;
+    size_t order;    // reverse postorder position
+    size_t domFirst; // preorder number in the tree, the blocks dominated are numbered up to domLast
+    size_t domLast;
+} IrBlock;
+
+typedef struct IrFunc
+{
+    char *ident;
+    SymbolEntry *symbolEntry;
+    IrType retType;
+    size_t frameSize; // bytes of the locals, inlined locals add theirs
+
+    // blocks in layout order, the first one is the entry
+    IrBlock **blocks;
+    size_t size;
+    size_t capacity;
+    size_t blockIds;
+
+    // type of every virtual register, index 0 is unused
+    IrType *vregTypes;
+    size_t vregCount;
+    size_t vregCapacity;
+
+    Arena *arena; // every block and instruction of the function
+} IrFunc;
+
+// Registers live into and out of every block, only registers that are read in some block
+// before being written in it are tracked, the sets are indexed by block id. A phi reads its
+// arguments at the end of their predecessors, like their terminators, not in its own block.
+typedef struct IrLiveness
+{
+    size_t *index; // set position of every register, SIZE_MAX when it is not tracked
+    size_t *vregs; // register at every set position
+    size_t size;
+    size_t words; // 64 bit words per set
+    uint64_t *liveIn;
+    uint64_t *liveOut;
+} IrLiveness;
+
+void *irArrayGrow(IrFunc *func, void *array, size_t *capacity, size_t size, size_t elementSize);
+
+IrFunc *irFuncCreate(char *ident, SymbolEntry *symbolEntry, IrType retType);
+void irFuncDestroy(IrFunc *func);
+
+IrBlock *irBlockCreate(IrFunc *func);
+void irBlockPlace(IrFunc *func, IrBlock *block);
+size_t irVregCreate(IrFunc *func, IrType type);
+
+IrInstr *irInstrCreate(IrFunc *func, IrOp op);
+void irInstrPush(IrFunc *func, IrBlock *block, IrInstr *instr);
+void irInstrInsert(IrFunc *func, IrBlock *block, size_t index, IrInstr *instr);
+void irArgPush(IrFunc *func, IrInstr *call, size_t arg);
+void irCasePush(IrFunc *func, IrInstr *instr, int32_t value, IrBlock *target);
+void irPhiPush(IrFunc *func, IrInstr *phi, size_t arg, IrBlock *pred);
+
+bool irIsTerminator(IrOp op);
+bool irIsComparison(IrOp op);
+bool irDefinesValue(const IrInstr *instr);
+size_t irSrcCount(const IrInstr *instr);
+size_t irUseCount(const IrInstr *instr);
+size_t irUse(const IrInstr *instr, size_t i);
+IrInstr *irTerminator(IrBlock *block);
+size_t irTargetCount(const IrInstr *term);
+IrBlock *irTarget(const IrInstr *term, size_t i);
+bool irHasDuplicateCase(const IrInstr *instr);
+
+void irComputeCfg(IrFunc *func);
+void irRemoveUnreachable(IrFunc *func);
+void irComputeDominators(IrFunc *func);
+bool irDominates(const IrBlock *dominator, const IrBlock *block);
+IrBlock *irCommonDominator(IrBlock *a, IrBlock *b);
+
+IrLiveness *irLivenessCreate(IrFunc *func);
+void irLivenessDestroy(IrLiveness *live);
+bool irLiveIn(const IrLiveness *live, const IrBlock *block, size_t vreg);
+bool irLiveOut(const IrLiveness *live, const IrBlock *block, size_t vreg);
+
+void irVerify(IrFunc *func);
+void irPrintFunc(IrFunc *func);
+
+IrType irTypeOf(DataType type);
+IrType irMemTypeOf(DataType type);
+IrType irValueType(IrType memType);
+bool irIsFloatType(IrType type);
+const char *irTypeStr(IrType type);
+const char *irOpStr(IrOp op);
+
+#endif
@@ -0,0 +1,1134 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ast.h"
+#include "ir.h"
+#include "irgen.h"
+#include "symbol.h"
+
+// arguments past these are passed on the stack, which is not supported
+#define MAX_INT_ARG_REGS 8
+#define MAX_FLOAT_ARG_REGS 8
+
+// a switch being lowered, its cases are added as the case labels are reached
+typedef struct SwitchContext
+{
+    IrInstr *dispatch;
+    bool hasDefault;
+} SwitchContext;
+
+typedef struct Label
+{
+    char *ident;
+    IrBlock *block;
+    bool defined;
+} Label;
+
+typedef struct Builder
+{
+    IrFunc *func;
+    IrBlock *block; // block new instructions are appended to
+
+    IrBlock **breakTargets;
+    size_t breakSize;
+    size_t breakCapacity;
+
+    IrBlock **continueTargets;
+    size_t continueSize;
+    size_t continueCapacity;
+
+    SwitchContext *switches;
+    size_t switchSize;
+    size_t switchCapacity;
+
+    Label *labels;
+    size_t labelSize;
+    size_t labelCapacity;
+} Builder;
+
+// memory location of an assignable expression
+typedef struct Lvalue
+{
+    SymbolEntry *var; // NULL when the location is addressed through addr
+    size_t addr;
+    int32_t offset;
+    DataType type;
+} Lvalue;
+
+static void lowerStmt(Builder *b, Stmt *stmt);
+static size_t lowerExpr(Builder *b, Expr *expr);
+
+static void lowerError(const char *message, const char *ident)
+{
+    if (ident == NULL)
+    {
+        fprintf(stderr, "%s, exiting...\n", message);
+    }
+    else
+    {
+        fprintf(stderr, "%s: %s, exiting...\n", message, ident);
+    }
+    exit(EXIT_FAILURE);
+}
+
+/* Instruction helpers */
+
+// Returns the block to append to, code following a jump gets a block of its own
+// which irRemoveUnreachable drops again
+static IrBlock *currentBlock(Builder *b)
+{
+    if (irTerminator(b->block) != NULL)
+    {
+        b->block = irBlockCreate(b->func);
+        irBlockPlace(b->func, b->block);
+    }
+    return b->block;
+}
+
+static IrInstr *append(Builder *b, const IrOp op, const IrType type)
+{
+    IrInstr *instr = irInstrCreate(b->func, op);
+    instr->type = type;
+    if (type != IR_VOID)
+    {
+        instr->dest = irVregCreate(b->func, type);
+    }
+    irInstrPush(b->func, currentBlock(b), instr);
+    return instr;
+}
+
+static IrType valueType(Builder *b, const size_t value)
+{
+    return b->func->vregTypes[value];
+}
+
+static bool isFloat(const IrType type)
+{
+    return type == IR_F32 || type == IR_F64;
+}
+
+static size_t emitInt(Builder *b, const int32_t value)
+{
+    IrInstr *instr = append(b, IR_LI, IR_I32);
+    instr->imm = value;
+    return instr->dest;
+}
+
+static size_t emitFloat(Builder *b, const IrType type, const double value)
+{
+    IrInstr *instr = append(b, IR_LF, type);
+    instr->fimm = value;
+    return instr->dest;
+}
+
+static size_t emitUnary(Builder *b, const IrOp op, const IrType type, const size_t src)
+{
+    IrInstr *instr = append(b, op, type);
+    instr->src[0] = src;
+    return instr->dest;
+}
+
+static size_t emitBinary(Builder *b, const IrOp op, const IrType type, const size_t src0, const size_t src1)
+{
+    IrInstr *instr = append(b, op, type);
+    instr->src[0] = src0;
+    instr->src[1] = src1;
+    return instr->dest;
+}
+
+static void emitMov(Builder *b, const size_t dest, const size_t src)
+{
+    IrInstr *instr = irInstrCreate(b->func, IR_MOV);
+    instr->type = valueType(b, dest);
+    instr->dest = dest;
+    instr->src[0] = src;
+    irInstrPush(b->func, currentBlock(b), instr);
+}
+
+// Jumps are dropped when the block already ended, the code is unreachable
+static void jumpTo(Builder *b, IrBlock *target)
+{
+    if (irTerminator(b->block) != NULL)
+    {
+        return;
+    }
+    IrInstr *instr = irInstrCreate(b->func, IR_JMP);
+    instr->targets[0] = target;
+    irInstrPush(b->func, b->block, instr);
+}
+
+static void branchTo(Builder *b, const size_t condition, IrBlock *ifTrue, IrBlock *ifFalse)
+{
+    IrInstr *instr = irInstrCreate(b->func, IR_BR);
+    instr->src[0] = condition;
+    instr->targets[0] = ifTrue;
+    instr->targets[1] = ifFalse;
+    irInstrPush(b->func, currentBlock(b), instr);
+}
+
+// Places a block after the current one, falling through into it
+static void startBlock(Builder *b, IrBlock *block)
+{
+    jumpTo(b, block);
+    irBlockPlace(b->func, block);
+    b->block = block;
+}
+
+static void blockPush(Builder *b, IrBlock ***stack, size_t *size, size_t *capacity, IrBlock *block)
+{
+    *stack = irArrayGrow(b->func, *stack, capacity, *size + 1, sizeof(IrBlock *));
+    (*stack)[(*size)++] = block;
+}
+
+/* Types */
+
+static bool isUnsigned(const DataType type)
+{
+    return type == UNSIGNED_INT_TYPE || type == UNSIGNED_LONG_TYPE || isPtr(type);
+}
+
+// usual arithmetic conversions
+static IrType promote(const IrType a, const IrType b)
+{
+    if (a == IR_F64 || b == IR_F64)
+    {
+        return IR_F64;
+    }
+    if (a == IR_F32 || b == IR_F32)
+    {
+        return IR_F32;
+    }
+    return IR_I32;
+}
+
+static size_t convert(Builder *b, const size_t value, const IrType type)
+{
+    if (type == IR_VOID || valueType(b, value) == type)
+    {
+        return value;
+    }
+    return emitUnary(b, IR_CVT, type, value);
+}
+
+static size_t intOperand(Builder *b, const size_t value)
+{
+    if (isFloat(valueType(b, value)))
+    {
+        lowerError("Operation cannot be done on floating-point types", NULL);
+    }
+    return value;
+}
+
+// dest = value != 0 for values of any type
+static size_t toBool(Builder *b, const size_t value)
+{
+    IrType type = valueType(b, value);
+    if (isFloat(type))
+    {
+        return emitBinary(b, IR_NE, IR_I32, value, emitFloat(b, type, 0.0));
+    }
+    return emitUnary(b, IR_BOOL, IR_I32, value);
+}
+
+static int32_t pointeeSize(const DataType type)
+{
+    return typeSize(removerPtrFromType(type));
+}
+
+static size_t scale(Builder *b, const size_t value, const int32_t size)
+{
+    if (size == 1)
+    {
+        return value;
+    }
+    return emitBinary(b, IR_MUL, IR_I32, intOperand(b, value), emitInt(b, size));
+}
+
+/* Memory */
+
+static SymbolEntry *requireSymbol(SymbolEntry *entry, char *ident)
+{
+    if (entry == NULL)
+    {
+        lowerError("Undeclared identifier", ident);
+    }
+    return entry;
+}
+
+static size_t loadFrom(Builder *b, Lvalue *lvalue)
+{
+    IrType memType = irMemTypeOf(lvalue->type);
+    IrInstr *instr = append(b, IR_LOAD, irValueType(memType));
+    instr->memType = memType;
+    instr->var = lvalue->var;
+    instr->src[0] = lvalue->addr;
+    instr->imm = lvalue->offset;
+    return instr->dest;
+}
+
+// Returns the stored value, converted to the type of the location
+static size_t storeTo(Builder *b, Lvalue *lvalue, size_t value)
+{
+    IrType memType = irMemTypeOf(lvalue->type);
+    value = convert(b, value, irValueType(memType));
+    IrInstr *instr = append(b, IR_STORE, IR_VOID);
+    instr->memType = memType;
+    instr->var = lvalue->var;
+    instr->src[0] = value;
+    instr->src[1] = lvalue->addr;
+    instr->imm = lvalue->offset;
+    return value;
+}
+
+static Lvalue variableLvalue(SymbolEntry *entry)
+{
+    if (entry->entryType == ARRAY_ENTRY)
+    {
+        lowerError("Array is not assignable", entry->ident);
+    }
+    Lvalue lvalue = {entry, 0, 0, entry->type.dataType};
+    return lvalue;
+}
+
+// Location pointed to by an address expression
+static Lvalue pointerLvalue(Builder *b, Expr *addr)
+{
+    DataType type = returnType(addr);
+    if (!isPtr(type))
+    {
+        lowerError("Expression is not assignable", NULL);
+    }
+    Lvalue lvalue = {NULL, 0, 0, removerPtrFromType(type)};
+    lvalue.addr = intOperand(b, lowerExpr(b, addr));
+    return lvalue;
+}
+
+static Lvalue lowerLvalue(Builder *b, Expr *expr)
+{
+    if (expr->type == VARIABLE_EXPR)
+    {
+        return variableLvalue(requireSymbol(expr->variable->symbolEntry, expr->variable->ident));
+    }
+    if (expr->type == OPERATION_EXPR && expr->operation->operator == DEREF)
+    {
+        return pointerLvalue(b, expr->operation->op1);
+    }
+    lowerError("Expression is not assignable", NULL);
+    return (Lvalue){0};
+}
+
+/* Expressions */
+
+// Like lowerExpr but the expression must produce a value
+static size_t lowerValue(Builder *b, Expr *expr)
+{
+    size_t value = lowerExpr(b, expr);
+    if (value == 0)
+    {
+        lowerError("Void value used in an expression", NULL);
+    }
+    return value;
+}
+
+// Lowers a condition to an I32 that is non zero when it holds
+static size_t lowerCond(Builder *b, Expr *expr)
+{
+    size_t value = lowerValue(b, expr);
+    if (isFloat(valueType(b, value)))
+    {
+        return toBool(b, value);
+    }
+    return value;
+}
+
+static size_t lowerConstant(Builder *b, ConstantExpr *constant)
+{
+    if (constant->isString)
+    {
+        IrInstr *instr = append(b, IR_LSTR, IR_I32);
+        instr->str = constant->string_const;
+        return instr->dest;
+    }
+    switch (constant->type)
+    {
+    case INT_TYPE:
+        return emitInt(b, constant->int_const);
+    case CHAR_TYPE:
+        return emitInt(b, (unsigned char)constant->char_const);
+    case FLOAT_TYPE:
+        return emitFloat(b, IR_F32, constant->float_const);
+    default:
+        lowerError("Non-long types not supported", NULL);
+        return 0;
+    }
+}
+
+static size_t lowerVariable(Builder *b, VariableExpr *variable)
+{
+    SymbolEntry *entry = requireSymbol(variable->symbolEntry, variable->ident);
+    if (entry->entryType == ARRAY_ENTRY)
+    {
+        // arrays decay to the address of their first element
+        IrInstr *instr = append(b, IR_ADDR, IR_I32);
+        instr->var = entry;
+        return instr->dest;
+    }
+    Lvalue lvalue = variableLvalue(entry);
+    return loadFrom(b, &lvalue);
+}
+
+// Lowers a binary operator on two values, lhsType and rhsType are the C types of the operands
+static size_t lowerArith(Builder *b, const Operator operator, size_t lhs, const DataType lhsType, size_t rhs, const DataType rhsType)
+{
+    // pointer arithmetic is scaled by the size of the pointed to type
+    if (operator== ADD && isPtr(lhsType) != isPtr(rhsType))
+    {
+        if (isPtr(lhsType))
+        {
+            return emitBinary(b, IR_ADD, IR_I32, intOperand(b, lhs), scale(b, rhs, pointeeSize(lhsType)));
+        }
+        return emitBinary(b, IR_ADD, IR_I32, scale(b, lhs, pointeeSize(rhsType)), intOperand(b, rhs));
+    }
+    if (operator== SUB && isPtr(lhsType))
+    {
+        if (isPtr(rhsType))
+        {
+            size_t difference = emitBinary(b, IR_SUB, IR_I32, lhs, rhs);
+            int32_t size = pointeeSize(lhsType);
+            return size == 1 ? difference : emitBinary(b, IR_DIV, IR_I32, difference, emitInt(b, size));
+        }
+        return emitBinary(b, IR_SUB, IR_I32, lhs, scale(b, rhs, pointeeSize(lhsType)));
+    }
+
+    bool isUnsignedOp = isUnsigned(lhsType) || isUnsigned(rhsType);
+    switch (operator)
+    {
+    case MOD:
+        return emitBinary(b, isUnsignedOp ? IR_REMU : IR_REM, IR_I32, intOperand(b, lhs), intOperand(b, rhs));
+    case AND_BIT:
+        return emitBinary(b, IR_AND, IR_I32, intOperand(b, lhs), intOperand(b, rhs));
+    case OR_BIT:
+        return emitBinary(b, IR_OR, IR_I32, intOperand(b, lhs), intOperand(b, rhs));
+    case XOR:
+        return emitBinary(b, IR_XOR, IR_I32, intOperand(b, lhs), intOperand(b, rhs));
+    case LEFT_SHIFT:
+        return emitBinary(b, IR_SHL, IR_I32, intOperand(b, lhs), intOperand(b, rhs));
+    case RIGHT_SHIFT:
+        return emitBinary(b, isUnsigned(lhsType) ? IR_SHR : IR_SAR, IR_I32, intOperand(b, lhs), intOperand(b, rhs));
+    default:
+        break;
+    }
+
+    IrType type = promote(valueType(b, lhs), valueType(b, rhs));
+    lhs = convert(b, lhs, type);
+    rhs = convert(b, rhs, type);
+    isUnsignedOp = isUnsignedOp && !isFloat(type);
+    switch (operator)
+    {
+    case ADD:
+        return emitBinary(b, IR_ADD, type, lhs, rhs);
+    case SUB:
+        return emitBinary(b, IR_SUB, type, lhs, rhs);
+    case MUL:
+        return emitBinary(b, IR_MUL, type, lhs, rhs);
+    case DIV:
+        return emitBinary(b, isUnsignedOp ? IR_DIVU : IR_DIV, type, lhs, rhs);
+    case EQ:
+        return emitBinary(b, IR_EQ, IR_I32, lhs, rhs);
+    case NE:
+        return emitBinary(b, IR_NE, IR_I32, lhs, rhs);
+    case LT:
+        return emitBinary(b, isUnsignedOp ? IR_LTU : IR_LT, IR_I32, lhs, rhs);
+    case LE:
+        return emitBinary(b, isUnsignedOp ? IR_LEU : IR_LE, IR_I32, lhs, rhs);
+    case GT:
+        return emitBinary(b, isUnsignedOp ? IR_GTU : IR_GT, IR_I32, lhs, rhs);
+    case GE:
+        return emitBinary(b, isUnsignedOp ? IR_GEU : IR_GE, IR_I32, lhs, rhs);
+    default:
+        lowerError("Operation not supported", NULL);
+        return 0;
+    }
+}
+
+// ++ and --, the prefix forms yield the new value and the postfix forms the old one
+static size_t lowerIncDec(Builder *b, OperationExpr *operation)
+{
+    Lvalue target = lowerLvalue(b, operation->op1);
+    size_t old = loadFrom(b, &target);
+    IrType type = valueType(b, old);
+    size_t step;
+    if (isPtr(target.type))
+    {
+        step = emitInt(b, pointeeSize(target.type));
+    }
+    else if (isFloat(type))
+    {
+        step = emitFloat(b, type, 1.0);
+    }
+    else
+    {
+        step = emitInt(b, 1);
+    }
+    bool increment = operation->operator== INC || operation->operator== INC_POST;
+    size_t updated = emitBinary(b, increment ? IR_ADD : IR_SUB, type, old, step);
+    updated = storeTo(b, &target, updated);
+    if (operation->operator== INC_POST || operation->operator== DEC_POST)
+    {
+        return old;
+    }
+    return updated;
+}
+
+static size_t lowerSizeof(Builder *b, Expr *operand)
+{
+    size_t size;
+    if (operand->type == CONSTANT_EXPR)
+    {
+        size = typeSize(operand->constant->type);
+    }
+    else if (operand->type == VARIABLE_EXPR)
+    {
+        SymbolEntry *entry = requireSymbol(operand->variable->symbolEntry, operand->variable->ident);
+        if (entry->entryType == ARRAY_ENTRY) // TODO: Do the same for structs
+        {
+            size = entry->storageSize;
+        }
+        else
+        {
+            size = entry->typeSize;
+        }
+    }
+    else
+    {
+        size = typeSize(returnType(operand));
+    }
+    return emitInt(b, size);
+}
+
+// Branches on a condition. && and || only evaluate their right operand when the left one
+// does not decide the outcome, and ! swaps the targets, so nested logic becomes jumps
+// without ever materializing the 0 or 1 of the inner operators.
+static void lowerBranch(Builder *b, Expr *expr, IrBlock *ifTrue, IrBlock *ifFalse)
+{
+    OperationExpr *operation = expr->type == OPERATION_EXPR ? expr->operation : NULL;
+    if (operation != NULL && (operation->operator== AND || operation->operator== OR))
+    {
+        IrBlock *right = irBlockCreate(b->func);
+        if (operation->operator== AND)
+        {
+            lowerBranch(b, operation->op1, right, ifFalse);
+        }
+        else
+        {
+            lowerBranch(b, operation->op1, ifTrue, right);
+        }
+        startBlock(b, right);
+        lowerBranch(b, operation->op2, ifTrue, ifFalse);
+        return;
+    }
+    if (operation != NULL && operation->operator== NOT)
+    {
+        lowerBranch(b, operation->op1, ifFalse, ifTrue);
+        return;
+    }
+    branchTo(b, lowerCond(b, expr), ifTrue, ifFalse);
+}
+
+// && and || used as values are 1 on the true path and 0 on the false one
+static size_t lowerLogical(Builder *b, OperationExpr *operation)
+{
+    size_t result = irVregCreate(b->func, IR_I32);
+    IrBlock *ifTrue = irBlockCreate(b->func);
+    IrBlock *ifFalse = irBlockCreate(b->func);
+    IrBlock *end = irBlockCreate(b->func);
+
+    Expr expr = {OPERATION_EXPR, {.operation = operation}};
+    lowerBranch(b, &expr, ifTrue, ifFalse);
+    startBlock(b, ifTrue);
+    emitMov(b, result, emitInt(b, 1));
+    jumpTo(b, end);
+    startBlock(b, ifFalse);
+    emitMov(b, result, emitInt(b, 0));
+    startBlock(b, end);
+    return result;
+}
+
+static size_t lowerTernary(Builder *b, OperationExpr *operation)
+{
+    IrType type = irTypeOf(operation->type);
+    size_t result = type == IR_VOID ? 0 : irVregCreate(b->func, type);
+    IrBlock *ifTrue = irBlockCreate(b->func);
+    IrBlock *ifFalse = irBlockCreate(b->func);
+    IrBlock *end = irBlockCreate(b->func);
+
+    lowerBranch(b, operation->op1, ifTrue, ifFalse);
+    Expr *arms[2] = {operation->op2, operation->op3};
+    IrBlock *blocks[2] = {ifTrue, ifFalse};
+    for (size_t i = 0; i < 2; i++)
+    {
+        startBlock(b, blocks[i]);
+        if (result != 0)
+        {
+            emitMov(b, result, convert(b, lowerValue(b, arms[i]), type));
+        }
+        else
+        {
+            lowerExpr(b, arms[i]);
+        }
+        jumpTo(b, end);
+    }
+    startBlock(b, end);
+    return result;
+}
+
+static size_t lowerOperation(Builder *b, OperationExpr *operation)
+{
+    switch (operation->operator)
+    {
+    case ADD:
+    case SUB:
+    {
+        if (operation->op2 == NULL) // unary plus and minus
+        {
+            size_t value = lowerValue(b, operation->op1);
+            if (operation->operator== ADD)
+            {
+                return value;
+            }
+            return emitUnary(b, IR_NEG, valueType(b, value), value);
+        }
+        size_t lhs = lowerValue(b, operation->op1);
+        size_t rhs = lowerValue(b, operation->op2);
+        return lowerArith(b, operation->operator, lhs, returnType(operation->op1), rhs, returnType(operation->op2));
+    }
+    case AND:
+    case OR:
+        return lowerLogical(b, operation);
+    case MUL:
+    case DIV:
+    case MOD:
+    case AND_BIT:
+    case OR_BIT:
+    case XOR:
+    case EQ:
+    case NE:
+    case LT:
+    case GT:
+    case LE:
+    case GE:
+    case LEFT_SHIFT:
+    case RIGHT_SHIFT:
+    {
+        size_t lhs = lowerValue(b, operation->op1);
+        size_t rhs = lowerValue(b, operation->op2);
+        return lowerArith(b, operation->operator, lhs, returnType(operation->op1), rhs, returnType(operation->op2));
+    }
+    case NOT:
+    {
+        size_t value = lowerValue(b, operation->op1);
+        IrType type = valueType(b, value);
+        if (isFloat(type))
+        {
+            return emitBinary(b, IR_EQ, IR_I32, value, emitFloat(b, type, 0.0));
+        }
+        return emitUnary(b, IR_LNOT, IR_I32, value);
+    }
+    case NOT_BIT:
+        return emitUnary(b, IR_NOT, IR_I32, intOperand(b, lowerValue(b, operation->op1)));
+    case INC:
+    case DEC:
+    case INC_POST:
+    case DEC_POST:
+        return lowerIncDec(b, operation);
+    case SIZEOF_OP:
+        return lowerSizeof(b, operation->op1);
+    case ADDRESS:
+    {
+        Expr *operand = operation->op1;
+        if (operand->type == VARIABLE_EXPR)
+        {
+            IrInstr *instr = append(b, IR_ADDR, IR_I32);
+            instr->var = requireSymbol(operand->variable->symbolEntry, operand->variable->ident);
+            return instr->dest;
+        }
+        if (operand->type == OPERATION_EXPR && operand->operation->operator== DEREF)
+        {
+            // &*p and &a[i] are just the address
+            return intOperand(b, lowerValue(b, operand->operation->op1));
+        }
+        lowerError("Cannot take the address of this expression", NULL);
+        return 0;
+    }
+    case DEREF:
+    {
+        Lvalue source = pointerLvalue(b, operation->op1);
+        return loadFrom(b, &source);
+    }
+    case COMMA_OP:
+        lowerExpr(b, operation->op1);
+        return lowerExpr(b, operation->op2);
+    case TERN:
+        return lowerTernary(b, operation);
+    default:
+        lowerError("Operation not supported", NULL);
+        return 0;
+    }
+}
+
+static size_t lowerAssign(Builder *b, AssignExpr *assign)
+{
+    Lvalue target;
+    if (assign->lvalue == NULL)
+    {
+        target = variableLvalue(requireSymbol(assign->symbolEntry, assign->ident));
+    }
+    else
+    {
+        target = pointerLvalue(b, assign->lvalue);
+    }
+
+    size_t value = lowerValue(b, assign->op);
+    if (assign->operator!= NOT) // compound assignment
+    {
+        size_t current = loadFrom(b, &target);
+        value = lowerArith(b, assign->operator, current, target.type, value, returnType(assign->op));
+    }
+    return storeTo(b, &target, value);
+}
+
+// Arguments are evaluated into registers before the call, so nested calls cannot clobber them
+static size_t lowerCall(Builder *b, FuncExpr *function)
+{
+    IrInstr *call = irInstrCreate(b->func, IR_CALL);
+    call->str = function->ident;
+    size_t intArgs = 0;
+    size_t floatArgs = 0;
+    for (size_t i = 0; i < function->argsSize; i++)
+    {
+        size_t arg = lowerValue(b, function->args[i]);
+        if (isFloat(valueType(b, arg)) ? ++floatArgs > MAX_FLOAT_ARG_REGS : ++intArgs > MAX_INT_ARG_REGS)
+        {
+            lowerError("Too many arguments in call to", function->ident);
+        }
+        irArgPush(b->func, call, arg);
+    }
+    // undeclared functions return int
+    DataType retType = function->symbolEntry != NULL ? function->symbolEntry->type.dataType : INT_TYPE;
+    call->type = irTypeOf(retType);
+    if (call->type != IR_VOID)
+    {
+        call->dest = irVregCreate(b->func, call->type);
+    }
+    irInstrPush(b->func, currentBlock(b), call);
+    return call->dest;
+}
+
+// Returns the value of an expression, 0 when it has none
+static size_t lowerExpr(Builder *b, Expr *expr)
+{
+    switch (expr->type)
+    {
+    case CONSTANT_EXPR:
+        return lowerConstant(b, expr->constant);
+    case VARIABLE_EXPR:
+        return lowerVariable(b, expr->variable);
+    case OPERATION_EXPR:
+        return lowerOperation(b, expr->operation);
+    case ASSIGN_EXPR:
+        return lowerAssign(b, expr->assignment);
+    case FUNC_EXPR:
+        return lowerCall(b, expr->function);
+    }
+    return 0;
+}
+
+/* Statements */
+
+static size_t zeroOf(Builder *b, const IrType type)
+{
+    return isFloat(type) ? emitFloat(b, type, 0.0) : emitInt(b, 0);
+}
+
+// Stores a flat initializer list to an array, the elements without an initializer are zeroed
+static void lowerArrayInit(Builder *b, SymbolEntry *entry, InitList *initList)
+{
+    DataType elementType = removerPtrFromType(entry->type.dataType);
+    size_t count = entry->storageSize / storageSize(elementType);
+    if (initList->size > count)
+    {
+        lowerError("Too many initializers for array", entry->ident);
+    }
+    Lvalue element = {entry, 0, 0, elementType};
+    for (size_t i = 0; i < count; i++)
+    {
+        size_t value;
+        if (i < initList->size)
+        {
+            if (initList->inits[i]->expr == NULL)
+            {
+                lowerError("Nested initializer lists are not supported", entry->ident);
+            }
+            value = lowerValue(b, initList->inits[i]->expr);
+        }
+        else
+        {
+            value = zeroOf(b, irValueType(irMemTypeOf(elementType)));
+        }
+        element.offset = i * typeSize(elementType);
+        storeTo(b, &element, value);
+    }
+}
+
+static void lowerDecl(Builder *b, Decl *decl)
+{
+    DeclInit *declInit = decl->declInit;
+    if (declInit == NULL || decl->symbolEntry == NULL)
+    {
+        return;
+    }
+    if (decl->symbolEntry->entryType == ARRAY_ENTRY)
+    {
+        if (declInit->initList != NULL)
+        {
+            lowerArrayInit(b, decl->symbolEntry, declInit->initList);
+        }
+        return;
+    }
+
+    Expr *initExpr = declInit->initExpr;
+    if (initExpr == NULL && declInit->initList != NULL && declInit->initList->size > 0)
+    {
+        initExpr = declInit->initList->inits[0]->expr; // int x = {1};
+    }
+    if (initExpr != NULL)
+    {
+        Lvalue target = variableLvalue(decl->symbolEntry);
+        storeTo(b, &target, lowerValue(b, initExpr));
+    }
+}
+
+static void lowerCompoundStmt(Builder *b, CompoundStmt *stmt)
+{
+    for (size_t i = 0; i < stmt->declList.size; i++)
+    {
+        lowerDecl(b, stmt->declList.decls[i]);
+    }
+    for (size_t i = 0; i < stmt->stmtList.size; i++)
+    {
+        lowerStmt(b, stmt->stmtList.stmts[i]);
+    }
+}
+
+static void lowerIfStmt(Builder *b, IfStmt *stmt)
+{
+    IrBlock *ifTrue = irBlockCreate(b->func);
+    IrBlock *end = irBlockCreate(b->func);
+    IrBlock *ifFalse = stmt->falseBody != NULL ? irBlockCreate(b->func) : end;
+
+    lowerBranch(b, stmt->condition, ifTrue, ifFalse);
+    startBlock(b, ifTrue);
+    lowerStmt(b, stmt->trueBody);
+    if (stmt->falseBody != NULL)
+    {
+        jumpTo(b, end);
+        startBlock(b, ifFalse);
+        lowerStmt(b, stmt->falseBody);
+    }
+    startBlock(b, end);
+}
+
+static void lowerLoopBody(Builder *b, Stmt *body, IrBlock *breakTarget, IrBlock *continueTarget)
+{
+    blockPush(b, &b->breakTargets, &b->breakSize, &b->breakCapacity, breakTarget);
+    blockPush(b, &b->continueTargets, &b->continueSize, &b->continueCapacity, continueTarget);
+    lowerStmt(b, body);
+    b->breakSize--;
+    b->continueSize--;
+}
+
+// Loops are lowered bottom-tested: a guard tests the condition once on entry and the latch at
+// the bottom tests it again to branch back, so an iteration takes one branch and no jump
+
+static void lowerWhileStmt(Builder *b, WhileStmt *stmt)
+{
+    IrBlock *body = irBlockCreate(b->func);
+    IrBlock *latch = irBlockCreate(b->func);
+    IrBlock *end = irBlockCreate(b->func);
+    if (!stmt->doWhile)
+    {
+        lowerBranch(b, stmt->condition, body, end);
+    }
+    startBlock(b, body);
+    lowerLoopBody(b, stmt->body, end, latch);
+    startBlock(b, latch);
+    lowerBranch(b, stmt->condition, body, end);
+    startBlock(b, end);
+}
+
+// guard: condition, body, latch: modifier then condition, continue jumps to the latch
+static void lowerForStmt(Builder *b, ForStmt *stmt)
+{
+    IrBlock *body = irBlockCreate(b->func);
+    IrBlock *latch = irBlockCreate(b->func);
+    IrBlock *end = irBlockCreate(b->func);
+    Expr *condition = stmt->condition != NULL ? stmt->condition->exprStmt->expr : NULL;
+
+    lowerStmt(b, stmt->init);
+    if (condition != NULL)
+    {
+        lowerBranch(b, condition, body, end);
+    }
+    startBlock(b, body);
+    lowerLoopBody(b, stmt->body, end, latch);
+    startBlock(b, latch);
+    if (stmt->modifier != NULL)
+    {
+        lowerExpr(b, stmt->modifier);
+    }
+    if (condition != NULL)
+    {
+        lowerBranch(b, condition, body, end);
+    }
+    else
+    {
+        jumpTo(b, body);
+    }
+    startBlock(b, end);
+}
+
+// Emits the dispatch before the body, case labels add themselves to it wherever they are nested
+static void lowerSwitchStmt(Builder *b, SwitchStmt *stmt)
+{
+    IrBlock *end = irBlockCreate(b->func);
+    size_t selector = intOperand(b, lowerValue(b, stmt->selector));
+    IrInstr *dispatch = append(b, IR_SWITCH, IR_VOID);
+    dispatch->src[0] = selector;
+    dispatch->targets[0] = end;
+
+    b->switches = irArrayGrow(b->func, b->switches, &b->switchCapacity, b->switchSize + 1, sizeof(SwitchContext));
+    b->switches[b->switchSize].dispatch = dispatch;
+    b->switches[b->switchSize].hasDefault = false;
+    b->switchSize++;
+    blockPush(b, &b->breakTargets, &b->breakSize, &b->breakCapacity, end);
+
+    lowerStmt(b, stmt->body);
+    if (irHasDuplicateCase(dispatch))
+    {
+        lowerError("Duplicate case value in switch statement", NULL);
+    }
+
+    b->breakSize--;
+    b->switchSize--;
+    startBlock(b, end);
+}
+
+static Label *findLabel(Builder *b, char *ident)
+{
+    for (size_t i = 0; i < b->labelSize; i++)
+    {
+        if (strcmp(b->labels[i].ident, ident) == 0)
+        {
+            return &b->labels[i];
+        }
+    }
+    b->labels = irArrayGrow(b->func, b->labels, &b->labelCapacity, b->labelSize + 1, sizeof(Label));
+    Label *label = &b->labels[b->labelSize++];
+    label->ident = ident;
+    label->block = irBlockCreate(b->func);
+    label->defined = false;
+    return label;
+}
+
+static void lowerLabelStmt(Builder *b, LabelStmt *stmt)
+{
+    if (stmt->ident != NULL) // goto label
+    {
+        Label *label = findLabel(b, stmt->ident);
+        if (label->defined)
+        {
+            lowerError("Duplicate label", stmt->ident);
+        }
+        label->defined = true;
+        startBlock(b, label->block);
+        lowerStmt(b, stmt->body);
+        return;
+    }
+
+    if (b->switchSize == 0)
+    {
+        lowerError("Case label not within a switch statement", NULL);
+    }
+    SwitchContext *context = &b->switches[b->switchSize - 1];
+    IrBlock *block = irBlockCreate(b->func);
+    startBlock(b, block);
+    if (stmt->caseLabel != NULL)
+    {
+        irCasePush(b->func, context->dispatch, evaluateIntConstExpr(stmt->caseLabel), block);
+    }
+    else
+    {
+        if (context->hasDefault)
+        {
+            lowerError("Multiple default labels in one switch", NULL);
+        }
+        context->dispatch->targets[0] = block;
+        context->hasDefault = true;
+    }
+    lowerStmt(b, stmt->body);
+}
+
+static void lowerJumpStmt(Builder *b, JumpStmt *stmt)
+{
+    switch (stmt->type)
+    {
+    case RETURN_JUMP:
+    {
+        size_t value = 0;
+        if (stmt->expr != NULL)
+        {
+            if (b->func->retType == IR_VOID)
+            {
+                lowerExpr(b, stmt->expr);
+            }
+            else
+            {
+                value = convert(b, lowerValue(b, stmt->expr), b->func->retType);
+            }
+        }
+        IrInstr *ret = append(b, IR_RET, IR_VOID);
+        ret->src[0] = value;
+        break;
+    }
+    case BREAK_JUMP:
+    {
+        if (b->breakSize == 0)
+        {
+            lowerError("Break statement not within a loop or switch", NULL);
+        }
+        jumpTo(b, b->breakTargets[b->breakSize - 1]);
+        break;
+    }
+    case CONTINUE_JUMP:
+    {
+        if (b->continueSize == 0)
+        {
+            lowerError("Continue statement not within a loop", NULL);
+        }
+        jumpTo(b, b->continueTargets[b->continueSize - 1]);
+        break;
+    }
+    case GOTO_JUMP:
+    {
+        jumpTo(b, findLabel(b, stmt->ident)->block);
+        break;
+    }
+    }
+}
+
+static void lowerStmt(Builder *b, Stmt *stmt)
+{
+    switch (stmt->type)
+    {
+    case EXPR_STMT:
+        if (stmt->exprStmt->expr != NULL)
+        {
+            lowerExpr(b, stmt->exprStmt->expr);
+        }
+        break;
+    case JUMP_STMT:
+        lowerJumpStmt(b, stmt->jumpStmt);
+        break;
+    case COMPOUND_STMT:
+        lowerCompoundStmt(b, stmt->compoundStmt);
+        break;
+    case IF_STMT:
+        lowerIfStmt(b, stmt->ifStmt);
+        break;
+    case WHILE_STMT:
+        lowerWhileStmt(b, stmt->whileStmt);
+        break;
+    case FOR_STMT:
+        lowerForStmt(b, stmt->forStmt);
+        break;
+    case SWITCH_STMT:
+        lowerSwitchStmt(b, stmt->switchStmt);
+        break;
+    case LABEL_STMT:
+        lowerLabelStmt(b, stmt->labelStmt);
+        break;
+    }
+}
+
+static bool isParamDecl(Decl *decl)
+{
+    return decl->declInit != NULL && decl->symbolEntry != NULL && decl->typeSpecList->typeSpecs[0]->dataType != VOID_TYPE;
+}
+
+// Copies the incoming arguments to their stack slots, all PARAMs come first so
+// nothing can clobber the argument registers before they are read
+static void lowerParams(Builder *b, DeclarationList *params)
+{
+    size_t intArgs = 0;
+    size_t floatArgs = 0;
+    size_t first = b->block->size;
+    for (size_t i = 0; i < params->size; i++)
+    {
+        if (!isParamDecl(params->decls[i]))
+        {
+            continue;
+        }
+        IrType type = irTypeOf(params->decls[i]->symbolEntry->type.dataType);
+        IrInstr *param = append(b, IR_PARAM, type);
+        param->imm = isFloat(type) ? floatArgs++ : intArgs++;
+        if (intArgs > MAX_INT_ARG_REGS || floatArgs > MAX_FLOAT_ARG_REGS)
+        {
+            lowerError("Too many parameters in function", b->func->ident);
+        }
+    }
+    for (size_t i = 0; i < params->size; i++)
+    {
+        if (!isParamDecl(params->decls[i]))
+        {
+            continue;
+        }
+        Lvalue slot = variableLvalue(params->decls[i]->symbolEntry);
+        storeTo(b, &slot, b->block->instrs[first++]->dest);
+    }
+}
+
+IrFunc *irLowerFunc(FuncDef *func)
+{
+    SymbolEntry *entry = func->symbolEntry;
+    Builder builder = {0};
+    Builder *b = &builder;
+    b->func = irFuncCreate(func->ident, entry, irTypeOf(entry->type.dataType));
+    b->block = irBlockCreate(b->func);
+    irBlockPlace(b->func, b->block);
+
+    if (func->isParam)
+    {
+        lowerParams(b, &func->args);
+    }
+    if (func->body != NULL)
+    {
+        lowerCompoundStmt(b, func->body->compoundStmt);
+    }
+    if (irTerminator(b->block) == NULL)
+    {
+        append(b, IR_RET, IR_VOID);
+    }
+
+    for (size_t i = 0; i < b->labelSize; i++)
+    {
+        if (!b->labels[i].defined)
+        {
+            lowerError("Label used but not defined", b->labels[i].ident);
+        }
+    }
+    irRemoveUnreachable(b->func);
+    return b->func;
+}
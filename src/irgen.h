@@ -0,0 +1,10 @@
+#ifndef IRGEN_H
+#define IRGEN_H
+
+#include "ast.h"
+#include "ir.h"
+
+// Lowers a function definition whose symbols have been resolved to IR
+IrFunc *irLowerFunc(FuncDef *func);
+
+#endif
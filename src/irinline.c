@@ -0,0 +1,412 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "arena.h"
+#include "ir.h"
+#include "irinline.h"
+#include "symbol.h"
+
+// instructions a function may have as lowered to be remembered, before promotion and the
+// other passes shrink it, which they do for the copies inlined as well
+#define INLINE_LEAF_COST 48 // a function making no calls
+#define INLINE_CALLS_COST 16 // one whose calls stay calls once it is inlined
+
+// instructions a caller may grow to through inlining
+#define INLINE_CALLER_LIMIT 2048
+
+/* Remembered functions */
+
+// functions in the order they were defined, with an open addressing index by name that is
+// kept at or under half full
+static IrFunc **remembered = NULL;
+static size_t rememberedSize = 0;
+static size_t rememberedCapacity = 0;
+static IrFunc **byName = NULL;
+static size_t byNameCapacity = 0;
+
+static size_t hashName(const char *name)
+{
+    size_t hash = 5381;
+    for (const char *c = name; *c != '\0'; c++)
+    {
+        hash = hash * 33 + (unsigned char)*c;
+    }
+    return hash;
+}
+
+static void indexInsert(IrFunc *func)
+{
+    size_t at = hashName(func->ident) & (byNameCapacity - 1);
+    while (byName[at] != NULL)
+    {
+        at = (at + 1) & (byNameCapacity - 1);
+    }
+    byName[at] = func;
+}
+
+static void rememberedPush(IrFunc *func)
+{
+    if (rememberedSize == rememberedCapacity)
+    {
+        rememberedCapacity = rememberedCapacity == 0 ? 16 : rememberedCapacity * 2;
+        remembered = realloc(remembered, sizeof(IrFunc *) * rememberedCapacity);
+        free(byName);
+        byNameCapacity = 2 * rememberedCapacity;
+        byName = calloc(byNameCapacity, sizeof(IrFunc *));
+        if (remembered == NULL || byName == NULL)
+        {
+            abort();
+        }
+        for (size_t i = 0; i < rememberedSize; i++)
+        {
+            indexInsert(remembered[i]);
+        }
+    }
+    remembered[rememberedSize++] = func;
+    indexInsert(func);
+}
+
+static IrFunc *rememberedFind(const char *name)
+{
+    if (byName == NULL)
+    {
+        return NULL;
+    }
+    for (size_t at = hashName(name) & (byNameCapacity - 1); byName[at] != NULL; at = (at + 1) & (byNameCapacity - 1))
+    {
+        if (strcmp(byName[at]->ident, name) == 0)
+        {
+            return byName[at];
+        }
+    }
+    return NULL;
+}
+
+static size_t instrCount(const IrFunc *func)
+{
+    size_t count = 0;
+    for (size_t i = 0; i < func->size; i++)
+    {
+        count += func->blocks[i]->size;
+    }
+    return count;
+}
+
+/* Copying */
+
+typedef struct LocalCopy
+{
+    SymbolEntry *from;
+    SymbolEntry *to;
+} LocalCopy;
+
+// A copy of the body of one function into another, with fresh registers, blocks and locals
+typedef struct Copy
+{
+    IrFunc *to;
+    const IrFunc *from;
+    size_t *vregs;     // register in to of every register of from
+    IrBlock **blocks;  // block in to of every block of from, by id
+    LocalCopy *locals; // locals of from met so far
+    size_t localsSize;
+} Copy;
+
+static void copyBegin(Copy *copy, IrFunc *to, const IrFunc *from)
+{
+    copy->to = to;
+    copy->from = from;
+    copy->vregs = malloc(sizeof(size_t) * from->vregCount);
+    copy->blocks = calloc(from->blockIds, sizeof(IrBlock *));
+    copy->locals = malloc(sizeof(LocalCopy) * (instrCount(from) + 1));
+    copy->localsSize = 0;
+    if (copy->vregs == NULL || copy->blocks == NULL || copy->locals == NULL)
+    {
+        abort();
+    }
+    copy->vregs[0] = 0;
+    for (size_t i = 1; i < from->vregCount; i++)
+    {
+        copy->vregs[i] = irVregCreate(to, from->vregTypes[i]);
+    }
+    for (size_t i = 0; i < from->size; i++)
+    {
+        copy->blocks[from->blocks[i]->id] = irBlockCreate(to);
+    }
+}
+
+static void copyEnd(Copy *copy)
+{
+    free(copy->vregs);
+    free(copy->blocks);
+    free(copy->locals);
+}
+
+// Gives a local of the copied function a slot of its own below the frame of to, the way
+// entryPush lays out the locals of a function
+static SymbolEntry *copyLocal(Copy *copy, SymbolEntry *var)
+{
+    if (var == NULL || var->isGlobal)
+    {
+        return var;
+    }
+    for (size_t i = 0; i < copy->localsSize; i++)
+    {
+        if (copy->locals[i].from == var)
+        {
+            return copy->locals[i].to;
+        }
+    }
+    SymbolEntry *local = arenaAlloc(copy->to->arena, sizeof(SymbolEntry));
+    *local = *var;
+    copy->to->frameSize += var->storageSize;
+    local->stackOffset = copy->to->frameSize;
+    copy->locals[copy->localsSize].from = var;
+    copy->locals[copy->localsSize++].to = local;
+    return local;
+}
+
+static IrInstr *copyInstr(Copy *copy, const IrInstr *instr)
+{
+    IrInstr *dup = irInstrCreate(copy->to, instr->op);
+    *dup = *instr;
+    dup->dest = copy->vregs[instr->dest];
+    dup->src[0] = copy->vregs[instr->src[0]];
+    dup->src[1] = copy->vregs[instr->src[1]];
+    dup->var = copyLocal(copy, instr->var);
+    dup->args = NULL;
+    dup->argsSize = 0;
+    dup->argsCapacity = 0;
+    dup->phiPreds = NULL;
+    dup->phiPredsCapacity = 0;
+    dup->cases = NULL;
+    dup->casesSize = 0;
+    dup->casesCapacity = 0;
+    for (size_t i = 0; i < instr->argsSize; i++)
+    {
+        if (instr->op == IR_PHI)
+        {
+            irPhiPush(copy->to, dup, copy->vregs[instr->args[i]], copy->blocks[instr->phiPreds[i]->id]);
+        }
+        else
+        {
+            irArgPush(copy->to, dup, copy->vregs[instr->args[i]]);
+        }
+    }
+    for (size_t i = 0; i < instr->casesSize; i++)
+    {
+        irCasePush(copy->to, dup, instr->cases[i].value, copy->blocks[instr->cases[i].target->id]);
+    }
+    for (size_t i = 0; i < 2; i++)
+    {
+        dup->targets[i] = instr->targets[i] != NULL ? copy->blocks[instr->targets[i]->id] : NULL;
+    }
+    return dup;
+}
+
+static void copyBody(Copy *copy)
+{
+    for (size_t i = 0; i < copy->from->size; i++)
+    {
+        const IrBlock *block = copy->from->blocks[i];
+        for (size_t j = 0; j < block->size; j++)
+        {
+            irInstrPush(copy->to, copy->blocks[block->id], copyInstr(copy, block->instrs[j]));
+        }
+    }
+}
+
+/* Inlining */
+
+static bool isFloat(const IrType type)
+{
+    return type == IR_F32 || type == IR_F64;
+}
+
+// The argument of a call that arrives in parameter register imm of the class of type, 0 when
+// the call passes none there or passes it as another type
+static size_t argumentOf(const IrFunc *caller, const IrInstr *call, const IrType type, const int32_t imm)
+{
+    int32_t position = 0;
+    for (size_t i = 0; i < call->argsSize; i++)
+    {
+        IrType argType = caller->vregTypes[call->args[i]];
+        if (isFloat(argType) != isFloat(type))
+        {
+            continue;
+        }
+        if (position++ == imm)
+        {
+            return argType == type ? call->args[i] : 0;
+        }
+    }
+    return 0;
+}
+
+// whether the call passes every parameter the function reads and expects what it returns
+static bool fitsCall(const IrFunc *caller, const IrInstr *call, const IrFunc *callee)
+{
+    if (call->type != callee->retType)
+    {
+        return false;
+    }
+    const IrBlock *entry = callee->blocks[0];
+    for (size_t i = 0; i < entry->size; i++)
+    {
+        const IrInstr *instr = entry->instrs[i];
+        if (instr->op == IR_PARAM && argumentOf(caller, call, instr->type, instr->imm) == 0)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Replaces the call at position at of block i by a copy of the callee. The copy reads the
+// arguments through moves from its parameters and jumps to a new block holding the rest of
+// block i from each return, moving the returned value into the result of the call first.
+// The copied blocks and that block follow block i in the layout, the position of the new
+// block is returned.
+static size_t inlineCall(IrFunc *caller, const size_t i, const size_t at, const IrFunc *callee)
+{
+    IrBlock *block = caller->blocks[i];
+    IrInstr *call = block->instrs[at];
+    IrBlock *rest = irBlockCreate(caller);
+    for (size_t j = at + 1; j < block->size; j++)
+    {
+        irInstrPush(caller, rest, block->instrs[j]);
+    }
+    block->size = at;
+
+    Copy copy;
+    copyBegin(&copy, caller, callee);
+    copyBody(&copy);
+    for (size_t j = 0; j < callee->size; j++)
+    {
+        IrBlock *dup = copy.blocks[callee->blocks[j]->id];
+        for (size_t k = 0; k < dup->size; k++)
+        {
+            IrInstr *instr = dup->instrs[k];
+            if (instr->op == IR_PARAM)
+            {
+                instr->op = IR_MOV;
+                instr->src[0] = argumentOf(caller, call, instr->type, instr->imm);
+                instr->imm = 0;
+            }
+        }
+        IrInstr *term = dup->instrs[dup->size - 1];
+        if (term->op != IR_RET)
+        {
+            continue;
+        }
+        if (call->dest != 0)
+        {
+            // falling off the end of a function leaves its result undefined, zero will do
+            IrInstr *result = irInstrCreate(caller, term->src[0] != 0 ? IR_MOV : isFloat(call->type) ? IR_LF : IR_LI);
+            result->type = call->type;
+            result->dest = call->dest;
+            result->src[0] = term->src[0];
+            irInstrInsert(caller, dup, dup->size - 1, result);
+        }
+        term->op = IR_JMP;
+        term->src[0] = 0;
+        term->targets[0] = rest;
+    }
+    IrInstr *jump = irInstrCreate(caller, IR_JMP);
+    jump->targets[0] = copy.blocks[callee->blocks[0]->id];
+    irInstrPush(caller, block, jump);
+
+    size_t count = callee->size + 1;
+    caller->blocks = irArrayGrow(caller, caller->blocks, &caller->capacity, caller->size + count, sizeof(IrBlock *));
+    memmove(caller->blocks + i + 1 + count, caller->blocks + i + 1, sizeof(IrBlock *) * (caller->size - i - 1));
+    for (size_t j = 0; j < callee->size; j++)
+    {
+        caller->blocks[i + 1 + j] = copy.blocks[callee->blocks[j]->id];
+        caller->blocks[i + 1 + j]->placed = true;
+    }
+    caller->blocks[i + count] = rest;
+    rest->placed = true;
+    caller->size += count;
+    copyEnd(&copy);
+    return i + count;
+}
+
+// The calls inside a copied body are left alone, a remembered function does not call itself
+// but two of them may still call each other.
+void irInlineCalls(IrFunc *func)
+{
+    if (rememberedSize == 0)
+    {
+        return;
+    }
+    size_t size = instrCount(func);
+    bool changed = false;
+    for (size_t i = 0; i < func->size; i++)
+    {
+        for (size_t j = 0; j < func->blocks[i]->size; j++)
+        {
+            IrInstr *instr = func->blocks[i]->instrs[j];
+            IrFunc *callee = instr->op == IR_CALL ? rememberedFind(instr->str) : NULL;
+            if (callee == NULL || size + instrCount(callee) > INLINE_CALLER_LIMIT || !fitsCall(func, instr, callee))
+            {
+                continue;
+            }
+            size += instrCount(callee);
+            i = inlineCall(func, i, j, callee);
+            j = SIZE_MAX; // the rest of the block moved to the start of block i
+            changed = true;
+        }
+    }
+    if (changed)
+    {
+        irComputeCfg(func);
+    }
+}
+
+void irInlineRemember(IrFunc *func)
+{
+    bool calls = false;
+    for (size_t i = 0; i < func->size; i++)
+    {
+        for (size_t j = 0; j < func->blocks[i]->size; j++)
+        {
+            const IrInstr *instr = func->blocks[i]->instrs[j];
+            if (instr->op == IR_CALL && strcmp(instr->str, func->ident) == 0)
+            {
+                return;
+            }
+            calls |= instr->op == IR_CALL;
+        }
+    }
+    if (instrCount(func) > (calls ? INLINE_CALLS_COST : INLINE_LEAF_COST))
+    {
+        return;
+    }
+
+    IrFunc *dup = irFuncCreate(func->ident, func->symbolEntry, func->retType);
+    Copy copy;
+    copyBegin(&copy, dup, func);
+    for (size_t i = 0; i < func->size; i++)
+    {
+        irBlockPlace(dup, copy.blocks[func->blocks[i]->id]);
+    }
+    copyBody(&copy);
+    copyEnd(&copy);
+    rememberedPush(dup);
+}
+
+void irInlineRelease(void)
+{
+    for (size_t i = 0; i < rememberedSize; i++)
+    {
+        irFuncDestroy(remembered[i]);
+    }
+    free(remembered);
+    free(byName);
+    remembered = NULL;
+    byName = NULL;
+    rememberedSize = 0;
+    rememberedCapacity = 0;
+    byNameCapacity = 0;
+}
@@ -0,0 +1,17 @@
+#ifndef IRINLINE_H
+#define IRINLINE_H
+
+#include "ir.h"
+
+// Replaces calls of remembered functions by copies of their bodies while the caller stays
+// small enough, on IR fresh from lowering
+void irInlineCalls(IrFunc *func);
+
+// Keeps a copy of a function for the calls that follow it in the file, when it is cheap
+// enough to inline and does not call itself
+void irInlineRemember(IrFunc *func);
+
+// Frees the remembered functions, once no function follows
+void irInlineRelease(void);
+
+#endif
@@ -0,0 +1,3935 @@
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ir.h"
+#include "iropt.h"
+#include "symbol.h"
+
+/* Local promotion */
+
+typedef struct Promotion
+{
+    SymbolEntry *var;
+    bool promotable;
+    size_t vreg;
+} Promotion;
+
+static int promotionCompare(const void *a, const void *b)
+{
+    uintptr_t x = (uintptr_t)((const Promotion *)a)->var;
+    uintptr_t y = (uintptr_t)((const Promotion *)b)->var;
+    return (x > y) - (x < y);
+}
+
+static Promotion *findPromotion(Promotion *promotions, const size_t size, SymbolEntry *var)
+{
+    Promotion key = {var, false, 0};
+    return bsearch(&key, promotions, size, sizeof(Promotion), promotionCompare);
+}
+
+// A local can live in a register when every access to it is a whole word load or store of
+// the variable itself. Narrow types stay in memory so that stores still truncate.
+static bool promotableAccess(const IrInstr *instr)
+{
+    if (instr->op == IR_ADDR || instr->imm != 0)
+    {
+        return false;
+    }
+    return instr->var->entryType == VARIABLE_ENTRY && instr->memType == irMemTypeOf(instr->var->type.dataType) &&
+           instr->memType != IR_I8 && instr->memType != IR_I16;
+}
+
+// Rewrites loads and stores of promotable locals into moves from and to one virtual register
+// per local. A local that may be read before it is written starts out as zero.
+void irPromoteLocals(IrFunc *func)
+{
+    size_t capacity = 0;
+    for (size_t i = 0; i < func->size; i++)
+    {
+        capacity += func->blocks[i]->size;
+    }
+    Promotion *promotions = malloc(sizeof(Promotion) * (capacity + 1));
+    if (promotions == NULL)
+    {
+        abort();
+    }
+
+    size_t size = 0;
+    for (size_t i = 0; i < func->size; i++)
+    {
+        IrBlock *block = func->blocks[i];
+        for (size_t j = 0; j < block->size; j++)
+        {
+            IrInstr *instr = block->instrs[j];
+            if (instr->var != NULL && !instr->var->isGlobal)
+            {
+                promotions[size++] = (Promotion){instr->var, true, 0};
+            }
+        }
+    }
+    qsort(promotions, size, sizeof(Promotion), promotionCompare);
+    size_t unique = 0;
+    for (size_t i = 0; i < size; i++)
+    {
+        if (unique == 0 || promotions[unique - 1].var != promotions[i].var)
+        {
+            promotions[unique++] = promotions[i];
+        }
+    }
+    size = unique;
+
+    for (size_t i = 0; i < func->size; i++)
+    {
+        IrBlock *block = func->blocks[i];
+        for (size_t j = 0; j < block->size; j++)
+        {
+            IrInstr *instr = block->instrs[j];
+            if (instr->var != NULL && !instr->var->isGlobal && !promotableAccess(instr))
+            {
+                findPromotion(promotions, size, instr->var)->promotable = false;
+            }
+        }
+    }
+    for (size_t i = 0; i < size; i++)
+    {
+        if (promotions[i].promotable)
+        {
+            promotions[i].vreg = irVregCreate(func, irValueType(irMemTypeOf(promotions[i].var->type.dataType)));
+        }
+    }
+
+    for (size_t i = 0; i < func->size; i++)
+    {
+        IrBlock *block = func->blocks[i];
+        for (size_t j = 0; j < block->size; j++)
+        {
+            IrInstr *instr = block->instrs[j];
+            if (instr->var == NULL || instr->var->isGlobal)
+            {
+                continue;
+            }
+            Promotion *promotion = findPromotion(promotions, size, instr->var);
+            if (!promotion->promotable)
+            {
+                continue;
+            }
+            if (instr->op == IR_LOAD)
+            {
+                instr->src[0] = promotion->vreg;
+            }
+            else
+            {
+                instr->type = func->vregTypes[promotion->vreg];
+                instr->dest = promotion->vreg;
+            }
+            instr->op = IR_MOV;
+            instr->var = NULL;
+            instr->memType = IR_VOID;
+        }
+    }
+
+    IrBlock *entry = func->blocks[0];
+    IrLiveness *live = irLivenessCreate(func);
+    for (size_t i = 0; i < size; i++)
+    {
+        if (promotions[i].promotable && irLiveIn(live, entry, promotions[i].vreg))
+        {
+            IrType type = func->vregTypes[promotions[i].vreg];
+            IrInstr *zero = irInstrCreate(func, type == IR_I32 ? IR_LI : IR_LF);
+            zero->type = type;
+            zero->dest = promotions[i].vreg;
+            irInstrInsert(func, entry, 0, zero);
+        }
+    }
+    irLivenessDestroy(live);
+    free(promotions);
+}
+
+/* Copy forwarding */
+
+typedef struct CopyInfo
+{
+    size_t *defCount;
+    size_t *useCount;
+    size_t *defBlock; // block index + 1 of the last definition
+    size_t *defIndex; // position of the last definition in its block
+    bool *usedOutside;
+} CopyInfo;
+
+static size_t countUses(const IrInstr *instr, const size_t vreg)
+{
+    size_t count = 0;
+    for (size_t i = 0; i < irUseCount(instr); i++)
+    {
+        count += irUse(instr, i) == vreg;
+    }
+    return count;
+}
+
+static bool readsOrWrites(const IrInstr *instr, const size_t vreg)
+{
+    return instr->dest == vreg || countUses(instr, vreg) != 0;
+}
+
+static void replaceUses(IrInstr *instr, const size_t from, const size_t to)
+{
+    for (size_t i = 0; i < irSrcCount(instr); i++)
+    {
+        if (instr->src[i] == from)
+        {
+            instr->src[i] = to;
+        }
+    }
+    for (size_t i = 0; i < instr->argsSize; i++)
+    {
+        if (instr->args[i] == from)
+        {
+            instr->args[i] = to;
+        }
+    }
+}
+
+static void removeMarked(IrBlock *block, bool *removed)
+{
+    size_t kept = 0;
+    for (size_t i = 0; i < block->size; i++)
+    {
+        if (!removed[i])
+        {
+            block->instrs[kept++] = block->instrs[i];
+        }
+        removed[i] = false;
+    }
+    block->size = kept;
+}
+
+// x = MOV t, where t is computed earlier in the block only to be copied, computes x directly
+static void forwardStores(CopyInfo *info, IrBlock *block, const size_t blockIndex, bool *removed)
+{
+    for (size_t j = 0; j < block->size; j++)
+    {
+        IrInstr *move = block->instrs[j];
+        size_t temp = move->src[0];
+        if (move->op != IR_MOV || info->defCount[temp] != 1 || info->useCount[temp] != 1 ||
+            info->defBlock[temp] != blockIndex + 1 || info->defIndex[temp] >= j)
+        {
+            continue;
+        }
+        bool clear = true;
+        for (size_t k = info->defIndex[temp] + 1; k < j && clear; k++)
+        {
+            clear = removed[k] || !readsOrWrites(block->instrs[k], move->dest);
+        }
+        if (clear)
+        {
+            block->instrs[info->defIndex[temp]]->dest = move->dest;
+            if (info->defBlock[move->dest] == blockIndex + 1 && info->defIndex[move->dest] == j)
+            {
+                info->defIndex[move->dest] = info->defIndex[temp];
+            }
+            info->defCount[temp] = 0;
+            info->useCount[temp] = 0;
+            removed[j] = true;
+        }
+    }
+    removeMarked(block, removed);
+}
+
+// d = MOV x, where d is only read later in the block while x still holds the same value,
+// lets those reads use x
+static void forwardLoads(CopyInfo *info, IrBlock *block, bool *removed)
+{
+    for (size_t j = 0; j < block->size; j++)
+    {
+        IrInstr *move = block->instrs[j];
+        size_t copy = move->dest;
+        size_t source = move->src[0];
+        if (move->op != IR_MOV || info->defCount[copy] != 1 || info->usedOutside[copy] || copy == source)
+        {
+            continue;
+        }
+        size_t seen = 0;
+        size_t last = j;
+        for (size_t k = j + 1; k < block->size && seen < info->useCount[copy]; k++)
+        {
+            if (removed[k])
+            {
+                continue;
+            }
+            seen += countUses(block->instrs[k], copy);
+            last = k;
+            if (seen < info->useCount[copy] && block->instrs[k]->dest == source)
+            {
+                break;
+            }
+        }
+        if (seen != info->useCount[copy])
+        {
+            continue;
+        }
+        for (size_t k = j + 1; k <= last; k++)
+        {
+            replaceUses(block->instrs[k], copy, source);
+        }
+        info->useCount[source] += seen;
+        info->useCount[source]--;
+        info->defCount[copy] = 0;
+        info->useCount[copy] = 0;
+        removed[j] = true;
+    }
+    removeMarked(block, removed);
+}
+
+// Removes the moves that promotion leaves around every access to a local when the value
+// can be computed into, or read from, the local's register directly
+void irForwardCopies(IrFunc *func)
+{
+    CopyInfo info;
+    info.defCount = calloc(func->vregCount, sizeof(size_t));
+    info.useCount = calloc(func->vregCount, sizeof(size_t));
+    info.defBlock = calloc(func->vregCount, sizeof(size_t));
+    info.defIndex = calloc(func->vregCount, sizeof(size_t));
+    info.usedOutside = calloc(func->vregCount, sizeof(bool));
+    size_t longest = 0;
+    for (size_t i = 0; i < func->size; i++)
+    {
+        longest = func->blocks[i]->size > longest ? func->blocks[i]->size : longest;
+    }
+    bool *removed = calloc(longest + 1, sizeof(bool));
+    if (info.defCount == NULL || info.useCount == NULL || info.defBlock == NULL || info.defIndex == NULL ||
+        info.usedOutside == NULL || removed == NULL)
+    {
+        abort();
+    }
+
+    for (size_t i = 0; i < func->size; i++)
+    {
+        IrBlock *block = func->blocks[i];
+        for (size_t j = 0; j < block->size; j++)
+        {
+            IrInstr *instr = block->instrs[j];
+            for (size_t k = 0; k < irUseCount(instr); k++)
+            {
+                info.useCount[irUse(instr, k)]++;
+            }
+            if (instr->dest != 0)
+            {
+                info.defCount[instr->dest]++;
+                info.defBlock[instr->dest] = i + 1;
+                info.defIndex[instr->dest] = j;
+            }
+        }
+    }
+    for (size_t i = 0; i < func->size; i++)
+    {
+        IrBlock *block = func->blocks[i];
+        for (size_t j = 0; j < block->size; j++)
+        {
+            IrInstr *instr = block->instrs[j];
+            for (size_t k = 0; k < irUseCount(instr); k++)
+            {
+                size_t vreg = irUse(instr, k);
+                info.usedOutside[vreg] |= info.defBlock[vreg] != i + 1;
+            }
+        }
+    }
+
+    for (size_t i = 0; i < func->size; i++)
+    {
+        forwardStores(&info, func->blocks[i], i, removed);
+        forwardLoads(&info, func->blocks[i], removed);
+    }
+    free(info.defCount);
+    free(info.useCount);
+    free(info.defBlock);
+    free(info.defIndex);
+    free(info.usedOutside);
+    free(removed);
+}
+
+/* SSA form */
+
+typedef struct SsaBuilder
+{
+    IrFunc *func;
+    bool *renamed;   // registers written more than once, which get a new name at every write
+    bool *foldable;  // registers whose moves can be dropped by reading the source instead
+    size_t *current; // name an original register reads as at the current point, 0 before any write
+    size_t *zeros;   // name of a renamed register read before any write, made on first use
+    size_t *undo;    // register and previous name pairs, restored when leaving a dominator subtree
+    size_t undoSize;
+} SsaBuilder;
+
+// Dominance frontiers with the method of Cooper, Harvey and Kennedy: a join point is in the
+// frontier of every block from each of its predecessors up to its immediate dominator. Returns
+// the frontier of block id i from start[i] to start[i + 1].
+static IrBlock **dominanceFrontiers(IrFunc *func, size_t **start)
+{
+    *start = calloc(func->blockIds + 1, sizeof(size_t));
+    IrBlock **last = calloc(func->blockIds, sizeof(IrBlock *));
+    if (*start == NULL || last == NULL)
+    {
+        abort();
+    }
+    IrBlock **frontiers = NULL;
+    for (int pass = 0; pass < 2; pass++)
+    {
+        size_t *fill = *start;
+        memset(last, 0, sizeof(IrBlock *) * func->blockIds);
+        for (size_t i = 0; i < func->size; i++)
+        {
+            IrBlock *join = func->blocks[i];
+            for (size_t j = 0; join->predsSize > 1 && j < join->predsSize; j++)
+            {
+                for (IrBlock *runner = join->preds[j]; runner != NULL && runner != join->idom; runner = runner->idom)
+                {
+                    if (last[runner->id] == join)
+                    {
+                        continue;
+                    }
+                    last[runner->id] = join;
+                    if (pass == 0)
+                    {
+                        fill[runner->id + 1]++;
+                    }
+                    else
+                    {
+                        frontiers[fill[runner->id]++] = join;
+                    }
+                }
+            }
+        }
+        if (pass == 0)
+        {
+            for (size_t id = 0; id < func->blockIds; id++)
+            {
+                fill[id + 1] += fill[id];
+            }
+            frontiers = malloc(sizeof(IrBlock *) * (fill[func->blockIds] + 1));
+            if (frontiers == NULL)
+            {
+                abort();
+            }
+        }
+    }
+    // the second pass advanced every start to the next block's, shift them back
+    memmove(*start + 1, *start, sizeof(size_t) * func->blockIds);
+    (*start)[0] = 0;
+    free(last);
+    return frontiers;
+}
+
+// Places a phi for every renamed register at the iterated dominance frontier of its writes,
+// pruned to the blocks it is live into
+static void placePhis(SsaBuilder *ssa, IrLiveness *live)
+{
+    IrFunc *func = ssa->func;
+    size_t *frontierStart;
+    IrBlock **frontiers = dominanceFrontiers(func, &frontierStart);
+
+    // the blocks writing every register, from defStart[v] to defStart[v + 1]
+    size_t *defStart = calloc(func->vregCount + 1, sizeof(size_t));
+    if (defStart == NULL)
+    {
+        abort();
+    }
+    for (size_t i = 0; i < func->size; i++)
+    {
+        IrBlock *block = func->blocks[i];
+        for (size_t j = 0; j < block->size; j++)
+        {
+            defStart[block->instrs[j]->dest + 1]++;
+        }
+    }
+    for (size_t v = 0; v < func->vregCount; v++)
+    {
+        defStart[v + 1] += defStart[v];
+    }
+    IrBlock **defBlocks = malloc(sizeof(IrBlock *) * (defStart[func->vregCount] + 1));
+    size_t *fill = malloc(sizeof(size_t) * (func->vregCount + 1));
+    size_t *hasPhi = calloc(func->blockIds, sizeof(size_t));
+    size_t *queued = calloc(func->blockIds, sizeof(size_t));
+    IrBlock **worklist = malloc(sizeof(IrBlock *) * (func->blockIds + 1));
+    if (defBlocks == NULL || fill == NULL || hasPhi == NULL || queued == NULL || worklist == NULL)
+    {
+        abort();
+    }
+    memcpy(fill, defStart, sizeof(size_t) * (func->vregCount + 1));
+    for (size_t i = 0; i < func->size; i++)
+    {
+        IrBlock *block = func->blocks[i];
+        for (size_t j = 0; j < block->size; j++)
+        {
+            defBlocks[fill[block->instrs[j]->dest]++] = block;
+        }
+    }
+
+    // hasPhi and queued hold the register last handled in every block
+    size_t originalCount = func->vregCount;
+    for (size_t v = 1; v < originalCount; v++)
+    {
+        if (!ssa->renamed[v])
+        {
+            continue;
+        }
+        size_t worklistSize = 0;
+        for (size_t i = defStart[v]; i < defStart[v + 1]; i++)
+        {
+            if (queued[defBlocks[i]->id] != v)
+            {
+                queued[defBlocks[i]->id] = v;
+                worklist[worklistSize++] = defBlocks[i];
+            }
+        }
+        while (worklistSize > 0)
+        {
+            IrBlock *block = worklist[--worklistSize];
+            for (size_t i = frontierStart[block->id]; i < frontierStart[block->id + 1]; i++)
+            {
+                IrBlock *join = frontiers[i];
+                if (hasPhi[join->id] == v || !irLiveIn(live, join, v))
+                {
+                    continue;
+                }
+                hasPhi[join->id] = v;
+                IrInstr *phi = irInstrCreate(func, IR_PHI);
+                phi->type = func->vregTypes[v];
+                phi->dest = v;
+                for (size_t j = 0; j < join->predsSize; j++)
+                {
+                    irPhiPush(func, phi, v, join->preds[j]);
+                }
+                irInstrInsert(func, join, 0, phi);
+                if (queued[join->id] != v)
+                {
+                    queued[join->id] = v;
+                    worklist[worklistSize++] = join;
+                }
+            }
+        }
+    }
+    free(frontierStart);
+    free(frontiers);
+    free(defStart);
+    free(defBlocks);
+    free(fill);
+    free(hasPhi);
+    free(queued);
+    free(worklist);
+}
+
+static void setName(SsaBuilder *ssa, const size_t vreg, const size_t name)
+{
+    ssa->undo[ssa->undoSize++] = vreg;
+    ssa->undo[ssa->undoSize++] = ssa->current[vreg];
+    ssa->current[vreg] = name;
+}
+
+static size_t readName(SsaBuilder *ssa, const size_t vreg)
+{
+    if (ssa->current[vreg] != 0)
+    {
+        return ssa->current[vreg];
+    }
+    if (ssa->zeros[vreg] == 0)
+    {
+        ssa->zeros[vreg] = irVregCreate(ssa->func, ssa->func->vregTypes[vreg]);
+    }
+    return ssa->zeros[vreg];
+}
+
+// Renames the reads and writes of a block, then the phi arguments its successors take from it.
+// A move into a foldable register is dropped and its source read in its place.
+static void renameBlock(SsaBuilder *ssa, IrBlock *block)
+{
+    size_t kept = 0;
+    for (size_t i = 0; i < block->size; i++)
+    {
+        IrInstr *instr = block->instrs[i];
+        if (instr->op != IR_PHI)
+        {
+            for (size_t k = 0; k < irSrcCount(instr); k++)
+            {
+                instr->src[k] = readName(ssa, instr->src[k]);
+            }
+            for (size_t k = 0; k < instr->argsSize; k++)
+            {
+                instr->args[k] = readName(ssa, instr->args[k]);
+            }
+        }
+        if (instr->op == IR_MOV && ssa->foldable[instr->dest])
+        {
+            setName(ssa, instr->dest, instr->src[0]);
+            continue;
+        }
+        if (instr->dest != 0 && ssa->renamed[instr->dest])
+        {
+            size_t name = irVregCreate(ssa->func, instr->type);
+            setName(ssa, instr->dest, name);
+            instr->dest = name;
+        }
+        block->instrs[kept++] = instr;
+    }
+    block->size = kept;
+
+    for (size_t i = 0; i < block->succsSize; i++)
+    {
+        IrBlock *succ = block->succs[i];
+        for (size_t j = 0; j < succ->size && succ->instrs[j]->op == IR_PHI; j++)
+        {
+            IrInstr *phi = succ->instrs[j];
+            phi->args[block->succSlots[i]] = readName(ssa, phi->args[block->succSlots[i]]);
+        }
+    }
+}
+
+// Rewrites the function into SSA form with the method of Cytron et al.: phis go to the
+// iterated dominance frontiers of the registers written more than once, promoted locals among
+// them, then a walk of the dominator tree gives every write a register of its own. Moves are
+// folded away on the way, so a read of a local reads the value last stored to it directly.
+void irBuildSsa(IrFunc *func)
+{
+    size_t originalCount = func->vregCount;
+    SsaBuilder ssa;
+    ssa.func = func;
+    ssa.renamed = calloc(originalCount, sizeof(bool));
+    ssa.foldable = calloc(originalCount, sizeof(bool));
+    ssa.current = calloc(originalCount, sizeof(size_t));
+    ssa.zeros = calloc(originalCount, sizeof(size_t));
+    size_t *defCount = calloc(originalCount, sizeof(size_t));
+    if (ssa.renamed == NULL || ssa.foldable == NULL || ssa.current == NULL || ssa.zeros == NULL || defCount == NULL)
+    {
+        abort();
+    }
+
+    irComputeDominators(func);
+    IrLiveness *live = irLivenessCreate(func);
+    for (size_t i = 0; i < func->size; i++)
+    {
+        IrBlock *block = func->blocks[i];
+        for (size_t j = 0; j < block->size; j++)
+        {
+            defCount[block->instrs[j]->dest]++;
+        }
+    }
+    // a register written once but live into the entry may be read before its write, its
+    // moves stay
+    IrBlock *entry = func->blocks[0];
+    for (size_t v = 1; v < originalCount; v++)
+    {
+        ssa.renamed[v] = defCount[v] > 1;
+        ssa.foldable[v] = ssa.renamed[v] || !irLiveIn(live, entry, v);
+        ssa.current[v] = ssa.renamed[v] ? 0 : v;
+    }
+    placePhis(&ssa, live);
+    irLivenessDestroy(live);
+
+    // every write records one undo pair
+    size_t instrCount = 0;
+    for (size_t i = 0; i < func->size; i++)
+    {
+        instrCount += func->blocks[i]->size;
+    }
+    ssa.undo = malloc(sizeof(size_t) * (2 * instrCount + 1));
+    ssa.undoSize = 0;
+
+    // the dominator tree as lists of children, walked depth first without recursion
+    size_t *childStart = calloc(func->blockIds + 1, sizeof(size_t));
+    IrBlock **children = malloc(sizeof(IrBlock *) * (func->size + 1));
+    size_t *fill = malloc(sizeof(size_t) * (func->blockIds + 1));
+    IrBlock **stack = malloc(sizeof(IrBlock *) * (func->size + 1));
+    size_t *marks = malloc(sizeof(size_t) * (func->size + 1));
+    size_t *nextChild = malloc(sizeof(size_t) * (func->size + 1));
+    if (ssa.undo == NULL || childStart == NULL || children == NULL || fill == NULL || stack == NULL || marks == NULL ||
+        nextChild == NULL)
+    {
+        abort();
+    }
+    for (size_t i = 1; i < func->size; i++)
+    {
+        childStart[func->blocks[i]->idom->id + 1]++;
+    }
+    for (size_t id = 0; id < func->blockIds; id++)
+    {
+        childStart[id + 1] += childStart[id];
+    }
+    memcpy(fill, childStart, sizeof(size_t) * (func->blockIds + 1));
+    for (size_t i = 1; i < func->size; i++)
+    {
+        children[fill[func->blocks[i]->idom->id]++] = func->blocks[i];
+    }
+
+    size_t stackSize = 0;
+    renameBlock(&ssa, entry);
+    stack[stackSize] = entry;
+    marks[stackSize] = 0;
+    nextChild[stackSize++] = childStart[entry->id];
+    while (stackSize > 0)
+    {
+        IrBlock *block = stack[stackSize - 1];
+        if (nextChild[stackSize - 1] == childStart[block->id + 1])
+        {
+            // leaving the subtree restores the names seen on entering it
+            size_t mark = marks[--stackSize];
+            while (ssa.undoSize > mark)
+            {
+                ssa.undoSize -= 2;
+                ssa.current[ssa.undo[ssa.undoSize]] = ssa.undo[ssa.undoSize + 1];
+            }
+            continue;
+        }
+        IrBlock *child = children[nextChild[stackSize - 1]++];
+        marks[stackSize] = ssa.undoSize;
+        renameBlock(&ssa, child);
+        stack[stackSize] = child;
+        nextChild[stackSize++] = childStart[child->id];
+    }
+
+    // registers read before any write read zero, as promotion already arranges for locals
+    for (size_t v = 1; v < originalCount; v++)
+    {
+        if (ssa.zeros[v] != 0)
+        {
+            IrInstr *zero = irInstrCreate(func, func->vregTypes[v] == IR_I32 ? IR_LI : IR_LF);
+            zero->type = func->vregTypes[v];
+            zero->dest = ssa.zeros[v];
+            irInstrInsert(func, entry, 0, zero);
+        }
+    }
+    free(ssa.renamed);
+    free(ssa.foldable);
+    free(ssa.current);
+    free(ssa.zeros);
+    free(ssa.undo);
+    free(defCount);
+    free(childStart);
+    free(children);
+    free(fill);
+    free(stack);
+    free(marks);
+    free(nextChild);
+}
+
+// Pairs of registers compared before two classes are kept apart, which bounds the work
+// a phi with a great many arguments costs
+#define MAX_INTERFERENCE_PAIRS 256
+
+typedef struct PhiCopy
+{
+    IrInstr *phi;
+    size_t temp; // register the predecessors copy to when they cannot write the phi's own, else 0
+} PhiCopy;
+
+typedef struct SsaDestruction
+{
+    IrFunc *func;
+    IrLiveness *live;
+    size_t *defBlock; // block index + 1 of the write of every register
+    size_t *defIndex;
+    size_t *parent;  // union find over the registers sharing one register after SSA form
+    size_t *members; // next register of the same class, the classes are circular lists
+    size_t *sizes;   // registers in every class, by its root
+    IrInstr **constants; // the write of every register written by a constant
+    PhiCopy *copies;     // the phis left once coalesced, those of one block are consecutive
+    size_t *firstCopy; // by block id
+} SsaDestruction;
+
+static size_t classOf(SsaDestruction *ssa, size_t vreg)
+{
+    while (ssa->parent[vreg] != vreg)
+    {
+        ssa->parent[vreg] = ssa->parent[ssa->parent[vreg]];
+        vreg = ssa->parent[vreg];
+    }
+    return vreg;
+}
+
+// Whether a phi of a successor takes vreg from block, reading it at the block's end
+static bool passesToPhi(IrBlock *block, const size_t vreg)
+{
+    for (size_t i = 0; i < block->succsSize; i++)
+    {
+        IrBlock *succ = block->succs[i];
+        for (size_t j = 0; j < succ->size && succ->instrs[j]->op == IR_PHI; j++)
+        {
+            if (succ->instrs[j]->args[block->succSlots[i]] == vreg)
+            {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+// Whether a still holds a value needed after the write of b
+static bool liveAtWrite(SsaDestruction *ssa, const size_t a, const size_t b)
+{
+    IrBlock *block = ssa->func->blocks[ssa->defBlock[b] - 1];
+    size_t index = ssa->defIndex[b];
+    if (ssa->defBlock[a] == ssa->defBlock[b] && ssa->defIndex[a] > index)
+    {
+        return false;
+    }
+    if (irLiveOut(ssa->live, block, a))
+    {
+        return true;
+    }
+    for (size_t i = index + 1; i < block->size; i++)
+    {
+        IrInstr *instr = block->instrs[i];
+        if (instr->op != IR_PHI && countUses(instr, a) != 0)
+        {
+            return true;
+        }
+    }
+    return passesToPhi(block, a);
+}
+
+static bool classesInterfere(SsaDestruction *ssa, const size_t a, const size_t b)
+{
+    size_t x = a;
+    do
+    {
+        size_t y = b;
+        do
+        {
+            if (liveAtWrite(ssa, x, y) || liveAtWrite(ssa, y, x))
+            {
+                return true;
+            }
+            y = ssa->members[y];
+        } while (y != b);
+        x = ssa->members[x];
+    } while (x != a);
+    return false;
+}
+
+// A predecessor can write the register of a phi directly when no successor still needs
+// the register's value and its terminator does not read it
+static bool writeClashes(SsaDestruction *ssa, IrBlock *pred, const size_t dest)
+{
+    for (size_t i = 0; i < pred->succsSize; i++)
+    {
+        if (irLiveIn(ssa->live, pred->succs[i], dest))
+        {
+            return true;
+        }
+    }
+    return countUses(irTerminator(pred), dest) != 0;
+}
+
+// Gathers the copies the phis of the successors of pred need from it, dest of copy i is
+// dests[i], or the phi's temporary register when it has one
+static size_t gatherCopies(SsaDestruction *ssa, IrBlock *pred, size_t *dests, size_t *srcs, size_t *owners)
+{
+    size_t size = 0;
+    for (size_t i = 0; i < pred->succsSize; i++)
+    {
+        IrBlock *succ = pred->succs[i];
+        for (size_t c = ssa->firstCopy[succ->id]; c < ssa->firstCopy[succ->id + 1]; c++)
+        {
+            IrInstr *phi = ssa->copies[c].phi;
+            dests[size] = ssa->copies[c].temp != 0 ? ssa->copies[c].temp : phi->dest;
+            srcs[size] = phi->args[pred->succSlots[i]];
+            owners[size++] = c;
+        }
+    }
+    return size;
+}
+
+// Emits copies that all read their sources before any writes its destination in front of
+// the terminator of block, ordering them so no source is overwritten before it is read and
+// breaking cycles through a new register. A copy of a constant loads it again after the rest.
+static void emitParallelCopy(IrFunc *func, IrBlock *block, IrInstr **constants, size_t *dests, size_t *srcs, size_t size)
+{
+    size_t at = block->size - 1; // the moves go in front of the loads
+    size_t kept = 0;
+    for (size_t i = 0; i < size; i++)
+    {
+        IrInstr *constant = constants[srcs[i]];
+        if (constant == NULL)
+        {
+            dests[kept] = dests[i];
+            srcs[kept++] = srcs[i];
+            continue;
+        }
+        IrInstr *load = irInstrCreate(func, constant->op);
+        load->type = constant->type;
+        load->dest = dests[i];
+        load->imm = constant->imm;
+        load->fimm = constant->fimm;
+        irInstrInsert(func, block, block->size - 1, load);
+    }
+    size = kept;
+    while (size > 0)
+    {
+        size_t ready = size;
+        for (size_t i = 0; i < size && ready == size; i++)
+        {
+            bool read = false;
+            for (size_t j = 0; j < size && !read; j++)
+            {
+                read = j != i && srcs[j] == dests[i];
+            }
+            ready = read ? size : i;
+        }
+        IrInstr *move = irInstrCreate(func, IR_MOV);
+        if (ready == size)
+        {
+            // every destination is still to be read, save the first one
+            size_t saved = irVregCreate(func, func->vregTypes[dests[0]]);
+            move->type = func->vregTypes[saved];
+            move->dest = saved;
+            move->src[0] = dests[0];
+            for (size_t j = 0; j < size; j++)
+            {
+                srcs[j] = srcs[j] == dests[0] ? saved : srcs[j];
+            }
+        }
+        else
+        {
+            move->type = func->vregTypes[dests[ready]];
+            move->dest = dests[ready];
+            move->src[0] = srcs[ready];
+            dests[ready] = dests[--size];
+            srcs[ready] = srcs[size];
+        }
+        irInstrInsert(func, block, at++, move);
+    }
+}
+
+// Turns the remaining phis into copies at the end of their predecessors. A phi whose register
+// a predecessor cannot safely write, or which two phis need different values in, takes a new
+// register there instead and becomes a move from it.
+static void placeCopies(SsaDestruction *ssa)
+{
+    IrFunc *func = ssa->func;
+    ssa->firstCopy = calloc(func->blockIds + 1, sizeof(size_t));
+    if (ssa->firstCopy == NULL)
+    {
+        abort();
+    }
+    size_t argCount = 0;
+    for (size_t i = 0; i < func->size; i++)
+    {
+        IrBlock *block = func->blocks[i];
+        for (size_t j = 0; j < block->size && block->instrs[j]->op == IR_PHI; j++)
+        {
+            ssa->firstCopy[block->id + 1]++;
+            argCount += block->instrs[j]->argsSize;
+        }
+    }
+    for (size_t id = 0; id < func->blockIds; id++)
+    {
+        ssa->firstCopy[id + 1] += ssa->firstCopy[id];
+    }
+    ssa->copies = malloc(sizeof(PhiCopy) * (ssa->firstCopy[func->blockIds] + 1));
+    size_t *dests = malloc(sizeof(size_t) * (argCount + 1));
+    size_t *srcs = malloc(sizeof(size_t) * (argCount + 1));
+    size_t *owners = malloc(sizeof(size_t) * (argCount + 1));
+    if (ssa->copies == NULL || dests == NULL || srcs == NULL || owners == NULL)
+    {
+        abort();
+    }
+    for (size_t i = 0; i < func->size; i++)
+    {
+        IrBlock *block = func->blocks[i];
+        for (size_t j = 0; j < block->size && block->instrs[j]->op == IR_PHI; j++)
+        {
+            ssa->copies[ssa->firstCopy[block->id] + j] = (PhiCopy){block->instrs[j], 0};
+        }
+    }
+
+    bool *needsTemp = calloc(ssa->firstCopy[func->blockIds] + 1, sizeof(bool));
+    if (needsTemp == NULL)
+    {
+        abort();
+    }
+    for (size_t i = 0; i < func->size; i++)
+    {
+        IrBlock *pred = func->blocks[i];
+        size_t size = gatherCopies(ssa, pred, dests, srcs, owners);
+        for (size_t j = 0; j < size; j++)
+        {
+            needsTemp[owners[j]] |= dests[j] != srcs[j] && writeClashes(ssa, pred, dests[j]);
+            for (size_t k = j + 1; k < size; k++)
+            {
+                if (dests[j] == dests[k] && srcs[j] != srcs[k])
+                {
+                    needsTemp[owners[j]] = true;
+                    needsTemp[owners[k]] = true;
+                }
+            }
+        }
+    }
+    for (size_t c = 0; c < ssa->firstCopy[func->blockIds]; c++)
+    {
+        if (needsTemp[c])
+        {
+            ssa->copies[c].temp = irVregCreate(func, ssa->copies[c].phi->type);
+        }
+    }
+
+    for (size_t i = 0; i < func->size; i++)
+    {
+        IrBlock *pred = func->blocks[i];
+        size_t gathered = gatherCopies(ssa, pred, dests, srcs, owners);
+        size_t size = 0;
+        for (size_t j = 0; j < gathered; j++)
+        {
+            bool needed = dests[j] != srcs[j];
+            for (size_t k = 0; k < size && needed; k++)
+            {
+                needed = dests[k] != dests[j];
+            }
+            if (needed)
+            {
+                dests[size] = dests[j];
+                srcs[size++] = srcs[j];
+            }
+        }
+        emitParallelCopy(func, pred, ssa->constants, dests, srcs, size);
+    }
+
+    // a phi with a temporary register reads it at the start of its block
+    for (size_t i = 0; i < func->size; i++)
+    {
+        IrBlock *block = func->blocks[i];
+        size_t kept = 0;
+        size_t j = 0;
+        for (; j < block->size && block->instrs[j]->op == IR_PHI; j++)
+        {
+            PhiCopy *copy = &ssa->copies[ssa->firstCopy[block->id] + j];
+            if (copy->temp != 0)
+            {
+                copy->phi->op = IR_MOV;
+                copy->phi->src[0] = copy->temp;
+                copy->phi->argsSize = 0;
+                block->instrs[kept++] = copy->phi;
+            }
+        }
+        memmove(block->instrs + kept, block->instrs + j, sizeof(IrInstr *) * (block->size - j));
+        block->size -= j - kept;
+    }
+    free(needsTemp);
+    free(dests);
+    free(srcs);
+    free(owners);
+}
+
+// Leaves SSA form. The registers of a phi and its arguments share one register when none
+// holds a needed value where another is written, then the phi disappears. The arguments
+// of any other phi are copied at the end of the predecessors, all copies into one block
+// as if at once. Constants are loaded again there rather than kept in a register.
+void irDestroySsa(IrFunc *func)
+{
+    SsaDestruction ssa;
+    ssa.func = func;
+    ssa.live = irLivenessCreate(func);
+    ssa.defBlock = calloc(func->vregCount, sizeof(size_t));
+    ssa.defIndex = calloc(func->vregCount, sizeof(size_t));
+    ssa.parent = malloc(sizeof(size_t) * func->vregCount);
+    ssa.members = malloc(sizeof(size_t) * func->vregCount);
+    ssa.sizes = malloc(sizeof(size_t) * func->vregCount);
+    ssa.constants = calloc(func->vregCount, sizeof(IrInstr *));
+    if (ssa.defBlock == NULL || ssa.defIndex == NULL || ssa.parent == NULL || ssa.members == NULL || ssa.sizes == NULL ||
+        ssa.constants == NULL)
+    {
+        abort();
+    }
+    for (size_t v = 0; v < func->vregCount; v++)
+    {
+        ssa.parent[v] = v;
+        ssa.members[v] = v;
+        ssa.sizes[v] = 1;
+    }
+    for (size_t i = 0; i < func->size; i++)
+    {
+        IrBlock *block = func->blocks[i];
+        for (size_t j = 0; j < block->size; j++)
+        {
+            IrInstr *instr = block->instrs[j];
+            ssa.defBlock[instr->dest] = i + 1;
+            ssa.defIndex[instr->dest] = j;
+            ssa.constants[instr->dest] = instr->op == IR_LI || instr->op == IR_LF ? instr : NULL;
+        }
+    }
+
+    for (size_t i = 0; i < func->size; i++)
+    {
+        IrBlock *block = func->blocks[i];
+        for (size_t j = 0; j < block->size && block->instrs[j]->op == IR_PHI; j++)
+        {
+            IrInstr *phi = block->instrs[j];
+            for (size_t k = 0; k < phi->argsSize; k++)
+            {
+                // a constant written in another block is loaded again rather than kept
+                size_t arg = phi->args[k];
+                bool reload = ssa.constants[arg] != NULL && func->blocks[ssa.defBlock[arg] - 1] != phi->phiPreds[k];
+                size_t a = classOf(&ssa, phi->dest);
+                size_t b = classOf(&ssa, arg);
+                if (!reload && a != b && ssa.sizes[a] * ssa.sizes[b] <= MAX_INTERFERENCE_PAIRS && !classesInterfere(&ssa, a, b))
+                {
+                    ssa.parent[b] = a;
+                    ssa.sizes[a] += ssa.sizes[b];
+                    size_t next = ssa.members[a];
+                    ssa.members[a] = ssa.members[b];
+                    ssa.members[b] = next;
+                }
+            }
+        }
+    }
+
+    for (size_t i = 0; i < func->size; i++)
+    {
+        IrBlock *block = func->blocks[i];
+        for (size_t j = 0; j < block->size; j++)
+        {
+            IrInstr *instr = block->instrs[j];
+            instr->dest = classOf(&ssa, instr->dest);
+            for (size_t k = 0; k < irSrcCount(instr); k++)
+            {
+                instr->src[k] = classOf(&ssa, instr->src[k]);
+            }
+            for (size_t k = 0; k < instr->argsSize; k++)
+            {
+                instr->args[k] = classOf(&ssa, instr->args[k]);
+            }
+        }
+    }
+
+    // phis whose arguments all share the result's register are done
+    for (size_t i = 0; i < func->size; i++)
+    {
+        IrBlock *block = func->blocks[i];
+        size_t kept = 0;
+        size_t j = 0;
+        for (; j < block->size && block->instrs[j]->op == IR_PHI; j++)
+        {
+            IrInstr *phi = block->instrs[j];
+            bool coalesced = true;
+            for (size_t k = 0; k < phi->argsSize; k++)
+            {
+                coalesced &= phi->args[k] == phi->dest;
+            }
+            if (!coalesced)
+            {
+                block->instrs[kept++] = phi;
+            }
+        }
+        memmove(block->instrs + kept, block->instrs + j, sizeof(IrInstr *) * (block->size - j));
+        block->size -= j - kept;
+    }
+    irLivenessDestroy(ssa.live);
+    ssa.live = irLivenessCreate(func);
+    placeCopies(&ssa);
+
+    irLivenessDestroy(ssa.live);
+    free(ssa.defBlock);
+    free(ssa.defIndex);
+    free(ssa.parent);
+    free(ssa.members);
+    free(ssa.sizes);
+    free(ssa.constants);
+    free(ssa.copies);
+    free(ssa.firstCopy);
+}
+
+/* Constant propagation */
+
+// TOP is a register no executable path has written yet, BOTTOM one that is not constant
+typedef enum LatticeKind
+{
+    LATTICE_TOP,
+    LATTICE_CONST,
+    LATTICE_BOTTOM
+} LatticeKind;
+
+typedef struct Lattice
+{
+    LatticeKind kind;
+    int32_t i; // I32
+    double f;  // F32 and F64, F32 values are already rounded to float
+} Lattice;
+
+static const Lattice top = {LATTICE_TOP, 0, 0.0};
+static const Lattice bottom = {LATTICE_BOTTOM, 0, 0.0};
+
+static Lattice intConst(const int32_t value)
+{
+    Lattice lattice = {LATTICE_CONST, value, 0.0};
+    return lattice;
+}
+
+// Floating point constants are emitted with their exact bit patterns, so any finite value
+// folds. Infinities and NaNs are left for the program to produce.
+static Lattice floatConst(const IrType type, double value)
+{
+    if (type == IR_F32)
+    {
+        value = (float)value;
+    }
+    if (!isfinite(value))
+    {
+        return bottom;
+    }
+    Lattice lattice = {LATTICE_CONST, 0, value};
+    return lattice;
+}
+
+static bool sameLattice(const Lattice a, const Lattice b)
+{
+    return a.kind == b.kind && (a.kind != LATTICE_CONST || (a.i == b.i && memcmp(&a.f, &b.f, sizeof(double)) == 0));
+}
+
+static Lattice meet(const Lattice a, const Lattice b)
+{
+    if (a.kind == LATTICE_TOP)
+    {
+        return b;
+    }
+    if (b.kind == LATTICE_TOP || sameLattice(a, b))
+    {
+        return a;
+    }
+    return bottom;
+}
+
+// C integer arithmetic on 32 bits. Operations whose result is undefined, division by zero,
+// INT_MIN / -1 and out of range shifts, are left for the program to perform.
+static Lattice foldInt(const IrOp op, const int32_t a, const int32_t b)
+{
+    uint32_t ua = (uint32_t)a;
+    uint32_t ub = (uint32_t)b;
+    bool badShift = b < 0 || b > 31;
+    bool badDiv = b == 0 || (a == INT32_MIN && b == -1);
+    switch (op)
+    {
+    case IR_ADD:
+        return intConst((int32_t)(ua + ub));
+    case IR_SUB:
+        return intConst((int32_t)(ua - ub));
+    case IR_MUL:
+        return intConst((int32_t)(ua * ub));
+    case IR_DIV:
+        return badDiv ? bottom : intConst(a / b);
+    case IR_REM:
+        return badDiv ? bottom : intConst(a % b);
+    case IR_MULH:
+        return intConst((int32_t)(((int64_t)a * b) >> 32));
+    case IR_MULHU:
+        return intConst((int32_t)(((uint64_t)ua * ub) >> 32));
+    case IR_DIVU:
+        return ub == 0 ? bottom : intConst((int32_t)(ua / ub));
+    case IR_REMU:
+        return ub == 0 ? bottom : intConst((int32_t)(ua % ub));
+    case IR_AND:
+        return intConst(a & b);
+    case IR_OR:
+        return intConst(a | b);
+    case IR_XOR:
+        return intConst(a ^ b);
+    case IR_SHL:
+        return badShift ? bottom : intConst((int32_t)(ua << b));
+    case IR_SHR:
+        return badShift ? bottom : intConst((int32_t)(ua >> b));
+    case IR_SAR:
+        return badShift ? bottom : intConst(a < 0 ? (int32_t)~(~ua >> b) : a >> b);
+    case IR_EQ:
+        return intConst(a == b);
+    case IR_NE:
+        return intConst(a != b);
+    case IR_LT:
+        return intConst(a < b);
+    case IR_LE:
+        return intConst(a <= b);
+    case IR_GT:
+        return intConst(a > b);
+    case IR_GE:
+        return intConst(a >= b);
+    case IR_LTU:
+        return intConst(ua < ub);
+    case IR_LEU:
+        return intConst(ua <= ub);
+    case IR_GTU:
+        return intConst(ua > ub);
+    case IR_GEU:
+        return intConst(ua >= ub);
+    default:
+        return bottom;
+    }
+}
+
+static Lattice foldFloat(const IrOp op, const IrType type, const double a, const double b)
+{
+    switch (op)
+    {
+    case IR_ADD:
+        return floatConst(type, type == IR_F32 ? (double)((float)a + (float)b) : a + b);
+    case IR_SUB:
+        return floatConst(type, type == IR_F32 ? (double)((float)a - (float)b) : a - b);
+    case IR_MUL:
+        return floatConst(type, type == IR_F32 ? (double)((float)a * (float)b) : a * b);
+    case IR_DIV:
+        return floatConst(type, type == IR_F32 ? (double)((float)a / (float)b) : a / b);
+    case IR_EQ:
+        return intConst(a == b);
+    case IR_NE:
+        return intConst(a != b);
+    case IR_LT:
+        return intConst(a < b);
+    case IR_LE:
+        return intConst(a <= b);
+    case IR_GT:
+        return intConst(a > b);
+    case IR_GE:
+        return intConst(a >= b);
+    default:
+        return bottom;
+    }
+}
+
+static Lattice foldConvert(const IrType to, const IrType from, const Lattice value)
+{
+    if (from == IR_I32)
+    {
+        return floatConst(to, (double)value.i);
+    }
+    if (to != IR_I32)
+    {
+        return floatConst(to, value.f);
+    }
+    // the conversion truncates, values outside int are undefined
+    if (!(value.f > -2147483649.0 && value.f < 2147483648.0))
+    {
+        return bottom;
+    }
+    return intConst((int32_t)value.f);
+}
+
+static Lattice evaluate(IrFunc *func, const IrInstr *instr, const Lattice *values)
+{
+    switch (instr->op)
+    {
+    case IR_LI:
+        return intConst(instr->imm);
+    case IR_LF:
+        return floatConst(instr->type, instr->fimm);
+    case IR_MOV:
+        return values[instr->src[0]];
+    case IR_LSTR:
+    case IR_ADDR:
+    case IR_PARAM:
+    case IR_LOAD:
+    case IR_CALL:
+        return bottom;
+    default:
+        break;
+    }
+
+    Lattice a = values[instr->src[0]];
+    Lattice b = instr->src[1] != 0 ? values[instr->src[1]] : intConst(instr->imm);
+    if (a.kind == LATTICE_BOTTOM || b.kind == LATTICE_BOTTOM)
+    {
+        return bottom;
+    }
+    if (a.kind == LATTICE_TOP || b.kind == LATTICE_TOP)
+    {
+        return top;
+    }
+    IrType operandType = func->vregTypes[instr->src[0]];
+    switch (instr->op)
+    {
+    case IR_CVT:
+        return foldConvert(instr->type, operandType, a);
+    case IR_NEG:
+        return operandType == IR_I32 ? intConst((int32_t)(0u - (uint32_t)a.i)) : floatConst(operandType, -a.f);
+    case IR_NOT:
+        return intConst(~a.i);
+    case IR_LNOT:
+        return intConst(a.i == 0);
+    case IR_BOOL:
+        return intConst(a.i != 0);
+    default:
+        return operandType == IR_I32 ? foldInt(instr->op, a.i, b.i) : foldFloat(instr->op, operandType, a.f, b.f);
+    }
+}
+
+typedef struct Propagation
+{
+    IrFunc *func;
+    Lattice *values;  // every register, only ever lowered
+    bool *executable; // by block id
+    size_t *userStart; // CSR of the blocks to evaluate again when a register is lowered
+    IrBlock **users;
+    IrBlock **worklist;
+    size_t worklistSize;
+    bool *queued;
+} Propagation;
+
+static void queueBlock(Propagation *prop, IrBlock *block)
+{
+    if (!prop->queued[block->id])
+    {
+        prop->queued[block->id] = true;
+        prop->worklist[prop->worklistSize++] = block;
+    }
+}
+
+static void lowerValue(Propagation *prop, const size_t vreg, const Lattice value)
+{
+    if (sameLattice(prop->values[vreg], value))
+    {
+        return;
+    }
+    prop->values[vreg] = value;
+    for (size_t i = prop->userStart[vreg]; i < prop->userStart[vreg + 1]; i++)
+    {
+        if (prop->executable[prop->users[i]->id])
+        {
+            queueBlock(prop, prop->users[i]);
+        }
+    }
+}
+
+// A block reads the registers of its instructions and, at its end, the phi arguments it
+// passes to its successors
+static void collectUsers(Propagation *prop)
+{
+    IrFunc *func = prop->func;
+    prop->userStart = calloc(func->vregCount + 1, sizeof(size_t));
+    if (prop->userStart == NULL)
+    {
+        abort();
+    }
+    for (int pass = 0; pass < 2; pass++)
+    {
+        for (size_t i = 0; i < func->size; i++)
+        {
+            IrBlock *block = func->blocks[i];
+            for (size_t j = 0; j < block->size; j++)
+            {
+                IrInstr *instr = block->instrs[j];
+                for (size_t k = 0; k < irUseCount(instr); k++)
+                {
+                    size_t vreg = irUse(instr, k);
+                    if (pass == 0)
+                    {
+                        prop->userStart[vreg]++;
+                    }
+                    else
+                    {
+                        prop->users[--prop->userStart[vreg]] = instr->op == IR_PHI ? instr->phiPreds[k] : block;
+                    }
+                }
+            }
+        }
+        if (pass == 0)
+        {
+            for (size_t v = 0; v < func->vregCount; v++)
+            {
+                prop->userStart[v + 1] += prop->userStart[v];
+            }
+            prop->users = malloc(sizeof(IrBlock *) * (prop->userStart[func->vregCount] + 1));
+            if (prop->users == NULL)
+            {
+                abort();
+            }
+        }
+    }
+}
+
+// The successor a branch or switch on a known value takes, NULL when it is not known
+static IrBlock *knownTarget(const IrInstr *term, const Lattice *values)
+{
+    Lattice selector = values[term->src[0]];
+    if (term->op == IR_JMP)
+    {
+        return term->targets[0];
+    }
+    if (selector.kind != LATTICE_CONST)
+    {
+        return NULL;
+    }
+    if (term->op == IR_BR)
+    {
+        return term->targets[selector.i != 0 ? 0 : 1];
+    }
+    for (size_t i = 0; i < term->casesSize; i++)
+    {
+        if (term->cases[i].value == selector.i)
+        {
+            return term->cases[i].target;
+        }
+    }
+    return term->targets[0];
+}
+
+// Marks the edge to successor i of from as taken and meets the arguments passed along it
+// into the successor's phis
+static void flowTo(Propagation *prop, IrBlock *from, const size_t i)
+{
+    IrBlock *target = from->succs[i];
+    if (!prop->executable[target->id])
+    {
+        prop->executable[target->id] = true;
+        queueBlock(prop, target);
+    }
+    for (size_t j = 0; j < target->size && target->instrs[j]->op == IR_PHI; j++)
+    {
+        IrInstr *phi = target->instrs[j];
+        size_t arg = phi->args[from->succSlots[i]];
+        lowerValue(prop, phi->dest, meet(prop->values[phi->dest], prop->values[arg]));
+    }
+}
+
+static void evaluateBlock(Propagation *prop, IrBlock *block)
+{
+    for (size_t i = 0; i < block->size; i++)
+    {
+        IrInstr *instr = block->instrs[i];
+        if (instr->op != IR_PHI && instr->dest != 0)
+        {
+            lowerValue(prop, instr->dest, evaluate(prop->func, instr, prop->values));
+        }
+    }
+    IrInstr *term = irTerminator(block);
+    IrBlock *target = knownTarget(term, prop->values);
+    for (size_t i = 0; i < block->succsSize; i++)
+    {
+        if (block->succs[i] == target || (target == NULL && prop->values[term->src[0]].kind == LATTICE_BOTTOM))
+        {
+            flowTo(prop, block, i);
+        }
+    }
+}
+
+// Replaces every instruction computing a known value by a constant and every branch on a
+// known condition by a jump
+static void rewriteBlock(Propagation *prop, IrBlock *block)
+{
+    for (size_t i = 0; i < block->size; i++)
+    {
+        IrInstr *instr = block->instrs[i];
+        if (irIsTerminator(instr->op))
+        {
+            IrBlock *target = knownTarget(instr, prop->values);
+            if (instr->op != IR_RET && instr->op != IR_JMP && target != NULL)
+            {
+                instr->op = IR_JMP;
+                instr->src[0] = 0;
+                instr->casesSize = 0;
+                instr->targets[0] = target;
+                instr->targets[1] = NULL;
+            }
+            break;
+        }
+        Lattice value = prop->values[instr->dest];
+        if (instr->dest == 0 || value.kind != LATTICE_CONST || instr->op == IR_PHI || instr->op == IR_LI || instr->op == IR_LF ||
+            instr->op == IR_CALL)
+        {
+            continue;
+        }
+        instr->op = instr->type == IR_I32 ? IR_LI : IR_LF;
+        instr->imm = value.i;
+        instr->fimm = value.f;
+        instr->src[0] = 0;
+        instr->src[1] = 0;
+        instr->var = NULL;
+        instr->memType = IR_VOID;
+    }
+}
+
+// Sparse conditional constant propagation in the style of Wegman and Zadeck. Every register
+// is written once in SSA form and keeps one value; values flow only along edges that can
+// execute, so a phi only meets the arguments of the edges taken and a constant condition
+// keeps the branch not taken out of the merge.
+void irFoldConstants(IrFunc *func)
+{
+    Propagation prop;
+    prop.func = func;
+    prop.values = calloc(func->vregCount, sizeof(Lattice));
+    prop.executable = calloc(func->blockIds, sizeof(bool));
+    prop.queued = calloc(func->blockIds, sizeof(bool));
+    prop.worklist = malloc(sizeof(IrBlock *) * (func->blockIds + 1));
+    if (prop.values == NULL || prop.executable == NULL || prop.queued == NULL || prop.worklist == NULL)
+    {
+        abort();
+    }
+    collectUsers(&prop);
+
+    prop.worklistSize = 0;
+    prop.executable[func->blocks[0]->id] = true;
+    queueBlock(&prop, func->blocks[0]);
+    while (prop.worklistSize > 0)
+    {
+        IrBlock *block = prop.worklist[--prop.worklistSize];
+        prop.queued[block->id] = false;
+        evaluateBlock(&prop, block);
+    }
+
+    for (size_t i = 0; i < func->size; i++)
+    {
+        if (prop.executable[func->blocks[i]->id])
+        {
+            rewriteBlock(&prop, func->blocks[i]);
+        }
+    }
+    free(prop.values);
+    free(prop.executable);
+    free(prop.userStart);
+    free(prop.users);
+    free(prop.queued);
+    free(prop.worklist);
+    irRemoveUnreachable(func);
+}
+
+/* Strength reduction */
+
+typedef struct Reduction
+{
+    IrFunc *func;
+    IrBlock *block;
+    bool *isConst; // registers written once, by a LI
+    int32_t *consts;
+} Reduction;
+
+static size_t emitOp(Reduction *red, const IrOp op, const size_t src0, const size_t src1)
+{
+    IrInstr *instr = irInstrCreate(red->func, op);
+    instr->type = IR_I32;
+    instr->dest = irVregCreate(red->func, IR_I32);
+    instr->src[0] = src0;
+    instr->src[1] = src1;
+    irInstrPush(red->func, red->block, instr);
+    return instr->dest;
+}
+
+static size_t emitConst(Reduction *red, const int32_t value)
+{
+    IrInstr *instr = irInstrCreate(red->func, IR_LI);
+    instr->type = IR_I32;
+    instr->dest = irVregCreate(red->func, IR_I32);
+    instr->imm = value;
+    irInstrPush(red->func, red->block, instr);
+    return instr->dest;
+}
+
+static size_t emitShift(Reduction *red, const IrOp op, const size_t src, const unsigned int amount)
+{
+    return amount == 0 ? src : emitOp(red, op, src, emitConst(red, (int32_t)amount));
+}
+
+static bool isPowerOfTwo(const uint32_t value)
+{
+    return value != 0 && (value & (value - 1)) == 0;
+}
+
+static unsigned int log2Of(uint32_t value)
+{
+    unsigned int log = 0;
+    while (value >>= 1)
+    {
+        log++;
+    }
+    return log;
+}
+
+// Multiplies by a constant with at most two shifts and an add or subtract, counting modulo
+// 2^32 so that negative factors are differences as well: -4 is 0 - (x << 2). Returns 0 when
+// the factor needs more than that and the multiply is kept.
+static size_t reduceMul(Reduction *red, const size_t src, const uint32_t factor)
+{
+    uint32_t low = factor & (0u - factor);
+    if (factor == 0)
+    {
+        return emitConst(red, 0);
+    }
+    if (factor == low)
+    {
+        return emitShift(red, IR_SHL, src, log2Of(factor));
+    }
+    if (isPowerOfTwo(factor - low))
+    {
+        size_t high = emitShift(red, IR_SHL, src, log2Of(factor - low));
+        return emitOp(red, IR_ADD, high, emitShift(red, IR_SHL, src, log2Of(low)));
+    }
+    if (factor + low == 0)
+    {
+        return emitOp(red, IR_NEG, emitShift(red, IR_SHL, src, log2Of(low)), 0);
+    }
+    if (isPowerOfTwo(factor + low))
+    {
+        size_t high = emitShift(red, IR_SHL, src, log2Of(factor + low));
+        return emitOp(red, IR_SUB, high, emitShift(red, IR_SHL, src, log2Of(low)));
+    }
+    return 0;
+}
+
+// The remainder is the dividend less the quotient times the divisor
+static size_t multiplyBack(Reduction *red, const size_t quotient, const uint32_t divisor)
+{
+    size_t product = reduceMul(red, quotient, divisor);
+    return product != 0 ? product : emitOp(red, IR_MUL, quotient, emitConst(red, (int32_t)divisor));
+}
+
+// Signed division by 2^shift rounds towards zero by adding 2^shift - 1 to negative dividends
+static size_t biasedDividend(Reduction *red, const size_t src, const unsigned int shift)
+{
+    size_t sign = emitShift(red, IR_SAR, src, 31);
+    return emitOp(red, IR_ADD, src, emitShift(red, IR_SHR, sign, 32 - shift));
+}
+
+// Unsigned division by a constant that is not a power of two as a multiply by a rounded up
+// reciprocal 2^(32 + shift) / divisor, after Granlund and Montgomery. When no such
+// reciprocal fits in 32 bits the 33 bit one is used, its top bit added back by hand.
+static size_t reduceDivU(Reduction *red, const size_t src, const uint32_t divisor)
+{
+    if (divisor >= 0x80000000u)
+    {
+        return emitOp(red, IR_GEU, src, emitConst(red, (int32_t)divisor));
+    }
+    for (unsigned int shift = 0; shift < 32; shift++)
+    {
+        uint64_t power = (uint64_t)1 << (32 + shift);
+        uint64_t multiplier = (power + divisor - 1) / divisor;
+        if (multiplier > UINT32_MAX)
+        {
+            break;
+        }
+        if (multiplier * divisor - power <= ((uint64_t)1 << shift))
+        {
+            size_t high = emitOp(red, IR_MULHU, src, emitConst(red, (int32_t)(uint32_t)multiplier));
+            return emitShift(red, IR_SHR, high, shift);
+        }
+    }
+    unsigned int log = log2Of(divisor) + 1;
+    uint64_t multiplier = (((uint64_t)1 << 32) * (((uint64_t)1 << log) - divisor)) / divisor + 1;
+    size_t high = emitOp(red, IR_MULHU, src, emitConst(red, (int32_t)(uint32_t)multiplier));
+    size_t half = emitShift(red, IR_SHR, emitOp(red, IR_SUB, src, high), 1);
+    return emitShift(red, IR_SHR, emitOp(red, IR_ADD, half, high), log - 1);
+}
+
+// Signed division by a constant whose magnitude is not a power of two: the multiply rounds
+// the quotient down and adding its sign bit rounds negative quotients back towards zero.
+static size_t reduceDiv(Reduction *red, const size_t src, const int32_t divisor)
+{
+    uint32_t magnitude = divisor < 0 ? 0u - (uint32_t)divisor : (uint32_t)divisor;
+    size_t quotient = 0;
+    for (unsigned int shift = 0; shift < 32; shift++)
+    {
+        uint64_t power = (uint64_t)1 << (32 + shift);
+        uint64_t multiplier = (power + magnitude - 1) / magnitude;
+        if (multiplier * magnitude - power >= ((uint64_t)2 << shift))
+        {
+            continue;
+        }
+        // a multiplier of 2^31 or more reads as negative, adding the dividend corrects it
+        quotient = emitOp(red, IR_MULH, src, emitConst(red, (int32_t)(uint32_t)multiplier));
+        if (multiplier > INT32_MAX)
+        {
+            quotient = emitOp(red, IR_ADD, quotient, src);
+        }
+        quotient = emitShift(red, IR_SAR, quotient, shift);
+        quotient = emitOp(red, IR_ADD, quotient, emitShift(red, IR_SHR, quotient, 31));
+        break;
+    }
+    return divisor < 0 ? emitOp(red, IR_NEG, quotient, 0) : quotient;
+}
+
+// Rewrites a multiply, divide or remainder by a constant, returning the register holding the
+// result or 0 when the instruction is kept
+static size_t reduce(Reduction *red, const IrInstr *instr)
+{
+    size_t src = instr->src[0];
+    if (instr->op == IR_MUL && red->isConst[src])
+    {
+        return reduceMul(red, instr->src[1], (uint32_t)red->consts[src]);
+    }
+    if (!red->isConst[instr->src[1]])
+    {
+        return 0;
+    }
+    int32_t divisor = red->consts[instr->src[1]];
+    uint32_t udivisor = (uint32_t)divisor;
+    uint32_t magnitude = divisor < 0 ? 0u - udivisor : udivisor;
+    switch (instr->op)
+    {
+    case IR_MUL:
+        return reduceMul(red, src, udivisor);
+    case IR_DIVU:
+        if (isPowerOfTwo(udivisor))
+        {
+            return emitShift(red, IR_SHR, src, log2Of(udivisor));
+        }
+        return udivisor == 0 ? 0 : reduceDivU(red, src, udivisor);
+    case IR_REMU:
+        if (isPowerOfTwo(udivisor))
+        {
+            return emitOp(red, IR_AND, src, emitConst(red, (int32_t)(udivisor - 1)));
+        }
+        return udivisor == 0 ? 0 : emitOp(red, IR_SUB, src, multiplyBack(red, reduceDivU(red, src, udivisor), udivisor));
+    case IR_DIV:
+        if (divisor == 0 || divisor == INT32_MIN)
+        {
+            return 0;
+        }
+        if (magnitude == 1)
+        {
+            return divisor < 0 ? emitOp(red, IR_NEG, src, 0) : src;
+        }
+        if (isPowerOfTwo(magnitude))
+        {
+            size_t quotient = emitShift(red, IR_SAR, biasedDividend(red, src, log2Of(magnitude)), log2Of(magnitude));
+            return divisor < 0 ? emitOp(red, IR_NEG, quotient, 0) : quotient;
+        }
+        return reduceDiv(red, src, divisor);
+    case IR_REM:
+        // the remainder takes the sign of the dividend only, so n % -d is n % d
+        if (divisor == 0 || divisor == INT32_MIN)
+        {
+            return 0;
+        }
+        if (magnitude == 1)
+        {
+            return emitConst(red, 0);
+        }
+        if (isPowerOfTwo(magnitude))
+        {
+            size_t rounded = biasedDividend(red, src, log2Of(magnitude));
+            return emitOp(red, IR_SUB, src, emitOp(red, IR_AND, rounded, emitConst(red, (int32_t)(0u - magnitude))));
+        }
+        return emitOp(red, IR_SUB, src, multiplyBack(red, reduceDiv(red, src, (int32_t)magnitude), magnitude));
+    default:
+        return 0;
+    }
+}
+
+// Replaces multiplies, divides and remainders by constants with shifts, adds and multiplies
+// by reciprocals, which take a cycle or a few where a divide takes tens
+void irReduceStrength(IrFunc *func)
+{
+    Reduction red;
+    red.func = func;
+    red.isConst = calloc(func->vregCount, sizeof(bool));
+    red.consts = calloc(func->vregCount, sizeof(int32_t));
+    size_t *defCount = calloc(func->vregCount, sizeof(size_t));
+    if (red.isConst == NULL || red.consts == NULL || defCount == NULL)
+    {
+        abort();
+    }
+    for (size_t i = 0; i < func->size; i++)
+    {
+        IrBlock *block = func->blocks[i];
+        for (size_t j = 0; j < block->size; j++)
+        {
+            IrInstr *instr = block->instrs[j];
+            defCount[instr->dest]++;
+            if (instr->op == IR_LI)
+            {
+                red.consts[instr->dest] = instr->imm;
+            }
+        }
+    }
+    for (size_t i = 1; i < func->vregCount; i++)
+    {
+        red.isConst[i] = defCount[i] == 1 && func->vregTypes[i] == IR_I32;
+    }
+    for (size_t i = 0; i < func->size; i++)
+    {
+        IrBlock *block = func->blocks[i];
+        for (size_t j = 0; j < block->size; j++)
+        {
+            IrInstr *instr = block->instrs[j];
+            red.isConst[instr->dest] = red.isConst[instr->dest] && instr->op == IR_LI;
+        }
+    }
+
+    // every block is rebuilt with the replacement sequences in front of the instructions
+    // they replace, which become moves of the result
+    size_t longest = 0;
+    for (size_t i = 0; i < func->size; i++)
+    {
+        longest = func->blocks[i]->size > longest ? func->blocks[i]->size : longest;
+    }
+    IrInstr **instrs = malloc(sizeof(IrInstr *) * (longest + 1));
+    if (instrs == NULL)
+    {
+        abort();
+    }
+    for (size_t i = 0; i < func->size; i++)
+    {
+        IrBlock *block = func->blocks[i];
+        size_t size = block->size;
+        memcpy(instrs, block->instrs, sizeof(IrInstr *) * size);
+        block->size = 0;
+        red.block = block;
+        for (size_t j = 0; j < size; j++)
+        {
+            IrInstr *instr = instrs[j];
+            bool candidate = instr->type == IR_I32 && (instr->op == IR_MUL || instr->op == IR_DIV || instr->op == IR_DIVU ||
+                                                       instr->op == IR_REM || instr->op == IR_REMU);
+            size_t result = candidate ? reduce(&red, instr) : 0;
+            if (result != 0)
+            {
+                instr->op = IR_MOV;
+                instr->src[0] = result;
+                instr->src[1] = 0;
+            }
+            irInstrPush(func, block, instr);
+        }
+    }
+    free(instrs);
+    free(red.isConst);
+    free(red.consts);
+    free(defCount);
+}
+
+/* Value numbering */
+
+// What an instruction computes, with its operands replaced by their leaders. Constants,
+// addresses and comparisons are only shared within a block, recomputing them is as cheap as
+// keeping them live and a comparison with a single use fuses into its branch. A load also
+// names the memory state it reads.
+typedef struct ValueKey
+{
+    IrOp op;
+    IrType type;
+    IrType memType;
+    size_t src[2];
+    int32_t imm;
+    uint64_t fimm;
+    SymbolEntry *var;
+    const char *str;
+    const IrBlock *local;
+    size_t memory;
+} ValueKey;
+
+typedef struct ValueEntry
+{
+    ValueKey key;
+    size_t value; // 0 for an empty slot
+    const IrBlock *block;
+} ValueEntry;
+
+typedef struct Numbering
+{
+    IrFunc *func;
+    size_t *leader; // the register every register was replaced by, itself when it was kept
+    ValueEntry *table;
+    size_t mask;
+    size_t memories;
+    bool *phiArg; // read by a phi
+} Numbering;
+
+// A constant that a phi reads keeps a register of its own, which leaving SSA form can then
+// share with the phi, rather than tying the phi to the other readers of the constant
+static bool isNumbered(const Numbering *num, const IrInstr *instr)
+{
+    IrOp op = instr->op;
+    if (op == IR_LI || op == IR_LF)
+    {
+        return !num->phiArg[instr->dest];
+    }
+    return op == IR_LSTR || op == IR_ADDR || op == IR_CVT || op == IR_LOAD || (op >= IR_ADD && op <= IR_GEU);
+}
+
+static bool commutes(const IrOp op)
+{
+    return op == IR_ADD || op == IR_MUL || op == IR_MULH || op == IR_MULHU || op == IR_AND || op == IR_OR ||
+           op == IR_XOR || op == IR_EQ || op == IR_NE;
+}
+
+static ValueKey keyOf(const Numbering *num, const IrInstr *instr, const IrBlock *block, const size_t memory)
+{
+    ValueKey key;
+    memset(&key, 0, sizeof(key));
+    key.op = instr->op;
+    key.type = instr->type;
+    key.imm = instr->imm;
+    for (size_t i = 0; i < irSrcCount(instr); i++)
+    {
+        key.src[i] = num->leader[instr->src[i]];
+    }
+    if (commutes(key.op) && key.src[1] != 0 && key.src[0] > key.src[1])
+    {
+        size_t src = key.src[0];
+        key.src[0] = key.src[1];
+        key.src[1] = src;
+    }
+    switch (instr->op)
+    {
+    case IR_LF:
+        memcpy(&key.fimm, &instr->fimm, sizeof(key.fimm));
+        key.local = block;
+        break;
+    case IR_LI:
+    case IR_LSTR:
+    case IR_ADDR:
+        key.str = instr->str;
+        key.var = instr->var;
+        key.local = block;
+        break;
+    case IR_LOAD:
+        key.memType = instr->memType;
+        key.var = instr->var;
+        key.memory = memory;
+        break;
+    case IR_CVT:
+        // the source type picks the conversion
+        key.memType = num->func->vregTypes[instr->src[0]];
+        break;
+    default:
+        key.local = irIsComparison(instr->op) ? block : NULL;
+        break;
+    }
+    return key;
+}
+
+static bool sameKey(const ValueKey *a, const ValueKey *b)
+{
+    return a->op == b->op && a->type == b->type && a->memType == b->memType && a->src[0] == b->src[0] &&
+           a->src[1] == b->src[1] && a->imm == b->imm && a->fimm == b->fimm && a->var == b->var && a->local == b->local &&
+           a->memory == b->memory && (a->str == b->str || (a->str != NULL && b->str != NULL && strcmp(a->str, b->str) == 0));
+}
+
+static size_t hashKey(const ValueKey *key)
+{
+    uint64_t hash = 14695981039346656037ull;
+    uint64_t parts[] = {key->op, key->type, key->memType, key->src[0], key->src[1], (uint32_t)key->imm, key->fimm,
+                        (uintptr_t)key->var, (uintptr_t)key->local, key->memory};
+    for (size_t i = 0; i < sizeof(parts) / sizeof(parts[0]); i++)
+    {
+        hash = (hash ^ parts[i]) * 1099511628211ull;
+    }
+    for (const char *c = key->str; c != NULL && *c != '\0'; c++)
+    {
+        hash = (hash ^ (unsigned char)*c) * 1099511628211ull;
+    }
+    return (size_t)(hash ^ hash >> 29);
+}
+
+// The register holding the value of key in block, 0 when none does yet, which makes value
+// its holder from here on. An entry whose block does not dominate this one belongs to a
+// subtree of the dominator tree that the walk has left, so its slot is taken over.
+static size_t lookupValue(Numbering *num, const ValueKey *key, const IrBlock *block, const size_t value)
+{
+    size_t at = hashKey(key) & num->mask;
+    while (num->table[at].value != 0 && !sameKey(&num->table[at].key, key))
+    {
+        at = (at + 1) & num->mask;
+    }
+    ValueEntry *entry = &num->table[at];
+    if (entry->value != 0 && irDominates(entry->block, block))
+    {
+        return entry->value;
+    }
+    entry->key = *key;
+    entry->value = value;
+    entry->block = block;
+    return 0;
+}
+
+// a phi whose arguments are all one value, or itself around a loop
+static size_t sameArgs(const Numbering *num, const IrInstr *phi)
+{
+    size_t value = 0;
+    for (size_t i = 0; i < phi->argsSize; i++)
+    {
+        size_t arg = num->leader[phi->args[i]];
+        if (arg != phi->dest && arg != value)
+        {
+            if (value != 0)
+            {
+                return 0;
+            }
+            value = arg;
+        }
+    }
+    return value;
+}
+
+// Numbers the instructions of a block, removing those whose value a dominating instruction
+// already holds. Stores and calls start a new memory state, a full width store also makes
+// its value the one a load of the same address reads.
+static size_t numberBlock(Numbering *num, IrBlock *block, size_t memory)
+{
+    size_t kept = 0;
+    for (size_t i = 0; i < block->size; i++)
+    {
+        IrInstr *instr = block->instrs[i];
+        size_t value = 0;
+        if (instr->op == IR_MOV)
+        {
+            value = num->leader[instr->src[0]];
+        }
+        else if (instr->op == IR_PHI)
+        {
+            value = sameArgs(num, instr);
+        }
+        else if (isNumbered(num, instr))
+        {
+            ValueKey key = keyOf(num, instr, block, memory);
+            value = lookupValue(num, &key, block, instr->dest);
+        }
+        else if (instr->op == IR_STORE || instr->op == IR_CALL)
+        {
+            memory = ++num->memories;
+            size_t stored = num->leader[instr->src[0]];
+            if (instr->op == IR_STORE && instr->memType == num->func->vregTypes[stored])
+            {
+                IrInstr load = *instr;
+                load.op = IR_LOAD;
+                load.type = instr->memType;
+                load.src[0] = instr->src[1];
+                load.src[1] = 0;
+                ValueKey key = keyOf(num, &load, block, memory);
+                lookupValue(num, &key, block, stored);
+            }
+        }
+        if (value != 0)
+        {
+            num->leader[instr->dest] = value;
+            continue;
+        }
+        block->instrs[kept++] = instr;
+    }
+    block->size = kept;
+    return memory;
+}
+
+// Replaces every computation of a value that an instruction dominating it already computed
+// by that instruction's register. The blocks are numbered in preorder of the dominator tree,
+// a block keeps the memory state of its immediate dominator when that is its only
+// predecessor, otherwise another path may have stored in between.
+void irNumberValues(IrFunc *func)
+{
+    irComputeDominators(func);
+    size_t instrs = 0;
+    for (size_t i = 0; i < func->size; i++)
+    {
+        instrs += func->blocks[i]->size;
+    }
+    size_t capacity = 16;
+    while (capacity < 2 * instrs)
+    {
+        capacity *= 2;
+    }
+    Numbering num;
+    num.func = func;
+    num.leader = malloc(sizeof(size_t) * func->vregCount);
+    num.table = calloc(capacity, sizeof(ValueEntry));
+    num.mask = capacity - 1;
+    num.memories = 0;
+    IrBlock **preorder = malloc(sizeof(IrBlock *) * (func->size + 1));
+    size_t *memoryOut = calloc(func->blockIds, sizeof(size_t));
+    num.phiArg = calloc(func->vregCount, sizeof(bool));
+    if (num.leader == NULL || num.table == NULL || preorder == NULL || memoryOut == NULL || num.phiArg == NULL)
+    {
+        abort();
+    }
+    for (size_t i = 0; i < func->vregCount; i++)
+    {
+        num.leader[i] = i;
+    }
+    for (size_t i = 0; i < func->size; i++)
+    {
+        IrBlock *block = func->blocks[i];
+        preorder[block->domFirst] = block;
+        for (size_t j = 0; j < block->size && block->instrs[j]->op == IR_PHI; j++)
+        {
+            for (size_t k = 0; k < block->instrs[j]->argsSize; k++)
+            {
+                num.phiArg[block->instrs[j]->args[k]] = true;
+            }
+        }
+    }
+    for (size_t i = 0; i < func->size; i++)
+    {
+        IrBlock *block = preorder[i];
+        bool inherits = block->predsSize == 1 && block->preds[0] == block->idom;
+        size_t memory = inherits ? memoryOut[block->idom->id] : ++num.memories;
+        memoryOut[block->id] = numberBlock(&num, block, memory);
+    }
+    for (size_t i = 0; i < func->size; i++)
+    {
+        IrBlock *block = func->blocks[i];
+        for (size_t j = 0; j < block->size; j++)
+        {
+            IrInstr *instr = block->instrs[j];
+            for (size_t k = 0; k < irSrcCount(instr); k++)
+            {
+                instr->src[k] = num.leader[instr->src[k]];
+            }
+            for (size_t k = 0; k < instr->argsSize; k++)
+            {
+                instr->args[k] = num.leader[instr->args[k]];
+            }
+        }
+    }
+    free(num.leader);
+    free(num.table);
+    free(preorder);
+    free(memoryOut);
+    free(num.phiArg);
+}
+
+/* Dead code */
+
+static bool hasSideEffects(const IrInstr *instr)
+{
+    return instr->op == IR_CALL || instr->op == IR_STORE || irIsTerminator(instr->op);
+}
+
+// Removes instructions with no other effect whose result is overwritten or dropped before
+// it is read. Removing one can make the values it read dead as well, so the liveness is
+// recomputed until nothing changes.
+void irRemoveDeadCode(IrFunc *func)
+{
+    size_t *liveMark = calloc(func->vregCount, sizeof(size_t));
+    if (liveMark == NULL)
+    {
+        abort();
+    }
+    size_t stamp = 0;
+    bool changed = true;
+    while (changed)
+    {
+        changed = false;
+        IrLiveness *live = irLivenessCreate(func);
+        for (size_t i = 0; i < func->size; i++)
+        {
+            // a register is live at the current point when its mark is the block's stamp
+            IrBlock *block = func->blocks[i];
+            stamp++;
+            const uint64_t *liveOut = live->liveOut + block->id * live->words;
+            for (size_t w = 0; w < live->words; w++)
+            {
+                for (size_t b = 0; liveOut[w] != 0 && b < 64; b++)
+                {
+                    if ((liveOut[w] >> b & 1) != 0)
+                    {
+                        liveMark[live->vregs[w * 64 + b]] = stamp;
+                    }
+                }
+            }
+            for (size_t j = 0; j < block->succsSize; j++)
+            {
+                IrBlock *succ = block->succs[j];
+                for (size_t k = 0; k < succ->size && succ->instrs[k]->op == IR_PHI; k++)
+                {
+                    liveMark[succ->instrs[k]->args[block->succSlots[j]]] = stamp;
+                }
+            }
+            size_t kept = block->size;
+            for (size_t j = block->size; j-- > 0;)
+            {
+                IrInstr *instr = block->instrs[j];
+                if (!hasSideEffects(instr) && instr->dest != 0 && liveMark[instr->dest] != stamp)
+                {
+                    changed = true;
+                    continue;
+                }
+                block->instrs[--kept] = instr;
+                liveMark[instr->dest] = 0;
+                for (size_t k = 0; k < irUseCount(instr); k++)
+                {
+                    liveMark[irUse(instr, k)] = stamp;
+                }
+            }
+            memmove(block->instrs, block->instrs + kept, sizeof(IrInstr *) * (block->size - kept));
+            block->size = block->size - kept;
+        }
+        irLivenessDestroy(live);
+    }
+    free(liveMark);
+}
+
+/* Branch fusion */
+
+// Moves a comparison whose only use is the branch ending its block into the branch, which
+// the selector turns into a single compare and branch instruction. This runs after the
+// other passes, which expect a branch to test a register.
+void irFuseBranches(IrFunc *func)
+{
+    size_t *useCount = calloc(func->vregCount, sizeof(size_t));
+    if (useCount == NULL)
+    {
+        abort();
+    }
+    for (size_t i = 0; i < func->size; i++)
+    {
+        IrBlock *block = func->blocks[i];
+        for (size_t j = 0; j < block->size; j++)
+        {
+            for (size_t k = 0; k < irUseCount(block->instrs[j]); k++)
+            {
+                useCount[irUse(block->instrs[j], k)]++;
+            }
+        }
+    }
+
+    for (size_t i = 0; i < func->size; i++)
+    {
+        IrBlock *block = func->blocks[i];
+        IrInstr *term = irTerminator(block);
+        if (term->op != IR_BR || term->cond != IR_BOOL || useCount[term->src[0]] != 1)
+        {
+            continue;
+        }
+        size_t def = block->size - 1;
+        while (def-- > 0 && block->instrs[def]->dest != term->src[0])
+        {
+        }
+        if (def == SIZE_MAX || !irIsComparison(block->instrs[def]->op))
+        {
+            continue;
+        }
+        // the comparison's operands must still hold the compared values at the branch
+        IrInstr *compare = block->instrs[def];
+        bool clobbered = false;
+        for (size_t j = def + 1; j < block->size - 1; j++)
+        {
+            size_t dest = block->instrs[j]->dest;
+            clobbered |= dest != 0 && (dest == compare->src[0] || dest == compare->src[1]);
+        }
+        if (clobbered)
+        {
+            continue;
+        }
+        term->cond = compare->op;
+        term->src[0] = compare->src[0];
+        term->src[1] = compare->src[1];
+        memmove(block->instrs + def, block->instrs + def + 1, sizeof(IrInstr *) * (block->size - def - 1));
+        block->size--;
+    }
+    free(useCount);
+}
+
+/* Immediate operands */
+
+#define MIN_IMMEDIATE -2048
+#define MAX_IMMEDIATE 2047
+
+typedef struct Immediates
+{
+    IrFunc *func;
+    IrInstr **defs; // the defining instruction of registers written once
+    IrBlock **defBlock;
+    size_t *defIndex; // position of the latest definition seen by the walk
+} Immediates;
+
+static bool fitsImmediate(const int64_t value)
+{
+    return value >= MIN_IMMEDIATE && value <= MAX_IMMEDIATE;
+}
+
+static bool constOf(const Immediates *imms, const size_t vreg, int32_t *value)
+{
+    IrInstr *def = imms->defs[vreg];
+    if (vreg == 0 || def == NULL || def->op != IR_LI || def->type != IR_I32)
+    {
+        return false;
+    }
+    *value = def->imm;
+    return true;
+}
+
+// comparison with its operands exchanged
+static IrOp swapComparison(const IrOp op)
+{
+    switch (op)
+    {
+    case IR_LT:
+        return IR_GT;
+    case IR_LE:
+        return IR_GE;
+    case IR_GT:
+        return IR_LT;
+    case IR_GE:
+        return IR_LE;
+    case IR_LTU:
+        return IR_GTU;
+    case IR_LEU:
+        return IR_GEU;
+    case IR_GTU:
+        return IR_LTU;
+    case IR_GEU:
+        return IR_LEU;
+    default:
+        return op;
+    }
+}
+
+// Rewrites op with constant right operand c into an equivalent that has an immediate instruction,
+// a subtract becomes an add of -c and x <= c becomes x < c + 1. Only comparisons with zero are left
+// for the rest, they read the zero register.
+static bool immediateForm(IrOp *op, int32_t *c)
+{
+    switch (*op)
+    {
+    case IR_SUB:
+        if (!fitsImmediate(-(int64_t)*c))
+        {
+            return false;
+        }
+        *op = IR_ADD;
+        *c = -*c;
+        return true;
+    case IR_ADD:
+    case IR_AND:
+    case IR_OR:
+    case IR_XOR:
+    case IR_LT:
+    case IR_GE:
+        return fitsImmediate(*c);
+    case IR_LTU:
+    case IR_GEU:
+        // sltiu sign extends its immediate before the unsigned comparison
+        return fitsImmediate(*c);
+    case IR_EQ:
+    case IR_NE:
+        // compared by adding -c and testing against zero
+        return fitsImmediate(-(int64_t)*c);
+    case IR_SHL:
+    case IR_SHR:
+    case IR_SAR:
+        return *c >= 0 && *c < 32;
+    case IR_LE:
+    case IR_GT:
+        if (*c == 0)
+        {
+            return true;
+        }
+        if (!fitsImmediate((int64_t)*c + 1))
+        {
+            return false;
+        }
+        *op = *op == IR_LE ? IR_LT : IR_GE;
+        *c += 1;
+        return true;
+    case IR_LEU:
+    case IR_GTU:
+        // x <= 0xffffffff always holds and has no strict form
+        if (*c == 0)
+        {
+            return true;
+        }
+        if (*c == -1 || !fitsImmediate((int64_t)*c + 1))
+        {
+            return false;
+        }
+        *op = *op == IR_LEU ? IR_LTU : IR_GEU;
+        *c += 1;
+        return true;
+    default:
+        return false;
+    }
+}
+
+static bool isCommutative(const IrOp op)
+{
+    return op == IR_ADD || op == IR_AND || op == IR_OR || op == IR_XOR || irIsComparison(op);
+}
+
+// Moves a constant right operand of an I32 operation into imm. A constant on the left of a
+// commutative operation or a comparison is swapped over first.
+static void selectOperand(const Immediates *imms, IrInstr *instr)
+{
+    int32_t c;
+    if (instr->src[1] == 0 || imms->func->vregTypes[instr->src[0]] != IR_I32)
+    {
+        return;
+    }
+    if (isCommutative(instr->op) && constOf(imms, instr->src[0], &c) && !constOf(imms, instr->src[1], &c))
+    {
+        size_t src = instr->src[0];
+        instr->src[0] = instr->src[1];
+        instr->src[1] = src;
+        instr->op = swapComparison(instr->op);
+    }
+    IrOp op = instr->op;
+    if (constOf(imms, instr->src[1], &c) && immediateForm(&op, &c))
+    {
+        // adding, or'ing, xor'ing or shifting by zero leaves the left operand
+        bool identity = c == 0 && !irIsComparison(op) && op != IR_AND;
+        instr->op = identity ? IR_MOV : op;
+        instr->src[1] = 0;
+        instr->imm = identity ? 0 : c;
+    }
+}
+
+// Branches only compare against the zero register, they have no immediate forms
+static void selectBranchOperand(const Immediates *imms, IrInstr *term)
+{
+    int32_t c;
+    if (imms->func->vregTypes[term->src[0]] != IR_I32)
+    {
+        return;
+    }
+    if (constOf(imms, term->src[0], &c) && c == 0 && !constOf(imms, term->src[1], &c))
+    {
+        term->src[0] = term->src[1];
+        term->src[1] = 0;
+        term->cond = swapComparison(term->cond);
+    }
+    else if (constOf(imms, term->src[1], &c) && c == 0)
+    {
+        term->src[1] = 0;
+    }
+}
+
+// Splits an address computed by an add of a constant, or a move, into its base and offset
+static bool splitAddress(const Immediates *imms, IrInstr *add, size_t *base, int32_t *offset)
+{
+    if (add != NULL && add->op == IR_MOV && add->type == IR_I32)
+    {
+        *base = add->src[0];
+        *offset = 0;
+        return true;
+    }
+    if (add == NULL || add->op != IR_ADD || add->type != IR_I32)
+    {
+        return false;
+    }
+    if (add->src[1] == 0)
+    {
+        *base = add->src[0];
+        *offset = add->imm;
+        return true;
+    }
+    for (size_t i = 0; i < 2; i++)
+    {
+        if (constOf(imms, add->src[i], offset))
+        {
+            *base = add->src[1 - i];
+            return true;
+        }
+    }
+    return false;
+}
+
+// Addresses a load or store through the variable or register an address was computed from,
+// moving the constant part of the computation into the access offset. A base register must
+// still hold its value at the access, so the add has to precede the access in the same block
+// with no write of the base in between.
+static void selectAddressing(const Immediates *imms, IrBlock *block, IrInstr *instr)
+{
+    size_t *address = &instr->src[instr->op == IR_LOAD ? 0 : 1];
+    IrInstr *def = imms->defs[*address];
+    size_t base;
+    int32_t offset;
+    if (instr->var != NULL || def == NULL)
+    {
+        return;
+    }
+    if (def->op == IR_ADDR)
+    {
+        instr->var = def->var;
+        *address = 0;
+        return;
+    }
+    if (!splitAddress(imms, def, &base, &offset) || (int64_t)instr->imm + offset > INT32_MAX ||
+        (int64_t)instr->imm + offset < INT32_MIN)
+    {
+        return;
+    }
+    IrInstr *baseDef = imms->defs[base];
+    if (baseDef != NULL && baseDef->op == IR_ADDR)
+    {
+        instr->var = baseDef->var;
+        instr->imm += offset;
+        *address = 0;
+        return;
+    }
+    bool stable = imms->defBlock[*address] == block &&
+                  (imms->defBlock[base] != block || imms->defIndex[base] < imms->defIndex[*address]);
+    if (stable && fitsImmediate((int64_t)instr->imm + offset))
+    {
+        instr->imm += offset;
+        *address = base;
+    }
+}
+
+void irSelectImmediates(IrFunc *func)
+{
+    Immediates imms;
+    imms.func = func;
+    imms.defs = calloc(func->vregCount, sizeof(IrInstr *));
+    imms.defBlock = calloc(func->vregCount, sizeof(IrBlock *));
+    imms.defIndex = calloc(func->vregCount, sizeof(size_t));
+    size_t *defCount = calloc(func->vregCount, sizeof(size_t));
+    if (imms.defs == NULL || imms.defBlock == NULL || imms.defIndex == NULL || defCount == NULL)
+    {
+        abort();
+    }
+    for (size_t i = 0; i < func->size; i++)
+    {
+        IrBlock *block = func->blocks[i];
+        for (size_t j = 0; j < block->size; j++)
+        {
+            IrInstr *instr = block->instrs[j];
+            defCount[instr->dest]++;
+            imms.defs[instr->dest] = instr;
+        }
+    }
+    for (size_t i = 0; i < func->vregCount; i++)
+    {
+        imms.defs[i] = i != 0 && defCount[i] == 1 ? imms.defs[i] : NULL;
+    }
+
+    for (size_t i = 0; i < func->size; i++)
+    {
+        IrBlock *block = func->blocks[i];
+        for (size_t j = 0; j < block->size; j++)
+        {
+            IrInstr *instr = block->instrs[j];
+            if (instr->op == IR_BR && instr->cond != IR_BOOL)
+            {
+                selectBranchOperand(&imms, instr);
+            }
+            else if (instr->op == IR_LOAD || instr->op == IR_STORE)
+            {
+                selectAddressing(&imms, block, instr);
+            }
+            else if (instr->op >= IR_ADD && instr->op <= IR_GEU)
+            {
+                selectOperand(&imms, instr);
+            }
+            imms.defBlock[instr->dest] = block;
+            imms.defIndex[instr->dest] = j;
+        }
+    }
+    free(imms.defs);
+    free(imms.defBlock);
+    free(imms.defIndex);
+    free(defCount);
+}
+
+/* Loop-invariant code motion */
+
+// A natural loop, the blocks that reach one of the header's back edges without passing
+// through the header
+typedef struct Loop
+{
+    IrBlock *header;
+    size_t start; // body blocks in the shared list, the header first
+    size_t size;
+} Loop;
+
+typedef struct LoopNest
+{
+    Loop *loops;
+    size_t size;
+    IrBlock **bodies;
+    size_t bodiesSize;
+    size_t bodiesCapacity;
+} LoopNest;
+
+static void bodyPush(LoopNest *nest, IrBlock *block)
+{
+    if (nest->bodiesSize == nest->bodiesCapacity)
+    {
+        nest->bodiesCapacity = nest->bodiesCapacity == 0 ? 64 : nest->bodiesCapacity * 2;
+        nest->bodies = realloc(nest->bodies, sizeof(IrBlock *) * nest->bodiesCapacity);
+        if (nest->bodies == NULL)
+        {
+            abort();
+        }
+    }
+    nest->bodies[nest->bodiesSize++] = block;
+}
+
+static int loopCompare(const void *a, const void *b)
+{
+    size_t x = ((const Loop *)a)->size;
+    size_t y = ((const Loop *)b)->size;
+    return (x > y) - (x < y);
+}
+
+// Finds the loops of every header a back edge, an edge to a dominator, leads to. An inner
+// loop has fewer blocks than the loops around it, so the loops are sorted innermost first.
+static LoopNest findLoops(IrFunc *func)
+{
+    irComputeDominators(func);
+    LoopNest nest = {NULL, 0, NULL, 0, 0};
+    nest.loops = malloc(sizeof(Loop) * (func->size + 1));
+    size_t *mark = calloc(func->blockIds, sizeof(size_t)); // loop index + 1 of the last walk reaching a block
+    IrBlock **stack = malloc(sizeof(IrBlock *) * (func->size + 1));
+    if (nest.loops == NULL || mark == NULL || stack == NULL)
+    {
+        abort();
+    }
+    for (size_t i = 0; i < func->size; i++)
+    {
+        IrBlock *header = func->blocks[i];
+        bool looping = false;
+        for (size_t j = 0; j < header->predsSize && !looping; j++)
+        {
+            looping = irDominates(header, header->preds[j]);
+        }
+        if (!looping)
+        {
+            continue;
+        }
+        Loop *loop = &nest.loops[nest.size++];
+        loop->header = header;
+        loop->start = nest.bodiesSize;
+        size_t stackSize = 0;
+        mark[header->id] = nest.size;
+        bodyPush(&nest, header);
+        for (size_t j = 0; j < header->predsSize; j++)
+        {
+            IrBlock *latch = header->preds[j];
+            if (irDominates(header, latch) && mark[latch->id] != nest.size)
+            {
+                mark[latch->id] = nest.size;
+                bodyPush(&nest, latch);
+                stack[stackSize++] = latch;
+            }
+        }
+        while (stackSize > 0)
+        {
+            IrBlock *block = stack[--stackSize];
+            for (size_t j = 0; j < block->predsSize; j++)
+            {
+                IrBlock *pred = block->preds[j];
+                if (mark[pred->id] != nest.size)
+                {
+                    mark[pred->id] = nest.size;
+                    bodyPush(&nest, pred);
+                    stack[stackSize++] = pred;
+                }
+            }
+        }
+        loop->size = nest.bodiesSize - loop->start;
+    }
+    free(mark);
+    free(stack);
+    qsort(nest.loops, nest.size, sizeof(Loop), loopCompare);
+    return nest;
+}
+
+static void retarget(IrInstr *term, IrBlock *from, IrBlock *to)
+{
+    for (size_t i = 0; i < 2; i++)
+    {
+        term->targets[i] = term->targets[i] == from ? to : term->targets[i];
+    }
+    for (size_t i = 0; i < term->casesSize; i++)
+    {
+        term->cases[i].target = term->cases[i].target == from ? to : term->cases[i].target;
+    }
+}
+
+// The block control enters a loop from, when it is the only way in and leads nowhere else
+static IrBlock *preheaderOf(const Loop *loop, const size_t *mark, const size_t stamp)
+{
+    IrBlock *header = loop->header;
+    IrBlock *outside = NULL;
+    for (size_t i = 0; i < header->predsSize; i++)
+    {
+        if (mark[header->preds[i]->id] != stamp)
+        {
+            if (outside != NULL)
+            {
+                return NULL;
+            }
+            outside = header->preds[i];
+        }
+    }
+    return outside != NULL && outside->succsSize == 1 ? outside : NULL;
+}
+
+// Routes the edges entering a loop from outside through a new block, which the phis of the
+// header take the outside values from. The entry block has no room in front of it and keeps
+// its loops as they are.
+static IrBlock *addPreheader(IrFunc *func, const Loop *loop, const size_t *mark, const size_t stamp)
+{
+    IrBlock *header = loop->header;
+    if (header == func->blocks[0] || preheaderOf(loop, mark, stamp) != NULL)
+    {
+        return NULL;
+    }
+    IrBlock *pre = irBlockCreate(func);
+    for (size_t i = 0; i < header->size && header->instrs[i]->op == IR_PHI; i++)
+    {
+        IrInstr *phi = header->instrs[i];
+        IrInstr *outer = irInstrCreate(func, IR_PHI);
+        outer->type = phi->type;
+        outer->dest = irVregCreate(func, phi->type);
+        size_t kept = 0;
+        for (size_t k = 0; k < phi->argsSize; k++)
+        {
+            if (mark[phi->phiPreds[k]->id] != stamp)
+            {
+                irPhiPush(func, outer, phi->args[k], phi->phiPreds[k]);
+                continue;
+            }
+            phi->args[kept] = phi->args[k];
+            phi->phiPreds[kept++] = phi->phiPreds[k];
+        }
+        phi->argsSize = kept;
+        irPhiPush(func, phi, outer->dest, pre);
+        irInstrPush(func, pre, outer);
+    }
+    IrInstr *jump = irInstrCreate(func, IR_JMP);
+    jump->targets[0] = header;
+    irInstrPush(func, pre, jump);
+    for (size_t i = 0; i < header->predsSize; i++)
+    {
+        if (mark[header->preds[i]->id] != stamp)
+        {
+            retarget(irTerminator(header->preds[i]), header, pre);
+        }
+    }
+    return pre;
+}
+
+static int orderCompare(const void *a, const void *b)
+{
+    size_t x = (*(IrBlock *const *)a)->order;
+    size_t y = (*(IrBlock *const *)b)->order;
+    return (x > y) - (x < y);
+}
+
+// Registers the allocator has for values living across a loop, less a few for the values
+// the body computes, and the callee-saved ones left when the loop makes calls
+#define LOOP_INT_REGS 12
+#define LOOP_INT_REGS_ACROSS_CALLS 7
+#define LOOP_FLOAT_REGS 18
+#define LOOP_FLOAT_REGS_ACROSS_CALLS 10
+
+typedef struct Hoisting
+{
+    IrFunc *func;
+    IrLiveness *live;
+    IrBlock **defBlock; // by register
+    IrInstr **defs;
+    bool *read;      // by register, the constants irSelectImmediates folded are no longer
+    bool *invariant; // by register, for the loop at hand
+    bool *crosses;   // invariant and read by the rest of the loop, so held across it once hoisted
+    bool *chosen;
+    size_t *mark; // loop index + 1 of the innermost loop holding a block
+} Hoisting;
+
+// Anything free of side effects can run before the loop: no RISC-V arithmetic traps, so an
+// operation from a path the loop may not take is safe to compute once up front. Loads wait
+// for alias information.
+static bool isInvariant(Hoisting *hoist, const IrInstr *instr, const size_t stamp)
+{
+    switch (instr->op)
+    {
+    case IR_PARAM:
+    case IR_PHI:
+    case IR_LOAD:
+    case IR_STORE:
+    case IR_CALL:
+        return false;
+    default:
+        break;
+    }
+    if (irIsTerminator(instr->op) || !hoist->read[instr->dest])
+    {
+        return false;
+    }
+    for (size_t i = 0; i < irUseCount(instr); i++)
+    {
+        size_t use = irUse(instr, i);
+        IrBlock *def = hoist->defBlock[use];
+        if (def != NULL && hoist->mark[def->id] == stamp && !hoist->invariant[use])
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Chooses an invariant register for hoisting along with the invariant registers it is
+// computed from
+static void chooseHoist(Hoisting *hoist, const size_t vreg, size_t *pressure)
+{
+    if (!hoist->invariant[vreg] || hoist->chosen[vreg])
+    {
+        return;
+    }
+    hoist->chosen[vreg] = true;
+    pressure[irIsFloatType(hoist->func->vregTypes[vreg])] += hoist->crosses[vreg];
+    for (size_t i = 0; i < irUseCount(hoist->defs[vreg]); i++)
+    {
+        chooseHoist(hoist, irUse(hoist->defs[vreg], i), pressure);
+    }
+}
+
+// Counts the integer and floating point values live across a loop, its header's phis and
+// what is live into the header, and the registers the allocator has for them
+static void loopPressure(IrFunc *func, IrLiveness *live, IrBlock **body, const size_t size, size_t *pressure, size_t *budget)
+{
+    IrBlock *header = body[0];
+    bool calls = false;
+    for (size_t i = 0; i < size; i++)
+    {
+        for (size_t j = 0; j < body[i]->size; j++)
+        {
+            calls |= body[i]->instrs[j]->op == IR_CALL;
+        }
+    }
+    pressure[0] = 0;
+    pressure[1] = 0;
+    for (size_t i = 0; i < header->size && header->instrs[i]->op == IR_PHI; i++)
+    {
+        pressure[irIsFloatType(header->instrs[i]->type)]++;
+    }
+    for (size_t i = 0; i < live->size; i++)
+    {
+        if (irLiveIn(live, header, live->vregs[i]))
+        {
+            pressure[irIsFloatType(func->vregTypes[live->vregs[i]])]++;
+        }
+    }
+    budget[0] = calls ? LOOP_INT_REGS_ACROSS_CALLS : LOOP_INT_REGS;
+    budget[1] = calls ? LOOP_FLOAT_REGS_ACROSS_CALLS : LOOP_FLOAT_REGS;
+}
+
+// Moves the invariant instructions of a loop to the end of its preheader. Only the values the
+// rest of the loop reads stay in registers across it, and they are taken in order while
+// registers are left for them, each with the chain of invariant instructions computing it.
+static void hoistLoop(Hoisting *hoist, IrBlock **body, const size_t size, const size_t stamp, IrBlock *pre)
+{
+    IrFunc *func = hoist->func;
+    size_t pressure[2];
+    size_t budget[2];
+    loopPressure(func, hoist->live, body, size, pressure, budget);
+    size_t instrs = 0;
+    for (size_t i = 0; i < size; i++)
+    {
+        instrs += body[i]->size;
+    }
+
+    // reverse postorder sees the writes of an instruction's operands before it
+    qsort(body, size, sizeof(IrBlock *), orderCompare);
+    size_t *found = malloc(sizeof(size_t) * (instrs + 1));
+    if (found == NULL)
+    {
+        abort();
+    }
+    size_t foundSize = 0;
+    for (size_t i = 0; i < size; i++)
+    {
+        for (size_t j = 0; j < body[i]->size; j++)
+        {
+            IrInstr *instr = body[i]->instrs[j];
+            if (isInvariant(hoist, instr, stamp))
+            {
+                hoist->invariant[instr->dest] = true;
+                found[foundSize++] = instr->dest;
+            }
+        }
+    }
+    for (size_t i = 0; i < size; i++)
+    {
+        for (size_t j = 0; j < body[i]->size; j++)
+        {
+            IrInstr *instr = body[i]->instrs[j];
+            for (size_t k = 0; !hoist->invariant[instr->dest] && k < irUseCount(instr); k++)
+            {
+                hoist->crosses[irUse(instr, k)] = hoist->invariant[irUse(instr, k)];
+            }
+        }
+    }
+    for (size_t i = 0; i < foundSize; i++)
+    {
+        size_t vreg = found[i];
+        if (hoist->crosses[vreg] && pressure[irIsFloatType(func->vregTypes[vreg])] < budget[irIsFloatType(func->vregTypes[vreg])])
+        {
+            chooseHoist(hoist, vreg, pressure);
+        }
+    }
+
+    for (size_t i = 0; i < size; i++)
+    {
+        IrBlock *block = body[i];
+        size_t kept = 0;
+        for (size_t j = 0; j < block->size; j++)
+        {
+            IrInstr *instr = block->instrs[j];
+            if (!hoist->chosen[instr->dest])
+            {
+                block->instrs[kept++] = instr;
+                continue;
+            }
+            irInstrInsert(func, pre, pre->size - 1, instr);
+            hoist->defBlock[instr->dest] = pre;
+        }
+        block->size = kept;
+    }
+    for (size_t i = 0; i < foundSize; i++)
+    {
+        hoist->invariant[found[i]] = false;
+        hoist->crosses[found[i]] = false;
+        hoist->chosen[found[i]] = false;
+    }
+    free(found);
+}
+
+// Finds the loops, innermost first, and hoists out of each in turn, so what an inner loop
+// hoists into its preheader can leave the loop around it as well
+void irHoistInvariants(IrFunc *func)
+{
+    LoopNest nest = findLoops(func);
+    if (nest.size == 0)
+    {
+        free(nest.loops);
+        free(nest.bodies);
+        return;
+    }
+    Hoisting hoist;
+    hoist.func = func;
+    hoist.mark = calloc(func->blockIds, sizeof(size_t));
+    IrBlock **before = calloc(func->blockIds, sizeof(IrBlock *)); // new preheader by header id
+    if (hoist.mark == NULL || before == NULL)
+    {
+        abort();
+    }
+
+    // every loop gets a preheader first, placed right in front of its header, and the loops
+    // are found again around them
+    size_t oldSize = func->size;
+    for (size_t i = 0; i < nest.size; i++)
+    {
+        Loop *loop = &nest.loops[i];
+        for (size_t j = 0; j < loop->size; j++)
+        {
+            hoist.mark[nest.bodies[loop->start + j]->id] = i + 1;
+        }
+        IrBlock *pre = addPreheader(func, loop, hoist.mark, i + 1);
+        if (pre != NULL)
+        {
+            before[loop->header->id] = pre;
+            irBlockPlace(func, pre);
+        }
+    }
+    if (func->size != oldSize)
+    {
+        IrBlock **blocks = malloc(sizeof(IrBlock *) * func->size);
+        if (blocks == NULL)
+        {
+            abort();
+        }
+        size_t size = 0;
+        for (size_t i = 0; i < oldSize; i++)
+        {
+            if (before[func->blocks[i]->id] != NULL)
+            {
+                blocks[size++] = before[func->blocks[i]->id];
+            }
+            blocks[size++] = func->blocks[i];
+        }
+        memcpy(func->blocks, blocks, sizeof(IrBlock *) * size);
+        free(blocks);
+        irComputeCfg(func);
+        free(nest.loops);
+        free(nest.bodies);
+        nest = findLoops(func);
+        free(hoist.mark);
+        hoist.mark = calloc(func->blockIds, sizeof(size_t));
+        if (hoist.mark == NULL)
+        {
+            abort();
+        }
+    }
+
+    hoist.live = irLivenessCreate(func);
+    hoist.defBlock = calloc(func->vregCount, sizeof(IrBlock *));
+    hoist.defs = calloc(func->vregCount, sizeof(IrInstr *));
+    hoist.read = calloc(func->vregCount, sizeof(bool));
+    hoist.invariant = calloc(func->vregCount, sizeof(bool));
+    hoist.crosses = calloc(func->vregCount, sizeof(bool));
+    hoist.chosen = calloc(func->vregCount, sizeof(bool));
+    if (hoist.defBlock == NULL || hoist.defs == NULL || hoist.read == NULL || hoist.invariant == NULL || hoist.crosses == NULL ||
+        hoist.chosen == NULL)
+    {
+        abort();
+    }
+    for (size_t i = 0; i < func->size; i++)
+    {
+        for (size_t j = 0; j < func->blocks[i]->size; j++)
+        {
+            IrInstr *instr = func->blocks[i]->instrs[j];
+            hoist.defBlock[instr->dest] = func->blocks[i];
+            hoist.defs[instr->dest] = instr;
+            for (size_t k = 0; k < irUseCount(instr); k++)
+            {
+                hoist.read[irUse(instr, k)] = true;
+            }
+        }
+    }
+    hoist.read[0] = false;
+    for (size_t i = 0; i < nest.size; i++)
+    {
+        Loop *loop = &nest.loops[i];
+        for (size_t j = 0; j < loop->size; j++)
+        {
+            hoist.mark[nest.bodies[loop->start + j]->id] = i + 1;
+        }
+        IrBlock *pre = preheaderOf(loop, hoist.mark, i + 1);
+        if (pre != NULL)
+        {
+            hoistLoop(&hoist, nest.bodies + loop->start, loop->size, i + 1, pre);
+        }
+    }
+    irLivenessDestroy(hoist.live);
+    free(nest.loops);
+    free(nest.bodies);
+    free(hoist.mark);
+    free(hoist.defBlock);
+    free(hoist.defs);
+    free(hoist.read);
+    free(hoist.invariant);
+    free(hoist.crosses);
+    free(hoist.chosen);
+    free(before);
+}
+
+/* Induction variables */
+
+// A value that steps along with a basic induction variable iv of its loop: base + scale * iv +
+// offset, counted modulo 2^32. base is a register defined before the loop, or 0 for none.
+typedef struct Affine
+{
+    size_t iv; // the header phi of the induction variable, 0 for a value that does not step
+    uint32_t scale;
+    size_t base;
+    uint32_t offset;
+} Affine;
+
+// A phi of the header counting up or down by a constant step every time around the loop
+typedef struct BasicIv
+{
+    IrInstr *phi;
+    IrInstr *next; // the step, the phi's argument from the latch
+    uint32_t step;
+    size_t init; // the value it starts from
+    IrOp cond;       // the exit test, counter cond bound with the counter stepped
+    size_t bound;
+    bool onlyCounts; // read for nothing but addressing and an exit test it can hand over
+} BasicIv;
+
+// A new induction variable stepping through the addresses an affine value takes
+typedef struct DerivedIv
+{
+    Affine value;
+    size_t phi;
+    size_t next;
+    bool everyIteration; // addressed through by an access made in every iteration
+} DerivedIv;
+
+typedef struct Inductions
+{
+    IrFunc *func;
+    size_t vregs; // registers there were when the pass started, the arrays cover these
+    IrInstr **defs;
+    IrBlock **defBlock;
+    Affine *affine;
+    bool *candidate; // addresses about to be derived
+
+    // the instructions reading every register, by register in userStart
+    size_t *userStart;
+    IrInstr **users;
+    IrBlock **userBlocks;
+
+    size_t *mark; // loop index + 1 of the innermost loop holding a block
+    size_t stamp;
+
+    // the loop at hand
+    IrBlock *pre;
+    IrBlock *header;
+    IrBlock *latch;
+    BasicIv *ivs;
+    size_t ivsSize;
+    DerivedIv *derived;
+    size_t derivedSize;
+} Inductions;
+
+static bool inLoop(const Inductions *ind, const IrBlock *block)
+{
+    return block != NULL && ind->mark[block->id] == ind->stamp;
+}
+
+// The registers made by this pass are not covered, they are taken to vary
+static bool definedBefore(const Inductions *ind, const size_t vreg)
+{
+    return vreg != 0 && vreg < ind->vregs && ind->defBlock[vreg] != NULL && !inLoop(ind, ind->defBlock[vreg]);
+}
+
+// Register 0 is the zero register here, as in the right operand of a branch
+static bool constantOf(const Inductions *ind, const size_t vreg, uint32_t *value)
+{
+    IrInstr *def = vreg < ind->vregs ? ind->defs[vreg] : NULL;
+    if (vreg == 0)
+    {
+        *value = 0;
+        return true;
+    }
+    if (def == NULL || def->op != IR_LI || def->type != IR_I32)
+    {
+        return false;
+    }
+    *value = (uint32_t)def->imm;
+    return true;
+}
+
+// The register a value was copied from, through moves and the single argument phis that
+// preheaders start with
+static size_t copiedFrom(const Inductions *ind, size_t vreg)
+{
+    IrInstr *def = vreg < ind->vregs ? ind->defs[vreg] : NULL;
+    while (def != NULL && (def->op == IR_MOV || (def->op == IR_PHI && def->argsSize == 1)))
+    {
+        vreg = def->op == IR_MOV ? def->src[0] : def->args[0];
+        def = vreg < ind->vregs ? ind->defs[vreg] : NULL;
+    }
+    return vreg;
+}
+
+// Emits an I32 operation at the end of the preheader, src1 0 with imm for its immediate form
+static size_t emitPre(Inductions *ind, const IrOp op, const size_t src0, const size_t src1, const uint32_t imm)
+{
+    IrInstr *instr = irInstrCreate(ind->func, op);
+    instr->type = IR_I32;
+    instr->dest = irVregCreate(ind->func, IR_I32);
+    instr->src[0] = src0;
+    instr->src[1] = src1;
+    instr->imm = (int32_t)imm;
+    irInstrInsert(ind->func, ind->pre, ind->pre->size - 1, instr);
+    return instr->dest;
+}
+
+static size_t emitAddConst(Inductions *ind, const size_t vreg, const uint32_t value)
+{
+    if (vreg == 0)
+    {
+        return emitPre(ind, IR_LI, 0, 0, value);
+    }
+    if (value == 0)
+    {
+        return vreg;
+    }
+    if (fitsImmediate((int32_t)value))
+    {
+        return emitPre(ind, IR_ADD, vreg, 0, value);
+    }
+    return emitPre(ind, IR_ADD, vreg, emitPre(ind, IR_LI, 0, 0, value), 0);
+}
+
+// vreg * factor, 0 for a factor of 0 or no register
+static size_t emitScale(Inductions *ind, const size_t vreg, const uint32_t factor)
+{
+    if (vreg == 0 || factor == 0)
+    {
+        return 0;
+    }
+    if (factor == 1)
+    {
+        return vreg;
+    }
+    if (factor == UINT32_MAX)
+    {
+        return emitPre(ind, IR_NEG, vreg, 0, 0);
+    }
+    if (isPowerOfTwo(factor))
+    {
+        return emitPre(ind, IR_SHL, vreg, 0, log2Of(factor));
+    }
+    return emitPre(ind, IR_MUL, vreg, emitPre(ind, IR_LI, 0, 0, factor), 0);
+}
+
+// a + b, or a - b when subtracting, of bases that may be 0
+static size_t emitBaseSum(Inductions *ind, const size_t a, const size_t b, const bool subtract)
+{
+    if (b == 0)
+    {
+        return a;
+    }
+    if (a == 0)
+    {
+        return subtract ? emitPre(ind, IR_NEG, b, 0, 0) : b;
+    }
+    return emitPre(ind, subtract ? IR_SUB : IR_ADD, a, b, 0);
+}
+
+// The value of an affine value where its induction variable holds x, computed in the preheader
+static size_t emitValueAt(Inductions *ind, const Affine *value, const size_t x)
+{
+    uint32_t c;
+    if (constantOf(ind, x, &c))
+    {
+        return emitAddConst(ind, value->base, value->scale * c + value->offset);
+    }
+    size_t scaled = emitBaseSum(ind, emitScale(ind, x, value->scale), value->base, false);
+    return emitAddConst(ind, scaled, value->offset);
+}
+
+// An operand as an affine value, a constant or a register defined before the loop have no
+// induction variable
+static bool liftOperand(const Inductions *ind, const size_t vreg, Affine *value)
+{
+    uint32_t c;
+    Affine none = {0, 0, 0, 0};
+    *value = none;
+    if (vreg < ind->vregs && ind->affine[vreg].iv != 0)
+    {
+        *value = ind->affine[vreg];
+        return true;
+    }
+    if (vreg != 0 && constantOf(ind, vreg, &c))
+    {
+        value->offset = c;
+        return true;
+    }
+    value->base = vreg;
+    return definedBefore(ind, vreg);
+}
+
+static bool combineAffine(Inductions *ind, const Affine *a, const Affine *b, const bool subtract, Affine *result)
+{
+    if ((a->iv == 0 && b->iv == 0) || (a->iv != 0 && b->iv != 0 && a->iv != b->iv))
+    {
+        return false;
+    }
+    result->iv = a->iv != 0 ? a->iv : b->iv;
+    result->scale = subtract ? a->scale - b->scale : a->scale + b->scale;
+    result->offset = subtract ? a->offset - b->offset : a->offset + b->offset;
+    result->base = emitBaseSum(ind, a->base, b->base, subtract);
+    return true;
+}
+
+static bool scaleAffine(Inductions *ind, const Affine *a, const uint32_t factor, Affine *result)
+{
+    if (a->iv == 0)
+    {
+        return false;
+    }
+    result->iv = a->iv;
+    result->scale = a->scale * factor;
+    result->offset = a->offset * factor;
+    result->base = emitScale(ind, a->base, factor);
+    return true;
+}
+
+// Works out whether an instruction of the loop computes an affine value. The bases of the
+// values found are summed up in the preheader as they are found, the sums nothing ends up
+// reading are removed with the rest of the dead code.
+static bool affineOf(Inductions *ind, const IrInstr *instr, Affine *result)
+{
+    Affine a;
+    Affine b;
+    uint32_t c;
+    if (instr->type != IR_I32 || instr->dest == 0)
+    {
+        return false;
+    }
+    switch (instr->op)
+    {
+    case IR_MOV:
+        return liftOperand(ind, instr->src[0], result) && result->iv != 0;
+    case IR_ADD:
+    case IR_SUB:
+        if (!liftOperand(ind, instr->src[0], &a))
+        {
+            return false;
+        }
+        if (instr->src[1] == 0)
+        {
+            Affine imm = {0, 0, 0, (uint32_t)instr->imm};
+            b = imm;
+        }
+        else if (!liftOperand(ind, instr->src[1], &b))
+        {
+            return false;
+        }
+        return combineAffine(ind, &a, &b, instr->op == IR_SUB, result);
+    case IR_NEG:
+        return liftOperand(ind, instr->src[0], &a) && scaleAffine(ind, &a, UINT32_MAX, result);
+    case IR_SHL:
+        if (instr->src[1] == 0)
+        {
+            c = (uint32_t)instr->imm;
+        }
+        else if (!constantOf(ind, instr->src[1], &c))
+        {
+            return false;
+        }
+        return c < 32 && liftOperand(ind, instr->src[0], &a) && scaleAffine(ind, &a, 1u << c, result);
+    case IR_MUL:
+        for (size_t i = 0; i < 2 && instr->src[1] != 0; i++)
+        {
+            if (constantOf(ind, instr->src[1 - i], &c) && liftOperand(ind, instr->src[i], &a) && a.iv != 0)
+            {
+                return scaleAffine(ind, &a, c, result);
+            }
+        }
+        return false;
+    default:
+        return false;
+    }
+}
+
+// The register an access to memory takes its address from, 0 when it has none
+static size_t addressOf(const IrInstr *instr)
+{
+    if (instr->var != NULL)
+    {
+        return 0;
+    }
+    return instr->op == IR_LOAD ? instr->src[0] : instr->op == IR_STORE ? instr->src[1] : 0;
+}
+
+static bool addressesInLoop(const Inductions *ind, const size_t vreg)
+{
+    for (size_t i = ind->userStart[vreg]; i < ind->userStart[vreg + 1]; i++)
+    {
+        if (inLoop(ind, ind->userBlocks[i]) && addressOf(ind->users[i]) == vreg)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Notes the derived induction variable addressed through in a block every iteration passes
+static void noteAccesses(Inductions *ind, DerivedIv *derived, const size_t vreg)
+{
+    for (size_t i = ind->userStart[vreg]; i < ind->userStart[vreg + 1]; i++)
+    {
+        if (inLoop(ind, ind->userBlocks[i]) && addressOf(ind->users[i]) == vreg &&
+            irDominates(ind->userBlocks[i], ind->latch))
+        {
+            derived->everyIteration = true;
+        }
+    }
+}
+
+// Points the accesses addressed by vreg at a derived induction variable offset by delta from
+// it, when vreg is read by nothing else and the offsets still fit
+static bool readdress(Inductions *ind, DerivedIv *derived, const size_t vreg, const uint32_t delta)
+{
+    for (size_t i = ind->userStart[vreg]; i < ind->userStart[vreg + 1]; i++)
+    {
+        IrInstr *user = ind->users[i];
+        bool storesIt = user->op == IR_STORE && user->src[0] == vreg;
+        if (addressOf(user) != vreg || storesIt || !fitsImmediate((int64_t)user->imm + (int32_t)delta))
+        {
+            return false;
+        }
+    }
+    noteAccesses(ind, derived, vreg);
+    for (size_t i = ind->userStart[vreg]; i < ind->userStart[vreg + 1]; i++)
+    {
+        IrInstr *user = ind->users[i];
+        if (addressOf(user) == vreg)
+        {
+            user->src[user->op == IR_LOAD ? 0 : 1] = derived->phi;
+            user->imm += (int32_t)delta;
+        }
+    }
+    return true;
+}
+
+static void replaceEverywhere(Inductions *ind, const size_t from, const size_t to)
+{
+    for (size_t i = ind->userStart[from]; i < ind->userStart[from + 1]; i++)
+    {
+        replaceUses(ind->users[i], from, to);
+    }
+}
+
+// Starts a new induction variable at the value of an affine value in the first iteration,
+// stepping it at the end of the latch
+static DerivedIv *deriveIv(Inductions *ind, const BasicIv *iv, const Affine *value)
+{
+    IrFunc *func = ind->func;
+    IrBlock *header = ind->header;
+    DerivedIv *derived = &ind->derived[ind->derivedSize++];
+    derived->value = *value;
+    derived->everyIteration = false;
+    size_t start = emitValueAt(ind, value, iv->init);
+    uint32_t stride = value->scale * iv->step;
+
+    IrInstr *phi = irInstrCreate(func, IR_PHI);
+    phi->type = IR_I32;
+    phi->dest = irVregCreate(func, IR_I32);
+    IrInstr *next = irInstrCreate(func, IR_ADD);
+    next->type = IR_I32;
+    next->dest = irVregCreate(func, IR_I32);
+    next->src[0] = phi->dest;
+    if (fitsImmediate((int32_t)stride))
+    {
+        next->imm = (int32_t)stride;
+    }
+    else
+    {
+        next->src[1] = emitPre(ind, IR_LI, 0, 0, stride);
+    }
+    for (size_t i = 0; i < header->predsSize; i++)
+    {
+        irPhiPush(func, phi, header->preds[i] == ind->pre ? start : next->dest, header->preds[i]);
+    }
+    irInstrInsert(func, header, 0, phi);
+    irInstrInsert(func, ind->latch, ind->latch->size - 1, next);
+    derived->phi = phi->dest;
+    derived->next = next->dest;
+    return derived;
+}
+
+// Addresses the accesses through vreg with a derived induction variable, one already stepping
+// through the same addresses give or take an access offset when there is one
+static bool reduceAddress(Inductions *ind, const size_t vreg, size_t *pressure, const size_t budget)
+{
+    Affine *value = &ind->affine[vreg];
+    for (size_t i = 0; i < ind->derivedSize; i++)
+    {
+        DerivedIv *derived = &ind->derived[i];
+        if (derived->value.iv != value->iv || derived->value.scale != value->scale || derived->value.base != value->base)
+        {
+            continue;
+        }
+        if (derived->value.offset == value->offset)
+        {
+            noteAccesses(ind, derived, vreg);
+            replaceEverywhere(ind, vreg, derived->phi);
+            return true;
+        }
+        if (readdress(ind, derived, vreg, value->offset - derived->value.offset))
+        {
+            return true;
+        }
+    }
+    if (*pressure >= budget)
+    {
+        return false;
+    }
+    for (size_t i = 0; i < ind->ivsSize; i++)
+    {
+        if (ind->ivs[i].phi->dest == value->iv)
+        {
+            DerivedIv *derived = deriveIv(ind, &ind->ivs[i], value);
+            (*pressure)++;
+            noteAccesses(ind, derived, vreg);
+            replaceEverywhere(ind, vreg, derived->phi);
+            return true;
+        }
+    }
+    return false;
+}
+
+// Marks the registers whose values reach a side effect. In SSA form this also finds the phis
+// and steps that only feed each other, which the liveness based removal keeps.
+static bool *markUseful(IrFunc *func)
+{
+    IrInstr **defs = calloc(func->vregCount, sizeof(IrInstr *));
+    bool *useful = calloc(func->vregCount, sizeof(bool));
+    size_t *stack = malloc(sizeof(size_t) * func->vregCount);
+    if (defs == NULL || useful == NULL || stack == NULL)
+    {
+        abort();
+    }
+    size_t stackSize = 0;
+    for (size_t i = 0; i < func->size; i++)
+    {
+        for (size_t j = 0; j < func->blocks[i]->size; j++)
+        {
+            IrInstr *instr = func->blocks[i]->instrs[j];
+            defs[instr->dest] = instr;
+            for (size_t k = 0; hasSideEffects(instr) && k < irUseCount(instr); k++)
+            {
+                size_t use = irUse(instr, k);
+                if (!useful[use])
+                {
+                    useful[use] = true;
+                    stack[stackSize++] = use;
+                }
+            }
+        }
+    }
+    while (stackSize > 0)
+    {
+        IrInstr *def = defs[stack[--stackSize]];
+        for (size_t k = 0; def != NULL && k < irUseCount(def); k++)
+        {
+            size_t use = irUse(def, k);
+            if (!useful[use])
+            {
+                useful[use] = true;
+                stack[stackSize++] = use;
+            }
+        }
+    }
+    free(defs);
+    free(stack);
+    return useful;
+}
+
+// Whether two operands hold the same value, either register or the same constant
+static bool sameValue(const Inductions *ind, size_t a, size_t b)
+{
+    uint32_t x;
+    uint32_t y;
+    a = copiedFrom(ind, a);
+    b = copiedFrom(ind, b);
+    return a == b || (constantOf(ind, a, &x) && constantOf(ind, b, &y) && x == y);
+}
+
+// Whether the loop is only entered with its induction variable below its bound, or at most at
+// it for IR_LE, seen from constants or from the branch to the preheader testing just that
+static bool entersBelow(const Inductions *ind, const size_t init, const size_t bound, const IrOp cond)
+{
+    uint32_t a;
+    uint32_t b;
+    if (constantOf(ind, init, &a) && constantOf(ind, bound, &b))
+    {
+        return cond == IR_LT ? (int32_t)a < (int32_t)b : (int32_t)a <= (int32_t)b;
+    }
+    IrInstr *guard = ind->pre->predsSize == 1 ? irTerminator(ind->pre->preds[0]) : NULL;
+    if (guard == NULL || guard->op != IR_BR || guard->cond == IR_BOOL || guard->targets[0] != ind->pre ||
+        guard->targets[1] == ind->pre)
+    {
+        return false;
+    }
+    return (guard->cond == cond && sameValue(ind, guard->src[0], init) && sameValue(ind, guard->src[1], bound)) ||
+           (guard->cond == swapComparison(cond) && sameValue(ind, guard->src[0], bound) && sameValue(ind, guard->src[1], init));
+}
+
+// Finds the exit test a basic induction variable can hand over to a derived one. The loop has
+// to count up by one from below its bound and leave only at the test: a derived variable then
+// stays within addresses accessed in every iteration, or just past them, and compares unsigned
+// without wrapping around.
+static bool findExitTest(Inductions *ind, BasicIv *iv, IrBlock **body, const size_t size)
+{
+    IrInstr *term = irTerminator(ind->latch);
+    uint32_t c;
+    if (iv->step != 1 || term->op != IR_BR || term->cond == IR_BOOL || term->targets[0] != ind->header ||
+        inLoop(ind, term->targets[1]))
+    {
+        return false;
+    }
+    iv->cond = term->cond;
+    iv->bound = term->src[1];
+    if (term->src[1] == iv->next->dest)
+    {
+        iv->cond = swapComparison(iv->cond);
+        iv->bound = term->src[0];
+    }
+    else if (term->src[0] != iv->next->dest)
+    {
+        return false;
+    }
+    if ((iv->cond != IR_LT && iv->cond != IR_LE) || (!constantOf(ind, iv->bound, &c) && !definedBefore(ind, iv->bound)))
+    {
+        return false;
+    }
+    for (size_t i = 0; i < size; i++)
+    {
+        for (size_t j = 0; j < body[i]->succsSize; j++)
+        {
+            IrBlock *succ = body[i]->succs[j];
+            if (!inLoop(ind, succ) && (body[i] != ind->latch || succ != term->targets[1]))
+            {
+                return false;
+            }
+        }
+    }
+    iv->bound = copiedFrom(ind, iv->bound);
+    return entersBelow(ind, iv->init, iv->bound, iv->cond);
+}
+
+// Whether a basic induction variable is read for nothing but its exit test and the addresses
+// about to be derived from it, through the affine values computed from it
+static bool onlyCounts(const Inductions *ind, const BasicIv *iv, IrBlock **body, const size_t size)
+{
+    IrInstr *term = irTerminator(ind->latch);
+    for (size_t i = 0; i < size; i++)
+    {
+        for (size_t j = 0; j < body[i]->size; j++)
+        {
+            size_t vreg = body[i]->instrs[j]->dest;
+            if (vreg >= ind->vregs || ind->affine[vreg].iv != iv->phi->dest || ind->candidate[vreg])
+            {
+                continue;
+            }
+            for (size_t k = ind->userStart[vreg]; k < ind->userStart[vreg + 1]; k++)
+            {
+                size_t dest = ind->users[k]->dest;
+                bool stepping = dest != 0 && dest < ind->vregs && ind->affine[dest].iv == iv->phi->dest;
+                if (!stepping && (ind->users[k] != term || vreg != iv->next->dest))
+                {
+                    return false;
+                }
+            }
+        }
+    }
+    return true;
+}
+
+// Tests the loop exit on a derived induction variable instead of the basic one it steps with,
+// once the basic one is left with nothing else to do
+static void replaceTest(Inductions *ind, const BasicIv *iv)
+{
+    IrInstr *term = irTerminator(ind->latch);
+    DerivedIv *derived = NULL;
+    for (size_t i = 0; i < ind->derivedSize && derived == NULL; i++)
+    {
+        DerivedIv *candidate = &ind->derived[i];
+        if (candidate->value.iv == iv->phi->dest && candidate->everyIteration && (int32_t)candidate->value.scale > 0)
+        {
+            derived = candidate;
+        }
+    }
+    if (derived == NULL || !iv->onlyCounts)
+    {
+        return;
+    }
+    term->src[1] = emitValueAt(ind, &derived->value, iv->bound);
+    term->src[0] = derived->next;
+    term->cond = iv->cond == IR_LT ? IR_LTU : IR_LEU;
+}
+
+// Finds the basic induction variables of a loop with a single latch, works out the affine
+// values of the loop from them, and reduces the ones addressing memory
+static void reduceLoop(Inductions *ind, IrLiveness *live, IrBlock **body, const size_t size)
+{
+    IrFunc *func = ind->func;
+    IrBlock *header = body[0];
+    if (header->predsSize != 2)
+    {
+        return;
+    }
+    ind->header = header;
+    ind->latch = header->preds[header->preds[0] == ind->pre ? 1 : 0];
+    size_t instrs = 0;
+    for (size_t i = 0; i < size; i++)
+    {
+        instrs += body[i]->size;
+    }
+    ind->ivs = malloc(sizeof(BasicIv) * (header->size + 1));
+    ind->derived = malloc(sizeof(DerivedIv) * (instrs + 1));
+    size_t *candidates = malloc(sizeof(size_t) * (instrs + 1));
+    if (ind->ivs == NULL || ind->derived == NULL || candidates == NULL)
+    {
+        abort();
+    }
+    ind->ivsSize = 0;
+    ind->derivedSize = 0;
+    for (size_t i = 0; i < header->size && header->instrs[i]->op == IR_PHI; i++)
+    {
+        IrInstr *phi = header->instrs[i];
+        size_t next = phi->args[phi->phiPreds[0] == ind->latch ? 0 : 1];
+        IrInstr *def = next < ind->vregs ? ind->defs[next] : NULL;
+        uint32_t step;
+        if (phi->type != IR_I32 || def == NULL || (def->op != IR_ADD && def->op != IR_SUB) || def->src[0] != phi->dest)
+        {
+            continue;
+        }
+        if (def->src[1] == 0)
+        {
+            step = (uint32_t)def->imm;
+        }
+        else if (!constantOf(ind, def->src[1], &step))
+        {
+            continue;
+        }
+        BasicIv *iv = &ind->ivs[ind->ivsSize++];
+        iv->phi = phi;
+        iv->next = def;
+        iv->step = def->op == IR_SUB ? 0u - step : step;
+        iv->init = copiedFrom(ind, phi->args[phi->phiPreds[0] == ind->pre ? 0 : 1]);
+        Affine self = {phi->dest, 1, 0, 0};
+        ind->affine[phi->dest] = self;
+    }
+
+    // reverse postorder sees the writes of an instruction's operands before it, and every
+    // affine value is worked out before any register is replaced
+    qsort(body, size, sizeof(IrBlock *), orderCompare);
+    size_t candidatesSize = 0;
+    for (size_t i = 0; i < size && ind->ivsSize != 0; i++)
+    {
+        for (size_t j = 0; j < body[i]->size; j++)
+        {
+            IrInstr *instr = body[i]->instrs[j];
+            Affine value;
+            if (instr->op == IR_PHI || instr->dest >= ind->vregs || !affineOf(ind, instr, &value))
+            {
+                continue;
+            }
+            ind->affine[instr->dest] = value;
+            if ((value.scale != 1 || value.base != 0) && value.scale != 0 && addressesInLoop(ind, instr->dest))
+            {
+                candidates[candidatesSize++] = instr->dest;
+            }
+        }
+    }
+
+    // stepping a pointer in place of an add of the counter to a base only pays off when the
+    // counter goes away
+    for (size_t i = 0; i < candidatesSize; i++)
+    {
+        ind->candidate[candidates[i]] = true;
+    }
+    for (size_t i = 0; i < ind->ivsSize; i++)
+    {
+        ind->ivs[i].onlyCounts = findExitTest(ind, &ind->ivs[i], body, size) && onlyCounts(ind, &ind->ivs[i], body, size);
+    }
+    size_t pressure[2];
+    size_t budget[2];
+    loopPressure(func, live, body, size, pressure, budget);
+    for (size_t i = 0; i < candidatesSize; i++)
+    {
+        Affine *value = &ind->affine[candidates[i]];
+        ind->candidate[candidates[i]] = false;
+        for (size_t j = 0; j < ind->ivsSize; j++)
+        {
+            BasicIv *iv = &ind->ivs[j];
+            if (iv->phi->dest != value->iv)
+            {
+                continue;
+            }
+            bool reduced = (value->scale != 1 || iv->onlyCounts) && reduceAddress(ind, candidates[i], &pressure[0], budget[0]);
+            iv->onlyCounts &= reduced;
+        }
+    }
+    for (size_t i = 0; i < ind->ivsSize; i++)
+    {
+        replaceTest(ind, &ind->ivs[i]);
+    }
+
+    for (size_t i = 0; i < size; i++)
+    {
+        for (size_t j = 0; j < body[i]->size; j++)
+        {
+            size_t dest = body[i]->instrs[j]->dest;
+            if (dest < ind->vregs)
+            {
+                ind->affine[dest].iv = 0;
+            }
+        }
+    }
+    free(ind->ivs);
+    free(ind->derived);
+    free(candidates);
+}
+
+// Reduces the loops innermost first, then removes the counters and index computations left
+// without readers
+void irReduceInductions(IrFunc *func)
+{
+    LoopNest nest = findLoops(func);
+    if (nest.size == 0)
+    {
+        free(nest.loops);
+        free(nest.bodies);
+        return;
+    }
+    Inductions ind;
+    ind.func = func;
+    ind.vregs = func->vregCount;
+    ind.defs = calloc(func->vregCount, sizeof(IrInstr *));
+    ind.defBlock = calloc(func->vregCount, sizeof(IrBlock *));
+    ind.affine = calloc(func->vregCount, sizeof(Affine));
+    ind.candidate = calloc(func->vregCount, sizeof(bool));
+    ind.userStart = calloc(func->vregCount + 1, sizeof(size_t));
+    ind.mark = calloc(func->blockIds, sizeof(size_t));
+    if (ind.defs == NULL || ind.defBlock == NULL || ind.affine == NULL || ind.candidate == NULL || ind.userStart == NULL ||
+        ind.mark == NULL)
+    {
+        abort();
+    }
+    for (size_t i = 0; i < func->size; i++)
+    {
+        for (size_t j = 0; j < func->blocks[i]->size; j++)
+        {
+            IrInstr *instr = func->blocks[i]->instrs[j];
+            ind.defs[instr->dest] = instr;
+            ind.defBlock[instr->dest] = func->blocks[i];
+            for (size_t k = 0; k < irUseCount(instr); k++)
+            {
+                ind.userStart[irUse(instr, k) + 1]++;
+            }
+        }
+    }
+    ind.defs[0] = NULL;
+    ind.defBlock[0] = NULL;
+    for (size_t i = 0; i < func->vregCount; i++)
+    {
+        ind.userStart[i + 1] += ind.userStart[i];
+    }
+    size_t *fill = malloc(sizeof(size_t) * (func->vregCount + 1));
+    ind.users = malloc(sizeof(IrInstr *) * (ind.userStart[func->vregCount] + 1));
+    ind.userBlocks = malloc(sizeof(IrBlock *) * (ind.userStart[func->vregCount] + 1));
+    if (fill == NULL || ind.users == NULL || ind.userBlocks == NULL)
+    {
+        abort();
+    }
+    memcpy(fill, ind.userStart, sizeof(size_t) * (func->vregCount + 1));
+    for (size_t i = 0; i < func->size; i++)
+    {
+        for (size_t j = 0; j < func->blocks[i]->size; j++)
+        {
+            IrInstr *instr = func->blocks[i]->instrs[j];
+            for (size_t k = 0; k < irUseCount(instr); k++)
+            {
+                size_t at = fill[irUse(instr, k)]++;
+                ind.users[at] = instr;
+                ind.userBlocks[at] = func->blocks[i];
+            }
+        }
+    }
+    free(fill);
+
+    IrLiveness *live = irLivenessCreate(func);
+    for (size_t i = 0; i < nest.size; i++)
+    {
+        Loop *loop = &nest.loops[i];
+        for (size_t j = 0; j < loop->size; j++)
+        {
+            ind.mark[nest.bodies[loop->start + j]->id] = i + 1;
+        }
+        ind.stamp = i + 1;
+        ind.pre = preheaderOf(loop, ind.mark, i + 1);
+        if (ind.pre != NULL)
+        {
+            reduceLoop(&ind, live, nest.bodies + loop->start, loop->size);
+        }
+    }
+    irLivenessDestroy(live);
+
+    bool *useful = markUseful(func);
+    for (size_t i = 0; i < func->size; i++)
+    {
+        IrBlock *block = func->blocks[i];
+        size_t kept = 0;
+        for (size_t j = 0; j < block->size; j++)
+        {
+            IrInstr *instr = block->instrs[j];
+            if (hasSideEffects(instr) || instr->dest == 0 || useful[instr->dest])
+            {
+                block->instrs[kept++] = instr;
+            }
+        }
+        block->size = kept;
+    }
+    free(useful);
+    free(nest.loops);
+    free(nest.bodies);
+    free(ind.defs);
+    free(ind.defBlock);
+    free(ind.affine);
+    free(ind.candidate);
+    free(ind.userStart);
+    free(ind.users);
+    free(ind.userBlocks);
+    free(ind.mark);
+}
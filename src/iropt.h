@@ -0,0 +1,48 @@
+#ifndef IROPT_H
+#define IROPT_H
+
+#include "ir.h"
+
+// Keeps scalar locals whose address is never taken in virtual registers
+void irPromoteLocals(IrFunc *func);
+
+// Renames every write of a register written more than once and joins the values reaching a
+// block with phis, the other passes run on the result
+void irBuildSsa(IrFunc *func);
+
+// Replaces the phis by shared registers or moves, before instruction selection
+void irDestroySsa(IrFunc *func);
+
+// Forwards the moves left behind by promotion or by leaving SSA form within their block
+void irForwardCopies(IrFunc *func);
+
+// Replaces values known at compile time by constants and folds branches on them
+void irFoldConstants(IrFunc *func);
+
+// Rewrites integer multiplies, divides and remainders by constants into cheaper sequences
+void irReduceStrength(IrFunc *func);
+
+// Reuses the register of a dominating computation of the same value, loads included while no
+// store or call comes in between
+void irNumberValues(IrFunc *func);
+
+// Removes instructions whose results are never read
+void irRemoveDeadCode(IrFunc *func);
+
+// Merges comparisons into the branches that test them
+void irFuseBranches(IrFunc *func);
+
+// Moves small constant operands and constant address offsets into the instructions using them,
+// runs after the passes that expect register operands
+void irSelectImmediates(IrFunc *func);
+
+// Gives every loop a preheader and moves the computations that do not change inside the loop
+// there
+void irHoistInvariants(IrFunc *func);
+
+// Steps pointers along with the loop counters in place of the array indexing computed from
+// them, and tests the loop exit on such a pointer when the counter is left with nothing else
+// to do, after irHoistInvariants has given the loops their preheaders
+void irReduceInductions(IrFunc *func);
+
+#endif
@@ -11,6 +11,7 @@
     #include "../src/symbol.h"
 
     extern TranslationUnit* root;
+    extern ExternDeclHandler externDeclHandler;
     extern FILE *yyin;
     int yylex(void);
     void yyerror(const char *);
@@ -115,17 +116,32 @@ ROOT
         root = $1;
     }
 
+// with a handler set every declaration is passed on as soon as it is complete
+// and root stays NULL, otherwise the whole translation unit is built in root
 translation_unit
 	: external_declaration {
-        $$ = $1;
+        if(externDeclHandler != NULL)
+        {
+            externDeclHandler($1);
+            $$ = NULL;
+        }
+        else
+        {
+            $$ = $1;
+        }
     }
 	| translation_unit external_declaration{
-        for(size_t i = 0; i < $2->size; i++)
+        if(externDeclHandler != NULL)
         {
-            transUnitPush($1, $2->externDecls[i]);
+            externDeclHandler($2);
+        }
+        else
+        {
+            for(size_t i = 0; i < $2->size; i++)
+            {
+                transUnitPush($1, $2->externDecls[i]);
+            }
         }
-        free($2->externDecls);
-        free($2);
     }
 	;
 
@@ -156,9 +172,6 @@ external_declaration
                     {   
                         funcDef->args = decl->declInit->declarator->parameterList;
                     }
-                    free(decl->declInit->declarator);
-                    free(decl->declInit);
-                    free(decl);
                     ExternDecl *externDecl = externDeclCreate(true);
                     externDecl->funcDef = funcDef;
                     transUnitPush($$, externDecl);
@@ -179,7 +192,6 @@ external_declaration
             }
             
         }
-        free($1.decls);
     }
 	;
 
@@ -194,7 +206,6 @@ function_definition
                 $$->args = $2->parameterList;
         }
         $$->body = $3;
-        free($2);
 	}
 	| declarator declaration_list compound_statement
                 //TODO: Add error message "out of spec"
@@ -250,8 +261,6 @@ postfix_expression
            $$ = exprCreate(FUNC_EXPR);
            $$->function = funcExprCreate(0);
            $$->function->ident = $1->variable->ident;
-           $1->variable->ident = NULL;
-           exprDestroy($1);
         }
         else
         {
@@ -265,8 +274,6 @@ postfix_expression
            $$ = exprCreate(FUNC_EXPR);
            $$->function = $3;
            $$->function->ident = $1->variable->ident;
-           $1->variable->ident = NULL;
-           exprDestroy($1);
         }
         else
         {
@@ -335,7 +342,6 @@ unary_expression
         Expr *expr = exprCreate(CONSTANT_EXPR);
         TypeSpecList *flatList = flattenTypeSpecs($3);
         expr->constant = constantExprCreate(flatList->typeSpecs[0]->dataType, false);
-        typeSpecListDestroy(flatList);
         $$->operation->op1 = expr;
         }
 	;
@@ -524,14 +530,10 @@ assignment_expression
         if ($1->type == VARIABLE_EXPR) 
         {
             $$->assignment->ident = $1->variable->ident;
-            $1->variable->ident = NULL;
-            exprDestroy($1);
         }
         else if ($1->type == OPERATION_EXPR && $1->operation->operator == DEREF)
         {
             $$->assignment->lvalue = $1->operation->op1;
-            $1->operation->op1 = NULL;
-            exprDestroy($1);
         } else
         {
             fprintf(stderr, "Expression is not assignable, exiting..."); // TODO: Maybe add the type of the object in the error message
@@ -598,8 +600,6 @@ declaration
             decl->declInit = $2->declInits[i];
             declarationListPush(&$$, decl);
         }
-        free($2->declInits);
-        free($2);
         }
 	;
 
@@ -646,7 +646,6 @@ init_declarator
                 {
                 $$->initExpr = $3->expr;
                 }
-                free($3);
         }
 	;
 
@@ -731,8 +730,6 @@ struct_declaration_list
         {
             structDeclListPush($$, $2->structDecls[i]);
         }
-        free($2->structDecls);
-        free($2);
         }
 	;
 
@@ -846,7 +843,6 @@ direct_declarator
                 $$->ident = $1->ident;
                 $$->isParam = false;
                 $$->isFunc = true;
-                free($1);
 	}
 	;
 
@@ -1016,7 +1012,6 @@ declaration_list
         {
             declarationListPush(&$$, $2.decls[i]);
         }
-		free($2.decls);
         }
 	;
 
@@ -1109,6 +1104,7 @@ jump_statement
 %%
 
 TranslationUnit* root;
+ExternDeclHandler externDeclHandler = NULL;
 // Node *g_root;
 
 // Node *ParseAST(std::string file_name)
@@ -0,0 +1,420 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "emit.h"
+#include "peephole.h"
+
+#define MAX_OPERANDS 3
+#define MAX_FIELD 40
+
+// One line of emitted assembly. Instructions are split into their mnemonic and operands,
+// anything that does not split cleanly keeps an empty mnemonic and matches no pattern.
+typedef struct AsmLine
+{
+    const char *text; // without its newline
+    size_t len;
+    bool removed;
+    bool isLabel;
+    bool isSection; // switches the output section
+
+    char mnemonic[MAX_FIELD];
+    char operands[MAX_OPERANDS][MAX_FIELD];
+    size_t operandCount;
+    char rewritten[MAX_OPERANDS * MAX_FIELD + 16]; // text of a rewritten line
+} AsmLine;
+
+typedef struct Peephole
+{
+    AsmLine *lines;
+    size_t size;
+} Peephole;
+
+typedef struct Pattern
+{
+    const char *name;
+    bool (*apply)(Peephole *peep, size_t at); // rewrites at the live line at, if it matches
+    size_t hits;
+} Pattern;
+
+static char *pendingSection = NULL; // trailing section switch of the last rewrite
+
+static bool startsWith(const char *text, const size_t len, const char *prefix)
+{
+    size_t prefixLen = strlen(prefix);
+    return len >= prefixLen && memcmp(text, prefix, prefixLen) == 0;
+}
+
+static void parseLine(AsmLine *line)
+{
+    line->mnemonic[0] = '\0';
+    line->operandCount = 0;
+    const char *text = line->text;
+    size_t len = line->len;
+    line->isLabel = len != 0 && text[0] != '\t' && text[len - 1] == ':';
+    while (len != 0 && (*text == '\t' || *text == ' '))
+    {
+        text++;
+        len--;
+    }
+    line->isSection = startsWith(text, len, ".text") || startsWith(text, len, ".section") || startsWith(text, len, ".data");
+    if (line->isLabel || line->text[0] != '\t' || len == 0 || text[0] == '.')
+    {
+        return;
+    }
+
+    const char *end = text + len;
+    const char *c = text;
+    while (c < end && *c != ' ')
+    {
+        c++;
+    }
+    if ((size_t)(c - text) >= MAX_FIELD)
+    {
+        return;
+    }
+    memcpy(line->mnemonic, text, c - text);
+    line->mnemonic[c - text] = '\0';
+    while (c < end)
+    {
+        c++; // the space or comma before the operand
+        while (c < end && *c == ' ')
+        {
+            c++;
+        }
+        const char *start = c;
+        while (c < end && *c != ',')
+        {
+            c++;
+        }
+        if (line->operandCount == MAX_OPERANDS || (size_t)(c - start) >= MAX_FIELD)
+        {
+            line->mnemonic[0] = '\0';
+            return;
+        }
+        char *operand = line->operands[line->operandCount++];
+        memcpy(operand, start, c - start);
+        operand[c - start] = '\0';
+    }
+}
+
+static void rewriteLine(AsmLine *line, const char *mnemonic, const char *dest, const char *src)
+{
+    snprintf(line->rewritten, sizeof(line->rewritten), "\t%s %s, %s", mnemonic, dest, src);
+    line->text = line->rewritten;
+    line->len = strlen(line->rewritten);
+    parseLine(line);
+}
+
+static size_t nextLive(Peephole *peep, size_t at)
+{
+    while (++at < peep->size && peep->lines[at].removed)
+    {
+    }
+    return at < peep->size ? at : SIZE_MAX;
+}
+
+static bool isInstr(const AsmLine *line, const char *mnemonic)
+{
+    return strcmp(line->mnemonic, mnemonic) == 0;
+}
+
+// the move of a register class, named by any of its moves, loads or stores
+static const char *moveOf(const AsmLine *line)
+{
+    if (isInstr(line, "mv") || isInstr(line, "sw") || isInstr(line, "lw"))
+    {
+        return "mv";
+    }
+    if (isInstr(line, "fmv.s") || isInstr(line, "fsw") || isInstr(line, "flw"))
+    {
+        return "fmv.s";
+    }
+    if (isInstr(line, "fmv.d") || isInstr(line, "fsd") || isInstr(line, "fld"))
+    {
+        return "fmv.d";
+    }
+    return NULL;
+}
+
+static bool isMove(const AsmLine *line)
+{
+    return line->operandCount == 2 && (isInstr(line, "mv") || isInstr(line, "fmv.s") || isInstr(line, "fmv.d"));
+}
+
+/* Patterns */
+
+// mv a, a
+static bool selfMove(Peephole *peep, const size_t at)
+{
+    AsmLine *line = &peep->lines[at];
+    if (!isMove(line) || strcmp(line->operands[0], line->operands[1]) != 0)
+    {
+        return false;
+    }
+    line->removed = true;
+    return true;
+}
+
+// mv a, b then mv b, a, the second move copies what b already holds
+static bool moveBack(Peephole *peep, const size_t at)
+{
+    AsmLine *first = &peep->lines[at];
+    size_t next = nextLive(peep, at);
+    if (!isMove(first) || next == SIZE_MAX)
+    {
+        return false;
+    }
+    AsmLine *second = &peep->lines[next];
+    if (!isInstr(second, first->mnemonic) || second->operandCount != 2 ||
+        strcmp(first->operands[0], second->operands[1]) != 0 || strcmp(first->operands[1], second->operands[0]) != 0)
+    {
+        return false;
+    }
+    second->removed = true;
+    return true;
+}
+
+// sw a, x then lw b, x reloads the stored register, a move when b is another one
+static bool storeLoad(Peephole *peep, const size_t at)
+{
+    static const char *pairs[][2] = {{"sw", "lw"}, {"fsw", "flw"}, {"fsd", "fld"}};
+
+    AsmLine *store = &peep->lines[at];
+    size_t next = nextLive(peep, at);
+    if (store->operandCount < 2 || next == SIZE_MAX)
+    {
+        return false;
+    }
+    AsmLine *load = &peep->lines[next];
+    for (size_t i = 0; i < sizeof(pairs) / sizeof(pairs[0]); i++)
+    {
+        if (isInstr(store, pairs[i][0]) && isInstr(load, pairs[i][1]) && load->operandCount == 2 &&
+            strcmp(store->operands[1], load->operands[1]) == 0)
+        {
+            if (strcmp(store->operands[0], load->operands[0]) == 0)
+            {
+                load->removed = true;
+            }
+            else
+            {
+                char value[MAX_FIELD];
+                strcpy(value, store->operands[0]);
+                rewriteLine(load, moveOf(load), load->operands[0], value);
+            }
+            return true;
+        }
+    }
+    return false;
+}
+
+// li r, 1 then mul d, x, r, or li r, 0 then add, sub, or or xor d, x, r, is a move of x
+static bool identityConstant(Peephole *peep, const size_t at)
+{
+    AsmLine *li = &peep->lines[at];
+    size_t next = nextLive(peep, at);
+    if (!isInstr(li, "li") || li->operandCount != 2 || next == SIZE_MAX)
+    {
+        return false;
+    }
+    AsmLine *op = &peep->lines[next];
+    const char *reg = li->operands[0];
+    bool isOne = strcmp(li->operands[1], "1") == 0;
+    bool isZero = strcmp(li->operands[1], "0") == 0;
+    bool commutes = (isOne && isInstr(op, "mul")) || (isZero && (isInstr(op, "add") || isInstr(op, "or") || isInstr(op, "xor")));
+    if (op->operandCount != 3 || (!commutes && !(isZero && isInstr(op, "sub"))))
+    {
+        return false;
+    }
+    const char *other = NULL;
+    if (strcmp(op->operands[2], reg) == 0 && strcmp(op->operands[1], reg) != 0)
+    {
+        other = op->operands[1];
+    }
+    else if (commutes && strcmp(op->operands[1], reg) == 0 && strcmp(op->operands[2], reg) != 0)
+    {
+        other = op->operands[2];
+    }
+    if (other == NULL)
+    {
+        return false;
+    }
+    char dest[MAX_FIELD];
+    char src[MAX_FIELD];
+    strcpy(dest, op->operands[0]);
+    strcpy(src, other);
+    rewriteLine(op, "mv", dest, src);
+    return true;
+}
+
+// j to one of the labels that directly follow it
+static bool jumpToNext(Peephole *peep, const size_t at)
+{
+    AsmLine *jump = &peep->lines[at];
+    if (!isInstr(jump, "j") || jump->operandCount != 1)
+    {
+        return false;
+    }
+    size_t target = strlen(jump->operands[0]);
+    for (size_t next = nextLive(peep, at); next != SIZE_MAX && peep->lines[next].isLabel; next = nextLive(peep, next))
+    {
+        AsmLine *label = &peep->lines[next];
+        if (label->len == target + 1 && memcmp(label->text, jump->operands[0], target) == 0)
+        {
+            jump->removed = true;
+            return true;
+        }
+    }
+    return false;
+}
+
+// a section switch directly followed by another
+static bool sectionSwitch(Peephole *peep, const size_t at)
+{
+    size_t next = nextLive(peep, at);
+    if (!peep->lines[at].isSection || next == SIZE_MAX || !peep->lines[next].isSection)
+    {
+        return false;
+    }
+    peep->lines[at].removed = true;
+    return true;
+}
+
+static Pattern patterns[] = {
+    {"self move", selfMove, 0},
+    {"move back", moveBack, 0},
+    {"store load", storeLoad, 0},
+    {"identity constant", identityConstant, 0},
+    {"jump to next", jumpToNext, 0},
+    {"section switch", sectionSwitch, 0},
+};
+
+/* Driver */
+
+void peepholeBegin(void)
+{
+    emitHold();
+    if (pendingSection != NULL)
+    {
+        emitBytes(pendingSection, strlen(pendingSection));
+        free(pendingSection);
+        pendingSection = NULL;
+    }
+}
+
+// Tries every pattern at every line. A rewrite can make the line before it match, so the
+// search steps back one line after each.
+static void rewrite(Peephole *peep)
+{
+    size_t at = 0;
+    while (at < peep->size)
+    {
+        if (peep->lines[at].removed)
+        {
+            at++;
+            continue;
+        }
+        bool hit = false;
+        for (size_t i = 0; i < sizeof(patterns) / sizeof(patterns[0]) && !hit; i++)
+        {
+            hit = patterns[i].apply(peep, at);
+            patterns[i].hits += hit;
+        }
+        if (!hit)
+        {
+            at++;
+            continue;
+        }
+        while (at > 0 && peep->lines[at - 1].removed)
+        {
+            at--;
+        }
+        at = at > 0 ? at - 1 : 0;
+    }
+}
+
+void peepholeEnd(void)
+{
+    size_t len;
+    char *text = emitTakeHeld(&len);
+    if (text == NULL)
+    {
+        return;
+    }
+
+    Peephole peep = {NULL, 0};
+    for (size_t i = 0; i < len; i++)
+    {
+        peep.size += text[i] == '\n';
+    }
+    peep.lines = malloc(sizeof(AsmLine) * (peep.size + 1));
+    if (peep.lines == NULL)
+    {
+        abort();
+    }
+    size_t size = 0;
+    for (char *line = text; line < text + len;)
+    {
+        char *end = memchr(line, '\n', text + len - line);
+        end = end != NULL ? end : text + len;
+        peep.lines[size].text = line;
+        peep.lines[size].len = end - line;
+        peep.lines[size].removed = false;
+        parseLine(&peep.lines[size]);
+        size++;
+        line = end + 1;
+    }
+    peep.size = size;
+
+    rewrite(&peep);
+
+    // a trailing section switch waits for the next rewrite, whose first line may replace it
+    size_t last = peep.size;
+    while (last > 0 && peep.lines[last - 1].removed)
+    {
+        last--;
+    }
+    if (last > 0 && peep.lines[last - 1].isSection)
+    {
+        AsmLine *line = &peep.lines[last - 1];
+        pendingSection = malloc(line->len + 2);
+        if (pendingSection == NULL)
+        {
+            abort();
+        }
+        memcpy(pendingSection, line->text, line->len);
+        strcpy(pendingSection + line->len, "\n");
+        line->removed = true;
+    }
+    for (size_t i = 0; i < peep.size; i++)
+    {
+        if (!peep.lines[i].removed)
+        {
+            emitBytes(peep.lines[i].text, peep.lines[i].len);
+            emitBytes("\n", 1);
+        }
+    }
+    free(peep.lines);
+    free(text);
+}
+
+void peepholeFinish(void)
+{
+    if (pendingSection != NULL)
+    {
+        emitBytes(pendingSection, strlen(pendingSection));
+        free(pendingSection);
+        pendingSection = NULL;
+    }
+}
+
+void peepholeReport(FILE *file)
+{
+    fprintf(file, "Peephole report:\n");
+    for (size_t i = 0; i < sizeof(patterns) / sizeof(patterns[0]); i++)
+    {
+        fprintf(file, "  %-20s %zu\n", patterns[i].name, patterns[i].hits);
+    }
+}
@@ -0,0 +1,18 @@
+#ifndef PEEPHOLE_H
+#define PEEPHOLE_H
+
+#include <stdio.h>
+
+// Starts holding back the assembly emitted from here on for rewriting
+void peepholeBegin(void);
+
+// Rewrites the assembly emitted since peepholeBegin with the patterns and emits it again
+void peepholeEnd(void);
+
+// Emits what the last rewrite held back, once no more assembly follows
+void peepholeFinish(void);
+
+// Prints how often each pattern rewrote the output
+void peepholeReport(FILE *file);
+
+#endif
@@ -1,6 +1,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 
+#include "intern.h"
 #include "parser.tab.h"
 
 // Convert a token into a string representation
@@ -205,7 +206,6 @@ int main(int argc, char **argv)
         if (token == IDENTIFIER || token == STRING_LITERAL)
         {
             printf("(%s)", yylval.string);
-            free(yylval.string);
         }
         if (token == INT_CONSTANT)
         {
@@ -218,5 +218,6 @@ int main(int argc, char **argv)
         printf(" ");
     }
     printf("\n");
+    internTableDestroy();
     return EXIT_SUCCESS;
 }
@@ -3,6 +3,7 @@
 #include <stdlib.h>
 
 #include "ast.h"
+#include "intern.h"
 #include "parser.tab.h"
 #include "symbol.h"
 
@@ -631,8 +632,9 @@ int main(int argc, char **argv)
 
     SymbolTable *globalTable = populateSymbolTable(root);
     displaySymbolTable(globalTable);
-    transUnitDestroy(root);
+    astArenaRelease();
     symbolTableDestroy(globalTable);
+    internTableDestroy();
 
     if (yyin != NULL)
     {
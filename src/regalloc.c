@@ -0,0 +1,350 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "codegen.h"
+#include "ir.h"
+#include "regalloc.h"
+
+// registers in the order they are handed out. Values that live across a call prefer the
+// callee-saved registers, which calls do not clobber, the others prefer the temporaries,
+// which the prologue does not have to save.
+static const Reg intCallerSaved[] = {T0, T1, T2, T3, T4, T5};
+static const Reg intCalleeSaved[] = {S1, S2, S3, S4, S5, S6, S7, S8, S11};
+static const Reg floatCallerSaved[] = {FT0, FT1, FT2, FT3, FT4, FT5, FT6, FT7, FT8, FT9};
+static const Reg floatCalleeSaved[] = {FS0, FS1, FS2, FS3, FS4, FS5, FS6, FS7, FS8, FS9, FS10, FS11};
+
+#define POOL_SIZE(pool) (sizeof(pool) / sizeof(Reg))
+#define MAX_ACTIVE (POOL_SIZE(floatCallerSaved) + POOL_SIZE(floatCalleeSaved))
+
+bool isCallerSaved(const Reg reg)
+{
+    return (reg >= T0 && reg <= T2) || (reg >= T3 && reg <= T6) || (reg >= FT0 && reg <= FT7) || reg >= FT8;
+}
+
+static bool isFloatCalleeSaved(const Reg reg)
+{
+    return reg == FS0 || reg == FS1 || (reg >= FS2 && reg <= FS11);
+}
+
+// Positions from the first to the last at which a register may hold a live value. Instruction
+// i reads its operands at 2i and writes its result at 2i + 1, so a result can take the
+// register of an operand that dies in the same instruction.
+typedef struct Interval
+{
+    size_t vreg;
+    size_t start;
+    size_t end;
+} Interval;
+
+static int intervalCompare(const void *a, const void *b)
+{
+    const Interval *x = a;
+    const Interval *y = b;
+    if (x->start != y->start)
+    {
+        return x->start < y->start ? -1 : 1;
+    }
+    return (x->vreg > y->vreg) - (x->vreg < y->vreg);
+}
+
+static void extend(Interval *intervals, const size_t vreg, const size_t position)
+{
+    if (position < intervals[vreg].start)
+    {
+        intervals[vreg].start = position;
+    }
+    if (position > intervals[vreg].end)
+    {
+        intervals[vreg].end = position;
+    }
+}
+
+// Extends every register of a live set to a block boundary
+static void extendSet(Interval *intervals, const IrLiveness *live, const uint64_t *set, const size_t position)
+{
+    for (size_t w = 0; w < live->words; w++)
+    {
+        for (uint64_t word = set[w]; word != 0; word &= word - 1)
+        {
+            size_t bit = 0;
+            while (((word >> bit) & 1) == 0)
+            {
+                bit++;
+            }
+            extend(intervals, live->vregs[w * 64 + bit], position);
+        }
+    }
+}
+
+// Builds one interval per register over the blocks in layout order and lists the positions of
+// the calls. A register live across a block boundary covers that boundary, which makes the
+// interval span whole loops.
+static Interval *buildIntervals(IrFunc *func, IrInstr ***instrAt, size_t **calls, size_t *callCount)
+{
+    Interval *intervals = malloc(sizeof(Interval) * func->vregCount);
+    size_t instrCount = 0;
+    for (size_t i = 0; i < func->size; i++)
+    {
+        instrCount += func->blocks[i]->size;
+    }
+    *instrAt = malloc(sizeof(IrInstr *) * (instrCount + 1));
+    *calls = malloc(sizeof(size_t) * (instrCount + 1));
+    *callCount = 0;
+    if (intervals == NULL || *instrAt == NULL || *calls == NULL)
+    {
+        abort();
+    }
+    for (size_t i = 0; i < func->vregCount; i++)
+    {
+        intervals[i] = (Interval){i, SIZE_MAX, 0};
+    }
+
+    IrLiveness *live = irLivenessCreate(func);
+    size_t index = 0;
+    for (size_t i = 0; i < func->size; i++)
+    {
+        IrBlock *block = func->blocks[i];
+        extendSet(intervals, live, live->liveIn + block->id * live->words, 2 * index);
+        extendSet(intervals, live, live->liveOut + block->id * live->words, 2 * (index + block->size - 1) + 1);
+        for (size_t j = 0; j < block->size; j++, index++)
+        {
+            IrInstr *instr = block->instrs[j];
+            (*instrAt)[index] = instr;
+            if (instr->op == IR_CALL)
+            {
+                (*calls)[(*callCount)++] = index;
+            }
+            for (size_t k = 0; k < irUseCount(instr); k++)
+            {
+                extend(intervals, irUse(instr, k), 2 * index);
+            }
+            if (instr->dest != 0)
+            {
+                extend(intervals, instr->dest, 2 * index + 1);
+            }
+        }
+    }
+    irLivenessDestroy(live);
+    return intervals;
+}
+
+// Index of the first call at or after an interval's start
+static size_t firstCallFrom(const size_t *calls, const size_t callCount, const size_t start)
+{
+    size_t low = 0;
+    size_t high = callCount;
+    while (low < high)
+    {
+        size_t middle = low + (high - low) / 2;
+        if (2 * calls[middle] < start)
+        {
+            low = middle + 1;
+        }
+        else
+        {
+            high = middle;
+        }
+    }
+    return low;
+}
+
+// A value lives across call i when it is written before the call and read after it
+static bool livesAcross(const Interval *interval, const size_t call)
+{
+    return interval->start <= 2 * call && interval->end >= 2 * call + 2;
+}
+
+static bool crossesCall(const size_t *calls, const size_t callCount, const Interval *interval)
+{
+    size_t i = firstCallFrom(calls, callCount, interval->start);
+    return i < callCount && livesAcross(interval, calls[i]);
+}
+
+// A move whose source dies at the move can reuse the source's register and disappear
+static Reg moveHint(RegAlloc *alloc, IrInstr **instrAt, const Interval *interval)
+{
+    if (interval->start % 2 == 0)
+    {
+        return ZERO;
+    }
+    IrInstr *instr = instrAt[interval->start / 2];
+    if (instr->op != IR_MOV || instr->dest != interval->vreg)
+    {
+        return ZERO;
+    }
+    return alloc->regs[instr->src[0]];
+}
+
+static Reg takeFree(const bool *used, const Reg *pool, const size_t poolSize)
+{
+    for (size_t i = 0; i < poolSize; i++)
+    {
+        if (!used[pool[i]])
+        {
+            return pool[i];
+        }
+    }
+    return ZERO;
+}
+
+static Reg pickReg(const bool *used, const bool isFloat, const bool acrossCall)
+{
+    const Reg *callerSaved = isFloat ? floatCallerSaved : intCallerSaved;
+    const Reg *calleeSaved = isFloat ? floatCalleeSaved : intCalleeSaved;
+    size_t callerSavedSize = isFloat ? POOL_SIZE(floatCallerSaved) : POOL_SIZE(intCallerSaved);
+    size_t calleeSavedSize = isFloat ? POOL_SIZE(floatCalleeSaved) : POOL_SIZE(intCalleeSaved);
+    Reg reg = takeFree(used, acrossCall ? calleeSaved : callerSaved, acrossCall ? calleeSavedSize : callerSavedSize);
+    if (reg == ZERO)
+    {
+        reg = takeFree(used, acrossCall ? callerSaved : calleeSaved, acrossCall ? callerSavedSize : calleeSavedSize);
+    }
+    return reg;
+}
+
+// Linear scan allocation over live intervals. When a class runs out of registers the
+// interval that ends last is moved to a frame slot for its whole lifetime.
+RegAlloc *regAllocCreate(IrFunc *func, const size_t frameSize)
+{
+    RegAlloc *alloc = malloc(sizeof(RegAlloc));
+    if (alloc == NULL)
+    {
+        abort();
+    }
+    alloc->regs = calloc(func->vregCount, sizeof(Reg));
+    alloc->spillOffsets = calloc(func->vregCount, sizeof(size_t));
+    if (alloc->regs == NULL || alloc->spillOffsets == NULL)
+    {
+        abort();
+    }
+
+    IrInstr **instrAt;
+    size_t *calls;
+    size_t callCount;
+    Interval *intervals = buildIntervals(func, &instrAt, &calls, &callCount);
+    size_t size = 0;
+    for (size_t i = 1; i < func->vregCount; i++)
+    {
+        if (intervals[i].start != SIZE_MAX)
+        {
+            intervals[size++] = intervals[i];
+        }
+    }
+    qsort(intervals, size, sizeof(Interval), intervalCompare);
+
+    // spill slots and callee-saved float registers are 8 byte aligned and sit below the locals
+    size_t slotBase = (frameSize + 7) & ~(size_t)7;
+    size_t slotCount = 0;
+
+    bool used[64] = {0};
+    bool *assigned = alloc->usedRegs;
+    memset(assigned, 0, sizeof(alloc->usedRegs));
+    Interval active[2][MAX_ACTIVE];
+    size_t activeSize[2] = {0, 0};
+    for (size_t i = 0; i < size; i++)
+    {
+        Interval *current = &intervals[i];
+        bool isFloat = irIsFloatType(func->vregTypes[current->vreg]);
+        bool acrossCall = crossesCall(calls, callCount, current);
+        Interval *classActive = active[isFloat];
+        size_t *classActiveSize = &activeSize[isFloat];
+
+        size_t kept = 0;
+        for (size_t j = 0; j < *classActiveSize; j++)
+        {
+            if (classActive[j].end < current->start)
+            {
+                used[alloc->regs[classActive[j].vreg]] = false;
+            }
+            else
+            {
+                classActive[kept++] = classActive[j];
+            }
+        }
+        *classActiveSize = kept;
+
+        Reg reg = moveHint(alloc, instrAt, current);
+        if (reg == ZERO || used[reg] || (acrossCall && isCallerSaved(reg)))
+        {
+            reg = pickReg(used, isFloat, acrossCall);
+        }
+        if (reg != ZERO)
+        {
+            used[reg] = true;
+            assigned[reg] = true;
+            alloc->regs[current->vreg] = reg;
+            classActive[(*classActiveSize)++] = *current;
+            continue;
+        }
+
+        size_t furthest = 0;
+        for (size_t j = 1; j < *classActiveSize; j++)
+        {
+            if (classActive[j].end > classActive[furthest].end)
+            {
+                furthest = j;
+            }
+        }
+        size_t spilled = current->vreg;
+        if (classActive[furthest].end > current->end)
+        {
+            spilled = classActive[furthest].vreg;
+            alloc->regs[current->vreg] = alloc->regs[spilled];
+            classActive[furthest] = *current;
+        }
+        alloc->regs[spilled] = ZERO;
+        alloc->spillOffsets[spilled] = slotBase + 8 * ++slotCount;
+        if (isFloat)
+        {
+            assigned[FLOAT_SPILL_REG_0] = assigned[FLOAT_SPILL_REG_1] = true;
+        }
+        else
+        {
+            assigned[INT_SPILL_REG_0] = assigned[INT_SPILL_REG_1] = true;
+        }
+    }
+
+    for (size_t i = 0; i < 64; i++)
+    {
+        alloc->saveOffsets[i] = 0;
+        if (assigned[i] && isFloatCalleeSaved(i))
+        {
+            alloc->saveOffsets[i] = slotBase + 8 * ++slotCount;
+        }
+    }
+    alloc->frameSize = slotCount == 0 ? frameSize : slotBase + 8 * slotCount;
+
+    // the caller-saved registers holding a value across a call are saved around it
+    alloc->callCount = callCount;
+    alloc->callSaves = calloc(callCount + 1, sizeof(uint64_t));
+    if (alloc->callSaves == NULL)
+    {
+        abort();
+    }
+    for (size_t i = 0; i < size; i++)
+    {
+        Reg reg = alloc->regs[intervals[i].vreg];
+        if (reg == ZERO || !isCallerSaved(reg))
+        {
+            continue;
+        }
+        for (size_t j = firstCallFrom(calls, callCount, intervals[i].start); j < callCount && 2 * calls[j] + 2 <= intervals[i].end; j++)
+        {
+            alloc->callSaves[j] |= (uint64_t)1 << reg;
+        }
+    }
+
+    free(intervals);
+    free(instrAt);
+    free(calls);
+    return alloc;
+}
+
+void regAllocDestroy(RegAlloc *alloc)
+{
+    free(alloc->regs);
+    free(alloc->spillOffsets);
+    free(alloc->callSaves);
+    free(alloc);
+}
@@ -0,0 +1,47 @@
+#ifndef REGALLOC_H
+#define REGALLOC_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "codegen.h"
+#include "ir.h"
+
+// Location of every virtual register, either a physical register or a frame slot
+typedef struct RegAlloc
+{
+    Reg *regs;            // ZERO for spilled and unused registers
+    size_t *spillOffsets; // offset of the slot of a spilled register like a local's, 0 otherwise
+    size_t frameSize;     // bytes of the locals and the spill slots
+
+    // bit r is set when caller-saved register r holds a value across the call, one mask
+    // per call in layout order
+    uint64_t *callSaves;
+    size_t callCount;
+
+    // registers that hold some value, including the spill registers when anything is spilled
+    bool usedRegs[64];
+
+    // offset like a local's where the prologue saves a callee-saved float register, 0 if unused
+    size_t saveOffsets[64];
+} RegAlloc;
+
+// the selector's own temporary for addresses and constants, never assigned to a value
+#define SCRATCH_REG T6
+
+// registers kept out of allocation so that spilled values can be reloaded into them
+#define INT_SPILL_REG_0 S9
+#define INT_SPILL_REG_1 S10
+#define FLOAT_SPILL_REG_0 FT10
+#define FLOAT_SPILL_REG_1 FT11
+
+// a switch reads a single operand, which leaves the second spill register free to hold the
+// address of its jump table
+#define SWITCH_TABLE_REG INT_SPILL_REG_1
+
+bool isCallerSaved(Reg reg);
+
+RegAlloc *regAllocCreate(IrFunc *func, size_t frameSize);
+void regAllocDestroy(RegAlloc *alloc);
+
+#endif
@@ -0,0 +1,143 @@
+// clock_gettime and getrusage are POSIX, not C18
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <sys/resource.h>
+#include <time.h>
+
+#include "report.h"
+
+typedef struct PhaseTime
+{
+    double wallStart;
+    double cpuStart;
+    double wall; // seconds
+    double cpu;  // seconds
+} PhaseTime;
+
+static PhaseTime phaseTimes[PHASE_COUNT] = {0};
+
+static const char *phaseNames[PHASE_COUNT] = {
+    "parse",
+    "symbols",
+    "symbol_dump",
+    "codegen",
+    "output",
+    "destroy"};
+
+static double wallSeconds(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec * 1e-9;
+}
+
+static double cpuSeconds(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &now);
+    return now.tv_sec + now.tv_nsec * 1e-9;
+}
+
+// Starts timing a phase
+void phaseBegin(const Phase phase)
+{
+    phaseTimes[phase].wallStart = wallSeconds();
+    phaseTimes[phase].cpuStart = cpuSeconds();
+}
+
+// Stops timing a phase, a phase may be timed more than once and accumulates
+void phaseEnd(const Phase phase)
+{
+    phaseTimes[phase].wall += wallSeconds() - phaseTimes[phase].wallStart;
+    phaseTimes[phase].cpu += cpuSeconds() - phaseTimes[phase].cpuStart;
+}
+
+// peak resident set size of the process in KiB
+static long peakRssKib(void)
+{
+    // ru_maxrss survives exec on Linux, so it would report the parent's peak
+    // when that was larger. VmHWM only covers this address space.
+    FILE *status = fopen("/proc/self/status", "r");
+    if (status != NULL)
+    {
+        char line[128];
+        long hwm = -1;
+        while (fgets(line, sizeof(line), status) != NULL)
+        {
+            if (sscanf(line, "VmHWM: %ld kB", &hwm) == 1)
+            {
+                break;
+            }
+        }
+        fclose(status);
+        if (hwm >= 0)
+        {
+            return hwm;
+        }
+    }
+
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0)
+    {
+        return 0;
+    }
+    return usage.ru_maxrss;
+}
+
+// Prints the requested reports, first as a table then as a single line of JSON
+void reportPrint(FILE *file, const MemoryStats *stats, const bool timeReport, const bool memReport)
+{
+    double totalWall = 0;
+    double totalCpu = 0;
+    for (size_t i = 0; i < PHASE_COUNT; i++)
+    {
+        totalWall += phaseTimes[i].wall;
+        totalCpu += phaseTimes[i].cpu;
+    }
+    long peakRss = peakRssKib();
+
+    if (timeReport)
+    {
+        fprintf(file, "Time report:\n");
+        fprintf(file, "  %-12s %12s %12s %7s\n", "phase", "wall (ms)", "cpu (ms)", "wall %");
+        for (size_t i = 0; i < PHASE_COUNT; i++)
+        {
+            double share = totalWall > 0 ? 100 * phaseTimes[i].wall / totalWall : 0;
+            fprintf(file, "  %-12s %12.3f %12.3f %6.1f%%\n", phaseNames[i], phaseTimes[i].wall * 1e3, phaseTimes[i].cpu * 1e3, share);
+        }
+        fprintf(file, "  %-12s %12.3f %12.3f\n", "total", totalWall * 1e3, totalCpu * 1e3);
+    }
+    if (memReport)
+    {
+        fprintf(file, "Memory report:\n");
+        fprintf(file, "  %-20s %zu\n", "AST allocations", stats->astAllocations);
+        fprintf(file, "  %-20s %zu\n", "AST arena bytes", stats->astArenaBytes);
+        fprintf(file, "  %-20s %zu\n", "interned strings", stats->internedStrings);
+        fprintf(file, "  %-20s %zu\n", "intern bytes", stats->internBytes);
+        fprintf(file, "  %-20s %zu\n", "symbol tables", stats->symbolTables);
+        fprintf(file, "  %-20s %zu\n", "symbol entries", stats->symbolEntries);
+        fprintf(file, "  %-20s %zu\n", "output bytes", stats->outputBytes);
+        fprintf(file, "  %-20s %ld\n", "peak RSS (KiB)", peakRss);
+    }
+
+    fprintf(file, "{");
+    if (timeReport)
+    {
+        fprintf(file, "\"phases\":{");
+        for (size_t i = 0; i < PHASE_COUNT; i++)
+        {
+            fprintf(file, "%s\"%s\":{\"wall_ms\":%.3f,\"cpu_ms\":%.3f}", i == 0 ? "" : ",", phaseNames[i], phaseTimes[i].wall * 1e3, phaseTimes[i].cpu * 1e3);
+        }
+        fprintf(file, "},\"total\":{\"wall_ms\":%.3f,\"cpu_ms\":%.3f}", totalWall * 1e3, totalCpu * 1e3);
+    }
+    if (memReport)
+    {
+        fprintf(file, "%s\"memory\":{\"ast_allocations\":%zu,\"ast_arena_bytes\":%zu,\"interned_strings\":%zu,\"intern_bytes\":%zu,"
+                      "\"symbol_tables\":%zu,\"symbol_entries\":%zu,\"output_bytes\":%zu,\"peak_rss_kib\":%ld}",
+                timeReport ? "," : "", stats->astAllocations, stats->astArenaBytes, stats->internedStrings, stats->internBytes,
+                stats->symbolTables, stats->symbolEntries, stats->outputBytes, peakRss);
+    }
+    fprintf(file, "}\n");
+}
@@ -0,0 +1,36 @@
+#ifndef REPORT_H
+#define REPORT_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+
+// compiler phases timed by -ftime-report, in the order they run
+typedef enum
+{
+    PARSE_PHASE,       // lexing and parsing
+    SYMBOL_PHASE,      // symbol table population and type resolution
+    SYMBOL_DUMP_PHASE, // printing the symbol table
+    CODEGEN_PHASE,
+    OUTPUT_PHASE, // flushing and closing the output file
+    DESTROY_PHASE,
+    PHASE_COUNT
+} Phase;
+
+// counters printed by -fmem-report
+typedef struct MemoryStats
+{
+    size_t astAllocations;
+    size_t astArenaBytes; // peak bytes reserved by the AST arena
+    size_t internedStrings;
+    size_t internBytes;
+    size_t symbolTables;
+    size_t symbolEntries;
+    size_t outputBytes;
+} MemoryStats;
+
+void phaseBegin(Phase phase);
+void phaseEnd(Phase phase);
+void reportPrint(FILE *file, const MemoryStats *stats, bool timeReport, bool memReport);
+
+#endif
@@ -1,7 +1,10 @@
 #include <stddef.h>
+#include <stdint.h>
 #include <stdlib.h>
 
+#include "arena.h"
 #include "ast.h"
+#include "intern.h"
 #include "symbol.h"
 #include <stdio.h>
 #include <string.h>
@@ -10,6 +13,12 @@ size_t whileCount = 0;
 size_t switchCount = 0;
 size_t forCount = 0;
 
+#define SYMBOL_ARENA_BLOCK_SIZE (4 * 1024)
+
+// Struct specifiers the symbol entries refer to, copied out of the AST arena that is reset
+// after every external declaration, freed with the global table
+static Arena *symbolArena = NULL;
+
 // returns the value of integer expressions (only works for constant expressions)
 int evaluateIntConstExpr(Expr *expr)
 {
@@ -17,13 +26,17 @@ int evaluateIntConstExpr(Expr *expr)
     {
     case CONSTANT_EXPR:
     {
+        if (expr->constant->type == CHAR_TYPE)
+        {
+            return (unsigned char)expr->constant->char_const;
+        }
         return expr->constant->int_const;
     }
     case OPERATION_EXPR:
     {
         int op1 = evaluateIntConstExpr(expr->operation->op1);
-        int op2;
-        int op3;
+        int op2 = 0;
+        int op3 = 0;
         if(expr->operation->op2 != NULL)
         {
             op2 = evaluateIntConstExpr(expr->operation->op2);
@@ -35,17 +48,27 @@ int evaluateIntConstExpr(Expr *expr)
 
         switch(expr->operation->operator)
         {
-            case ADD:
+            case ADD: // also unary plus and minus, where op2 stays 0
                 return op1 + op2;
             case SUB:
-                return op1 - op2;
+                return expr->operation->op2 == NULL ? -op1 : op1 - op2;
             case MUL:
                 return op1 * op2;
             case DIV:
+                if (op2 == 0)
+                {
+                    fprintf(stderr, "Division by zero in constant expression, exiting...\n");
+                    exit(EXIT_FAILURE);
+                }
                 return op1 / op2;
             case AND:
                 return op1 && op2;
             case MOD:
+                if (op2 == 0)
+                {
+                    fprintf(stderr, "Division by zero in constant expression, exiting...\n");
+                    exit(EXIT_FAILURE);
+                }
                 return op1 % op2;
             case OR:
                 return op1 || op2;
@@ -89,47 +112,134 @@ int evaluateIntConstExpr(Expr *expr)
         }
     }
     }
+    fprintf(stderr, "Expression is not an integer constant, exiting...\n");
+    exit(EXIT_FAILURE);
+}
+
+// Whether a constant expression has a floating type in C, a floating constant or arithmetic on
+// one. Comparisons and logical operators give an int whatever their operands.
+static bool isFloatingConstExpr(Expr *expr)
+{
+    if (expr->type == CONSTANT_EXPR)
+    {
+        return expr->constant->type == FLOAT_TYPE;
+    }
+    if (expr->type != OPERATION_EXPR)
+    {
+        return false;
+    }
+    OperationExpr *operation = expr->operation;
+    switch (operation->operator)
+    {
+    case ADD:
+    case SUB:
+    case MUL:
+    case DIV:
+        return isFloatingConstExpr(operation->op1) || (operation->op2 != NULL && isFloatingConstExpr(operation->op2));
+    case TERN:
+        return isFloatingConstExpr(operation->op2) || isFloatingConstExpr(operation->op3);
+    default:
+        return false;
+    }
+}
+
+// Whether a floating constant appears anywhere in a constant expression
+static bool hasFloatingConst(Expr *expr)
+{
+    if (expr->type == CONSTANT_EXPR)
+    {
+        return expr->constant->type == FLOAT_TYPE;
+    }
+    if (expr->type != OPERATION_EXPR)
+    {
+        return false;
+    }
+    OperationExpr *operation = expr->operation;
+    return hasFloatingConst(operation->op1) || (operation->op2 != NULL && hasFloatingConst(operation->op2)) ||
+           (operation->op3 != NULL && hasFloatingConst(operation->op3));
 }
 
 // returns the value of float expressions (only works for constant expressions)
 float evaluateFloatConstExpr(Expr *expr)
+{
+    // C's floating constants are doubles, so the initializer is folded in double and rounded once
+    return (float)evaluateDoubleConstExpr(expr);
+}
+
+// returns the value of arithmetic constant expressions in double precision. Integer parts are
+// folded as ints, and only converted where they meet a floating operand, like C would
+double evaluateDoubleConstExpr(Expr *expr)
 {
     switch (expr->type)
     {
     case CONSTANT_EXPR:
     {
-        return expr->constant->float_const;
+        if (expr->constant->type == FLOAT_TYPE)
+        {
+            return expr->constant->float_const;
+        }
+        return evaluateIntConstExpr(expr);
     }
     case OPERATION_EXPR:
     {
-        float op1 = evaluateFloatConstExpr(expr->operation->op1);
-        float op2;
-        float op3;
+        if (!hasFloatingConst(expr))
+        {
+            return evaluateIntConstExpr(expr);
+        }
+        // an int typed operation can still have floating constants below a comparison
+        bool isInt = !isFloatingConstExpr(expr);
+        double op1 = evaluateDoubleConstExpr(expr->operation->op1);
+        double op2 = 0;
+        double op3 = 0;
         if(expr->operation->op2 != NULL)
         {
-            op2 = evaluateFloatConstExpr(expr->operation->op2);
+            op2 = evaluateDoubleConstExpr(expr->operation->op2);
         }
         if(expr->operation->op3 != NULL)
         {
-            op3 = evaluateFloatConstExpr(expr->operation->op3);
+            op3 = evaluateDoubleConstExpr(expr->operation->op3);
         }
 
         switch(expr->operation->operator)
         {
-            case ADD:
+            case ADD: // also unary plus and minus, where op2 stays 0
                 return op1 + op2;
             case SUB:
-                return op1 - op2;
+                return expr->operation->op2 == NULL ? -op1 : op1 - op2;
             case MUL:
                 return op1 * op2;
             case DIV:
-                return op1 / op2;
+                if (op2 == 0)
+                {
+                    fprintf(stderr, "Division by zero in constant expression, exiting...\n");
+                    exit(EXIT_FAILURE);
+                }
+                return isInt ? (int)op1 / (int)op2 : op1 / op2;
+            case MOD:
+                if ((int)op2 == 0)
+                {
+                    fprintf(stderr, "Division by zero in constant expression, exiting...\n");
+                    exit(EXIT_FAILURE);
+                }
+                return (int)op1 % (int)op2;
             case AND:
                 return op1 && op2;
             case OR:
                 return op1 || op2;
             case NOT:
                 return !op1;
+            case AND_BIT:
+                return (int)op1 & (int)op2;
+            case OR_BIT:
+                return (int)op1 | (int)op2;
+            case NOT_BIT:
+                return ~(int)op1;
+            case XOR:
+                return (int)op1 ^ (int)op2;
+            case LEFT_SHIFT:
+                return (int)op1 << (int)op2;
+            case RIGHT_SHIFT:
+                return (int)op1 >> (int)op2;
             case EQ:
                 return op1 == op2;
             case NE:
@@ -142,23 +252,19 @@ float evaluateFloatConstExpr(Expr *expr)
                 return op1 <= op2;
             case GE:
                 return op1 >= op2;
-            case TERN: // easy
-                if(op1)
-                {
-                    return op2;
-                }
-                else{
-                    return op3;
-                }
-            case SIZEOF_OP:
-                printf("SizeOf Constant Expression Evaluation Not Implemented\n");
+            case TERN:
+                return op1 ? op2 : op3;
+            default:
                 break;
         }
     }
+    default:
+        break;
     }
+    fprintf(stderr, "Expression is not a floating constant, exiting...\n");
+    exit(EXIT_FAILURE);
 }
 
-
 // constructor for symbol entry
 SymbolEntry *symbolEntryCreate(char *ident, size_t storageSize, size_t typeSize, EntryType entryType)
 {
@@ -173,7 +279,7 @@ SymbolEntry *symbolEntryCreate(char *ident, size_t storageSize, size_t typeSize,
     switch (entryType)
     {
     case FUNCTION_ENTRY:
-        symbolEntry->storageSize = storageSize + (4 * (2 + 11 + 7)) + (8 * (12)); // space allocated for ra and fp and s1-s11 and t0-t6 and ft0-ft11
+        symbolEntry->storageSize = storageSize; // the locals, code generation adds the saved registers
         symbolEntry->typeSize = typeSize;
         break;
 
@@ -203,6 +309,7 @@ SymbolEntry *symbolEntryCreate(char *ident, size_t storageSize, size_t typeSize,
         break;
     }
     
+    symbolEntry->stackOffset = 0; // set by entryPush for entries that get a stack slot
     symbolEntry->isGlobal = false;
     symbolEntry->entryType = entryType;
     return symbolEntry;
@@ -211,10 +318,7 @@ SymbolEntry *symbolEntryCreate(char *ident, size_t storageSize, size_t typeSize,
 // destructor for symbol entry
 void symbolEntryDestroy(SymbolEntry *symbolEntry)
 {
-    if (symbolEntry->entryType == WHILE_ENTRY || symbolEntry->entryType == SWITCH_ENTRY || symbolEntry->entryType == FOR_ENTRY)
-    {
-        free(symbolEntry->ident);
-    }
+    // the identifier is interned and owned by the intern table
     free(symbolEntry);
 }
 
@@ -258,6 +362,9 @@ SymbolTable *symbolTableCreate(size_t entryLength, size_t childrenLength, Symbol
     symbolTable->parentTable = parentTable;
     symbolTable->masterFunc = masterFunc; // NULL for global scope
 
+    symbolTable->index = NULL;
+    symbolTable->indexCapacity = 0;
+
     symbolTable->entrySize = entryLength;
     symbolTable->entryCapacity = entryLength;
 
@@ -328,12 +435,68 @@ void childrenListResize(SymbolTable *symbolTable, const size_t childrenLength)
     }
 }
 
+// hashes an interned identifier together with the namespace it is looked up in
+static size_t symbolHash(const char *ident, const EntryType entryType)
+{
+    uint64_t hash = ((uintptr_t)ident >> 3) ^ ((uint64_t)entryType << 59);
+    hash *= 0x9E3779B97F4A7C15u;
+    return (size_t)(hash >> 32);
+}
+
+// inserts an entry into the index, the first entry of a given key wins
+static void indexInsert(SymbolTable *symbolTable, SymbolEntry *symbolEntry)
+{
+    size_t mask = symbolTable->indexCapacity - 1;
+    size_t slot = symbolHash(symbolEntry->ident, symbolEntry->entryType) & mask;
+    while (symbolTable->index[slot] != NULL)
+    {
+        SymbolEntry *other = symbolTable->index[slot];
+        if (other->ident == symbolEntry->ident && other->entryType == symbolEntry->entryType)
+        {
+            return; // linear search would also have returned the earlier entry
+        }
+        slot = (slot + 1) & mask;
+    }
+    symbolTable->index[slot] = symbolEntry;
+}
+
+// (re)builds the index of a table with room for at least twice its entries
+static void indexRebuild(SymbolTable *symbolTable)
+{
+    size_t capacity = 2 * SYMBOL_INDEX_THRESHOLD;
+    while (capacity < 2 * symbolTable->entrySize)
+    {
+        capacity *= 2;
+    }
+    free(symbolTable->index);
+    symbolTable->index = calloc(capacity, sizeof(SymbolEntry *));
+    if (symbolTable->index == NULL)
+    {
+        abort();
+    }
+    symbolTable->indexCapacity = capacity;
+    for (size_t i = 0; i < symbolTable->entrySize; i++)
+    {
+        indexInsert(symbolTable, symbolTable->entries[i]);
+    }
+}
+
 // Adds a symbol table entry to a symbol table
 void entryPush(SymbolTable *symbolTable, SymbolEntry *symbolEntry)
 {
     entryListResize(symbolTable, symbolTable->entrySize + 1);
     symbolTable->entries[symbolTable->entrySize - 1] = symbolEntry;
 
+    // keep the load factor of the index at or under a half
+    if (symbolTable->entrySize >= SYMBOL_INDEX_THRESHOLD && 2 * symbolTable->entrySize > symbolTable->indexCapacity)
+    {
+        indexRebuild(symbolTable);
+    }
+    else if (symbolTable->index != NULL)
+    {
+        indexInsert(symbolTable, symbolEntry);
+    }
+
     // only update stack values of local decls, global is not on the stack
     if (symbolTable->masterFunc != NULL)
     {
@@ -358,6 +521,7 @@ void symbolTableDestroy(SymbolTable *symbolTable)
         symbolEntryDestroy(symbolTable->entries[i]);
     }
     free(symbolTable->entries);
+    free(symbolTable->index);
 
     if (symbolTable->childrenTables != NULL)
     {
@@ -367,27 +531,47 @@ void symbolTableDestroy(SymbolTable *symbolTable)
         }
     }
     free(symbolTable->childrenTables);
+    if (symbolTable->parentTable == NULL && symbolArena != NULL)
+    {
+        arenaDestroy(symbolArena);
+        symbolArena = NULL;
+    }
     free(symbolTable);
 }
 
-// recursively searches upwards through the symbol table for a symbol
+// searches upwards through the symbol table for a symbol
+// Important: ident must be interned, identifiers are compared by pointer
 SymbolEntry *getSymbolEntry(SymbolTable *symbolTable, char *ident, EntryType entryType)
 {
-    // base case
-    if (symbolTable == NULL)
+    size_t hash = symbolHash(ident, entryType);
+    for (; symbolTable != NULL; symbolTable = symbolTable->parentTable)
     {
-        return NULL;
-    }
-    // search current table
-    for (size_t i = 0; i < symbolTable->entrySize; i++)
-    {
-        if (strcmp(symbolTable->entries[i]->ident, ident) == 0 && entryType == symbolTable->entries[i]->entryType)
+        if (symbolTable->index != NULL)
+        {
+            // search the index of a large table
+            size_t mask = symbolTable->indexCapacity - 1;
+            for (size_t slot = hash & mask; symbolTable->index[slot] != NULL; slot = (slot + 1) & mask)
+            {
+                SymbolEntry *symbolEntry = symbolTable->index[slot];
+                if (symbolEntry->ident == ident && symbolEntry->entryType == entryType)
+                {
+                    return symbolEntry;
+                }
+            }
+        }
+        else
         {
-            return symbolTable->entries[i];
+            // search a small table linearly
+            for (size_t i = 0; i < symbolTable->entrySize; i++)
+            {
+                if (symbolTable->entries[i]->ident == ident && entryType == symbolTable->entries[i]->entryType)
+                {
+                    return symbolTable->entries[i];
+                }
+            }
         }
     }
-    // search further tables
-    return getSymbolEntry(symbolTable->parentTable, ident, entryType);
+    return NULL;
 }
 
 // prints a symbol entry to the terminal
@@ -487,6 +671,17 @@ void displaySymbolTable(SymbolTable *symbolTable)
     }
 }
 
+// counts a symbol table and it's children, adding to tables and entries
+void symbolTableCount(SymbolTable *symbolTable, size_t *tables, size_t *entries)
+{
+    *tables += 1;
+    *entries += symbolTable->entrySize;
+    for (size_t i = 0; i < symbolTable->childrenSize; i++)
+    {
+        symbolTableCount(symbolTable->childrenTables[i], tables, entries);
+    }
+}
+
 void scanStmt(Stmt *stmt, SymbolTable *parentTable);
 void scanExpr(Expr *expr, SymbolTable *parentTable);
 
@@ -504,11 +699,99 @@ void scanInitList(InitList *initList, SymbolTable *parentTable)
     }
 }
 
+static void *symbolAlloc(const size_t size)
+{
+    if (symbolArena == NULL)
+    {
+        symbolArena = arenaCreate(SYMBOL_ARENA_BLOCK_SIZE);
+    }
+    return arenaAlloc(symbolArena, size);
+}
+
+static StructSpecifier *keepStructSpecifier(const StructSpecifier *spec);
+
+// The type of a symbol entry, which outlives the AST its declaration came from
+static TypeSpecifier keepType(const TypeSpecifier *type)
+{
+    TypeSpecifier kept = *type;
+    kept.structSpecifier = type->isStruct ? keepStructSpecifier(type->structSpecifier) : NULL;
+    return kept;
+}
+
+static Expr *keepIntConst(Expr *expr)
+{
+    if (expr == NULL)
+    {
+        return NULL;
+    }
+    Expr *kept = symbolAlloc(sizeof(Expr));
+    kept->type = CONSTANT_EXPR;
+    kept->constant = symbolAlloc(sizeof(ConstantExpr));
+    kept->constant->int_const = evaluateIntConstExpr(expr);
+    kept->constant->type = INT_TYPE;
+    kept->constant->isString = false;
+    return kept;
+}
+
+// Copies the layout of a struct, its members' types, names, array sizes and bit field
+// widths, into the symbol arena. The sizes and widths are kept as their values.
+static StructSpecifier *keepStructSpecifier(const StructSpecifier *spec)
+{
+    if (spec == NULL)
+    {
+        return NULL;
+    }
+    StructSpecifier *kept = symbolAlloc(sizeof(StructSpecifier));
+    kept->ident = spec->ident; // interned
+    kept->structDeclList = NULL;
+    if (spec->structDeclList == NULL)
+    {
+        return kept;
+    }
+    const StructDeclList *members = spec->structDeclList;
+    kept->structDeclList = symbolAlloc(sizeof(StructDeclList));
+    kept->structDeclList->structDeclListSize = members->structDeclListSize;
+    kept->structDeclList->structDeclListCapacity = members->structDeclListSize;
+    kept->structDeclList->structDecls = symbolAlloc(sizeof(StructDecl *) * (members->structDeclListSize + 1));
+    for (size_t i = 0; i < members->structDeclListSize; i++)
+    {
+        const StructDecl *member = members->structDecls[i];
+        StructDecl *keptMember = symbolAlloc(sizeof(StructDecl));
+        keptMember->typeSpecList = NULL;
+        if (member->typeSpecList != NULL)
+        {
+            const TypeSpecList *types = member->typeSpecList;
+            keptMember->typeSpecList = symbolAlloc(sizeof(TypeSpecList));
+            keptMember->typeSpecList->typeSpecSize = types->typeSpecSize;
+            keptMember->typeSpecList->typeSpecCapacity = types->typeSpecSize;
+            keptMember->typeSpecList->typeSpecs = symbolAlloc(sizeof(TypeSpecifier *) * (types->typeSpecSize + 1));
+            for (size_t j = 0; j < types->typeSpecSize; j++)
+            {
+                TypeSpecifier *type = symbolAlloc(sizeof(TypeSpecifier));
+                *type = keepType(types->typeSpecs[j]);
+                keptMember->typeSpecList->typeSpecs[j] = type;
+            }
+        }
+        keptMember->declarator = NULL;
+        if (member->declarator != NULL)
+        {
+            keptMember->declarator = symbolAlloc(sizeof(Declarator));
+            *keptMember->declarator = *member->declarator;
+            keptMember->declarator->parameterList.size = 0;
+            keptMember->declarator->parameterList.capacity = 0;
+            keptMember->declarator->parameterList.decls = NULL;
+            keptMember->declarator->arraySize = keepIntConst(member->declarator->arraySize);
+        }
+        keptMember->bitField = keepIntConst(member->bitField);
+    }
+    return kept;
+}
+
 // declaration second pass
 void scanDecl(Decl *decl, SymbolTable *symbolTable)
 {
     char *ident = decl->declInit->declarator->ident;
-    TypeSpecifier type = *(decl->typeSpecList->typeSpecs[0]); // assumes a list of length 1 after type flattening stuff
+    TypeSpecifier type = keepType(decl->typeSpecList->typeSpecs[0]); // assumes a list of length 1 after type flattening stuff
     SymbolEntry *symbolEntry;
 
     if (decl->declInit->declarator->isArray)
@@ -675,17 +958,12 @@ void scanExpr(Expr *expr, SymbolTable *parentTable)
     }
 }
 
-// converts an integer to a string
-char *IntToStr(int integer)
+// converts an integer to an interned string
+char *IntToStr(size_t integer)
 {
-    int strSize = snprintf(NULL, 0, "%lu", integer);
-    char *string = malloc((strSize + 1) * sizeof(char));
-    if (string == NULL)
-    {
-        abort();
-    }
-    sprintf(string, "%lu", integer);
-    return string;
+    char string[24];
+    int strSize = snprintf(string, sizeof(string), "%zu", integer);
+    return internStr(string, strSize);
 }
 
 // switch statement second pass
@@ -851,7 +1129,7 @@ void scanFuncDef(FuncDef *funcDef, SymbolTable *parentTable)
 {
     // new function def symbol entry
     SymbolEntry *funcDefEntry = symbolEntryCreate(funcDef->ident, 0, 0, FUNCTION_ENTRY);
-    funcDefEntry->type = *(funcDef->retType->typeSpecs[0]);
+    funcDefEntry->type = keepType(funcDef->retType->typeSpecs[0]);
     funcDefEntry->isGlobal = true;
     entryPush(parentTable, funcDefEntry);
     funcDef->symbolEntry = funcDefEntry;
@@ -895,7 +1173,7 @@ void scanTransUnit(TranslationUnit *transUnit, SymbolTable *parentTable)
         {
             scanFuncDef(transUnit->externDecls[i]->funcDef, parentTable);
         }
-        else
+        else if (transUnit->externDecls[i]->decl->declInit != NULL) // struct declarations declare no symbol
         {
             scanDecl(transUnit->externDecls[i]->decl, parentTable);
         }
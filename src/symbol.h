@@ -5,6 +5,9 @@
 #include <stdbool.h>
 #include <stddef.h>
 
+// scopes smaller than this are searched linearly, hashing them costs more than it saves
+#define SYMBOL_INDEX_THRESHOLD 8
+
 typedef enum EntryType
 {
     FUNCTION_ENTRY,
@@ -37,6 +40,11 @@ typedef struct SymbolTable
     size_t entrySize;
     size_t entryCapacity;
 
+    // open addressing index over entries keyed by (ident, entryType)
+    // NULL until the table holds SYMBOL_INDEX_THRESHOLD entries
+    SymbolEntry **index;
+    size_t indexCapacity;
+
     SymbolTable **childrenTables;
     size_t childrenSize;
     size_t chldrenCapacity;
@@ -51,6 +59,7 @@ void childrenListResize(SymbolTable *symbolTable, size_t childrenLength);
 
 void displaySymbolTable(SymbolTable *symbolTable);
 void displaySymbolEntry(SymbolEntry *symbolEntry);
+void symbolTableCount(SymbolTable *symbolTable, size_t *tables, size_t *entries);
 
 size_t storageSize(DataType type);
 
@@ -60,9 +69,11 @@ void childTablePush(SymbolTable *symbolTable, SymbolTable *childTable);
 
 SymbolEntry *getSymbolEntry(SymbolTable *symbolTable, char *ident, EntryType EntryType);
 
+void scanTransUnit(TranslationUnit *transUnit, SymbolTable *parentTable);
 SymbolTable *populateSymbolTable(TranslationUnit *rootExpr);
 
 size_t typeSize(DataType type);
 int evaluateIntConstExpr(Expr *expr);
 float evaluateFloatConstExpr(Expr *expr);
+double evaluateDoubleConstExpr(Expr *expr);
 #endif